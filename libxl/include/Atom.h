@@ -0,0 +1,177 @@
+#ifndef XL_ATOM_H
+#define XL_ATOM_H
+/**
+ * Atoms: the names interned once in CAtomTable, and then compared, hashed
+ * and copied as small integers. The id of a name never changes and the
+ * name is never freed, so an atom can be kept anywhere.
+ *
+ * The names known by libxl (the style properties) are interned first, in
+ * the order of XL_KNOWN_ATOMS, so their ids are constants at compile time
+ * and can be switched on:
+ *
+ *	switch (key.getId()) {
+ *	case KA_WIDTH:
+ *		...
+ *	}
+ *
+ * The other names are interned at run time, once:
+ *
+ *	static const CAtom s_myProperty(_T("my-property"));
+ *	if (key == s_myProperty) {
+ *		...
+ *	}
+ *
+ * As the names are never freed, the atoms are for a fixed vocabulary, such
+ * as the style properties, not for the names read from the data (the
+ * sections of an ini, say), which would grow the table without bound.
+ */
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include "common.h"
+#include "string.h"
+#include "lockable.h"
+XL_BEGIN
+
+#define XL_KNOWN_ATOMS(ATOM) \
+	ATOM(WIDTH,                      "width") \
+	ATOM(HEIGHT,                     "height") \
+	ATOM(POSITION,                   "position") \
+	ATOM(PX,                         "px") \
+	ATOM(PY,                         "py") \
+	ATOM(FLOAT,                      "float") \
+	ATOM(MARGIN,                     "margin") \
+	ATOM(PADDING,                    "padding") \
+	ATOM(BORDER,                     "border") \
+	ATOM(BORDER_TOP,                 "border-top") \
+	ATOM(BORDER_RIGHT,               "border-right") \
+	ATOM(BORDER_BOTTOM,              "border-bottom") \
+	ATOM(BORDER_LEFT,                "border-left") \
+	ATOM(BACKGROUND,                 "background") \
+	ATOM(BACKGROUND_COLOR,           "background-color") \
+	ATOM(BACKGROUND_IMAGE_ID,        "background-image-id") \
+	ATOM(BACKGROUND_IMAGE_URL,       "background-image-url") \
+	ATOM(OPACITY,                    "opacity") \
+	ATOM(FONT_WEIGHT,                "font-weight") \
+	ATOM(FONT_SIZE,                  "font-size") \
+	ATOM(COLOR,                      "color") \
+	ATOM(DISPLAY,                    "display") \
+	ATOM(DISABLE,                    "disable") \
+	ATOM(SLIDER,                     "slider") \
+	ATOM(THUMBNAIL_MIN_WIDTH,        "thumbnail-min-width") \
+	ATOM(GESTURE_SENSITIVITY,        "gesture-sensitivity") \
+	ATOM(GESTURE_TIMEOUT,            "gesture-timeout") \
+	ATOM(GESTURE_LINE_WIDTH,         "gesture-line-width") \
+	ATOM(BUTTON_IMAGE,               "button-image") \
+	ATOM(BUTTON_IMAGE_TEXT_PADDING,  "button-image-text-padding") \
+	ATOM(IMAGEBUTTON_IMAGE,          "imagebutton-image")
+
+enum KNOWN_ATOM {
+	KA_NONE = 0, // ""
+#define XL_ATOM_ENUM(id, name) KA_##id,
+	XL_KNOWN_ATOMS(XL_ATOM_ENUM)
+#undef XL_ATOM_ENUM
+	KA_COUNT
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CAtomTable
+
+class CAtomTable
+{
+protected:
+	struct _Hash {
+		size_t operator () (const tstring_view &name) const;
+	};
+	typedef std::unordered_map<tstring_view, uint, _Hash> _IdMap;
+
+	std::deque<tstring>                                   m_names;       // never moved, the views point into them
+	std::vector<tstring_view>                             m_views;       // of the ids
+	_IdMap                                                m_ids;
+	CReadWriteLock                                        m_lock;
+
+	CAtomTable ();
+	CAtomTable (const CAtomTable &);
+	CAtomTable& operator = (const CAtomTable &);
+
+	uint _Add (const tstring_view &name);
+
+public:
+	static CAtomTable* getInstance ();
+
+	/**
+	 * @return the id of the name, interned if it is not yet
+	 */
+	uint intern (const tstring_view &name);
+	/**
+	 * @return the id of the name, or KA_NONE if it is not interned
+	 */
+	uint find (const tstring_view &name) const;
+	/**
+	 * the view is valid as long as the process
+	 */
+	tstring_view getName (uint id) const;
+	size_t getCount () const;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CAtom
+
+class CAtom
+{
+	uint                                                  m_id;
+
+public:
+	CAtom () : m_id(KA_NONE) {}
+	CAtom (KNOWN_ATOM known) : m_id(known) {}
+	/**
+	 * intern the name
+	 */
+	explicit CAtom (const tstring_view &name) : m_id(CAtomTable::getInstance()->intern(name)) {}
+	explicit CAtom (const tchar *name) : m_id(CAtomTable::getInstance()->intern(name)) {}
+	explicit CAtom (const tstring &name) : m_id(CAtomTable::getInstance()->intern(tstring_view(name.data(), name.length()))) {}
+
+	/**
+	 * the atom of the name if it is interned, or the empty one, the table
+	 * does not grow by the names never used
+	 */
+	static CAtom find (const tstring_view &name) {
+		CAtom atom;
+		atom.m_id = CAtomTable::getInstance()->find(name);
+		return atom;
+	}
+
+	uint getId () const {
+		return m_id;
+	}
+	bool empty () const {
+		return m_id == KA_NONE;
+	}
+	tstring_view getName () const {
+		return CAtomTable::getInstance()->getName(m_id);
+	}
+
+	/**
+	 * by the id, not the name
+	 */
+	bool operator < (const CAtom &rhs) const {
+		return m_id < rhs.m_id;
+	}
+	bool operator == (const CAtom &rhs) const {
+		return m_id == rhs.m_id;
+	}
+	bool operator != (const CAtom &rhs) const {
+		return m_id != rhs.m_id;
+	}
+
+	struct Hash {
+		size_t operator () (const CAtom &atom) const {
+			return atom.m_id;
+		}
+	};
+};
+
+XL_END
+#endif
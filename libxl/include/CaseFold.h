@@ -0,0 +1,66 @@
+#ifndef XL_CASEFOLD_H
+#define XL_CASEFOLD_H
+/**
+ * Case insensitive compare, equality and hash, consistent with each other,
+ * so the case insensitive keys can be in a hash map as well as in std::map:
+ *
+ *	std::unordered_map<tstring, tstring, string_ihash<tstring>, string_iequal_to<tstring> > values;
+ *
+ * wchar_t is folded by the simple case folding of Unicode (the BMP), char by
+ * ASCII only, as _stricmp() in the "C" locale. The ASCII letters are folded
+ * 16 bytes at a time (SSE2), so the other characters cost only where they are.
+ */
+#include <functional>
+#include "common.h"
+XL_BEGIN
+
+char fold_case (char c);
+wchar_t fold_case (wchar_t c);
+/**
+ * fold s[0, n) into dst[0, n), dst may be s
+ */
+void fold_case (const char *s, size_t n, char *dst);
+void fold_case (const wchar_t *s, size_t n, wchar_t *dst);
+
+/**
+ * compare the folded characters as unsigned
+ * @return < 0, 0 or > 0 as strcmp()
+ */
+int icompare (const char *lhs, size_t lhsLength, const char *rhs, size_t rhsLength);
+int icompare (const wchar_t *lhs, size_t lhsLength, const wchar_t *rhs, size_t rhsLength);
+bool iequals (const char *lhs, size_t lhsLength, const char *rhs, size_t rhsLength);
+bool iequals (const wchar_t *lhs, size_t lhsLength, const wchar_t *rhs, size_t rhsLength);
+/**
+ * the hash of the folded characters, the strings iequals() have the same hash
+ */
+size_t ihash (const char *s, size_t n);
+size_t ihash (const wchar_t *s, size_t n);
+
+
+//////////////////////////////////////////////////////////////////////////
+// functors of the strings which have data() and length(), such as xl::tstring
+// and xl::tstring_view
+
+template <class T>
+struct string_iless : public std::binary_function<T, T, bool> {
+	bool operator () (const T &lhs, const T &rhs) const {
+		return icompare(lhs.data(), lhs.length(), rhs.data(), rhs.length()) < 0;
+	}
+};
+
+template <class T>
+struct string_iequal_to : public std::binary_function<T, T, bool> {
+	bool operator () (const T &lhs, const T &rhs) const {
+		return iequals(lhs.data(), lhs.length(), rhs.data(), rhs.length());
+	}
+};
+
+template <class T>
+struct string_ihash : public std::unary_function<T, size_t> {
+	size_t operator () (const T &s) const {
+		return ihash(s.data(), s.length());
+	}
+};
+
+XL_END
+#endif
@@ -0,0 +1,80 @@
+#ifndef XL_CHARSCAN_H
+#define XL_CHARSCAN_H
+/**
+ * Find the first or the last character of a string which is (or is not) in a
+ * small set of characters, 16 bytes at a time. They are the kernels of trim(),
+ * basic_string_view::find_xxx_of() and so CSplitterT and the ini parser.
+ *
+ * The bytes are compared to each character of the set with SSE2, or looked up
+ * in a bitmap of the 256 values with pshufb (SSSE3) for the larger sets. The
+ * wchar_t are compared with SSE2 8 at a time. The others fall back to a scalar
+ * lookup table.
+ *
+ * CharScanT picks them for std::char_traits<char> and <wchar_t>, other traits
+ * (which may compare otherwise) use the plain loops.
+ */
+#include <string>
+#include "common.h"
+XL_BEGIN
+
+/**
+ * @return the position of the first character of s[0, n) in set[0, setLength), or (size_t)-1
+ */
+size_t scan_first_of (const char *s, size_t n, const char *set, size_t setLength);
+size_t scan_first_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength);
+size_t scan_first_not_of (const char *s, size_t n, const char *set, size_t setLength);
+size_t scan_first_not_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength);
+size_t scan_last_of (const char *s, size_t n, const char *set, size_t setLength);
+size_t scan_last_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength);
+size_t scan_last_not_of (const char *s, size_t n, const char *set, size_t setLength);
+size_t scan_last_not_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength);
+
+
+//////////////////////////////////////////////////////////////////////////
+// CharScanT
+
+template <class CharT, class Traits>
+struct CharScanT {
+	static bool _In (CharT c, const CharT *set, size_t setLength) {
+		return Traits::find(set, setLength, c) != NULL;
+	}
+	static size_t first (const CharT *s, size_t n, const CharT *set, size_t setLength, bool of) {
+		for (size_t i = 0; i < n; ++ i) {
+			if (_In(s[i], set, setLength) == of) {
+				return i;
+			}
+		}
+		return (size_t)-1;
+	}
+	static size_t last (const CharT *s, size_t n, const CharT *set, size_t setLength, bool of) {
+		for (size_t i = n; i > 0; -- i) {
+			if (_In(s[i - 1], set, setLength) == of) {
+				return i - 1;
+			}
+		}
+		return (size_t)-1;
+	}
+};
+
+template <>
+struct CharScanT<char, std::char_traits<char> > {
+	static size_t first (const char *s, size_t n, const char *set, size_t setLength, bool of) {
+		return of ? scan_first_of(s, n, set, setLength) : scan_first_not_of(s, n, set, setLength);
+	}
+	static size_t last (const char *s, size_t n, const char *set, size_t setLength, bool of) {
+		return of ? scan_last_of(s, n, set, setLength) : scan_last_not_of(s, n, set, setLength);
+	}
+};
+
+template <>
+struct CharScanT<wchar_t, std::char_traits<wchar_t> > {
+	static size_t first (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength, bool of) {
+		return of ? scan_first_of(s, n, set, setLength) : scan_first_not_of(s, n, set, setLength);
+	}
+	static size_t last (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength, bool of) {
+		return of ? scan_last_of(s, n, set, setLength) : scan_last_not_of(s, n, set, setLength);
+	}
+};
+
+XL_END
+#endif
@@ -0,0 +1,98 @@
+#ifndef XL_FILEMAPPING_H
+#define XL_FILEMAPPING_H
+/**
+ * A file backed memory, so large buffers page through the OS file cache
+ * instead of the heap and the page file.
+ */
+#include <Windows.h>
+#include "common.h"
+#include "string.h"
+XL_BEGIN
+
+class CFileMapping
+{
+	HANDLE                                         m_hFile;
+	HANDLE                                         m_hMapping;
+	uint64                                         m_size;
+	bool                                           m_copyOnWrite;
+
+	CFileMapping (const CFileMapping &);
+	CFileMapping& operator = (const CFileMapping &);
+
+	bool _Create (HANDLE hFile, uint64 size, bool copyOnWrite = false);
+
+public:
+	/**
+	 * the access pattern hints, like madvise()
+	 */
+	enum ADVICE {
+		ADV_NORMAL = 0,
+		ADV_SEQUENTIAL,  // the file is read mostly from the beginning to the end
+		ADV_WILLNEED,    // read the pages in now (Windows 8 and later)
+		ADV_DONTNEED,    // drop the pages from the working set, dirty pages are written back to the file
+		ADV_COUNT
+	};
+
+	CFileMapping ();
+	~CFileMapping ();
+
+	/**
+	 * create a temporary file, it is deleted when closed
+	 * @param dir The directory of the file, NULL for the temp directory
+	 * @param advice ADV_SEQUENTIAL opens the file for sequential scan
+	 */
+	bool createTemp (uint64 size, ADVICE advice = ADV_NORMAL, const tchar *dir = NULL);
+	/**
+	 * create (or truncate) a named file, it is kept when closed
+	 */
+	bool create (const tstring &path, uint64 size, ADVICE advice = ADV_NORMAL);
+	/**
+	 * open an existing file read only, the views are copied on write:
+	 * the written pages become private and the file never changes
+	 */
+	bool open (const tstring &path, ADVICE advice = ADV_NORMAL);
+	/**
+	 * open a named file for reading and writing, it is created if missing and grown
+	 * to size if smaller, and kept when closed. The views are coherent with the views
+	 * of the other processes mapping the file.
+	 */
+	bool openShared (const tstring &path, uint64 size, ADVICE advice = ADV_NORMAL);
+	/**
+	 * create a section backed by the page file, committed at once
+	 * @param largePages Try large pages first, which needs SeLockMemoryPrivilege
+	 *        enabled, the size is rounded up to the large page minimum then
+	 */
+	bool createAnonymous (uint64 size, bool largePages = false);
+	void close ();
+
+	bool isOpen () const;
+	/**
+	 * false for createAnonymous()
+	 */
+	bool hasFile () const;
+	uint64 getSize () const;
+	/**
+	 * the section handle, such as for CreateDIBSection()
+	 */
+	HANDLE getHandle () const;
+
+	/**
+	 * @param offset must be a multiple of the allocation granularity (64K)
+	 * @param size 0 maps to the end of the file
+	 */
+	void* map (uint64 offset = 0, size_t size = 0);
+	static void unmap (void *view);
+
+	/**
+	 * hint the pages of a mapped range, ADV_SEQUENTIAL and ADV_NORMAL do nothing here
+	 */
+	static void advise (void *addr, size_t len, ADVICE advice);
+
+	/**
+	 * 0 if large pages are not supported
+	 */
+	static size_t getLargePageMinimum ();
+};
+
+XL_END
+#endif
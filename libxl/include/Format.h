@@ -0,0 +1,338 @@
+#ifndef XL_FORMAT_H
+#define XL_FORMAT_H
+/**
+ * Formatting by the formats of printf(), with the types of the arguments
+ * known to the compiler: an argument is a CFormatArg, which is built from the
+ * integers, the floating points, the characters, the pointers and the strings
+ * (C strings, string and string_view, narrow or wide) only, so any other type
+ * is a compile error, and a "%s" of an integer formats the integer instead
+ * of crashing. A number is converted to the conversion: an integer of "%f"
+ * to a double, a double of "%d" or "%x" truncated to an integer.
+ *
+ * The format is read once, while the text is appended into a CStringBuilderT,
+ * there is no pass to measure:
+ *
+ *	CStringBuilder sb;
+ *	format_to(sb, _T("%s: %.2fms on thread %u\n"), name, ms, thread);
+ *	tstring s = format(_T("%d items"), count);
+ *
+ * The conversions are %d %i %u %x %X %o %c %s %f %F %e %E %g %G %p and %%, the
+ * flags are '-', '+', ' ', '#' and '0', the width and the precision are
+ * numbers ('*' is not supported), and the length modifiers (h, l, ll, I64,
+ * z...) are skipped, the type comes from the argument. The precision of the
+ * floating points is 17 at most, the ties exact in binary are rounded away
+ * from zero (see format_double()), where printf() may round them to even.
+ *
+ * There are 0 to 8 arguments, by the overloads of XL_FORMAT_OVERLOADS().
+ */
+#include <assert.h>
+#include "common.h"
+#include "string.h"
+#include "StringBuilder.h"
+XL_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// FormatSpec, "%-08.3f" and so on
+
+struct FormatSpec {
+	bool                                                  left;          // '-'
+	bool                                                  zero;          // '0'
+	bool                                                  alternate;     // '#'
+	char                                                  sign;          // '+', ' ' or 0
+	size_t                                                width;
+	int                                                   precision;     // -1 if none
+	char                                                  conversion;    // 'd', 's', 'f'...
+
+	FormatSpec ()
+		: left(false), zero(false), alternate(false), sign(0)
+		, width(0), precision(-1), conversion('s') {}
+};
+
+/**
+ * parse the spec after '%', to the conversion character included
+ * @return the character after the spec
+ */
+const char* parse_format_spec (const char *p, FormatSpec &spec);
+const wchar_t* parse_format_spec (const wchar_t *p, FormatSpec &spec);
+
+
+//////////////////////////////////////////////////////////////////////////
+// CFormatArg
+
+class CFormatArg
+{
+public:
+	enum TYPE {
+		FAT_INT = 0,
+		FAT_UINT,
+		FAT_DOUBLE,
+		FAT_CHAR,
+		FAT_WCHAR,
+		FAT_STRING,
+		FAT_WSTRING,
+		FAT_POINTER
+	};
+
+protected:
+	TYPE                                                  m_type;
+	union {
+		__int64                                           i;
+		unsigned __int64                                  u;
+		double                                            d;
+		const void                                       *p;
+		struct {
+			const void                                   *data;
+			size_t                                        length;
+		}                                                 s;
+	}                                                     m_value;
+
+	void _Set (const char *s, size_t length) {
+		m_type = FAT_STRING;
+		m_value.s.data = s;
+		m_value.s.length = length;
+	}
+	void _Set (const wchar_t *s, size_t length) {
+		m_type = FAT_WSTRING;
+		m_value.s.data = s;
+		m_value.s.length = length;
+	}
+
+public:
+	CFormatArg (int value) : m_type(FAT_INT) { m_value.i = value; }
+	CFormatArg (long value) : m_type(FAT_INT) { m_value.i = value; }
+	CFormatArg (__int64 value) : m_type(FAT_INT) { m_value.i = value; }
+	CFormatArg (short value) : m_type(FAT_INT) { m_value.i = value; }
+	CFormatArg (unsigned int value) : m_type(FAT_UINT) { m_value.u = value; }
+	CFormatArg (unsigned long value) : m_type(FAT_UINT) { m_value.u = value; }
+	CFormatArg (unsigned __int64 value) : m_type(FAT_UINT) { m_value.u = value; }
+	CFormatArg (unsigned char value) : m_type(FAT_UINT) { m_value.u = value; }
+	CFormatArg (bool value) : m_type(FAT_UINT) { m_value.u = value ? 1 : 0; }
+	CFormatArg (double value) : m_type(FAT_DOUBLE) { m_value.d = value; }
+	CFormatArg (float value) : m_type(FAT_DOUBLE) { m_value.d = value; }
+	CFormatArg (char value) : m_type(FAT_CHAR) { m_value.u = (unsigned char)value; }
+	CFormatArg (wchar_t value) : m_type(FAT_WCHAR) { m_value.u = value; }
+	CFormatArg (const void *value) : m_type(FAT_POINTER) { m_value.p = value; }
+
+	CFormatArg (const char *s) {
+		_Set(s == NULL ? "(null)" : s, s == NULL ? 6 : std::char_traits<char>::length(s));
+	}
+	CFormatArg (const wchar_t *s) {
+		_Set(s == NULL ? L"(null)" : s, s == NULL ? 6 : std::char_traits<wchar_t>::length(s));
+	}
+	template <class Traits, class Allocator>
+	CFormatArg (const std::basic_string<char, Traits, Allocator> &s) {
+		_Set(s.data(), s.length());
+	}
+	template <class Traits, class Allocator>
+	CFormatArg (const std::basic_string<wchar_t, Traits, Allocator> &s) {
+		_Set(s.data(), s.length());
+	}
+	template <class Traits>
+	CFormatArg (const basic_string_view<char, Traits> &s) {
+		_Set(s.data(), s.length());
+	}
+	template <class Traits>
+	CFormatArg (const basic_string_view<wchar_t, Traits> &s) {
+		_Set(s.data(), s.length());
+	}
+
+	TYPE getType () const {
+		return m_type;
+	}
+	bool isString () const {
+		return m_type >= FAT_CHAR && m_type <= FAT_WSTRING;
+	}
+	bool isInteger () const {
+		return m_type == FAT_INT || m_type == FAT_UINT;
+	}
+	unsigned __int64 getUInt () const {
+		assert(isInteger());
+		return m_value.u;
+	}
+
+	/**
+	 * the characters of a string, char or wchar_t, converted to CharT
+	 */
+	template <class CharT, size_t N>
+	void appendString (CStringBuilderT<CharT, N> &sb, size_t maxLength) const;
+
+	/**
+	 * the number by spec, with the sign, the prefix and the zeros of the width
+	 * @return the count of characters written, 350 at most (a "%f" of DBL_MAX)
+	 */
+	size_t formatNumber (const FormatSpec &spec, char *buffer) const;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CFormatArg::appendString
+
+template <class CharT, size_t N>
+void CFormatArg::appendString (CStringBuilderT<CharT, N> &sb, size_t maxLength) const {
+	assert(isString());
+	if (m_type == FAT_CHAR || m_type == FAT_WCHAR) {
+		if (maxLength > 0) {
+			sb.append((CharT)m_value.u);
+		}
+		return;
+	}
+
+	size_t length = m_value.s.length < maxLength ? m_value.s.length : maxLength;
+	if (sizeof(CharT) == sizeof(char) && m_type == FAT_STRING) {
+		sb.append((const CharT *)m_value.s.data, length);
+	} else if (sizeof(CharT) == sizeof(wchar_t) && m_type == FAT_WSTRING) {
+		sb.append((const CharT *)m_value.s.data, length);
+	} else if (m_type == FAT_STRING) {
+		sb.append((const CharT *)s2ws(string((const char *)m_value.s.data, length)).c_str());
+	} else {
+		sb.append((const CharT *)ws2s(wstring((const wchar_t *)m_value.s.data, length)).c_str());
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// format_args, in one pass
+
+template <class CharT, size_t N>
+CStringBuilderT<CharT, N>& format_args (CStringBuilderT<CharT, N> &sb, const CharT *format,
+                                        const CFormatArg *const *args, size_t count) {
+	assert(format != NULL);
+	size_t next = 0;
+	const CharT *p = format;
+	while (*p != 0) {
+		const CharT *text = p;
+		while (*p != 0 && *p != (CharT)'%') {
+			++ p;
+		}
+		if (p != text) {
+			sb.append(text, p - text);
+		}
+		if (*p == 0) {
+			break;
+		}
+		if (p[1] == (CharT)'%') {
+			sb.append((CharT)'%');
+			p += 2;
+			continue;
+		}
+
+		FormatSpec spec;
+		p = parse_format_spec(p + 1, spec);
+		assert(next < count); // not enough arguments
+		if (next >= count) {
+			continue;
+		}
+
+		const CFormatArg *arg = args[next ++];
+		CFormatArg character((wchar_t)0);
+		if (spec.conversion == 'c' && arg->isInteger()) {
+			character = CFormatArg((wchar_t)arg->getUInt());
+			arg = &character;
+		}
+
+		size_t before = sb.length();
+		size_t maxLength = spec.precision < 0 ? (size_t)-1 : (size_t)spec.precision;
+		if (arg->isString() && (spec.left || spec.width == 0)) {
+			arg->appendString(sb, maxLength);
+		} else if (arg->isString()) {
+			// the width is of the characters converted
+			CStringBuilderT<CharT, 64> converted;
+			arg->appendString(converted, maxLength);
+			if (spec.width > converted.length()) {
+				sb.append(spec.width - converted.length(), (CharT)' ');
+			}
+			for (size_t i = 0; i < converted.getChunkCount(); ++ i) {
+				typename CStringBuilderT<CharT, 64>::Chunk chunk = converted.getChunk(i);
+				sb.append(chunk.data, chunk.length);
+			}
+		} else {
+			char buffer[352];
+			size_t length = arg->formatNumber(spec, buffer);
+			if (!spec.left && spec.width > length) {
+				sb.append(spec.width - length, (CharT)' ');
+			}
+			sb.reserve(length);
+			for (size_t i = 0; i < length; ++ i) {
+				sb.append((CharT)buffer[i]);
+			}
+		}
+		size_t written = sb.length() - before;
+		if (spec.left && spec.width > written) {
+			sb.append(spec.width - written, (CharT)' ');
+		}
+	}
+	assert(next == count); // too many arguments
+	return sb;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// the overloads of 0 to 8 arguments, as the compiler has no variadic
+// templates: XL_FORMAT_OVERLOADS(M) expands M(n) for n = 0 to 8, where
+// M uses XL_FORMAT_PARAMS_##n in its parameters (after the format) and
+// XL_FORMAT_ARGS_##n to declare the array of the arguments:
+//
+//	#define DECLARE_LOG(n) void log (const tchar *format XL_FORMAT_PARAMS_##n);
+//	#define DEFINE_LOG(n) void log (const tchar *format XL_FORMAT_PARAMS_##n) { \
+//		XL_FORMAT_ARGS_##n; \
+//		_Log(format, args + 1, n); \
+//	}
+
+#define XL_FORMAT_PARAMS_0
+#define XL_FORMAT_PARAMS_1 , const xl::CFormatArg &a1
+#define XL_FORMAT_PARAMS_2 XL_FORMAT_PARAMS_1, const xl::CFormatArg &a2
+#define XL_FORMAT_PARAMS_3 XL_FORMAT_PARAMS_2, const xl::CFormatArg &a3
+#define XL_FORMAT_PARAMS_4 XL_FORMAT_PARAMS_3, const xl::CFormatArg &a4
+#define XL_FORMAT_PARAMS_5 XL_FORMAT_PARAMS_4, const xl::CFormatArg &a5
+#define XL_FORMAT_PARAMS_6 XL_FORMAT_PARAMS_5, const xl::CFormatArg &a6
+#define XL_FORMAT_PARAMS_7 XL_FORMAT_PARAMS_6, const xl::CFormatArg &a7
+#define XL_FORMAT_PARAMS_8 XL_FORMAT_PARAMS_7, const xl::CFormatArg &a8
+
+// args[0] is a placeholder, so there is no array of 0
+#define XL_FORMAT_LIST_0 NULL
+#define XL_FORMAT_LIST_1 XL_FORMAT_LIST_0, &a1
+#define XL_FORMAT_LIST_2 XL_FORMAT_LIST_1, &a2
+#define XL_FORMAT_LIST_3 XL_FORMAT_LIST_2, &a3
+#define XL_FORMAT_LIST_4 XL_FORMAT_LIST_3, &a4
+#define XL_FORMAT_LIST_5 XL_FORMAT_LIST_4, &a5
+#define XL_FORMAT_LIST_6 XL_FORMAT_LIST_5, &a6
+#define XL_FORMAT_LIST_7 XL_FORMAT_LIST_6, &a7
+#define XL_FORMAT_LIST_8 XL_FORMAT_LIST_7, &a8
+
+#define XL_FORMAT_ARGS_0 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_0}
+#define XL_FORMAT_ARGS_1 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_1}
+#define XL_FORMAT_ARGS_2 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_2}
+#define XL_FORMAT_ARGS_3 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_3}
+#define XL_FORMAT_ARGS_4 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_4}
+#define XL_FORMAT_ARGS_5 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_5}
+#define XL_FORMAT_ARGS_6 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_6}
+#define XL_FORMAT_ARGS_7 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_7}
+#define XL_FORMAT_ARGS_8 const xl::CFormatArg *args[] = {XL_FORMAT_LIST_8}
+
+#define XL_FORMAT_OVERLOADS(M) M(0) M(1) M(2) M(3) M(4) M(5) M(6) M(7) M(8)
+
+
+//////////////////////////////////////////////////////////////////////////
+// format_to() a builder, format() a string
+
+#define XL_FORMAT_TO(n) \
+	template <class CharT, size_t N> \
+	CStringBuilderT<CharT, N>& format_to (CStringBuilderT<CharT, N> &sb, const CharT *format XL_FORMAT_PARAMS_##n) { \
+		XL_FORMAT_ARGS_##n; \
+		return format_args(sb, format, args + 1, n); \
+	}
+XL_FORMAT_OVERLOADS(XL_FORMAT_TO)
+#undef XL_FORMAT_TO
+
+#define XL_FORMAT(n) \
+	template <class CharT> \
+	basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > format (const CharT *format XL_FORMAT_PARAMS_##n) { \
+		XL_FORMAT_ARGS_##n; \
+		CStringBuilderT<CharT, 256> sb; \
+		return format_args(sb, format, args + 1, n).str(); \
+	}
+XL_FORMAT_OVERLOADS(XL_FORMAT)
+#undef XL_FORMAT
+
+XL_END
+#endif
@@ -10,15 +10,19 @@
  *
  * The ini file MUST be placed in the SAME directory with the executable, unless you
  * set the base directory via .setBaseDir()
+ *
+ * All methods may be called from any thread, so the strings can be loaded by
+ * preload() on a worker at startup (see CPreloader).
  */
 #include <memory>
 #include "common.h"
 #include "string.h"
+#include "lockable.h"
 
 XL_BEGIN
 
 class CIni;
-class CLanguage {
+class CLanguage : private CUserLock {
 private:
 	CLanguage ();
 	~CLanguage ();
@@ -37,6 +41,11 @@ public:
 	void setLcid (const tstring &lcid);
 
 	static CLanguage* getInstance ();
+	/**
+	 * load the ini file now, instead of on the first getString()
+	 * @return false if there is no ini file
+	 */
+	bool preload ();
 	tstring getString (const tstring &key);
 };
 
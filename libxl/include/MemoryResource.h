@@ -0,0 +1,332 @@
+#ifndef XL_MEMORYRESOURCE_H
+#define XL_MEMORYRESOURCE_H
+/**
+ * The memory resources and the allocator over them, as std::pmr of C++17:
+ * the strings and the containers of xl::pmr allocate from the resource they
+ * are given, so a whole parse allocates from one arena, and is freed at once
+ * when the arena is released (or goes out of scope):
+ *
+ *	pmr::CLocalArena<512> arena;
+ *	pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
+ *
+ * There are no alias templates nor scoped allocators in this compiler: the
+ * containers are pmr::vector<T>::type and pmr::map<K, V>::type, and an element
+ * takes the allocator of the value it is copied from, so build the elements
+ * with the resource of the container (as pmr::explode() does).
+ *
+ * The resources are not thread safe, they are for the objects of one thread.
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <map>
+#include <new>
+#include <vector>
+#include "common.h"
+#include "string.h"
+XL_BEGIN
+PMR_BEGIN
+
+/**
+ * the alignment of ::operator new(), the most the resources support
+ */
+enum { DEFAULT_ALIGNMENT = 2 * sizeof(void *) };
+
+
+//////////////////////////////////////////////////////////////////////////
+// IMemoryResource
+
+class IMemoryResource {
+public:
+	virtual ~IMemoryResource () {}
+
+	/**
+	 * @param alignment A power of 2, DEFAULT_ALIGNMENT at most
+	 */
+	virtual void* allocate (size_t bytes, size_t alignment = DEFAULT_ALIGNMENT) = 0;
+	/**
+	 * bytes and alignment are as they were passed to allocate()
+	 */
+	virtual void deallocate (void *p, size_t bytes, size_t alignment = DEFAULT_ALIGNMENT) = 0;
+	/**
+	 * true if the memory of one can be deallocated by the other
+	 */
+	virtual bool isEqual (const IMemoryResource &other) const {
+		return this == &other;
+	}
+};
+
+/**
+ * ::operator new() and ::operator delete()
+ */
+IMemoryResource* new_delete_resource ();
+/**
+ * the resource of the allocators constructed without one, new_delete_resource()
+ * if not set; set it before the other threads start
+ * @return the previous one
+ */
+IMemoryResource* get_default_resource ();
+IMemoryResource* set_default_resource (IMemoryResource *resource);
+
+
+//////////////////////////////////////////////////////////////////////////
+// CMonotonicArena: the allocations are bumped from the buffer given, then from
+// blocks of upstream, each twice as large as the last; deallocate() does
+// nothing, release() (or the destructor) frees all the blocks at once
+
+class CMonotonicArena : public IMemoryResource
+{
+protected:
+	struct _Block {
+		_Block                                           *next;
+		size_t                                            size;
+	};
+
+	IMemoryResource                                      *m_upstream;
+	char                                                 *m_buffer;      // the initial one, not owned
+	size_t                                                m_bufferSize;
+	char                                                 *m_cur;
+	char                                                 *m_end;
+	_Block                                               *m_blocks;      // the last first
+	size_t                                                m_initialSize; // of the first block
+	size_t                                                m_nextSize;
+
+	CMonotonicArena (const CMonotonicArena &);
+	CMonotonicArena& operator = (const CMonotonicArena &);
+
+	void _Init (void *buffer, size_t size);
+	void _Grow (size_t bytes);
+
+public:
+	/**
+	 * @param upstream NULL for get_default_resource()
+	 */
+	explicit CMonotonicArena (IMemoryResource *upstream = NULL);
+	/**
+	 * @param initialSize The size of the first block of upstream
+	 */
+	explicit CMonotonicArena (size_t initialSize, IMemoryResource *upstream = NULL);
+	/**
+	 * allocate from buffer first, which must outlive the arena
+	 */
+	CMonotonicArena (void *buffer, size_t size, IMemoryResource *upstream = NULL);
+	virtual ~CMonotonicArena ();
+
+	/**
+	 * free the blocks, all the memory allocated becomes invalid
+	 */
+	void release ();
+	IMemoryResource* getUpstream () const {
+		return m_upstream;
+	}
+
+	virtual void* allocate (size_t bytes, size_t alignment = DEFAULT_ALIGNMENT);
+	virtual void deallocate (void *p, size_t bytes, size_t alignment = DEFAULT_ALIGNMENT);
+};
+
+/**
+ * an arena with its first N bytes in itself, on the stack if it is there
+ */
+template <size_t N>
+class CLocalArena : public CMonotonicArena
+{
+	union {
+		char                                              m_local[N];
+		double                                            m_align;
+	};
+
+public:
+	explicit CLocalArena (IMemoryResource *upstream = NULL)
+		: CMonotonicArena(upstream)
+	{
+		_Init(m_local, N);
+	}
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPoolResource: the allocations of up to MAX_POOLED bytes are kept in the
+// free lists of their size class (8, 16, 32... bytes), which are refilled by
+// chunks of upstream; the larger ones are passed to upstream. release() (or the
+// destructor) frees all the chunks and the larger ones.
+
+class CPoolResource : public IMemoryResource
+{
+public:
+	enum {
+		MIN_POOLED = 8,
+		MAX_POOLED = 512,
+		POOL_COUNT = 7,                       // 8 to 512
+		MAX_CHUNK = 64 * 1024
+	};
+
+protected:
+	struct _Free {
+		_Free                                            *next;
+	};
+	struct _Chunk {
+		_Chunk                                           *next;
+		size_t                                            size;
+	};
+	struct _Large {
+		_Large                                           *next;
+		_Large                                           *prev;
+		size_t                                            size;
+	};
+
+	IMemoryResource                                      *m_upstream;
+	_Free                                                *m_free[POOL_COUNT];
+	size_t                                                m_chunkBlocks[POOL_COUNT]; // of the next chunk
+	_Chunk                                               *m_chunks;
+	_Large                                               *m_large;
+
+	CPoolResource (const CPoolResource &);
+	CPoolResource& operator = (const CPoolResource &);
+
+	static size_t _GetPool (size_t bytes, size_t alignment);
+	void _Refill (size_t pool);
+
+public:
+	/**
+	 * @param upstream NULL for get_default_resource(), may be an arena
+	 */
+	explicit CPoolResource (IMemoryResource *upstream = NULL);
+	virtual ~CPoolResource ();
+
+	void release ();
+	IMemoryResource* getUpstream () const {
+		return m_upstream;
+	}
+
+	virtual void* allocate (size_t bytes, size_t alignment = DEFAULT_ALIGNMENT);
+	virtual void deallocate (void *p, size_t bytes, size_t alignment = DEFAULT_ALIGNMENT);
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CAllocator, the polymorphic allocator
+
+template <class T>
+class CAllocator
+{
+public:
+	typedef T                                             value_type;
+	typedef T*                                            pointer;
+	typedef const T*                                      const_pointer;
+	typedef T&                                            reference;
+	typedef const T&                                      const_reference;
+	typedef size_t                                        size_type;
+	typedef ptrdiff_t                                     difference_type;
+
+	template <class U>
+	struct rebind {
+		typedef CAllocator<U>                             other;
+	};
+
+protected:
+	IMemoryResource                                      *m_resource;
+
+public:
+	CAllocator () : m_resource(get_default_resource()) {}
+	/**
+	 * @param resource NULL for get_default_resource()
+	 */
+	CAllocator (IMemoryResource *resource)
+		: m_resource(resource == NULL ? get_default_resource() : resource) {}
+	template <class U>
+	CAllocator (const CAllocator<U> &other) : m_resource(other.getResource()) {}
+
+	IMemoryResource* getResource () const {
+		return m_resource;
+	}
+
+	pointer address (reference x) const {
+		return &x;
+	}
+	const_pointer address (const_reference x) const {
+		return &x;
+	}
+	pointer allocate (size_type n, const void * = NULL) {
+		assert(__alignof(T) <= DEFAULT_ALIGNMENT);
+		return (pointer)m_resource->allocate(n * sizeof(T), __alignof(T));
+	}
+	void deallocate (pointer p, size_type n) {
+		m_resource->deallocate(p, n * sizeof(T), __alignof(T));
+	}
+	void construct (pointer p, const T &value) {
+		::new ((void *)p) T(value);
+	}
+	void destroy (pointer p) {
+		XL_PARAMETER_NOT_USED(p);
+		p->~T();
+	}
+	size_type max_size () const {
+		return (size_t)-1 / sizeof(T);
+	}
+};
+
+template <class T, class U>
+bool operator == (const CAllocator<T> &lhs, const CAllocator<U> &rhs) {
+	return lhs.getResource() == rhs.getResource() || lhs.getResource()->isEqual(*rhs.getResource());
+}
+template <class T, class U>
+bool operator != (const CAllocator<T> &lhs, const CAllocator<U> &rhs) {
+	return !(lhs == rhs);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// the strings and the containers
+
+typedef xl::basic_string<char, std::char_traits<char>, CAllocator<char> >             string;
+typedef xl::basic_string<wchar_t, std::char_traits<wchar_t>, CAllocator<wchar_t> >    wstring;
+typedef xl::basic_string<tchar, std::char_traits<tchar>, CAllocator<tchar> >          tstring;
+
+template <class T>
+struct vector {
+	typedef std::vector<T, CAllocator<T> >                type;
+};
+
+template <class K, class V, class Less = std::less<K> >
+struct map {
+	typedef std::map<K, V, Less, CAllocator<std::pair<const K, V> > > type;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// explode, the parts and the vector are allocated from resource
+
+template <class CharT>
+struct ExplodeT {
+	typedef xl::basic_string<CharT, std::char_traits<CharT>, CAllocator<CharT> >      StringT;
+	typedef std::vector<StringT, CAllocator<StringT> >                                ValueT;
+};
+
+template <class CharT>
+typename ExplodeT<CharT>::ValueT
+explode (const CharT *delimiter, const basic_string_view<CharT> &str, IMemoryResource *resource, int max_parts = -1) {
+	typedef typename ExplodeT<CharT>::StringT StringT;
+	typename ExplodeT<CharT>::ValueT ret((CAllocator<StringT>(resource)));
+	CSplitterT<CharT> splitter(str, delimiter, max_parts);
+	basic_string_view<CharT> token;
+	while (splitter.next(token)) {
+		ret.push_back(StringT(token.data(), token.length(), CAllocator<CharT>(resource)));
+	}
+	return ret;
+}
+
+template <class CharT>
+typename ExplodeT<CharT>::ValueT
+explode (const CharT *delimiter, const CharT *str, IMemoryResource *resource, int max_parts = -1) {
+	return explode(delimiter, basic_string_view<CharT>(str), resource, max_parts);
+}
+
+template <class CharT, class Traits, class Allocator>
+typename ExplodeT<CharT>::ValueT
+explode (const CharT *delimiter, const std::basic_string<CharT, Traits, Allocator> &str,
+         IMemoryResource *resource, int max_parts = -1) {
+	return explode(delimiter, basic_string_view<CharT>(str.data(), str.length()), resource, max_parts);
+}
+
+PMR_END
+XL_END
+#endif
@@ -0,0 +1,95 @@
+#ifndef XL_SHARDEDMAP_H
+#define XL_SHARDEDMAP_H
+/**
+ * A map for the read mostly caches, such as the resources of CResMgr.
+ *
+ * The keys (integers) are spread over SHARDS maps, each one behind its own
+ * read write lock, so the readers run in parallel and a writer only blocks
+ * the readers of its shard. A missing value is created under the exclusive
+ * lock of the shard, so two threads asking for the same key never both create it.
+ *
+ *	struct CREATOR {
+ *		HFONT operator () () const { ... }
+ *	};
+ *	HFONT font = fonts.get(key, CREATOR());
+ */
+#include <map>
+#include "common.h"
+#include "lockable.h"
+#include "utilities.h"
+XL_BEGIN
+
+template <class KEY, class VALUE, uint SHARDS = 16>
+class CShardedMapT
+{
+	typedef std::map<KEY, VALUE>                          _MapType;
+
+	struct SHARD {
+		CReadWriteLock                                    lock;
+		_MapType                                          map;
+	};
+
+	SHARD                                                 m_shards[SHARDS];
+
+	CShardedMapT (const CShardedMapT &);
+	CShardedMapT& operator = (const CShardedMapT &);
+
+	static uint _ShardOf (KEY key) {
+		uint64 h = (uint64)key * 0x9e3779b97f4a7c15ULL;
+		return (uint)(h >> 32) % SHARDS;
+	}
+
+public:
+	CShardedMapT () {}
+
+	bool find (KEY key, VALUE &value) const {
+		const SHARD &shard = m_shards[_ShardOf(key)];
+		CScopeSharedLock sl(&shard.lock);
+		typename _MapType::const_iterator it = shard.map.find(key);
+		if (it == shard.map.end()) {
+			return false;
+		}
+		value = it->second;
+		return true;
+	}
+
+	/**
+	 * the value of key, created by creator() if missing, a false value (such as NULL) is not kept
+	 */
+	template <class CREATOR>
+	VALUE get (KEY key, const CREATOR &creator) {
+		VALUE value = VALUE();
+		if (find(key, value)) {
+			return value;
+		}
+
+		SHARD &shard = m_shards[_ShardOf(key)];
+		CScopeLock sl(&shard.lock);
+		typename _MapType::iterator it = shard.map.find(key);
+		if (it != shard.map.end()) {
+			return it->second; // created by another thread meanwhile
+		}
+		value = creator();
+		if (value) {
+			shard.map[key] = value;
+		}
+		return value;
+	}
+
+	/**
+	 * remove all, destroyer(value) is called for each one
+	 */
+	template <class DESTROYER>
+	void clear (const DESTROYER &destroyer) {
+		for (uint i = 0; i < SHARDS; ++ i) {
+			CScopeLock sl(&m_shards[i].lock);
+			for (typename _MapType::iterator it = m_shards[i].map.begin(); it != m_shards[i].map.end(); ++ it) {
+				destroyer(it->second);
+			}
+			m_shards[i].map.clear();
+		}
+	}
+};
+
+XL_END
+#endif
@@ -0,0 +1,381 @@
+#ifndef XL_STRINGBUILDER_H
+#define XL_STRINGBUILDER_H
+/**
+ * CStringBuilderT: appends into a buffer on the stack (N characters), then
+ * into blocks on the heap, each at least as large as all before it, so a
+ * long text costs O(log n) allocations and nothing is ever moved. The text
+ * is kept in blocks, it is written to a file block by block, or given as a
+ * list of blocks (for writev() or WSASend()), without being joined first:
+ *
+ *	CStringBuilder sb;
+ *	sb.append(_T("width="));
+ *	sb.appendInt(width);
+ *	sb.append(_T("px"));
+ *	sb.write(file);
+ *
+ * The numbers are appended by the typed appenders, with no format string to
+ * parse; format_to() of Format.h appends by the formats of printf() in one
+ * pass, appendFormatV() is there for a va_list.
+ */
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <vector>
+#include "common.h"
+#include "string.h"
+XL_BEGIN
+
+/**
+ * the digits of the numbers, in ASCII, written to buffer (not terminated)
+ * @return the count of characters written
+ */
+size_t format_uint (unsigned __int64 value, char *buffer); // 20 characters at most
+size_t format_int (__int64 value, char *buffer); // 20 characters at most
+/**
+ * @param width The minimum count of digits, padded by '0', 16 at most
+ */
+size_t format_hex (unsigned __int64 value, size_t width, bool upper, char *buffer); // 16 characters at most
+/**
+ * fixed ("%.*f"), or d.ddde+xx from 2^63 on, rounded half away from zero
+ * @param precision The digits after the point, 0 to 17
+ */
+size_t format_double (double value, int precision, char *buffer); // 64 characters at most
+
+/**
+ * the printf() formats, by _vscprintf() and vsprintf_s()
+ * @return the count of characters, not including the terminating 0
+ */
+int format_length (const char *format, va_list args);
+int format_length (const wchar_t *format, va_list args);
+int format_v (char *buffer, size_t count, const char *format, va_list args);
+int format_v (wchar_t *buffer, size_t count, const wchar_t *format, va_list args);
+
+
+//////////////////////////////////////////////////////////////////////////
+// CStringBuilderT
+
+template <class CharT, size_t N = 256>
+class CStringBuilderT
+{
+public:
+	typedef std::char_traits<CharT>                       Traits;
+	/**
+	 * a block of the text, as (iov_base, iov_len) of iovec
+	 */
+	struct Chunk {
+		const CharT                                      *data;
+		size_t                                            length;
+	};
+
+protected:
+	struct _Block {
+		CharT                                            *data;
+		size_t                                            length;
+		size_t                                            capacity;
+	};
+
+	CharT                                                 m_local[N];
+	size_t                                                m_localLength; // when closed
+	std::vector<_Block>                                   m_blocks;      // after m_local
+	CharT                                                *m_begin;       // of the current block
+	CharT                                                *m_cur;
+	CharT                                                *m_end;
+	size_t                                                m_closed;      // the length of the blocks before the current one
+
+	CStringBuilderT (const CStringBuilderT &);
+	CStringBuilderT& operator = (const CStringBuilderT &);
+
+	void _Close () {
+		if (m_blocks.empty()) {
+			m_localLength = m_cur - m_begin;
+		} else {
+			m_blocks.back().length = m_cur - m_begin;
+		}
+		m_closed += m_cur - m_begin;
+	}
+
+	void _Open (size_t capacity) {
+		_Block block;
+		block.data = new CharT[capacity];
+		block.length = 0;
+		block.capacity = capacity;
+		m_blocks.push_back(block);
+		m_begin = m_cur = block.data;
+		m_end = block.data + capacity;
+	}
+
+	/**
+	 * close the current block and open a new one of need characters at least
+	 */
+	void _Grow (size_t need) {
+		_Close();
+		size_t capacity = m_closed < N ? N : m_closed;
+		_Open(need > capacity ? need : capacity);
+	}
+
+	/**
+	 * join the blocks into one with room for extra characters more
+	 */
+	void _Flatten (size_t extra) {
+		size_t length = this->length();
+		size_t capacity = length + extra;
+		if (capacity < N * 2) {
+			capacity = N * 2;
+		}
+
+		CharT *data = new CharT[capacity];
+		CharT *p = data;
+		_CopyTo(p);
+
+		_Free();
+		_Block block;
+		block.data = data;
+		block.length = 0;
+		block.capacity = capacity;
+		m_blocks.push_back(block);
+		m_begin = data;
+		m_cur = data + length;
+		m_end = data + capacity;
+		m_localLength = 0;
+		m_closed = 0;
+	}
+
+	void _CopyTo (CharT *&p) const {
+		for (size_t i = 0, count = getChunkCount(); i < count; ++ i) {
+			Chunk chunk = getChunk(i);
+			Traits::copy(p, chunk.data, chunk.length);
+			p += chunk.length;
+		}
+	}
+
+	void _Free () {
+		for (size_t i = 0; i < m_blocks.size(); ++ i) {
+			delete [] m_blocks[i].data;
+		}
+		m_blocks.clear();
+	}
+
+	void _AppendAscii (const char *s, size_t n) {
+		reserve(n);
+		for (size_t i = 0; i < n; ++ i) {
+			m_cur[i] = (CharT)s[i];
+		}
+		m_cur += n;
+	}
+
+public:
+	CStringBuilderT ()
+		: m_localLength(0)
+		, m_begin(m_local)
+		, m_cur(m_local)
+		, m_end(m_local + N)
+		, m_closed(0)
+	{
+	}
+	~CStringBuilderT () {
+		_Free();
+	}
+
+	size_t length () const {
+		return m_closed + (m_cur - m_begin);
+	}
+	bool empty () const {
+		return length() == 0;
+	}
+	void clear () {
+		_Free();
+		m_localLength = 0;
+		m_begin = m_cur = m_local;
+		m_end = m_local + N;
+		m_closed = 0;
+	}
+
+	/**
+	 * make room for count characters more, so the next count characters are
+	 * appended without allocating, into one block
+	 */
+	void reserve (size_t count) {
+		if ((size_t)(m_end - m_cur) < count) {
+			_Grow(count);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// append
+	CStringBuilderT& append (const CharT *s, size_t n) {
+		size_t room = m_end - m_cur;
+		if (n > room) {
+			Traits::copy(m_cur, s, room);
+			m_cur += room;
+			s += room;
+			n -= room;
+			_Grow(n);
+		}
+		Traits::copy(m_cur, s, n);
+		m_cur += n;
+		return *this;
+	}
+	CStringBuilderT& append (const CharT *s) {
+		assert(s != NULL);
+		return append(s, Traits::length(s));
+	}
+	CStringBuilderT& append (const basic_string_view<CharT, Traits> &s) {
+		return append(s.data(), s.length());
+	}
+	template <class Allocator>
+	CStringBuilderT& append (const std::basic_string<CharT, Traits, Allocator> &s) {
+		return append(s.data(), s.length());
+	}
+	CStringBuilderT& append (CharT c) {
+		if (m_cur == m_end) {
+			_Grow(1);
+		}
+		*m_cur ++ = c;
+		return *this;
+	}
+	CStringBuilderT& append (size_t count, CharT c) {
+		reserve(count);
+		Traits::assign(m_cur, count, c);
+		m_cur += count;
+		return *this;
+	}
+
+	CStringBuilderT& appendInt (__int64 value) {
+		char buffer[24];
+		_AppendAscii(buffer, format_int(value, buffer));
+		return *this;
+	}
+	CStringBuilderT& appendUInt (unsigned __int64 value) {
+		char buffer[24];
+		_AppendAscii(buffer, format_uint(value, buffer));
+		return *this;
+	}
+	/**
+	 * @param width The minimum count of digits, padded by '0'
+	 */
+	CStringBuilderT& appendHex (unsigned __int64 value, size_t width = 0, bool upper = false) {
+		char buffer[24];
+		_AppendAscii(buffer, format_hex(value, width, upper, buffer));
+		return *this;
+	}
+	CStringBuilderT& appendFloat (double value, int precision = 6) {
+		char buffer[64];
+		_AppendAscii(buffer, format_double(value, precision, buffer));
+		return *this;
+	}
+
+	/**
+	 * formatted by vsprintf() in place, no buffer between
+	 */
+	CStringBuilderT& appendFormatV (const CharT *format, va_list args) {
+		assert(format != NULL);
+		int count = format_length(format, args);
+		assert(count >= 0);
+		if (count > 0) {
+			reserve(count + 1); // the 0 of vsprintf()
+			m_cur += format_v(m_cur, count + 1, format, args);
+		}
+		return *this;
+	}
+	CStringBuilderT& appendFormat (const CharT *format, ...) {
+		va_list args;
+		va_start(args, format);
+		appendFormatV(format, args);
+		va_end(args);
+		return *this;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// output
+
+	/**
+	 * the blocks, the first may be empty
+	 */
+	size_t getChunkCount () const {
+		return 1 + m_blocks.size();
+	}
+	Chunk getChunk (size_t index) const {
+		assert(index < getChunkCount());
+		Chunk chunk;
+		if (index == 0) {
+			chunk.data = m_local;
+			chunk.length = m_blocks.empty() ? m_cur - m_begin : m_localLength;
+		} else {
+			const _Block &block = m_blocks[index - 1];
+			chunk.data = block.data;
+			chunk.length = index == m_blocks.size() ? m_cur - m_begin : block.length;
+		}
+		return chunk;
+	}
+	/**
+	 * append the blocks not empty to chunks
+	 * @return the count of the chunks appended
+	 */
+	size_t getChunks (std::vector<Chunk> &chunks) const {
+		size_t count = 0;
+		for (size_t i = 0; i < getChunkCount(); ++ i) {
+			Chunk chunk = getChunk(i);
+			if (chunk.length > 0) {
+				chunks.push_back(chunk);
+				++ count;
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * append the text to s, which is allocated once
+	 */
+	template <class Allocator>
+	void appendTo (std::basic_string<CharT, Traits, Allocator> &s) const {
+		s.reserve(s.length() + length());
+		for (size_t i = 0; i < getChunkCount(); ++ i) {
+			Chunk chunk = getChunk(i);
+			s.append(chunk.data, chunk.length);
+		}
+	}
+	basic_string<CharT, Traits, std::allocator<CharT> > str () const {
+		basic_string<CharT, Traits, std::allocator<CharT> > s;
+		appendTo(s);
+		return s;
+	}
+
+	/**
+	 * the text terminated by 0, the blocks are joined if there are more than one
+	 */
+	const CharT* c_str () {
+		if (m_closed > 0 || m_cur == m_end) {
+			_Flatten(1);
+		}
+		*m_cur = 0;
+		return m_begin;
+	}
+
+	/**
+	 * write the text to file block by block
+	 * @return the count of bytes written
+	 */
+	size_t write (FILE *file) const {
+		assert(file != NULL);
+		size_t written = 0;
+		for (size_t i = 0; i < getChunkCount(); ++ i) {
+			Chunk chunk = getChunk(i);
+			if (chunk.length > 0) {
+				size_t bytes = chunk.length * sizeof(CharT);
+				size_t result = fwrite(chunk.data, 1, bytes, file);
+				written += result;
+				if (result != bytes) {
+					break;
+				}
+			}
+		}
+		return written;
+	}
+};
+
+typedef CStringBuilderT<char>                             CStringBuilderA;
+typedef CStringBuilderT<wchar_t>                          CStringBuilderW;
+typedef CStringBuilderT<tchar>                            CStringBuilder;
+
+XL_END
+#endif
@@ -0,0 +1,268 @@
+#ifndef XL_STRINGREPLACER_H
+#define XL_STRINGREPLACER_H
+/**
+ * Replace many searches in one scan, as strtr() of PHP: at every position the
+ * longest search found there is replaced, and the scan goes on after it, so
+ * a replacement is never searched again.
+ *
+ * The searches are built into an Aho-Corasick automaton once, then each
+ * replace() runs over the source once whatever the number of the searches,
+ * so expanding thousands of placeholders of a template is linear.
+ *
+ *	std::map<tstring, tstring> pairs;
+ *	pairs[_T("{name}")] = _T("libxl");
+ *	pairs[_T("{version}")] = _T("1.0");
+ *	CStringReplacerT<tchar> replacer(pairs);
+ *	tstring page = replacer.replace(page_template);
+ */
+#include <assert.h>
+#include <map>
+#include <vector>
+#include "common.h"
+#include "string.h"
+XL_BEGIN
+
+template <class CharT>
+class CStringReplacerT
+{
+public:
+	typedef basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > StringType;
+	typedef std::map<StringType, StringType>              PairContainer;
+
+protected:
+	/**
+	 * the characters below DIRECT_SIZE have a table in the root, where the
+	 * scan spends most of its time
+	 */
+	static const size_t DIRECT_SIZE = 128;
+
+	struct NODE {
+		std::map<CharT, int>  next;
+		int                   fail;
+		int                   output;      // the index of the search ending here, or -1
+		int                   dict;        // the node of the longest shorter search ending here, or -1
+		size_t                depth;
+	};
+
+	/**
+	 * the longest match of a start position
+	 */
+	struct MATCH {
+		size_t                length;
+		int                   pair;
+	};
+
+	std::vector<NODE>                                     m_nodes;
+	std::vector<StringType>                               m_searches;
+	std::vector<StringType>                               m_replaces;
+	int                                                   m_direct[DIRECT_SIZE];
+	size_t                                                m_longest;
+
+	int _Child (int node, CharT c) const {
+		typename std::map<CharT, int>::const_iterator it = m_nodes[node].next.find(c);
+		return it == m_nodes[node].next.end() ? -1 : it->second;
+	}
+
+	int _Goto (int node, CharT c) const {
+		while (node != 0) {
+			int child = _Child(node, c);
+			if (child >= 0) {
+				return child;
+			}
+			node = m_nodes[node].fail;
+		}
+		if ((size_t)c < DIRECT_SIZE) {
+			return m_direct[(size_t)c];
+		}
+		int child = _Child(0, c);
+		return child >= 0 ? child : 0;
+	}
+
+	void _Insert (const StringType &search, int pair) {
+		int node = 0;
+		for (size_t i = 0; i < search.length(); ++ i) {
+			int child = _Child(node, search[i]);
+			if (child < 0) {
+				child = (int)m_nodes.size();
+				m_nodes[node].next[search[i]] = child;
+				NODE n;
+				n.fail = 0;
+				n.output = -1;
+				n.dict = -1;
+				n.depth = i + 1;
+				m_nodes.push_back(n);
+			}
+			node = child;
+		}
+		m_nodes[node].output = pair;
+	}
+
+	/**
+	 * the failure links, breadth first
+	 */
+	void _Link () {
+		for (size_t c = 0; c < DIRECT_SIZE; ++ c) {
+			int child = _Child(0, (CharT)c);
+			m_direct[c] = child >= 0 ? child : 0;
+		}
+
+		std::vector<int> queue;
+		for (typename std::map<CharT, int>::const_iterator it = m_nodes[0].next.begin(); it != m_nodes[0].next.end(); ++ it) {
+			queue.push_back(it->second);
+		}
+		for (size_t head = 0; head < queue.size(); ++ head) {
+			int node = queue[head];
+			for (typename std::map<CharT, int>::const_iterator it = m_nodes[node].next.begin(); it != m_nodes[node].next.end(); ++ it) {
+				int child = it->second;
+				int fail = _Goto(m_nodes[node].fail, it->first);
+				m_nodes[child].fail = fail;
+				m_nodes[child].dict = m_nodes[fail].output >= 0 ? fail : m_nodes[fail].dict;
+				queue.push_back(child);
+			}
+		}
+	}
+
+	void _Emit (const StringType &src, size_t pos, std::vector<MATCH> &window, StringType &dst, size_t &next) const {
+		MATCH &match = window[pos % window.size()];
+		if (match.length == 0) {
+			dst += src[pos];
+			next = pos + 1;
+			return;
+		}
+
+		dst += m_replaces[match.pair];
+		next = pos + match.length;
+		// the matches starting inside the replaced one are dropped
+		for (size_t i = pos; i < next; ++ i) {
+			window[i % window.size()].length = 0;
+		}
+	}
+
+public:
+	CStringReplacerT () {
+		clear();
+	}
+
+	CStringReplacerT (const PairContainer &pairs) {
+		clear();
+		assign(pairs);
+	}
+
+	/**
+	 * replace the searches, the empty searches are ignored as PHP does
+	 */
+	void assign (const PairContainer &pairs) {
+		clear();
+		for (typename PairContainer::const_iterator it = pairs.begin(); it != pairs.end(); ++ it) {
+			if (it->first.empty()) {
+				continue;
+			}
+			_Insert(it->first, (int)m_searches.size());
+			m_searches.push_back(it->first);
+			m_replaces.push_back(it->second);
+			if (it->first.length() > m_longest) {
+				m_longest = it->first.length();
+			}
+		}
+		_Link();
+	}
+
+	void clear () {
+		m_nodes.clear();
+		m_searches.clear();
+		m_replaces.clear();
+		NODE root;
+		root.fail = 0;
+		root.output = -1;
+		root.dict = -1;
+		root.depth = 0;
+		m_nodes.push_back(root);
+		m_longest = 0;
+		for (size_t c = 0; c < DIRECT_SIZE; ++ c) {
+			m_direct[c] = 0;
+		}
+	}
+
+	bool empty () const {
+		return m_searches.empty();
+	}
+
+	/**
+	 * @param count If not NULL, receives the number of the replacements
+	 */
+	StringType replace (const StringType &src, size_t *count = NULL) const {
+		if (count != NULL) {
+			*count = 0;
+		}
+		if (m_searches.empty()) {
+			return src;
+		}
+
+		// a start position is decided when all the searches from it have ended,
+		// so the longest matches of the last m_longest positions are enough
+		std::vector<MATCH> window(m_longest);
+		for (size_t i = 0; i < window.size(); ++ i) {
+			window[i].length = 0;
+			window[i].pair = -1;
+		}
+
+		StringType dst;
+		dst.reserve(src.length());
+		size_t next = 0; // the first position not emitted
+		int node = 0;
+		for (size_t i = 0; i < src.length(); ++ i) {
+			node = _Goto(node, src[i]);
+			int out = m_nodes[node].output >= 0 ? node : m_nodes[node].dict;
+			for (; out >= 0; out = m_nodes[out].dict) {
+				size_t length = m_nodes[out].depth;
+				size_t start = i + 1 - length;
+				if (start < next) {
+					continue; // inside a replaced one, the shorter ones start later
+				}
+				MATCH &match = window[start % window.size()];
+				if (length > match.length) {
+					match.length = length;
+					match.pair = m_nodes[out].output;
+				}
+			}
+
+			while (next + m_longest <= i + 1) {
+				if (count != NULL && window[next % window.size()].length > 0) {
+					++ *count;
+				}
+				_Emit(src, next, window, dst, next);
+			}
+		}
+		while (next < src.length()) {
+			if (count != NULL && window[next % window.size()].length > 0) {
+				++ *count;
+			}
+			_Emit(src, next, window, dst, next);
+		}
+		return dst;
+	}
+};
+
+typedef CStringReplacerT<char>                            CStringReplacerA;
+typedef CStringReplacerT<wchar_t>                         CStringReplacerW;
+typedef CStringReplacerT<tchar>                           CStringReplacer;
+
+
+//////////////////////////////////////////////////////////////////////////
+// strtr
+
+/**
+ * @brief Borrowed from PHP, replace the searches of pairs in one scan.
+ * Build a CStringReplacerT once to replace the same pairs in many strings.
+ */
+template <class CharT>
+basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> >
+strtr (const basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > &str,
+       const typename CStringReplacerT<CharT>::PairContainer &pairs
+      ) {
+	CStringReplacerT<CharT> replacer(pairs);
+	return replacer.replace(str);
+}
+
+XL_END
+#endif
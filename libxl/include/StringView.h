@@ -0,0 +1,386 @@
+#ifndef XL_STRINGVIEW_H
+#define XL_STRINGVIEW_H
+/**
+ * basic_string_view: a part of a string that is not owned (a pointer and a
+ * length), so taking a part of a string allocates nothing. The string must
+ * outlive its views.
+ *
+ * CSplitterT cuts a string into views lazily, by a character, by a string,
+ * by any character of a set, or into lines, so parsing allocates nothing per
+ * token:
+ *
+ *	CSplitter splitter(line, _T("="), 2);
+ *	tstring_view token;
+ *	while (splitter.next(token)) {
+ *		...
+ *	}
+ */
+#include <assert.h>
+#include <iterator>
+#include <limits>
+#include <string>
+#include "common.h"
+#include "CharScan.h"
+XL_BEGIN
+
+template <class CharT, class Traits = std::char_traits<CharT> >
+class basic_string_view
+{
+public:
+	typedef basic_string_view<CharT, Traits>              MyType;
+	typedef CharT                                         value_type;
+	typedef const CharT*                                  const_iterator;
+	typedef size_t                                        size_type;
+
+	static const size_t npos = (size_t)-1;
+
+protected:
+	const CharT                                          *m_data;
+	size_t                                                m_length;
+
+public:
+	//////////////////////////////////////////////////////////////////////////
+	// constructors
+	basic_string_view ()
+		: m_data(NULL), m_length(0) {}
+	basic_string_view (const CharT *_Ptr, size_t _Count)
+		: m_data(_Ptr), m_length(_Count) {}
+	basic_string_view (const CharT *_Ptr)
+		: m_data(_Ptr), m_length(_Ptr == NULL ? 0 : Traits::length(_Ptr)) {}
+	template <class Allocator>
+	basic_string_view (const std::basic_string<CharT, Traits, Allocator> &_Str)
+		: m_data(_Str.data()), m_length(_Str.length()) {}
+
+	const CharT* data () const {
+		return m_data;
+	}
+	size_t length () const {
+		return m_length;
+	}
+	size_t size () const {
+		return m_length;
+	}
+	bool empty () const {
+		return m_length == 0;
+	}
+	const CharT* begin () const {
+		return m_data;
+	}
+	const CharT* end () const {
+		return m_data + m_length;
+	}
+	CharT operator [] (size_t pos) const {
+		assert(pos < m_length);
+		return m_data[pos];
+	}
+	CharT front () const {
+		assert(m_length > 0);
+		return m_data[0];
+	}
+	CharT back () const {
+		assert(m_length > 0);
+		return m_data[m_length - 1];
+	}
+
+	void remove_prefix (size_t count) {
+		assert(count <= m_length);
+		m_data += count;
+		m_length -= count;
+	}
+	void remove_suffix (size_t count) {
+		assert(count <= m_length);
+		m_length -= count;
+	}
+	MyType substr (size_t pos, size_t count = npos) const {
+		assert(pos <= m_length);
+		if (count > m_length - pos) {
+			count = m_length - pos;
+		}
+		return MyType(m_data + pos, count);
+	}
+
+	/**
+	 * the view without the characters of charlist (' ' if NULL) at the ends,
+	 * as xl::basic_string::trim() but nothing is changed or allocated
+	 */
+	MyType trimmed (const CharT *charlist = NULL) const {
+		return _Trimmed(charlist, true, true);
+	}
+	MyType ltrimmed (const CharT *charlist = NULL) const {
+		return _Trimmed(charlist, true, false);
+	}
+	MyType rtrimmed (const CharT *charlist = NULL) const {
+		return _Trimmed(charlist, false, true);
+	}
+
+	int compare (const MyType &rhs) const {
+		size_t count = m_length < rhs.m_length ? m_length : rhs.m_length;
+		int result = Traits::compare(m_data, rhs.m_data, count);
+		if (result != 0) {
+			return result;
+		}
+		return m_length < rhs.m_length ? -1 : (m_length > rhs.m_length ? 1 : 0);
+	}
+	bool starts_with (const MyType &prefix) const {
+		return m_length >= prefix.m_length && Traits::compare(m_data, prefix.m_data, prefix.m_length) == 0;
+	}
+	bool ends_with (const MyType &suffix) const {
+		return m_length >= suffix.m_length && Traits::compare(m_data + m_length - suffix.m_length, suffix.m_data, suffix.m_length) == 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// find
+	size_t find (CharT c, size_t pos = 0) const {
+		if (pos >= m_length) {
+			return npos;
+		}
+		size_t offset = CharScanT<CharT, Traits>::first(m_data + pos, m_length - pos, &c, 1, true);
+		return offset == npos ? npos : pos + offset;
+	}
+	size_t find (const MyType &s, size_t pos = 0) const {
+		if (s.m_length == 0) {
+			return pos <= m_length ? pos : npos;
+		}
+		while (pos + s.m_length <= m_length) {
+			// the first character by the kernel, then the rest
+			size_t offset = CharScanT<CharT, Traits>::first(m_data + pos, m_length - s.m_length + 1 - pos, s.m_data, 1, true);
+			if (offset == npos) {
+				return npos;
+			}
+			pos += offset;
+			if (Traits::compare(m_data + pos + 1, s.m_data + 1, s.m_length - 1) == 0) {
+				return pos;
+			}
+			++ pos;
+		}
+		return npos;
+	}
+	size_t rfind (CharT c, size_t pos = npos) const {
+		if (m_length == 0) {
+			return npos;
+		}
+		size_t i = pos < m_length ? pos + 1 : m_length;
+		while (i > 0) {
+			if (Traits::eq(m_data[-- i], c)) {
+				return i;
+			}
+		}
+		return npos;
+	}
+	size_t find_first_of (const MyType &set, size_t pos = 0) const {
+		return _ScanFirst(set, pos, true);
+	}
+	size_t find_first_not_of (const MyType &set, size_t pos = 0) const {
+		return _ScanFirst(set, pos, false);
+	}
+	size_t find_last_of (const MyType &set, size_t pos = npos) const {
+		return _ScanLast(set, pos, true);
+	}
+	size_t find_last_not_of (const MyType &set, size_t pos = npos) const {
+		return _ScanLast(set, pos, false);
+	}
+
+protected:
+	size_t _ScanFirst (const MyType &set, size_t pos, bool of) const {
+		if (pos >= m_length) {
+			return npos;
+		}
+		size_t offset = CharScanT<CharT, Traits>::first(m_data + pos, m_length - pos, set.m_data, set.m_length, of);
+		return offset == npos ? npos : pos + offset;
+	}
+	MyType _Trimmed (const CharT *charlist, bool left, bool right) const {
+		assert (!charlist || *charlist != 0);
+		const CharT space = (CharT)' ';
+		MyType set = charlist == NULL ? MyType(&space, 1) : MyType(charlist);
+		size_t start = 0, end = m_length;
+		if (right) {
+			size_t last = _ScanLast(set, npos, false);
+			end = last == npos ? 0 : last + 1;
+		}
+		if (left && end > 0) {
+			start = CharScanT<CharT, Traits>::first(m_data, end, set.m_data, set.m_length, false);
+			if (start == npos) {
+				start = end;
+			}
+		}
+		return MyType(m_data + start, end - start);
+	}
+	size_t _ScanLast (const MyType &set, size_t pos, bool of) const {
+		size_t count = pos < m_length ? pos + 1 : m_length;
+		return CharScanT<CharT, Traits>::last(m_data, count, set.m_data, set.m_length, of);
+	}
+};
+
+template <class CharT, class Traits>
+const size_t basic_string_view<CharT, Traits>::npos;
+
+template <class CharT, class Traits>
+inline bool operator == (const basic_string_view<CharT, Traits> &lhs, const basic_string_view<CharT, Traits> &rhs) {
+	return lhs.length() == rhs.length() && Traits::compare(lhs.data(), rhs.data(), lhs.length()) == 0;
+}
+template <class CharT, class Traits>
+inline bool operator == (const basic_string_view<CharT, Traits> &lhs, const CharT *rhs) {
+	return lhs == basic_string_view<CharT, Traits>(rhs);
+}
+template <class CharT, class Traits>
+inline bool operator != (const basic_string_view<CharT, Traits> &lhs, const basic_string_view<CharT, Traits> &rhs) {
+	return !(lhs == rhs);
+}
+template <class CharT, class Traits>
+inline bool operator != (const basic_string_view<CharT, Traits> &lhs, const CharT *rhs) {
+	return !(lhs == rhs);
+}
+template <class CharT, class Traits>
+inline bool operator < (const basic_string_view<CharT, Traits> &lhs, const basic_string_view<CharT, Traits> &rhs) {
+	return lhs.compare(rhs) < 0;
+}
+
+typedef basic_string_view<char>                           string_view;
+typedef basic_string_view<wchar_t>                        wstring_view;
+typedef basic_string_view<tchar>                          tstring_view;
+
+
+//////////////////////////////////////////////////////////////////////////
+// CSplitterT
+
+template <class CharT, class Traits = std::char_traits<CharT> >
+class CSplitterT
+{
+public:
+	typedef basic_string_view<CharT, Traits>              ViewType;
+
+	enum MODE {
+		SM_STRING = 0,     // the delimiter is the whole string
+		SM_ANY_OF,         // the delimiter is any character of the string
+		SM_LINES           // the delimiter is "\r\n", "\n" or "\r", whatever is passed
+	};
+
+protected:
+	ViewType                                              m_rest;
+	ViewType                                              m_delimiter;
+	MODE                                                  m_mode;
+	int                                                   m_splits;      // the cuts left
+	bool                                                  m_done;
+
+	void _Init (int max_parts) {
+		assert(max_parts > 0 || max_parts == -1);
+		m_splits = max_parts == -1 ? (std::numeric_limits<int>::max)() : max_parts - 1;
+		m_done = false;
+	}
+
+public:
+	/**
+	 * as explode(): at most max_parts parts, the last one holds the rest, and
+	 * an empty last part is not returned
+	 * @param max_parts -1 for no limit
+	 */
+	CSplitterT (ViewType str, ViewType delimiter, int max_parts = -1, MODE mode = SM_STRING)
+		: m_rest(str), m_delimiter(delimiter), m_mode(mode)
+	{
+		assert(!delimiter.empty());
+		_Init(max_parts);
+	}
+
+	/**
+	 * the next part
+	 * @return false if there is no more
+	 */
+	bool next (ViewType &token) {
+		if (m_done) {
+			return false;
+		}
+		if (m_splits > 0) {
+			size_t offset, skip = 1;
+			if (m_mode == SM_LINES) {
+				const CharT breaks[] = { (CharT)'\r', (CharT)'\n' };
+				offset = m_rest.find_first_of(ViewType(breaks, 2));
+				if (offset != ViewType::npos && offset + 1 < m_rest.length()
+				    && Traits::eq(m_rest[offset], breaks[0]) && Traits::eq(m_rest[offset + 1], breaks[1])) {
+					skip = 2;
+				}
+			} else if (m_mode == SM_ANY_OF) {
+				offset = m_rest.find_first_of(m_delimiter);
+			} else if (m_delimiter.length() == 1) {
+				offset = m_rest.find(m_delimiter[0]);
+			} else {
+				offset = m_rest.find(m_delimiter);
+				skip = m_delimiter.length();
+			}
+			if (offset != ViewType::npos) {
+				token = m_rest.substr(0, offset);
+				m_rest.remove_prefix(offset + skip);
+				-- m_splits;
+				return true;
+			}
+		}
+
+		m_done = true;
+		if (m_rest.empty()) {
+			return false;
+		}
+		token = m_rest;
+		m_rest = ViewType(m_rest.end(), 0);
+		return true;
+	}
+
+	/**
+	 * the part not returned yet
+	 */
+	ViewType rest () const {
+		return m_rest;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// iterator, for the algorithms of STL
+
+	class iterator : public std::iterator<std::input_iterator_tag, ViewType>
+	{
+		CSplitterT                                        m_splitter;
+		ViewType                                          m_token;
+		bool                                              m_end;
+
+	public:
+		iterator (const CSplitterT &splitter, bool end)
+			: m_splitter(splitter), m_end(end)
+		{
+			if (!m_end) {
+				m_end = !m_splitter.next(m_token);
+			}
+		}
+		const ViewType& operator * () const {
+			assert(!m_end);
+			return m_token;
+		}
+		const ViewType* operator -> () const {
+			return &m_token;
+		}
+		iterator& operator ++ () {
+			assert(!m_end);
+			m_end = !m_splitter.next(m_token);
+			return *this;
+		}
+		/**
+		 * only an iterator and the end compare
+		 */
+		bool operator == (const iterator &rhs) const {
+			return m_end == rhs.m_end;
+		}
+		bool operator != (const iterator &rhs) const {
+			return m_end != rhs.m_end;
+		}
+	};
+
+	iterator begin () const {
+		return iterator(*this, false);
+	}
+	iterator end () const {
+		return iterator(*this, true);
+	}
+};
+
+typedef CSplitterT<char>                                  CSplitterA;
+typedef CSplitterT<wchar_t>                               CSplitterW;
+typedef CSplitterT<tchar>                                 CSplitter;
+
+XL_END
+#endif
@@ -0,0 +1,59 @@
+#ifndef XL_THREADPOOL_H
+#define XL_THREADPOOL_H
+/**
+ * A simple thread pool, one thread per processor, and parallel_for()
+ * which splits a work into bands and runs them on the pool.
+ */
+#include <deque>
+#include <vector>
+#include <Windows.h>
+#include "common.h"
+#include "interfaces.h"
+#include "lockable.h"
+XL_BEGIN
+
+class CThreadPool : private CUserLock
+{
+	typedef std::deque<IExecutable *>              _JobContainer;
+	typedef std::vector<HANDLE>                    _ThreadContainer;
+
+	_JobContainer                                  m_jobs;
+	_ThreadContainer                               m_threads;
+	HANDLE                                         m_semaphore;
+	bool                                           m_exiting;
+
+	CThreadPool ();
+	~CThreadPool ();
+
+	static unsigned __stdcall _ThreadProc (void *param);
+	void _Run ();
+
+public:
+	static CThreadPool* getInstance ();
+
+	uint getThreadCount () const;
+
+	/**
+	 * queue the job, the job must be alive until it has been executed or canceled
+	 */
+	void post (IExecutable *job);
+
+	/**
+	 * remove the job if it has not been started.
+	 * @return true if it is removed, false if it is running or has been executed
+	 */
+	bool cancel (IExecutable *job);
+};
+
+
+/**
+ * Run task(0) ... task(bands - 1) on the pool, the calling thread takes part
+ * in the work too, and it returns after all bands are done.
+ * It is safe to call it from a pool thread.
+ * @return false if any band returns false
+ */
+bool parallel_for (uint bands, IBandExecutable *task);
+
+
+XL_END
+#endif
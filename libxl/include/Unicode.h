@@ -0,0 +1,68 @@
+#ifndef XL_UNICODE_H
+#define XL_UNICODE_H
+/**
+ * UTF-8 and UTF-16 (LE or BE) to and from wchar_t, without the Windows API.
+ * wchar_t holds UTF-16 where it is 16 bits (Windows) and UTF-32 elsewhere.
+ *
+ * Every conversion has a xxx_length() which returns the exact length of the
+ * output, so the caller allocates once and converts once:
+ *
+ *	size_t length = utf8_to_wide_length(s, n);
+ *	wstring ws(length, 0);
+ *	utf8_to_wide(s, n, &ws[0]);
+ *
+ * The runs of ASCII are checked and converted 16 bytes at a time (SSE2).
+ * The ill-formed sequences (and the lone surrogates in UTF-8 or UTF-16
+ * input) are replaced by U+FFFD, a maximal ill-formed part by one U+FFFD.
+ *
+ * See utf82ws() and ws2utf8() of string.h for the strings.
+ */
+#include "common.h"
+XL_BEGIN
+
+enum TEXT_ENCODING {
+	TE_UNKNOWN = 0,    // no BOM
+	TE_UTF8,           // EF BB BF
+	TE_UTF16LE,        // FF FE
+	TE_UTF16BE         // FE FF
+};
+
+/**
+ * @param bomLength If not NULL, receives the length of the BOM in bytes, 0 for TE_UNKNOWN
+ */
+TEXT_ENCODING detect_bom (const void *data, size_t length, size_t *bomLength = NULL);
+
+bool is_ascii (const char *s, size_t n);
+bool is_ascii (const wchar_t *s, size_t n);
+/**
+ * @return true if s[0, n) is well-formed UTF-8
+ */
+bool utf8_validate (const char *s, size_t n);
+
+/**
+ * widen or narrow the characters below 0x80, s must be is_ascii()
+ */
+void ascii_to_wide (const char *s, size_t n, wchar_t *dst);
+void wide_to_ascii (const wchar_t *s, size_t n, char *dst);
+
+/**
+ * @return the number of wchar_t written, which is utf8_to_wide_length()
+ */
+size_t utf8_to_wide_length (const char *s, size_t n);
+size_t utf8_to_wide (const char *s, size_t n, wchar_t *dst);
+
+/**
+ * @return the number of bytes written, which is wide_to_utf8_length()
+ */
+size_t wide_to_utf8_length (const wchar_t *s, size_t n);
+size_t wide_to_utf8 (const wchar_t *s, size_t n, char *dst);
+
+/**
+ * @param bytes An odd last byte is ignored
+ * @return the number of wchar_t written, which is utf16_to_wide_length()
+ */
+size_t utf16_to_wide_length (const void *data, size_t bytes, bool bigEndian);
+size_t utf16_to_wide (const void *data, size_t bytes, bool bigEndian, wchar_t *dst);
+
+XL_END
+#endif
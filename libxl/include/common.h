@@ -13,6 +13,9 @@
 #define DP_BEGIN namespace dp {
 #define DP_END }
 
+#define PMR_BEGIN namespace pmr {
+#define PMR_END }
+
 //////////////////////////////////////////////////////////////////////////
 // typedef 
 #ifdef _MSC_VER
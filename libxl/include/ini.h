@@ -2,26 +2,39 @@
 #define XL_INI_H
 /**
  * A simple ini processor
+ *
+ * The keys and the values are allocated from the resource given, so an arena
+ * holds a whole ini and frees it at once:
+ *
+ *	pmr::CMonotonicArena arena(16 * 1024);
+ *	CIni ini(path, &arena);
  */
 #include <map>
 #include "common.h"
 #include "string.h"
+#include "MemoryResource.h"
 XL_BEGIN
 
 class CIni {
 	tstring                                        m_fileName;
+	pmr::IMemoryResource                          *m_resource;
 
-	typedef std::map<tstring, tstring>             _KVType;
-	typedef std::map<tstring, _KVType>             _MapType;
+	typedef pmr::map<pmr::tstring, pmr::tstring>::type _KVType;
+	typedef pmr::map<pmr::tstring, _KVType>::type  _MapType;
 	_MapType                                       m_ini;
 
 	tstring _LoadFile ();
 	void _Load ();
+	_KVType& _GetSection (const tstring_view &section);
+	void _Set (_KVType &kv, const tstring_view &key, const tstring_view &value);
 
 public:
 	typedef _KVType::iterator                      Iterator;
 
-	CIni (const tstring &file);
+	/**
+	 * @param resource NULL for pmr::get_default_resource()
+	 */
+	CIni (const tstring &file, pmr::IMemoryResource *resource = NULL);
 
 	Iterator begin (const tstring &section);
 	Iterator end (const tstring &section);
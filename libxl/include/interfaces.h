@@ -45,6 +45,19 @@ public:
 	virtual bool operator() () = 0;
 };
 
+//////////////////////////////////////////////////////////////////////////
+// IBandExecutable
+class IBandExecutable {
+public:
+	virtual ~IBandExecutable () {}
+
+	/**
+	 * process the band [band], it is called from several threads at the same time.
+	 * @return false to stop processing the remaining bands
+	 */
+	virtual bool operator() (uint band) = 0;
+};
+
 
 XL_END
 #endif
@@ -32,5 +32,66 @@ public:
 
 
 
+//////////////////////////////////////////////////////////////////////////
+/// read write lock, a slim reader/writer lock where available (vista and later),
+/// a critical section otherwise (the readers exclude each other then)
+/// It is not recursive, neither in the shared mode nor in the exclusive one.
+
+class CReadWriteLock : public ILockable
+{
+protected:
+	mutable void                                  *m_srw;        // SRWLOCK
+	mutable CRITICAL_SECTION                       m_cs;
+
+public:
+	CReadWriteLock ();
+	virtual ~CReadWriteLock ();
+
+	/**
+	 * exclusive
+	 */
+	virtual void lock () const;
+	virtual void unlock () const;
+	/**
+	 * always false with SRW before windows 7
+	 */
+	virtual bool tryLock () const;
+
+	void lockShared () const;
+	void unlockShared () const;
+
+	/**
+	 * if the readers run in parallel
+	 */
+	static bool isSlim ();
+};
+
+
+
+//////////////////////////////////////////////////////////////////////////
+/// once guard, for the function-local statics: VS2010 does not construct them
+/// thread safely. The first caller constructs, the others wait for it, and
+/// after that nobody locks. The state is zero before any code runs.
+///
+///	static volatile LONG once = 0;
+///	CScopeOnce so(&once);
+///	static CFoo foo;
+///	return &foo;
+
+class CScopeOnce
+{
+	volatile LONG                                 *m_state;
+	bool                                           m_first;
+
+	CScopeOnce (const CScopeOnce &);
+	CScopeOnce& operator = (const CScopeOnce &);
+
+public:
+	CScopeOnce (volatile LONG *state);
+	~CScopeOnce ();
+};
+
+
+
 XL_END
 #endif
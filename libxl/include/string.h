@@ -12,6 +12,9 @@
 #include <functional>
 #include <windows.h>
 #include "common.h"
+#include "StringView.h"
+#include "Unicode.h"
+#include "CaseFold.h"
 
 #ifdef max // <windows.h> defines max & min
 #define RESTORE_MIN_MAX
@@ -32,78 +35,26 @@ template< class CharT,
 protected:
 	typedef std::basic_string<CharT, Traits, Allocator> _Base;
 
-	void _TrimSingle (CharT c) {
-		const CharT *s = c_str();
-		const CharT *p = s;
-		while (*p == c) {
-			++ p;
-		}
-		size_t start = p - s;
-		size_t end = start;
-		if (*p != 0) { // not reach the end, so we begin from the end.
-			p = s + length() - 1;
-			while (p != s && *p == c) {
-				-- p;
-			}
-			++ p;
-			end = p - s;
-			assert (end >= start);
-		}
-		MyType tmp = substr(start, end - start);
-		std::swap(*this, tmp);
-	}
-
-	void _TrimMulti (const CharT *charlist) {
-		assert (charlist);
-		const CharT *l = NULL;
-		const CharT *s = c_str();
-		const CharT *p = s;
-		while (*p != NULL) {
-			CharT c = *p;
-			l = charlist;
-			bool matched = false;
-			while (*l != NULL) {
-				if (*l == c) {
-					matched = true;
-					break;
-				}
-				++ l;
-			}
-			if (matched) {
-				++ p;
-			} else {
-				break;
-			}
+	/**
+	 * erase the characters of charlist (' ' if NULL) at the ends, in place, so
+	 * nothing is allocated; the ends are found by the kernels of CharScan.h
+	 */
+	void _Trim (const CharT *charlist, bool left, bool right) {
+		assert (!charlist || *charlist != 0);
+		const CharT space = (CharT)' ';
+		const CharT *set = charlist == NULL ? &space : charlist;
+		size_t setLength = charlist == NULL ? 1 : Traits::length(charlist);
+
+		size_t end = this->length();
+		if (right) {
+			size_t last = CharScanT<CharT, Traits>::last(this->data(), end, set, setLength, false);
+			end = last == (size_t)-1 ? 0 : last + 1;
+			this->erase(end);
 		}
-		// now *p is not in [charlist]
-		size_t start = p - s;
-		size_t end = start;
-		if (*p != NULL) { // not reach the end, so we search from the end
-			p = s + length() - 1;
-			while (p != s) {
-				CharT c = *p;
-				l = charlist;
-				bool matched = false;
-				while (*l != NULL) {
-					if (*l == c) {
-						matched = true;
-						break;
-					}
-					++ l;
-				}
-				if (matched) {
-					-- p;
-				} else {
-					break;
-				}
-			}
-			// now *p is not in [charlist]
-			++ p;
-			end = p - s;
-			assert (end > start);
+		if (left && end > 0) {
+			size_t start = CharScanT<CharT, Traits>::first(this->data(), end, set, setLength, false);
+			this->erase(0, start == (size_t)-1 ? end : start);
 		}
-		MyType tmp = substr(start, end - start);
-		std::swap(*this, tmp);
 	}
 
 public:
@@ -127,6 +78,26 @@ public:
 		: _Base(_Ptr) {}
 	basic_string (size_type _Count, CharT _Ch)
 		: _Base(_Count, _Ch) {}
+	explicit basic_string (const basic_string_view<CharT, Traits> &_View)
+		: _Base(_View.data(), _View.length()) {}
+	/**
+	 * a copy of a string of another allocator, such as a pmr::tstring
+	 */
+	template <class OtherAllocator>
+	basic_string (const std::basic_string<CharT, Traits, OtherAllocator> &_Right)
+		: _Base(_Right.data(), _Right.length()) {}
+
+	// with an allocator, see MemoryResource.h
+	explicit basic_string (const Allocator &_Al)
+		: _Base(_Al) {}
+	basic_string (const CharT *_Ptr, size_type _Count, const Allocator &_Al)
+		: _Base(_Ptr, _Count, _Al) {}
+	basic_string (const CharT *_Ptr, const Allocator &_Al)
+		: _Base(_Ptr, _Al) {}
+	basic_string (size_type _Count, CharT _Ch, const Allocator &_Al)
+		: _Base(_Count, _Ch, _Al) {}
+	basic_string (const basic_string_view<CharT, Traits> &_View, const Allocator &_Al)
+		: _Base(_View.data(), _View.length(), _Al) {}
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -136,6 +107,9 @@ public:
 
 	/**
 	 * @brief A common used function for replacing 
+	 * The matches are found first, then the result is built once with its
+	 * exact length, so it is linear in the length and not in the matches.
+	 * See CStringReplacerT (StringReplacer.h) for many searches in one scan.
 	 */
 	int replace (
 	             const MyType &search,
@@ -145,28 +119,42 @@ public:
 		assert (search.length() > 0);
 		assert (count > 0 || count == -1);
 
+		if (search.empty() || count == 0) {
+			return 0; // an empty search would match at every offset
+		}
 		if (count == -1) {
 			count = std::numeric_limits<int>::max();
 		}
-		if (length() < search.length()) {
+		if (this->length() < search.length()) {
 			return 0;
 		}
 
-		int replaced = 0;
+		std::vector<size_t> offsets;
 		size_t start = 0;
 		do {
-			size_t offset = find(search, start);
-			if (offset == npos) {
+			size_t offset = this->find(search, start);
+			if (offset == MyType::npos) {
 				break;
 			}
-			erase(offset, search.length());
-			insert(offset, replace);
+			offsets.push_back(offset);
+			start = offset + search.length();
+		} while ((int)offsets.size() < count);
+		if (offsets.empty()) {
+			return 0;
+		}
 
-			start = offset + replace.length();
-			replaced ++;
-		} while (replaced < count);
+		MyType result;
+		result.reserve(this->length() - offsets.size() * search.length() + offsets.size() * replace.length());
+		start = 0;
+		for (std::vector<size_t>::const_iterator it = offsets.begin(); it != offsets.end(); ++ it) {
+			result.append(*this, start, *it - start);
+			result.append(replace);
+			start = *it + search.length();
+		}
+		result.append(*this, start, MyType::npos);
+		this->swap(result);
 
-		return replaced;
+		return (int)offsets.size();
 	}
 
 	/**
@@ -175,15 +163,36 @@ public:
 	 *  if NULL, trim all ' ' from the begin and the end.
 	 *  else, trim charlist[0], charlist[1]... from the begin and the end.
 	 * @note pass charlist = "" is forbidden because it make no sense.
+	 * @note The characters are erased in place, nothing is allocated.
 	 */
 	void trim (const CharT *charlist = NULL) {
-		assert (!charlist || *charlist != 0);
-		if (charlist == NULL || charlist[1] == 0) { // single
-			CharT c = charlist == NULL ? (CharT)' ' : charlist[0];
-			_TrimSingle(c);
-		} else { // many
-			_TrimMulti(charlist);
-		}
+		_Trim(charlist, true, true);
+	}
+	/**
+	 * trim() the begin only
+	 */
+	void ltrim (const CharT *charlist = NULL) {
+		_Trim(charlist, true, false);
+	}
+	/**
+	 * trim() the end only
+	 */
+	void rtrim (const CharT *charlist = NULL) {
+		_Trim(charlist, false, true);
+	}
+
+	/**
+	 * the trimmed part as a view, the string is not changed and nothing is
+	 * allocated; the view is valid until the string is changed
+	 */
+	basic_string_view<CharT, Traits> trimmed_view (const CharT *charlist = NULL) const {
+		return basic_string_view<CharT, Traits>(this->data(), this->length()).trimmed(charlist);
+	}
+	basic_string_view<CharT, Traits> ltrimmed_view (const CharT *charlist = NULL) const {
+		return basic_string_view<CharT, Traits>(this->data(), this->length()).ltrimmed(charlist);
+	}
+	basic_string_view<CharT, Traits> rtrimmed_view (const CharT *charlist = NULL) const {
+		return basic_string_view<CharT, Traits>(this->data(), this->length()).rtrimmed(charlist);
 	}
 
 	/**
@@ -201,20 +210,11 @@ typedef basic_string<wchar_t, std::char_traits<wchar_t>, std::allocator<wchar_t>
 typedef basic_string<tchar, std::char_traits<tchar>, std::allocator<tchar> >         tstring;
 
 //////////////////////////////////////////////////////////////////////////
-// case insensitive comparer
+// case insensitive comparer, see CaseFold.h for the equality and the hash
 template <class T>
 struct tstring_iless : public std::binary_function <T, T, bool> {
-	bool operator () (const T &lhs, const T &rhs) const;
-};
-
-template <>
-struct tstring_iless <tstring> : public std::binary_function <tstring, tstring, bool> {
-	bool operator () (const tstring &lhs, const tstring &rhs) const {
-		if (_tcsicmp(lhs.c_str(), rhs.c_str()) < 0) {
-			return true;
-		} else {
-			return false;
-		}
+	bool operator () (const T &lhs, const T &rhs) const {
+		return icompare(lhs.data(), lhs.length(), rhs.data(), rhs.length()) < 0;
 	}
 };
 
@@ -225,30 +225,21 @@ template <class CharT>
 struct ExplodeT {
 	typedef std::vector<basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > > ValueT;
 };
+/**
+ * copy the parts cut by CSplitterT, which allocates nothing, use it instead
+ * when the parts do not need to be kept
+ */
 template <class CharT>
 typename ExplodeT<CharT>::ValueT
 explode (const basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > &delimiter,
          const basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > &str, 
          int max_parts = -1
         ) {
-	if (max_parts == -1) {
-		max_parts = std::numeric_limits<int>::max();
-	}
-	-- max_parts;
-	std::vector<basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > > ret;
-	basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> > s = str;
-	int parts = 0;
-	while (parts < max_parts) {
-		size_t offset = s.find(delimiter);
-		if (offset == std::string::npos) {
-			break;
-		}
-		ret.push_back(s.substr(0, offset));
-		s = s.substr(offset + delimiter.length());
-		++ parts;
-	}
-	if (s.length() > 0) {
-		ret.push_back(s);
+	typename ExplodeT<CharT>::ValueT ret;
+	CSplitterT<CharT> splitter(str, delimiter, max_parts);
+	basic_string_view<CharT> token;
+	while (splitter.next(token)) {
+		ret.push_back(basic_string<CharT, std::char_traits<CharT>, std::allocator<CharT> >(token));
 	}
 	return ret;
 }
@@ -274,13 +265,30 @@ explode (const CharT *delimiter,
 
 //////////////////////////////////////////////////////////////////////////
 // !!!! BELOW HAVE NOT BEEN TESTED !!!!!
+/**
+ * the ANSI code page to and from wchar_t on Windows (UTF-8 elsewhere), the
+ * ASCII strings are converted without the API
+ */
 inline wstring s2ws (const string &s) {
-	const char *p = s.c_str();
-	int wlen = MultiByteToWideChar(CP_ACP, 0, p, s.length(), NULL, 0);
-	std::auto_ptr<wchar_t> wp(new wchar_t[wlen + 1]);
-	MultiByteToWideChar(CP_ACP, 0, p, s.length(), wp.get(), wlen);
 	wstring ws;
-	ws.append(wp.get(), wlen);
+	if (s.empty()) {
+		return ws;
+	}
+	if (is_ascii(s.data(), s.length())) {
+		ws.resize(s.length());
+		ascii_to_wide(s.data(), s.length(), &ws[0]);
+		return ws;
+	}
+#ifdef _WIN32
+	// a character is never less bytes than wchar_t, so it is converted once
+	// into the upper bound
+	ws.resize(s.length());
+	int wlen = MultiByteToWideChar(CP_ACP, 0, s.data(), (int)s.length(), &ws[0], (int)ws.length());
+	ws.resize(wlen);
+#else
+	ws.resize(utf8_to_wide_length(s.data(), s.length()));
+	utf8_to_wide(s.data(), s.length(), &ws[0]);
+#endif
 	return ws;
 }
 
@@ -293,12 +301,23 @@ inline tstring s2ts (const string &s) {
 }
 
 inline string ws2s (const wstring &ws) {
-	const wchar_t *wp = ws.c_str();
-	int len = WideCharToMultiByte(CP_ACP, 0, wp, ws.length(), NULL, 0, NULL, NULL);
-	std::auto_ptr<char> p(new char[len + 1]);
-	WideCharToMultiByte(CP_ACP, 0, wp, ws.length(), p.get(), len, NULL, NULL);
 	string s;
-	s.append(p.get(), len);
+	if (ws.empty()) {
+		return s;
+	}
+	if (is_ascii(ws.data(), ws.length())) {
+		s.resize(ws.length());
+		wide_to_ascii(ws.data(), ws.length(), &s[0]);
+		return s;
+	}
+#ifdef _WIN32
+	int len = WideCharToMultiByte(CP_ACP, 0, ws.data(), (int)ws.length(), NULL, 0, NULL, NULL);
+	s.resize(len);
+	WideCharToMultiByte(CP_ACP, 0, ws.data(), (int)ws.length(), &s[0], len, NULL, NULL);
+#else
+	s.resize(wide_to_utf8_length(ws.data(), ws.length()));
+	wide_to_utf8(ws.data(), ws.length(), &s[0]);
+#endif
 	return s;
 }
 
@@ -326,6 +345,58 @@ inline string ts2s (const tstring &ts) {
 #endif
 }
 
+/**
+ * UTF-8 to and from wchar_t, by Unicode.h, with one allocation
+ */
+inline wstring utf82ws (const char *s, size_t length) {
+	wstring ws;
+	size_t wlen = utf8_to_wide_length(s, length);
+	if (wlen > 0) {
+		ws.resize(wlen);
+		utf8_to_wide(s, length, &ws[0]);
+	}
+	return ws;
+}
+
+inline wstring utf82ws (const string &s) {
+	return utf82ws(s.data(), s.length());
+}
+
+inline string ws2utf8 (const wstring &ws) {
+	string s;
+	size_t len = wide_to_utf8_length(ws.data(), ws.length());
+	if (len > 0) {
+		s.resize(len);
+		wide_to_utf8(ws.data(), ws.length(), &s[0]);
+	}
+	return s;
+}
+
+inline tstring utf82ts (const string &s) {
+#ifdef UNICODE
+	return utf82ws(s);
+#else
+	return ws2s(utf82ws(s));
+#endif
+}
+
+inline string ts2utf8 (const tstring &ts) {
+	return ws2utf8(ts2ws(ts));
+}
+
+/**
+ * UTF-16 bytes (LE or BE, without the BOM) to wchar_t, with one allocation
+ */
+inline wstring utf162ws (const void *data, size_t bytes, bool bigEndian) {
+	wstring ws;
+	size_t wlen = utf16_to_wide_length(data, bytes, bigEndian);
+	if (wlen > 0) {
+		ws.resize(wlen);
+		utf16_to_wide(data, bytes, bigEndian, &ws[0]);
+	}
+	return ws;
+}
+
 XL_END
 
 
@@ -4,6 +4,7 @@
 #include <atlbase.h>
 #include <atlapp.h>
 #include "ResMgr.h"
+#include "Preloader.h"
 
 #pragma comment (linker, "/manifestdependency:\"type='win32' name='Microsoft.Windows.Common-Controls' version='6.0.0.0' processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 
@@ -14,6 +15,7 @@ UI_BEGIN
 template <class T>
 class CApplicationT : public CAppModule {
 	CMessageLoop m_msgLoop;
+	CPreloader m_preloader;
 	bool m_initialized;
 
 protected:
@@ -33,6 +35,13 @@ protected:
 		return NULL;
 	}
 
+	/**
+	 * the resources of the first frame, loaded on the pool threads while
+	 * createMainWindow() runs, see CPreloader
+	 */
+	virtual void getPreloadManifest (CPreloadManifest & /* manifest */) {
+	}
+
 	virtual void preRun () {
 	}
 
@@ -41,6 +50,13 @@ protected:
 
 
 public:
+	/**
+	 * the timings of the preload, after createMainWindow()
+	 */
+	const CPreloader* getPreloader () const {
+		return &m_preloader;
+	}
+
 	static T* getInstance () {
 		static T This;
 		return &This;
@@ -73,12 +89,18 @@ public:
 		AddMessageLoop(&m_msgLoop);
 
 		T *p = (T *)this;
+		CPreloadManifest manifest;
+		p->getPreloadManifest(manifest);
+		m_preloader.start(manifest);
+
 		HWND hWnd = p->createMainWindow(lpstrCmdLine, nCmdShow);
 		if (!hWnd) {
 			::MessageBox(0, _T("Create main window failed!"), NULL, 0);
 			::PostQuitMessage(-1);
 		}
 
+		// the first paint finds them loaded
+		m_preloader.wait();
 		::UpdateWindow(hWnd);
 		::ShowWindow(hWnd, nCmdShow);
 
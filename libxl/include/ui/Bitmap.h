@@ -2,6 +2,7 @@
 #define XL_UI_BITMAP_H
 #include <memory>
 #include "../common.h"
+#include "../string.h"
 #include "DIBSection.h"
 XL_BEGIN
 UI_BEGIN
@@ -25,6 +26,7 @@ public:
 
 	bool load (HBITMAP);
 	bool load (int id); // load from resource
+	bool load (const tstring &path); // load from a file, see CImageCodec::map()
 
 	void draw (HDC hdc, int toX, int toY, int toW, int toH, int fromX, int fromY, uint op = SRCCOPY);
 	void draw (HDC hdc, int toX, int toY, int toW, int toH, int fromX, int fromY, int fromW, int fromH, uint op = SRCCOPY);
@@ -0,0 +1,152 @@
+#ifndef XL_UI_BITMAPATLAS_H
+#define XL_UI_BITMAPATLAS_H
+/**
+ * Pack the small bitmaps (the icons of the menus and the buttons) into a few
+ * large 32 bpp pages, so they are not one DIB section (and one kernel object)
+ * each, and the blits of a menu read from the same page.
+ *
+ * A page is filled by a skyline packer: the top edge of the placed sprites is
+ * kept as a list of segments, and a sprite goes where its bottom would be
+ * the lowest. The color keyed sprites go to the pages of their color key, so
+ * a page is drawn by CBitmap::draw() with its key.
+ *
+ *	CSpritePtr sprite = atlas.add(bitmap.get());
+ *	sprite->draw(hdc, x, y);
+ */
+#include <memory>
+#include <vector>
+#include "../common.h"
+#include "../lockable.h"
+#include "Bitmap.h"
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// CSkylinePacker
+
+class CSkylinePacker
+{
+	struct SEGMENT {
+		int      x;
+		int      y;
+		int      width;
+	};
+	typedef std::vector<SEGMENT>                          _SkylineType;
+
+	int                                                   m_width;
+	int                                                   m_height;
+	_SkylineType                                          m_skyline;
+	int                                                   m_used;        // the area of the rects placed
+
+	/**
+	 * @return the y of a w x h rect placed from the left of segment i, -1 if it does not fit
+	 */
+	int _Fit (size_t i, int w, int h) const;
+	void _Place (size_t i, int x, int y, int w, int h);
+
+public:
+	CSkylinePacker (int width, int height);
+
+	/**
+	 * @return false if it does not fit
+	 */
+	bool insert (int w, int h, int &x, int &y);
+	void clear ();
+	/**
+	 * the used area / the whole area
+	 */
+	double getOccupancy () const;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CSprite
+/**
+ * a rect of a page, the page lives as long as any of its sprites
+ */
+class CSprite
+{
+	CBitmapPtr                                            m_page;
+	RECT                                                  m_rect;
+
+public:
+	CSprite (CBitmapPtr page, const RECT &rect);
+
+	int getWidth () const;
+	int getHeight () const;
+	/**
+	 * the page is shared with the other sprites, and the atlas writes the new
+	 * sprites into it; a clone() of it keeps the pixels as they were
+	 */
+	CBitmapPtr getPage () const;
+	RECT getRect () const;
+
+	void draw (HDC hdc, int toX, int toY);
+	/**
+	 * stretched to toW x toH
+	 */
+	void draw (HDC hdc, int toX, int toY, int toW, int toH);
+	/**
+	 * the toW x toH part from (fromX, fromY) of the sprite, as CBitmap::draw()
+	 */
+	void draw (HDC hdc, int toX, int toY, int toW, int toH, int fromX, int fromY);
+};
+typedef std::tr1::shared_ptr<CSprite>                     CSpritePtr;
+
+
+//////////////////////////////////////////////////////////////////////////
+// CBitmapAtlas
+
+class CBitmapAtlas : private CUserLock
+{
+public:
+	static const int PAGE_SIZE = 512;
+	/**
+	 * the larger bitmaps get a page of their own
+	 */
+	static const int MAX_SPRITE_SIZE = 64;
+	/**
+	 * between the sprites, so a stretched sprite does not pick up its neighbour
+	 */
+	static const int PADDING = 1;
+
+protected:
+	struct PAGE {
+		CBitmapPtr                                        bitmap;
+		CSkylinePacker                                    packer;
+		bool                                              transparent;
+		COLORREF                                          colorKey;
+
+		PAGE (CBitmapPtr _bitmap, bool _transparent, COLORREF _colorKey)
+			: bitmap(_bitmap), packer(PAGE_SIZE, PAGE_SIZE), transparent(_transparent), colorKey(_colorKey) {}
+	};
+	typedef std::vector<PAGE>                             _PageContainer;
+
+	_PageContainer                                        m_pages;
+
+	static CBitmapPtr _CreatePage (int w, int h, bool transparent, COLORREF colorKey);
+
+public:
+	CBitmapAtlas ();
+	~CBitmapAtlas ();
+
+	/**
+	 * copy src (24 or 32 bpp) into a page
+	 * @param transparent Drawn with colorKey as the transparent color
+	 * @return NULL if failed
+	 */
+	CSpritePtr add (const CDIBSection *src, bool transparent = false, COLORREF colorKey = 0);
+	/**
+	 * forget the pages, the sprites handed out keep theirs
+	 */
+	void clear ();
+
+	/**
+	 * the shared pages, not the ones of the large bitmaps
+	 */
+	int getPageCount () const;
+};
+
+UI_END
+XL_END
+#endif
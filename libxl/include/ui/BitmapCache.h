@@ -0,0 +1,161 @@
+#ifndef XL_UI_BITMAPCACHE_H
+#define XL_UI_BITMAPCACHE_H
+/**
+ * The bitmaps of CResMgr, bounded by the bytes of their pixels.
+ *
+ * When the bytes exceed the budget, the least recently used bitmaps are
+ * evicted, except those still used outside of the cache (use_count() > 1),
+ * which are pinned: evicting them frees nothing. So the cache may stay over
+ * the budget while they are used, and is trimmed by the next insert().
+ *
+ * The entries are spread over SHARDS maps with a read write lock each, so
+ * the hits of several threads run in parallel. A hit only reads the LRU
+ * clock, which ticks on insert(), so the order is exact between two inserts
+ * and the hits never write a shared line unless the entry was not used since.
+ * The writers (insert(), clear() and the evictions) are serialized, so the
+ * bytes always count the entries of the shards.
+ * get() creates a missing bitmap once, the threads asking for the same key
+ * wait for it.
+ *
+ * The entries of a group (such as the sizes of a bitmap in a size class, see
+ * CResMgr::getBitmap()) replace each other, only the GROUP_VARIANTS most
+ * recently inserted ones are kept, so a window resized live does not fill
+ * the cache with sizes it will never paint again.
+ */
+#include <deque>
+#include <map>
+#include <utility>
+#include "../common.h"
+#include "../lockable.h"
+#include "../utilities.h"
+#include "Bitmap.h"
+XL_BEGIN
+UI_BEGIN
+
+class CBitmapCache
+{
+public:
+	enum CATEGORY {
+		BC_BITMAP = 0,     // CResMgr::getBitmap()
+		BC_TRANS,          // CResMgr::getTransBitmap()
+		BC_SIZED,          // CResMgr::getBitmap() of a size
+		BC_COUNT
+	};
+
+	struct STATS {
+		uint     entries;
+		uint64   bytes;
+		uint     hits;
+		uint     misses;
+		uint     evictions;
+	};
+
+	static const uint64 DEFAULT_BUDGET = 64 * 1024 * 1024;
+	static const uint SHARDS = 16;
+	static const uint GROUP_VARIANTS = 4;
+
+protected:
+	typedef std::pair<int, uint64>                        _KeyType;
+
+	struct ENTRY {
+		CBitmapPtr                                        bitmap;
+		uint64                                            bytes;
+		volatile uint                                     lastUse;
+	};
+	typedef std::map<_KeyType, ENTRY>                     _EntryContainer;
+	typedef std::map<_KeyType, std::deque<uint64> >       _GroupContainer; // the keys, the last inserted first
+
+	struct SHARD {
+		CReadWriteLock                                    lock;
+		_EntryContainer                                   entries;
+		volatile LONG                                     hits[BC_COUNT];
+		volatile LONG                                     misses[BC_COUNT];
+		STATS                                             stats[BC_COUNT]; // entries, bytes and evictions, by the writers
+	};
+
+	SHARD                                                 m_shards[SHARDS];
+	CUserLock                                             m_creating[SHARDS];
+	CUserLock                                             m_trimLock;    // m_bytes, m_budget, m_groups and the writers, taken before a shard lock
+	_GroupContainer                                       m_groups;
+	volatile uint                                         m_clock;
+	uint64                                                m_budget;
+	uint64                                                m_bytes;
+
+	CBitmapCache (const CBitmapCache &);
+	CBitmapCache& operator = (const CBitmapCache &);
+
+	static uint _ShardOf (const _KeyType &key);
+	static uint64 _Bytes (const CBitmap *bitmap);
+	/**
+	 * no statistics
+	 */
+	CBitmapPtr _Find (const _KeyType &key);
+	/**
+	 * counted as an eviction, with m_trimLock held
+	 * @param keepPinned Do nothing if the bitmap is used outside
+	 */
+	bool _Erase (const _KeyType &key, bool keepPinned);
+	/**
+	 * key is the last inserted of the group, drop the variants beyond GROUP_VARIANTS
+	 */
+	void _Group (const _KeyType &group, uint64 key);
+	/**
+	 * evict the unpinned bitmaps from the LRU end until the bytes fit the budget
+	 */
+	void _Trim ();
+
+public:
+	CBitmapCache (uint64 budget = DEFAULT_BUDGET);
+	~CBitmapCache ();
+
+	/**
+	 * @return NULL if not cached (a miss)
+	 */
+	CBitmapPtr find (CATEGORY category, uint64 key);
+	/**
+	 * replace the bitmap of the key if any, and trim to the budget
+	 * @param group 0 for none
+	 */
+	void insert (CATEGORY category, uint64 key, CBitmapPtr bitmap, uint64 group = 0);
+	/**
+	 * the bitmap of the key, created by creator() and inserted if missing.
+	 * The creators of the same key never run at the same time.
+	 */
+	template <class CREATOR>
+	CBitmapPtr get (CATEGORY category, uint64 key, const CREATOR &creator, uint64 group = 0);
+	/**
+	 * remove all bitmaps, pinned or not, the statistics are kept
+	 */
+	void clear ();
+
+	void setBudget (uint64 budget);
+	uint64 getBudget () const;
+	/**
+	 * of all categories
+	 */
+	uint64 getBytes () const;
+	STATS getStats (CATEGORY category) const;
+};
+
+template <class CREATOR>
+CBitmapPtr CBitmapCache::get (CATEGORY category, uint64 key, const CREATOR &creator, uint64 group) {
+	CBitmapPtr bitmap = find(category, key);
+	if (bitmap) {
+		return bitmap;
+	}
+
+	_KeyType k(category, key);
+	CScopeLock sl(&m_creating[_ShardOf(k)]);
+	bitmap = _Find(k); // created by another thread meanwhile
+	if (!bitmap) {
+		bitmap = creator();
+		if (bitmap) {
+			insert(category, key, bitmap, group);
+		}
+	}
+	return bitmap;
+}
+
+UI_END
+XL_END
+#endif
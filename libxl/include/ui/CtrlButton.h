@@ -22,7 +22,7 @@ protected:
 
 	//////////////////////////////////////////////////////////////////////////
 	// protected virtual methods
-	virtual void _ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw);
+	virtual void _ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw);
 
 public:
 	CCtrlButton (uint id, const tstring &text = _T(""), uint idImg = 0, bool imgTrans = false, COLORREF clrKey = RGB(255, 0, 255));
@@ -47,11 +47,14 @@ class CCtrlImageButton : public CCtrlButton
 	COLORREF          *m_pColorKey;
 protected:
 
-	CBitmapPtr _GetImage();
+	/**
+	 * of the size of the client rect, except the transparent ones, which are stretched when drawn
+	 */
+	CBitmapPtr _GetImage(int width, int height);
 
 	//////////////////////////////////////////////////////////////////////////
 	// protected virtual methods
-	virtual void _ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw);
+	virtual void _ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw);
 
 public:
 	CCtrlImageButton (uint id, uint normalId = 0, uint hoverId = 0, uint pushId = 0, bool bitmapTrans = false, COLORREF colorKey = RGB(255, 0, 255));
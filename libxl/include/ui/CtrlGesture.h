@@ -21,7 +21,7 @@ class CCtrlGesture : public CControl
 	bool                   m_isTimeout;
 
 protected:
-	virtual void _ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw);
+	virtual void _ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw);
 
 public:
 	CCtrlGesture (CCtrlMain *pCtrlMain);
@@ -27,7 +27,7 @@ protected:
 protected:
 	//////////////////////////////////////////////////////////////////////////
 	// protected virtual methods
-	virtual void _ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw);
+	virtual void _ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw);
 
 // 	virtual void _DrawThumb (HDC);
 // 	virtual void _DrawThumbHover (HDC);
@@ -0,0 +1,37 @@
+#ifndef XL_UI_DIBCONVERTER_H
+#define XL_UI_DIBCONVERTER_H
+#include "../common.h"
+#include "DIBSection.h"
+
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// Convert Engine
+/**
+ * 24 <-> 32 bpp conversion kernels.
+ * With SSSE3, 16 pixels are moved per step by pshufb, the stores are aligned
+ * when the destination row is (see CDIBSection::STRIDE_ALIGN_CACHELINE).
+ * Without it, a scalar loop is used.
+ */
+class CConvertEngine
+{
+public:
+	/**
+	 * @param src The source DIB, 24 or 32 bpp
+	 * @param dst The destination DIB, 24 or 32 bpp, must have the same size of src
+	 * @param alpha The alpha of dst when converting 24 bpp to 32 bpp
+	 */
+	static bool convert (const CDIBSection *src, CDIBSection *dst, uint8 alpha = 255);
+
+	/**
+	 * convert count pixels, src and dst must not overlap
+	 */
+	static void convert24to32 (const uint8 *src, uint8 *dst, uint count, uint8 alpha = 255);
+	static void convert32to24 (const uint8 *src, uint8 *dst, uint count);
+};
+
+
+UI_END
+XL_END
+#endif
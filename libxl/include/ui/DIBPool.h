@@ -0,0 +1,112 @@
+#ifndef XL_UI_DIBPOOL_H
+#define XL_UI_DIBPOOL_H
+#include <list>
+#include "../common.h"
+#include "../lockable.h"
+#include "DIBSection.h"
+
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// DIB Pool
+/**
+ * Recycles the pixel buffers of short lived DIBs, such as the intermediates
+ * of the resizer and the back buffers of painting.
+ *
+ * A pooled DIB lives on a page file backed section whose size is rounded up
+ * to a size class (4 classes per power of 2, 64K at least), so a released
+ * buffer is reused by any later lease of the same class, the bitmap is
+ * recreated on the kept section if the shape differs.
+ * Each thread keeps the last THREAD_CACHE_SIZE released buffers for itself,
+ * the others go to a shared LRU list. The capacity bounds both: the shared
+ * list is trimmed first, then the thread caches are flushed.
+ */
+class CDIBPool : private CUserLock
+{
+public:
+	struct STATS {
+		uint     leases;
+		uint     reused;      // served by a released buffer, threadHits included
+		uint     threadHits;  // served by the cache of the calling thread
+		uint     reshaped;    // the bitmap was recreated on a reused section
+		uint     created;
+		uint     trimmed;
+		uint64   idleBytes;   // held by the shared list and the thread caches
+		uint64   threadBytes; // held by the thread caches
+	};
+
+	static const uint THREAD_CACHE_SIZE = 2;
+	/**
+	 * larger buffers skip the thread cache
+	 */
+	static const uint64 THREAD_CACHE_MAX_BYTES = 16 * 1024 * 1024;
+	static const uint64 DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+protected:
+	typedef std::list<CDIBSection *>               _DIBContainer; // MRU first
+	struct _ThreadCache;
+
+	_DIBContainer                                  m_idle;
+	_ThreadCache                                  *m_caches;     // of the living threads
+	volatile LONG                                  m_threadUnits; // the bytes of the thread caches / 64K
+	uint64                                         m_capacity;
+	bool                                           m_largePages;
+	STATS                                          m_stats;
+	DWORD                                          m_fls;
+
+	CDIBPool ();
+	~CDIBPool ();
+
+	static uint64 _Capacity (CDIBSection *dib);
+	uint64 _SectionSize (uint64 classSize) const;
+	bool _Fits (CDIBSection *dib, uint64 classSize) const;
+	static bool _HasShape (CDIBSection *dib, int w, int h, int bitcount, uint stridealign);
+	CDIBSection* _TakeFromThread (int w, int h, int bitcount, uint stridealign, uint64 classSize);
+	CDIBSection* _TakeIdle (int w, int h, int bitcount, uint stridealign, uint64 classSize);
+	CDIBSection* _Create (int w, int h, int bitcount, uint stridealign, uint64 classSize);
+	void _PutIdle (CDIBSection *dib);
+	uint64 _ThreadBytes () const;
+	void _FlushThreads ();
+	void _Trim (uint64 bytes);
+	void _Release (CDIBSection *dib);
+
+	static void _Recycle (CDIBSection *dib);
+	static void __stdcall _FlsCallback (void *data);
+
+public:
+	static CDIBPool* getInstance ();
+
+	/**
+	 * the content of the DIB is undefined, it goes back to the pool when the last reference goes
+	 */
+	CDIBSectionPtr lease (int w, int h, int bitcount = 32, uint stridealign = CDIBSection::STRIDE_ALIGN_DEFAULT);
+
+	/**
+	 * the bytes the shared list and the thread caches may hold, the buffers
+	 * on lease are not counted
+	 */
+	void setCapacity (uint64 bytes);
+	uint64 getCapacity () const;
+	/**
+	 * back the classes not smaller than the large page minimum with large pages,
+	 * the process needs SeLockMemoryPrivilege enabled, falls back to small pages silently
+	 */
+	void setLargePages (bool enable);
+	/**
+	 * flush the thread caches to the shared list, and free it down to bytes
+	 */
+	void trim (uint64 bytes = 0);
+
+	STATS getStats () const;
+
+	/**
+	 * a multiple of 64K
+	 */
+	static uint64 getClassSize (uint64 bytes);
+};
+
+
+UI_END
+XL_END
+#endif
@@ -25,15 +25,15 @@ public:
 	CWeightsTable(CGenericFilter *pFilter, uint uDstSize, uint uSrcSize);
 	~CWeightsTable();
 
-	inline double getWeight(int dst_pos, int src_pos) {
+	inline double getWeight(int dst_pos, int src_pos) const {
 		return m_WeightTable[dst_pos].Weights[src_pos];
 	}
 
-	int getLeftBoundary(int dst_pos) {
+	int getLeftBoundary(int dst_pos) const {
 		return m_WeightTable[dst_pos].Left;
 	}
 
-	int getRightBoundary(int dst_pos) {
+	int getRightBoundary(int dst_pos) const {
 		return m_WeightTable[dst_pos].Right;
 	}
 };
@@ -56,16 +56,55 @@ public:
 	 * @param dst_height Destination image height
 	 * @return Returns the scaled image if successful, returns NULL otherwise
 	*/
-	// CDIBSectionPtr scale(CDIBSection *src, uint dst_width, uint dst_height);
-	bool scale(CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback = NULL);
+	// CDIBSectionPtr scale(const CDIBSection *src, uint dst_width, uint dst_height);
+	bool scale(const CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback = NULL);
 
-	bool horizontalFilter(CDIBSection *src, uint src_height,
+	/** Scale and rotate an image in one go
+	 * @param ot For the transposing orientations, the first pass reads the source rows
+	 * and writes the intermediate columns, so the rotation costs no extra pass.
+	 * dst must have the rotated size.
+	*/
+	bool scale(const CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback, CDIBSection::ORIENTATION ot);
+
+	bool horizontalFilter(const CDIBSection *src, uint src_height,
 		CDIBSection *dst, uint dst_offset, uint dst_height,
 		ILongTimeRunCallback *pCallback);
-	bool verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback);
+	bool verticalFilter(const CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback);
+
+	/**
+	 * filter every row of src to the height of dst, and write it as a column of dst
+	 * (dst width must be src height).
+	 * @param reverseX write the filtered row from the bottom to the top
+	 * @param reverseY write the rows from the right column to the left one
+	 */
+	bool transposedFilter(const CDIBSection *src, CDIBSection *dst, bool reverseX, bool reverseY,
+		ILongTimeRunCallback *pCallback);
+
+	/**
+	 * the passes on a region of the image, for the tiled pipeline (see CResizeNode).
+	 * table maps the whole dst to the whole src, src holds the src pixels from src_x (src_y)
+	 * and dst receives the dst pixels from dst_x (dst_y), the other axis is not scaled.
+	 */
+	static void horizontalRegion(const CDIBSection *src, int src_x, CDIBSection *dst, int dst_x,
+		const CWeightsTable &table);
+	static void verticalRegion(const CDIBSection *src, int src_y, CDIBSection *dst, int dst_y,
+		const CWeightsTable &table);
+
+	/**
+	 * resize the sources into their rects of dst on the thread pool, see CDIBSection::compose()
+	 * Each rect is written through a view of dst, the intermediate of the two passes is
+	 * leased from CDIBPool, so no DIB is created per source once the pool is warm.
+	 */
+	static bool scaleInto(const CDIBSection::PLACEMENT *placements, uint count, CDIBSection *dst,
+		CDIBSection::RESIZE_TYPE rt, ILongTimeRunCallback *pCallback = NULL);
+
+	/**
+	 * @return NULL for RT_FAST, delete it after use
+	 */
+	static CGenericFilter* createFilter(CDIBSection::RESIZE_TYPE rt);
 
 protected:
-	void _FastScale (CDIBSection *src, CDIBSection *dst);
+	void _FastScale (const CDIBSection *src, CDIBSection *dst);
 };
 
 
@@ -0,0 +1,44 @@
+#ifndef XL_UI_DIBROTATOR_H
+#define XL_UI_DIBROTATOR_H
+#include "../common.h"
+#include "DIBSection.h"
+
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// Rotate Engine
+/**
+ * Transpose, rotate (90/180/270) and flip kernels for 24/32 bpp DIBs.
+ * The image is walked in square tiles so both the source and destination
+ * working set stay in L1/L2, 32 bpp blocks are transposed in SSE registers.
+ */
+class CRotateEngine
+{
+public:
+	/**
+	 * the tile size (in pixels) used to walk the image
+	 */
+	static const uint TILE_SIZE = 64;
+
+	/**
+	 * @param src The source DIB
+	 * @param dst The destination DIB, must have the rotated size of src, and must not be src
+	 * @param ot The transformation to apply, see CDIBSection::ORIENTATION
+	 */
+	static bool rotate (const CDIBSection *src, CDIBSection *dst, CDIBSection::ORIENTATION ot);
+
+	/**
+	 * flip the DIB in place, used after a fused resize for the non-transposing orientations
+	 */
+	static void flip (CDIBSection *dib, bool horizontal, bool vertical);
+
+	static bool isTransposed (CDIBSection::ORIENTATION ot);
+	static bool isReversedX (CDIBSection::ORIENTATION ot);
+	static bool isReversedY (CDIBSection::ORIENTATION ot);
+};
+
+
+UI_END
+XL_END
+#endif
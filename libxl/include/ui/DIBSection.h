@@ -5,12 +5,15 @@
 #include "../common.h"
 #include "../interfaces.h"
 #include "../lockable.h"
+#include "../FileMapping.h"
 #include "DIBResizerFilter.h"
 
 XL_BEGIN
 UI_BEGIN
 
 class CResizeEngine;
+class CDIBPool;
+class CImageCodec;
 class CDIBSection;
 typedef std::tr1::shared_ptr<CDIBSection>    CDIBSectionPtr;
 
@@ -18,14 +21,57 @@ class CDIBSection
 	: public std::tr1::enable_shared_from_this<CDIBSection>
 {
 	friend class CResizeEngine;
+	friend class CDIBPool;
+	friend class CImageCodec;
 protected:
-	HBITMAP                                               m_hBitmap;
+	/**
+	 * the pixels, shared by the clones until one of them writes
+	 */
+	struct STORAGE {
+		HBITMAP                                           hBitmap;      // NULL if wrapped, such as a mapped file
+		CFileMapping                                     *pFileMapping; // the section of the pixels, if not on the heap
+		void                                             *view;         // the view of pFileMapping if wrapped
+		bool                                              shareable;    // false for the pooled buffers
+
+		STORAGE () : hBitmap(NULL), pFileMapping(NULL), view(NULL), shareable(true) {}
+		~STORAGE ();
+	};
+	typedef std::tr1::shared_ptr<STORAGE>                 _StoragePtr;
+
+	_StoragePtr                                           m_storage;
+	HBITMAP                                               m_hBitmap;     // m_storage->hBitmap
 	DIBSECTION                                            m_section;
 
 	HBITMAP                                               m_hOldBitmap;
 
+	int                                                   m_width;       // the logical width, the DIB may be wider
+	int                                                   m_pitch;       // from a line to the next, negative if bottom up
+	uint                                                  m_strideAlign;
+
 protected:
 	void _Clear ();
+	/**
+	 * delete the bitmap only, the section is kept, the storage must not be shared
+	 */
+	void _ClearBitmap ();
+	/**
+	 * create the bitmap on the section of the storage if any, or on the heap
+	 */
+	bool _CreateBitmap (int w, int h, int bitcount, uint stridealign);
+	/**
+	 * copy the pixels if the storage is shared, called before any write
+	 * @param needBitmap also copy a wrapped storage into a GDI bitmap
+	 * @return false while selected into a DC, the bitmap must not change then
+	 */
+	bool _Detach (bool needBitmap = false);
+	/**
+	 * use the pixels somewhere else without copying, there is no HBITMAP then
+	 * @param pFileMapping, view Owned by the storage from now on, may be NULL
+	 * @param top The line 0
+	 * @param pitch From a line to the next, negative if the lines are bottom up
+	 * @return false if a line is longer than the pitch, pFileMapping and view are freed then
+	 */
+	bool _Wrap (CFileMapping *pFileMapping, void *view, uint8 *top, int w, int h, int bitcount, int pitch);
 
 public:
 	enum RESIZE_TYPE {
@@ -39,29 +85,137 @@ public:
 		RT_COUNT
 	};
 
+	/**
+	 * the values are the same as the EXIF orientation tag, and each one names
+	 * the transformation which brings such an image upright
+	 */
+	enum ORIENTATION {
+		OT_NORMAL = 1,
+		OT_FLIP_H,       // mirror left and right
+		OT_ROTATE_180,
+		OT_FLIP_V,       // mirror top and bottom
+		OT_TRANSPOSE,    // mirror along the top-left to bottom-right diagonal
+		OT_ROTATE_90,    // clockwise
+		OT_TRANSVERSE,   // mirror along the top-right to bottom-left diagonal
+		OT_ROTATE_270,   // clockwise
+		OT_COUNT
+	};
+
+	/**
+	 * a source of compose() and the rect of the destination it is resized to
+	 */
+	struct PLACEMENT {
+		const CDIBSection                                *src;
+		RECT                                              rect;
+	};
+
+	/**
+	 * the default stride alignment, what GDI requires
+	 */
+	static const uint STRIDE_ALIGN_DEFAULT = 4;
+	/**
+	 * every row starts on a cache line, so the kernels can use aligned full width SSE/AVX loads and stores
+	 */
+	static const uint STRIDE_ALIGN_CACHELINE = 64;
+
 	CDIBSection ();
 	virtual ~CDIBSection ();
 
-	bool create (int w, int h, int bitcount = 24, bool usefilemap = false);
+	/**
+	 * @param stridealign A power of 2, not less than 4. If larger than 4, the DIB
+	 *        is created wider than w to get such a stride, and the padding pixels
+	 *        are never shown. The bits itself are page aligned.
+	 * @param usefilemap If true, the pixels live in a temporary file mapping
+	 *        (deleted with the DIB) instead of the heap, so huge images page
+	 *        through the OS file cache.
+	 */
+	bool create (int w, int h, int bitcount = 24, bool usefilemap = false, uint stridealign = STRIDE_ALIGN_DEFAULT);
+	bool isNull () const;
 	int getWidth () const;
 	int getHeight () const;
 	int getBitCounts () const;
 	int getStride () const;
+	/**
+	 * the bytes from a line to the next, negative if the lines are bottom up in memory,
+	 * which only happens for the wrapped DIBs (see CImageCodec::map)
+	 */
+	int getPitch () const;
+	uint getStrideAlign () const;
+	bool isFileMapped () const;
+	/**
+	 * if the pixels are shared with a clone
+	 */
+	bool isShared () const;
+	/**
+	 * if made by createView(): the lines are those of another DIB, the bytes
+	 * between them (to the pitch) are its pixels
+	 */
+	bool isView () const;
+	/**
+	 * hint the access of the lines, only file mapped DIBs are affected
+	 */
+	void advise (int line, int lines, CFileMapping::ADVICE advice) const;
+
+	/**
+	 * for writing, the pixels are copied first if shared
+	 * getData() is the line 0, the lines are getPitch() apart
+	 */
 	uint8* getLine (int line);
 	uint8* getData ();
-
+	/**
+	 * for reading, never copy
+	 */
+	const uint8* getLine (int line) const;
+	const uint8* getData () const;
+
+	/**
+	 * GDI may write the DIB, so the pixels are copied first if shared
+	 */
 	bool attachToDC (HDC hdc);
 	bool tryAttachToDC (HDC hdc);
 	void detachFromDC (HDC hdc);
 	void stretchBlt (HDC hdc, int xDest, int yDest, int nDestWidth, int nDestHeight,
 		int xSrc, int ySrc, int nSrcWidth, int nSrcHeight, DWORD dwRop,
-		bool highQuality = true);
-
-	CDIBSectionPtr clone ();
-	CDIBSectionPtr cloneAndResize (int w, int h, RESIZE_TYPE rt = RT_BOX, ILongTimeRunCallback *pCallback = NULL, bool usefilemap = false);
-	bool resize (CDIBSection *dib, RESIZE_TYPE rt = RT_BOX, ILongTimeRunCallback *pCallback = NULL);
-
-	static CDIBSectionPtr createDIBSection (int w, int h, int bitcount = 24, bool usefilemap = false);
+		bool highQuality = true) const;
+
+	/**
+	 * O(1), the pixels are shared until one side writes them (except the pooled
+	 * buffers, and the DIB selected into a DC, which are copied)
+	 */
+	CDIBSectionPtr clone () const;
+	/**
+	 * a DIB on a rect of the pixels of this one, nothing is copied: writing to the view
+	 * writes to this DIB, and the view must not outlive it. There is no HBITMAP.
+	 */
+	CDIBSectionPtr createView (int x, int y, int w, int h) const;
+	CDIBSectionPtr cloneAndResize (int w, int h, RESIZE_TYPE rt = RT_BOX, ILongTimeRunCallback *pCallback = NULL, bool usefilemap = false, ORIENTATION ot = OT_NORMAL) const;
+	CDIBSectionPtr cloneAndRotate (ORIENTATION ot, bool usefilemap = false) const;
+	/**
+	 * @param bitcount 24 or 32, the alpha of 32 bpp is 255
+	 */
+	CDIBSectionPtr cloneAndConvert (int bitcount, bool usefilemap = false) const;
+	/**
+	 * @param ot if not OT_NORMAL, rotate while resizing, so dib must have the rotated size
+	 */
+	bool resize (CDIBSection *dib, RESIZE_TYPE rt = RT_BOX, ILongTimeRunCallback *pCallback = NULL, ORIENTATION ot = OT_NORMAL) const;
+	/**
+	 * resize each source straight into its rect of this DIB, such as a contact sheet
+	 * or an atlas, the sources run in parallel. The rects must not overlap, the pixels
+	 * out of the rects are left alone. A source of another bit count is converted.
+	 * @return false, nothing drawn, if a rect is empty or not inside this DIB
+	 */
+	bool compose (const PLACEMENT *placements, uint count, RESIZE_TYPE rt = RT_BOX, ILongTimeRunCallback *pCallback = NULL);
+	bool rotate (CDIBSection *dib, ORIENTATION ot) const;
+	/**
+	 * copy this into dib of the same size, converting between 24 and 32 bpp if needed
+	 */
+	bool convert (CDIBSection *dib) const;
+
+	static CDIBSectionPtr createDIBSection (int w, int h, int bitcount = 24, bool usefilemap = false, uint stridealign = STRIDE_ALIGN_DEFAULT);
+	/**
+	 * the bytes of the pixels of such a DIB
+	 */
+	static uint64 getBytes (int w, int h, int bitcount, uint stridealign = STRIDE_ALIGN_DEFAULT);
 };
 
 
@@ -0,0 +1,91 @@
+#ifndef XL_UI_DIBWARPER_H
+#define XL_UI_DIBWARPER_H
+#include "../interfaces.h"
+#include "DIBResizerFilter.h"
+#include "DIBSection.h"
+
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// Affine matrix
+/**
+ * x' = a * x + b * y + c
+ * y' = d * x + e * y + f
+ * the coordinates are of the pixel centers
+ */
+struct AFFINEMATRIX {
+	double a, b, c;
+	double d, e, f;
+
+	AFFINEMATRIX (double _a = 1, double _b = 0, double _c = 0, double _d = 0, double _e = 1, double _f = 0)
+		: a(_a), b(_b), c(_c), d(_d), e(_e), f(_f) {}
+
+	void transform (double x, double y, double &ox, double &oy) const {
+		ox = a * x + b * y + c;
+		oy = d * x + e * y + f;
+	}
+
+	/**
+	 * @return *this then m, that is, m * (*this)
+	 */
+	AFFINEMATRIX then (const AFFINEMATRIX &m) const;
+	bool invert (AFFINEMATRIX &inv) const;
+
+	static AFFINEMATRIX translation (double tx, double ty);
+	static AFFINEMATRIX scaling (double sx, double sy);
+	/**
+	 * @param degrees clockwise (y axis goes down)
+	 */
+	static AFFINEMATRIX rotation (double degrees, double cx = 0, double cy = 0);
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// Warp Engine
+/**
+ * Map an image through an affine matrix.
+ * The destination is walked row by row, the source position is stepped
+ * incrementally along a row, and only the span of the row which falls into
+ * the source is sampled. Rows are split into bands and run on the thread pool.
+ *
+ * The filters of the resizer are reused as the sampling kernels:
+ * NULL is the nearest neighbour, CBilinearFilter takes a fixed point SSE2 path,
+ * others (CBicubicFilter, CCatmullRomFilter, ...) are sampled by their own weights.
+ * There is no prefiltering, so shrink the image by CResizeEngine first if
+ * the matrix scales it down a lot.
+ */
+class CWarpEngine
+{
+private:
+	CGenericFilter* m_pFilter;
+
+public:
+	/**
+	 * rows per band
+	 */
+	static const uint BAND_HEIGHT = 32;
+
+	CWarpEngine(CGenericFilter* filter) : m_pFilter(filter) {}
+	virtual ~CWarpEngine() {}
+
+	/**
+	 * @param m Maps the src coordinates to the dst coordinates
+	 * @param background The color of dst pixels outside the src, the alpha of 32 bpp is 0
+	 * @param fill If false, the dst pixels outside the src are left untouched
+	 */
+	bool warp(const CDIBSection *src, CDIBSection *dst, const AFFINEMATRIX &m,
+		COLORREF background = RGB(255,255,255), bool fill = true,
+		ILongTimeRunCallback *pCallback = NULL);
+
+	/**
+	 * The matrix rotating a w x h image around its center, and moving the
+	 * result into a (dst_w x dst_h) box which holds it entirely.
+	 */
+	static AFFINEMATRIX rotation(double degrees, int w, int h, int &dst_w, int &dst_h);
+};
+
+
+UI_END
+XL_END
+#endif
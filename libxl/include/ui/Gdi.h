@@ -8,6 +8,7 @@
 #include "../common.h"
 #include "ResMgr.h"
 #include "DIBSection.h"
+#include "DIBPool.h"
 XL_BEGIN
 UI_BEGIN
 
@@ -179,6 +180,56 @@ public:
 //////////////////////////////////////////////////////////////////////////
 
 
+//////////////////////////////////////////////////////////////////////////
+// CMemoryDC on a 32 bpp DIB leased from CDIBPool, so the back buffers
+// are recycled between paints instead of being created every time
+class CDIBMemoryDC : public CDC
+{
+public:
+	HDC m_hDCOriginal;
+	RECT m_rcPaint;
+	CDIBSectionPtr m_dib;
+	WTL::CBitmap m_bmp; // if the pool fails
+	HBITMAP m_hBmpOld;
+	bool m_paintWhenDestroy;
+
+	CDIBMemoryDC(HDC hDC, RECT& rcPaint, bool paintWhenDestroy = true)
+		: m_hDCOriginal(hDC)
+		, m_hBmpOld(NULL)
+		, m_paintWhenDestroy(paintWhenDestroy)
+	{
+		m_rcPaint = rcPaint;
+		int w = m_rcPaint.right - m_rcPaint.left;
+		int h = m_rcPaint.bottom - m_rcPaint.top;
+		CreateCompatibleDC(m_hDCOriginal);
+		ATLASSERT(m_hDC != NULL);
+		m_dib = CDIBPool::getInstance()->lease(w, h, 32);
+		if (m_dib != NULL) {
+			m_dib->attachToDC(m_hDC);
+			PatBlt(0, 0, w, h, BLACKNESS); // what a new compatible bitmap holds
+		} else {
+			m_bmp.CreateCompatibleBitmap(m_hDCOriginal, w, h);
+			ATLASSERT(m_bmp.m_hBitmap != NULL);
+			m_hBmpOld = SelectBitmap(m_bmp);
+		}
+		SetViewportOrg(-m_rcPaint.left, -m_rcPaint.top);
+	}
+
+	~CDIBMemoryDC()
+	{
+		if (m_paintWhenDestroy)
+		{
+			::BitBlt(m_hDCOriginal, m_rcPaint.left, m_rcPaint.top, m_rcPaint.right - m_rcPaint.left, m_rcPaint.bottom - m_rcPaint.top, m_hDC, m_rcPaint.left, m_rcPaint.top, SRCCOPY);
+		}
+		if (m_dib != NULL) {
+			m_dib->detachFromDC(m_hDC);
+		} else {
+			SelectBitmap(m_hBmpOld);
+		}
+	}
+};
+
+
 
 
 UI_END
@@ -0,0 +1,150 @@
+#ifndef XL_UI_IMAGECODEC_H
+#define XL_UI_IMAGECODEC_H
+/**
+ * Read and write the uncompressed image files without GDI, so the images
+ * can be loaded where there is no resource and no DC, such as the workers.
+ *
+ * BMP:     BI_RGB, 24 or 32 bpp, top down or bottom up
+ * PPM/PGM: binary (P6 / P5), maxval <= 255
+ * TGA:     uncompressed true color (24 / 32 bpp) or gray, origin at the bottom or the top
+ *
+ * The PPM is RGB and the gray images are expanded, these are always decoded to 24 bpp.
+ */
+#include <stdio.h>
+#include <vector>
+#include "../common.h"
+#include "../string.h"
+#include "../interfaces.h"
+#include "DIBSection.h"
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// CImageCodec
+
+class CImageCodec
+{
+public:
+	enum FORMAT {
+		IF_UNKNOWN = 0,
+		IF_BMP,
+		IF_PPM,
+		IF_PGM,
+		IF_TGA,
+		IF_COUNT
+	};
+
+	/**
+	 * the format by the content of the file
+	 */
+	static FORMAT detect (const tstring &path);
+	/**
+	 * the format by the extension of the path
+	 */
+	static FORMAT formatOf (const tstring &path);
+
+	/**
+	 * decode the whole file into dib
+	 * @param usefilemap The pixels of dib are in a temporary file, the lines
+	 *        written are dropped from the working set as the decoding goes
+	 */
+	static bool load (const tstring &path, CDIBSection *dib, bool usefilemap = false,
+	                  ILongTimeRunCallback *pCallback = NULL);
+	/**
+	 * map the file into dib without copying when the pixels on the disk
+	 * can be used as they are (BMP and TGA of 24 / 32 bpp), a bottom up
+	 * file gets a negative pitch. Otherwise the file is decoded by load().
+	 * The view is copied on write, writing to dib never changes the file.
+	 */
+	static bool map (const tstring &path, CDIBSection *dib);
+
+	/**
+	 * @param format IF_UNKNOWN to use the extension of path
+	 * @param topdown For BMP and TGA, write the lines from the top
+	 */
+	static bool save (const CDIBSection *dib, const tstring &path,
+	                  FORMAT format = IF_UNKNOWN, bool topdown = false);
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CImageReader
+/**
+ * Decode a file line by line, in the order of the file, so that an image
+ * larger than the memory can be processed by the lines.
+ *
+ *	CImageReader reader;
+ *	if (reader.open(path)) {
+ *		std::vector<uint8> line(reader.getWidth() * reader.getBitCounts() / 8);
+ *		int y;
+ *		while ((y = reader.getNextLine()) >= 0 && reader.readLine(&line[0])) {
+ *			// line y is ready
+ *		}
+ *	}
+ */
+class CImageReader
+{
+	friend class CImageCodec;
+
+	FILE                                                 *m_file;
+	CImageCodec::FORMAT                                   m_format;
+	int                                                   m_width;
+	int                                                   m_height;
+	int                                                   m_bytespp;     // in the file, 1, 3 or 4
+	bool                                                  m_bottomUp;
+	bool                                                  m_rgb;         // the order of the colors in the file
+	uint                                                  m_fileStride;
+	uint64                                                m_dataOffset;
+	uint                                                  m_maxval;      // of the samples, 255 but in PNM
+	uint8                                                 m_levels[256]; // the samples to 0..255 if m_maxval is not 255
+	int                                                   m_read;        // the lines read
+	std::vector<uint8>                                    m_buffer;
+
+	CImageReader (const CImageReader &);
+	CImageReader& operator = (const CImageReader &);
+
+	bool _SetSize (uint64 w, uint64 h, int bytespp, uint align);
+	bool _ReadBMPHeader ();
+	bool _ReadPNMHeader ();
+	bool _ReadTGAHeader ();
+
+public:
+	CImageReader ();
+	~CImageReader ();
+
+	/**
+	 * read the header, the reader is at the first line then
+	 */
+	bool open (const tstring &path);
+	void close ();
+	bool isOpen () const;
+
+	CImageCodec::FORMAT getFormat () const;
+	int getWidth () const;
+	int getHeight () const;
+	/**
+	 * of the lines returned by readLine(), 24 or 32
+	 */
+	int getBitCounts () const;
+	/**
+	 * true if the last line of the image comes first in the file
+	 */
+	bool isBottomUp () const;
+
+	/**
+	 * the line of the image which readLine() returns next, -1 at the end
+	 */
+	int getNextLine () const;
+	/**
+	 * @param dst getWidth() * getBitCounts() / 8 bytes, BGR(A)
+	 */
+	bool readLine (uint8 *dst);
+	/**
+	 * read the remaining lines into dib, which must be of the size and the bit count
+	 */
+	bool readAll (CDIBSection *dib, ILongTimeRunCallback *pCallback = NULL);
+};
+
+UI_END
+XL_END
+#endif
@@ -0,0 +1,216 @@
+#ifndef XL_UI_IMAGEPIPELINE_H
+#define XL_UI_IMAGEPIPELINE_H
+/**
+ * A lazy, demand driven image pipeline.
+ *
+ * The operations are described as a graph of nodes, nothing is computed until
+ * the graph is rendered. The output is then cut into tiles which run on the
+ * thread pool, and each tile pulls the region it needs from the node before,
+ * and so on up to the source. Only tiles are allocated (leased from CDIBPool,
+ * so a thread reuses the same few buffers, which stay in its cache), so the
+ * peak memory depends on the tile size and the number of threads, not on
+ * the image size.
+ *
+ * There is no cache of the regions, the halo a filter needs around a tile
+ * is computed again by the neighbour tiles, larger tiles waste less.
+ *
+ *	CImagePipeline pipeline(dib);
+ *	pipeline.crop(0, 0, 1024, 768).rotate(CDIBSection::OT_ROTATE_90).resize(320, 240, CDIBSection::RT_BICUBIC).sharpen(0.5);
+ *	CDIBSectionPtr thumbnail = pipeline.render();
+ */
+#include <memory>
+#include "../common.h"
+#include "../interfaces.h"
+#include "DIBResizer.h"
+#include "DIBSection.h"
+XL_BEGIN
+UI_BEGIN
+
+class CImageNode;
+typedef std::tr1::shared_ptr<CImageNode> CImageNodePtr;
+
+//////////////////////////////////////////////////////////////////////////
+// CImageNode
+class CImageNode
+{
+	CImageNode (const CImageNode &);
+	CImageNode& operator = (const CImageNode &);
+
+protected:
+	CImageNodePtr                                         m_input;
+	int                                                   m_width;
+	int                                                   m_height;
+	int                                                   m_bitcount;
+
+public:
+	CImageNode (CImageNodePtr input, int w, int h, int bitcount);
+	virtual ~CImageNode ();
+
+	int getWidth () const;
+	int getHeight () const;
+	int getBitCounts () const;
+	CImageNodePtr getInput () const;
+
+	/**
+	 * compute the pixels from (x, y) of this node into dst, dst is of the size of the region.
+	 * It is called from several threads at the same time for different regions.
+	 */
+	virtual bool generate (int x, int y, CDIBSection *dst) = 0;
+
+	/**
+	 * the pixels of a region, by default generated into a tile leased from the pool,
+	 * the nodes which have the pixels already return a view of them instead.
+	 * @return NULL if failed
+	 */
+	virtual CDIBSectionPtr region (int x, int y, int w, int h);
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// the nodes
+
+/**
+ * the pixels of a DIB, the DIB is cloned (copy on write, no copy made here)
+ */
+class CSourceNode : public CImageNode
+{
+	CDIBSectionPtr                                        m_dib;
+
+public:
+	CSourceNode (const CDIBSection *dib);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+	virtual CDIBSectionPtr region (int x, int y, int w, int h);
+};
+
+class CCropNode : public CImageNode
+{
+	int                                                   m_x;
+	int                                                   m_y;
+
+public:
+	CCropNode (CImageNodePtr input, int x, int y, int w, int h);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+	virtual CDIBSectionPtr region (int x, int y, int w, int h);
+};
+
+/**
+ * by CRotateEngine, a region of the output is the rotated region of the input
+ */
+class CRotateNode : public CImageNode
+{
+	CDIBSection::ORIENTATION                              m_ot;
+
+public:
+	CRotateNode (CImageNodePtr input, CDIBSection::ORIENTATION ot);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+};
+
+/**
+ * by the weights tables and the region passes of CResizeEngine,
+ * the tables are made once for the whole image
+ */
+class CResizeNode : public CImageNode
+{
+	std::auto_ptr<CGenericFilter>                         m_pFilter;
+	std::auto_ptr<CWeightsTable>                          m_pTableX;
+	std::auto_ptr<CWeightsTable>                          m_pTableY;
+
+	static void _Range (const CWeightsTable &table, int pos, int len, int &first, int &count);
+
+public:
+	CResizeNode (CImageNodePtr input, int w, int h, CDIBSection::RESIZE_TYPE rt = CDIBSection::RT_BOX);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+};
+
+/**
+ * unsharp mask of radius 1: out = in + amount * (in - blur(in))
+ */
+class CSharpenNode : public CImageNode
+{
+	int                                                   m_amount;      // fixed point, 8 bits of fraction
+
+public:
+	CSharpenNode (CImageNodePtr input, double amount);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+};
+
+/**
+ * a table per channel, and optionally gray first (the mean of the channels, as CBitmap::gray)
+ * the alpha of 32 bpp is left alone
+ */
+class CColorNode : public CImageNode
+{
+	uint8                                                 m_table[256];
+	bool                                                  m_gray;
+
+public:
+	/**
+	 * @param brightness [-255, 255] added
+	 * @param contrast multiplied around 128, 1 to keep
+	 * @param gamma 1 to keep
+	 */
+	CColorNode (CImageNodePtr input, bool gray, int brightness = 0, double contrast = 1, double gamma = 1);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+};
+
+/**
+ * 24 <-> 32 bpp, by CConvertEngine
+ */
+class CConvertNode : public CImageNode
+{
+public:
+	CConvertNode (CImageNodePtr input, int bitcount);
+
+	virtual bool generate (int x, int y, CDIBSection *dst);
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CImagePipeline
+/**
+ * builds a chain of nodes and renders it
+ */
+class CImagePipeline
+{
+	CImageNodePtr                                         m_node;
+
+public:
+	static const int TILE_SIZE = 256;
+
+	CImagePipeline (const CDIBSection *src);
+	CImagePipeline (CImageNodePtr node);
+
+	/**
+	 * append a node of its own, its input must be getNode()
+	 */
+	CImagePipeline& then (CImageNodePtr node);
+	CImagePipeline& crop (int x, int y, int w, int h);
+	CImagePipeline& rotate (CDIBSection::ORIENTATION ot);
+	CImagePipeline& resize (int w, int h, CDIBSection::RESIZE_TYPE rt = CDIBSection::RT_BOX);
+	CImagePipeline& sharpen (double amount);
+	CImagePipeline& color (int brightness, double contrast = 1, double gamma = 1);
+	CImagePipeline& gray ();
+	CImagePipeline& convert (int bitcount);
+
+	CImageNodePtr getNode () const;
+	int getWidth () const;
+	int getHeight () const;
+	int getBitCounts () const;
+
+	/**
+	 * @param dst Of the size and the bit count of the last node
+	 * @param tile The size of the tiles, TILE_SIZE x TILE_SIZE by default
+	 */
+	bool render (CDIBSection *dst, ILongTimeRunCallback *pCallback = NULL, int tile = TILE_SIZE) const;
+	CDIBSectionPtr render (bool usefilemap = false, ILongTimeRunCallback *pCallback = NULL) const;
+};
+
+UI_END
+XL_END
+#endif
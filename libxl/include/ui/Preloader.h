@@ -0,0 +1,188 @@
+#ifndef XL_UI_PRELOADER_H
+#define XL_UI_PRELOADER_H
+/**
+ * Load the resources of the first frame on the pool threads while the main
+ * window is being created, so the first paint finds them in CResMgr and
+ * CLanguage instead of loading them one by one on the UI thread.
+ *
+ * The manifest is an ini file (or built by the add methods), the keys only
+ * name the items in the report:
+ *
+ *	[fonts]
+ *	caption = -14, bold           ; CResMgr::getSysFont(-14, FS_BOLD)
+ *	[icons]
+ *	app = 1
+ *	[bitmaps]
+ *	toolbar = 101
+ *	toolbar.disabled = 101, gray
+ *	thumb = 102, 48x48            ; resized, CResMgr::getBitmap(102, 48, 48)
+ *	[sprites]
+ *	open = 103, ff00ff            ; color keyed, CResMgr::getTransSprite()
+ *	open.disabled = 103, ff00ff, gray
+ *	[language]
+ *	strings = yes                 ; the lang-xxxx.ini of CLanguage
+ *
+ *	CPreloadManifest manifest;
+ *	manifest.load(_T("preload.ini"));
+ *	CPreloader preloader;
+ *	preloader.start(manifest);
+ *	... create the main window ...
+ *	preloader.wait();
+ *	preloader.report();
+ */
+#include <vector>
+#include <Windows.h>
+#include "../common.h"
+#include "../string.h"
+#include "../interfaces.h"
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// CPreloadManifest
+
+class CPreloadManifest
+{
+public:
+	enum KIND {
+		PK_FONT = 0,
+		PK_ICON,
+		PK_BITMAP,
+		PK_SPRITE,
+		PK_LANGUAGE,
+		PK_COUNT
+	};
+
+	struct ITEM {
+		KIND         kind;
+		tstring      name;
+		ushort       id;          // icon, bitmap, sprite
+		int          width;       // bitmap, 0 for the size as loaded
+		int          height;      // bitmap, or the height of the font
+		uint         style;       // font, CResMgr::FS_XXX
+		bool         grayscale;   // bitmap, sprite
+		bool         transparent; // sprite
+		COLORREF     colorKey;    // sprite
+	};
+
+protected:
+	typedef std::vector<ITEM>                             _ItemContainer;
+
+	_ItemContainer                                        m_items;
+
+	static ITEM _Item (KIND kind, const tstring &name);
+	/**
+	 * the values of a section, such as "101, gray, 48x48"
+	 */
+	bool _Parse (KIND kind, const tstring &name, const tstring &value);
+
+public:
+	void addFont (const tstring &name, int height, uint style = 0);
+	void addIcon (const tstring &name, ushort id);
+	/**
+	 * @param width, height 0 for the size as loaded
+	 */
+	void addBitmap (const tstring &name, ushort id, bool grayscale = false, int width = 0, int height = 0);
+	void addSprite (const tstring &name, ushort id, bool grayscale = false, bool transparent = false, COLORREF colorKey = 0);
+	void addLanguage (const tstring &name);
+
+	/**
+	 * add the items of an ini file, see above
+	 * @return false if the file can not be read, or a value is bad (the good ones are added)
+	 */
+	bool load (const tstring &path);
+	void clear ();
+
+	size_t getCount () const;
+	const ITEM& getItem (size_t index) const;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPreloader
+
+class CPreloader
+{
+public:
+	struct TIMING {
+		CPreloadManifest::KIND   kind;
+		tstring                  name;
+		bool                     loaded;
+		uint                     thread;      // the id of the thread which loaded it
+		double                   ms;
+	};
+
+protected:
+	class CJob : public IExecutable
+	{
+		CPreloader                        *m_pPreloader;
+		CPreloadManifest::ITEM             m_item;
+		TIMING                            *m_pTiming;
+
+	public:
+		CJob (CPreloader *pPreloader, const CPreloadManifest::ITEM &item, TIMING *pTiming);
+		bool operator() ();
+	};
+	friend class CJob;
+
+	typedef std::vector<CJob *>                           _JobContainer;
+	typedef std::vector<TIMING>                           _TimingContainer;
+
+	_JobContainer                                         m_jobs;        // freed by the last one done
+	_TimingContainer                                      m_timings;
+	volatile LONG                                         m_pending;
+	HANDLE                                                m_done;
+	LARGE_INTEGER                                         m_start;
+	double                                                m_elapsed;     // ms, from start() to the last one done
+
+	CPreloader (const CPreloader &);
+	CPreloader& operator = (const CPreloader &);
+
+	static bool _Load (const CPreloadManifest::ITEM &item);
+	void _Done ();
+	void _FreeJobs ();
+	/**
+	 * one more pending, unless none is
+	 * @return false if none is pending, the jobs are done
+	 */
+	bool _Hold ();
+	/**
+	 * cancel the jobs not started yet, and wait for the others
+	 */
+	void _Stop ();
+
+public:
+	CPreloader ();
+	/**
+	 * the jobs not started yet are canceled
+	 */
+	~CPreloader ();
+
+	/**
+	 * post the items to CThreadPool and return at once
+	 * @return false if it has been started and is not done
+	 */
+	bool start (const CPreloadManifest &manifest);
+	/**
+	 * @return true if all items are done
+	 */
+	bool wait (uint timeout = INFINITE);
+	bool isDone () const;
+
+	/**
+	 * valid after wait() returns true, in the order of the manifest
+	 */
+	const std::vector<TIMING>& getTimings () const;
+	/**
+	 * the wall time of the whole preload in ms, less than the sum of the items
+	 */
+	double getElapsed () const;
+	/**
+	 * trace() the timing of every item, and the total
+	 */
+	void report () const;
+};
+
+UI_END
+XL_END
+#endif
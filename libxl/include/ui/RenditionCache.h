@@ -0,0 +1,131 @@
+#ifndef XL_UI_RENDITIONCACHE_H
+#define XL_UI_RENDITIONCACHE_H
+/**
+ * A persistent cache of resized images, shared by the processes, so that
+ * a warm restart finds the resize results of the last run.
+ *
+ * All renditions live in one container file which is mapped into memory:
+ *
+ *	HEADER | ENTRY x entries | data (the budget)
+ *
+ * An entry is keyed by the hash of the source pixels, the size, the filter
+ * and the bit count, its pixels are stored packed (no line padding) in the
+ * data area. When an image does not fit, the least recently used entries
+ * are evicted until a free range is large enough.
+ * The file is guarded by a named mutex derived from its path, and the view
+ * by a lock of the object, so the threads of a process share one cache.
+ * The entries are written before they are marked used, so the cache
+ * survives a process killed while writing (not a system crash). The
+ * entries read are checked against the data area, as the file may be
+ * broken or written by another version.
+ */
+#include "../common.h"
+#include "../string.h"
+#include "../interfaces.h"
+#include "../lockable.h"
+#include "../FileMapping.h"
+#include "DIBSection.h"
+XL_BEGIN
+UI_BEGIN
+
+class CRenditionCache : private CUserLock
+{
+public:
+	struct KEY {
+		uint64   hash;       // of the source, see hash()
+		int      width;
+		int      height;
+		int      rt;         // CDIBSection::RESIZE_TYPE
+		int      bitcount;
+
+		KEY (uint64 _hash, int _width, int _height, CDIBSection::RESIZE_TYPE _rt, int _bitcount)
+			: hash(_hash), width(_width), height(_height), rt(_rt), bitcount(_bitcount) {}
+	};
+
+	/**
+	 * of this process
+	 */
+	struct STATS {
+		uint     hits;
+		uint     misses;
+		uint     puts;
+		uint     evictions;
+		uint     entries;    // in the file
+		uint64   bytes;      // of the entries in the file
+	};
+
+	static const uint DEFAULT_ENTRIES = 4096;
+
+protected:
+	struct HEADER;
+	struct ENTRY;
+
+	CFileMapping                                          m_file;
+	HANDLE                                                m_mutex;
+	uint8                                                *m_view;
+	STATS                                                 m_stats;
+
+	CRenditionCache (const CRenditionCache &);
+	CRenditionCache& operator = (const CRenditionCache &);
+
+	bool _Lock () const;
+	void _Unlock () const;
+	HEADER* _Header () const;
+	ENTRY* _Entries () const;
+	uint8* _Data () const;
+
+	/**
+	 * the pixels of a used entry are as large as its size, and in the data area
+	 */
+	bool _IsValid (const ENTRY *entry) const;
+	ENTRY* _Find (const KEY &key) const;
+	/**
+	 * evict the least recently used entries until bytes fit
+	 * @return the offset in the data area, -1 if failed
+	 */
+	int64 _Allocate (uint64 bytes);
+	ENTRY* _FreeEntry ();
+	void _Evict (ENTRY *entry);
+
+public:
+	CRenditionCache ();
+	~CRenditionCache ();
+
+	/**
+	 * open or create the container, an existing valid container keeps its layout,
+	 * an open one is closed first
+	 * @param budget The bytes of the data area
+	 */
+	bool open (const tstring &path, uint64 budget, uint entries = DEFAULT_ENTRIES);
+	void close ();
+	bool isOpen () const;
+
+	/**
+	 * copy the rendition into dib (created here)
+	 */
+	bool get (const KEY &key, CDIBSection *dib);
+	bool put (const KEY &key, const CDIBSection *dib);
+	/**
+	 * remove all entries
+	 */
+	void clear ();
+
+	/**
+	 * src resized from the cache, or resized now and put into the cache
+	 * @param hash The hash of src, 0 to compute it here
+	 */
+	CDIBSectionPtr resize (const CDIBSection *src, int w, int h,
+	                       CDIBSection::RESIZE_TYPE rt = CDIBSection::RT_BOX,
+	                       uint64 hash = 0, ILongTimeRunCallback *pCallback = NULL);
+
+	STATS getStats () const;
+
+	/**
+	 * the hash of the size, the bit count and the pixels (not the line padding) of dib
+	 */
+	static uint64 hash (const CDIBSection *dib);
+};
+
+UI_END
+XL_END
+#endif
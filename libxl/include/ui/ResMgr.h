@@ -7,13 +7,20 @@
 #include "../common.h"
 #include "../string.h"
 #include "../lockable.h"
+#include "../ShardedMap.h"
 #include "Bitmap.h"
+#include "BitmapAtlas.h"
+#include "BitmapCache.h"
+#include "RenditionCache.h"
 
 XL_BEGIN
 UI_BEGIN
 
 /**
  * Manage resources such as fonts, icons, cursors, and so on.
+ * All methods may be called from any thread, the hits only take the shared
+ * lock of a shard, and a missing resource is created once (see CShardedMapT
+ * and CBitmapCache).
  */
 class CResMgr : private CUserLock
 {
@@ -24,22 +31,22 @@ public:
 private:
 	CResMgr ();
 	~CResMgr ();
-	typedef std::map<uint, HFONT>                  _FontMapType;
-	typedef std::map<uint64, HPEN>                 _PenMapType;
-	typedef std::map<uint, HICON>                  _IconMapType;
-	typedef std::map<uint64, CBitmapPtr>           _BitmapBigMapType;
+	typedef CShardedMapT<uint, HFONT>              _FontMapType;
+	typedef CShardedMapT<uint64, HPEN>             _PenMapType;
+	typedef CShardedMapT<uint, HICON>              _IconMapType;
+	typedef CShardedMapT<uint64, CSpritePtr>       _SpriteMapType;
 
 	_FontMapType                                   m_sysFonts;
 	_PenMapType                                    m_pens;
 	_IconMapType                                   m_icons;
-	_BitmapBigMapType                              m_bitmaps;
-	_BitmapBigMapType                              m_transBitmaps;
+	CBitmapCache                                   m_bitmaps;
+	CBitmapAtlas                                   m_atlas;
+	_SpriteMapType                                 m_sprites;
+	CRenditionCache                                m_diskCache;
 
 	void _Lock ();
 	void _Unlock ();
 
-	HFONT _CreateSysFont(int height, uint style);
-
 public:
 	static const uint FS_BOLD = 0x01;
 	static const uint FS_ITALIC = 0x02;
@@ -48,6 +55,7 @@ public:
 	static const uint FS_MASK = 0xffff;
 
 	static const uint64 BMP_GRAY = 0x10000000;
+	static const uint64 BMP_TRANS = 0x20000000;
 
 	static CResMgr* getInstance ();
 	void reset ();
@@ -62,7 +70,40 @@ public:
 	HICON getIcon (ushort id);
 
 	CBitmapPtr getBitmap (ushort id, bool grayscale = false);
+	/**
+	 * the bitmap resized to width x height, made once and shared, so drawing it
+	 * is a plain blit. The sizes of a size class (4 per power of 2) replace each
+	 * other beyond CBitmapCache::GROUP_VARIANTS. With a disk cache, the resized
+	 * bitmaps are kept across the runs too.
+	 */
+	CBitmapPtr getBitmap (ushort id, int width, int height,
+	                      CDIBSection::RESIZE_TYPE rt = CDIBSection::RT_BICUBIC, bool grayscale = false);
 	CBitmapPtr getTransBitmap (ushort id, COLORREF colorKey, bool grayscale = false);
+
+	/**
+	 * the small bitmaps (the icons of the menus and the buttons) as sprites of
+	 * the atlas, many of them share one DIB section, see CBitmapAtlas. They are
+	 * never evicted, use getBitmap() for the large ones.
+	 */
+	CSpritePtr getSprite (ushort id, bool grayscale = false);
+	CSpritePtr getTransSprite (ushort id, COLORREF colorKey, bool grayscale = false);
+
+	/**
+	 * the bytes the bitmaps may hold, CBitmapCache::DEFAULT_BUDGET by default
+	 */
+	void setBitmapBudget (uint64 budget);
+	CBitmapCache::STATS getBitmapStats (CBitmapCache::CATEGORY category) const;
+
+	/**
+	 * keep the resized bitmaps in a file across the runs, see CRenditionCache,
+	 * call it before any bitmap of a size is asked for
+	 * @param budget The bytes of the pixels kept in the file
+	 */
+	bool setDiskCache (const tstring &path, uint64 budget);
+	/**
+	 * @return not open if setDiskCache() was not called
+	 */
+	CRenditionCache* getDiskCache ();
 };
 
 UI_END
@@ -3,6 +3,8 @@
 #include <limits>
 #include "../common.h"
 #include "../string.h"
+#include "../Atom.h"
+#include "../MemoryResource.h"
 
 #ifdef max // <windows.h> defines max & min
 #define RESTORE_MIN_MAX
@@ -154,17 +156,18 @@ protected:
 	void _ParsePosition (tstring value);
 	void _ParseEdge (tstring value, EDGE &edge);
 	COLORREF _ParseColor (tstring value);
-	void _ParseBorder (tstring key, tstring value);
+	void _ParseBorder (CAtom key, tstring value);
 	BACKGROUNDIMAGEPOS_X _ParseBackgroundImagePosX (tstring value);
 	BACKGROUNDIMAGEPOS_Y _ParseBackgroundImagePosY (tstring value);
-	void _ParseBackground (tstring key, tstring value);
+	void _ParseBackground (CAtom key, tstring value);
 	void _Reset ();
 	void _SetStyle (tstring style, bool &relayout, bool &redraw);
 
 	/**
-	 * the derived class can have its own _ParseProperty()
+	 * the derived class can have its own _ParseProperty(), the key is a
+	 * KNOWN_ATOM or is interned at run time, see Atom.h
 	 */
-	virtual void _ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw);
+	virtual void _ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw);
 
 public:
 	bool display;
@@ -1,9 +1,9 @@
 #ifndef XL_UTLITIES_H
 #define XL_UTLITIES_H
 #include "common.h"
-#include <stdarg.h>
 #include "string.h"
 #include "lockable.h"
+#include "Format.h"
 
 #ifdef XL_TRACE_ENABLE
 #define XLTRACE(format, ...) xl::trace(format, __VA_ARGS__)
@@ -14,8 +14,10 @@
 XL_BEGIN
 
 //////////////////////////////////////////////////////////////////////////
-// trace
-void trace (const tchar *format, ...);
+// trace, by the formats of Format.h
+#define XL_TRACE_DECLARE(n) void trace (const tchar *format XL_FORMAT_PARAMS_##n);
+XL_FORMAT_OVERLOADS(XL_TRACE_DECLARE)
+#undef XL_TRACE_DECLARE
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -26,14 +28,17 @@ class CTimerLogger
 	tstring m_msg;
 	uint m_tick;
 
-	void _Init (const tchar *, va_list);
+	void _Init (const tchar *format, const CFormatArg *const *args, size_t count);
 
 public:
-	CTimerLogger (const tchar *format, ...);
+#define XL_TIMER_LOGGER_DECLARE(n) \
+	CTimerLogger (const tchar *format XL_FORMAT_PARAMS_##n); \
+	void restart (const tchar *format XL_FORMAT_PARAMS_##n);
+	XL_FORMAT_OVERLOADS(XL_TIMER_LOGGER_DECLARE)
+#undef XL_TIMER_LOGGER_DECLARE
 	~CTimerLogger ();
 
 	void log ();
-	void restart (const tchar *format, ...);
 };
 
 
@@ -51,6 +56,18 @@ public:
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+// CScopeSharedLock
+class CScopeSharedLock
+{
+	const CReadWriteLock   *m_lock;
+public:
+	CScopeSharedLock (const CReadWriteLock *lock);
+	~CScopeSharedLock ();
+	void unlock ();
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 // OS Version
 #ifdef WIN32
@@ -59,5 +76,12 @@ bool os_is_vista_or_later ();
 #endif
 
 
+//////////////////////////////////////////////////////////////////////////
+// CPU Features
+bool cpu_has_sse2 ();
+bool cpu_has_ssse3 ();
+bool cpu_has_sse41 ();
+
+
 XL_END
 #endif
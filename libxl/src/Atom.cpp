@@ -0,0 +1,82 @@
+#include <assert.h>
+#include "../include/Atom.h"
+#include "../include/utilities.h"
+
+XL_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// CAtomTable
+
+size_t CAtomTable::_Hash::operator () (const tstring_view &name) const {
+	// FNV-1a
+	size_t value = sizeof(size_t) == 8 ? (size_t)14695981039346656037ULL : (size_t)2166136261U;
+	const size_t prime = sizeof(size_t) == 8 ? (size_t)1099511628211ULL : (size_t)16777619U;
+	for (size_t i = 0; i < name.length(); ++ i) {
+		value = (value ^ (size_t)name[i]) * prime;
+	}
+	return value;
+}
+
+CAtomTable::CAtomTable () {
+	static const tchar *known[] = {
+		_T(""),
+#define XL_ATOM_NAME(id, name) _T(name),
+		XL_KNOWN_ATOMS(XL_ATOM_NAME)
+#undef XL_ATOM_NAME
+	};
+	assert(COUNT_OF(known) == KA_COUNT);
+	for (size_t i = 0; i < COUNT_OF(known); ++ i) {
+		VERIFY(_Add(known[i]) == i);
+	}
+}
+
+uint CAtomTable::_Add (const tstring_view &name) {
+	uint id = (uint)m_views.size();
+	m_names.push_back(tstring(name));
+	tstring_view stored(m_names.back().data(), m_names.back().length());
+	m_views.push_back(stored);
+	m_ids[stored] = id;
+	return id;
+}
+
+CAtomTable* CAtomTable::getInstance () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static CAtomTable table;
+	return &table;
+}
+
+uint CAtomTable::intern (const tstring_view &name) {
+	m_lock.lockShared();
+	_IdMap::const_iterator it = m_ids.find(name);
+	if (it != m_ids.end()) {
+		uint id = it->second;
+		m_lock.unlockShared();
+		return id;
+	}
+	m_lock.unlockShared();
+
+	// look up again, it may have been added between the locks
+	CScopeLock sl(&m_lock);
+	it = m_ids.find(name);
+	return it != m_ids.end() ? it->second : _Add(name);
+}
+
+uint CAtomTable::find (const tstring_view &name) const {
+	CScopeSharedLock sl(&m_lock);
+	_IdMap::const_iterator it = m_ids.find(name);
+	return it == m_ids.end() ? KA_NONE : it->second;
+}
+
+tstring_view CAtomTable::getName (uint id) const {
+	CScopeSharedLock sl(&m_lock);
+	assert(id < m_views.size());
+	return id < m_views.size() ? m_views[id] : tstring_view();
+}
+
+size_t CAtomTable::getCount () const {
+	CScopeSharedLock sl(&m_lock);
+	return m_views.size();
+}
+
+XL_END
@@ -0,0 +1,345 @@
+#include <assert.h>
+#include <string.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include "../include/CharScan.h"
+#include "../include/utilities.h"
+
+XL_BEGIN
+
+namespace {
+
+const size_t NPOS = (size_t)-1;
+
+bool _UseSSE2 () {
+	static const bool use = cpu_has_sse2();
+	return use;
+}
+
+bool _UseSSSE3 () {
+	static const bool use = cpu_has_ssse3();
+	return use;
+}
+
+uint _LowestBit (uint mask) {
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return (uint)index;
+}
+
+uint _HighestBit (uint mask) {
+	unsigned long index = 0;
+	_BitScanReverse(&index, mask);
+	return (uint)index;
+}
+
+/**
+ * the bytes of a set, as a bitmap of the 256 values
+ */
+struct BYTESET {
+	uint8 bits[32];
+
+	BYTESET (const uint8 *set, size_t setLength) {
+		memset(bits, 0, sizeof(bits));
+		for (size_t i = 0; i < setLength; ++ i) {
+			bits[set[i] >> 3] |= (uint8)(1 << (set[i] & 7));
+		}
+	}
+	bool contains (uint8 c) const {
+		return (bits[c >> 3] & (1 << (c & 7))) != 0;
+	}
+};
+
+/**
+ * the characters of a set which is not scanned by SIMD, the ones below 256 by a bitmap
+ */
+template <class T>
+struct SCALARSET {
+	BYTESET          low;
+	const T         *set;
+	size_t           setLength;
+
+	SCALARSET (const T *_set, size_t _setLength) : low(NULL, 0), set(_set), setLength(_setLength) {
+		for (size_t i = 0; i < setLength; ++ i) {
+			if ((size_t)set[i] < 256) {
+				uint8 c = (uint8)set[i];
+				low.bits[c >> 3] |= (uint8)(1 << (c & 7));
+			}
+		}
+	}
+	bool contains (T c) const {
+		if ((size_t)c < 256) {
+			return low.contains((uint8)c);
+		}
+		for (size_t i = 0; i < setLength; ++ i) {
+			if (set[i] == c) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+template <class T, class SET>
+size_t _ScanScalar (const T *s, size_t n, const SET &set, bool of, bool last) {
+	if (!last) {
+		for (size_t i = 0; i < n; ++ i) {
+			if (set.contains(s[i]) == of) {
+				return i;
+			}
+		}
+	} else {
+		for (size_t i = n; i > 0; -- i) {
+			if (set.contains(s[i - 1]) == of) {
+				return i - 1;
+			}
+		}
+	}
+	return NPOS;
+}
+
+/**
+ * match() gives a bit per lane of the characters in the set,
+ * contains() is for the tail shorter than a vector
+ */
+template <class MATCHER>
+size_t _ScanBlocks (const typename MATCHER::CharType *s, size_t n, const MATCHER &matcher, bool of, bool last) {
+	const size_t LANES = MATCHER::LANES;
+	const uint all = (1 << LANES) - 1;
+	if (!last) {
+		size_t i = 0;
+		for (; i + LANES <= n; i += LANES) {
+			uint mask = matcher.match(_mm_loadu_si128((const __m128i *)(s + i)));
+			if (!of) {
+				mask ^= all;
+			}
+			if (mask != 0) {
+				return i + _LowestBit(mask);
+			}
+		}
+		for (; i < n; ++ i) {
+			if (matcher.contains(s[i]) == of) {
+				return i;
+			}
+		}
+	} else {
+		size_t i = n;
+		for (; i >= LANES; i -= LANES) {
+			uint mask = matcher.match(_mm_loadu_si128((const __m128i *)(s + i - LANES)));
+			if (!of) {
+				mask ^= all;
+			}
+			if (mask != 0) {
+				return i - LANES + _HighestBit(mask);
+			}
+		}
+		for (; i > 0; -- i) {
+			if (matcher.contains(s[i - 1]) == of) {
+				return i - 1;
+			}
+		}
+	}
+	return NPOS;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// the matchers
+
+/**
+ * a byte compared to each one of the set (SSE2)
+ */
+class CByteCompare
+{
+public:
+	typedef uint8 CharType;
+	static const size_t LANES = 16;
+	static const size_t MAX_SET = 16;
+
+private:
+	__m128i          m_chars[MAX_SET];
+	size_t           m_count;
+	BYTESET          m_set;
+
+public:
+	CByteCompare (const uint8 *set, size_t setLength) : m_count(setLength), m_set(set, setLength) {
+		assert(setLength > 0 && setLength <= MAX_SET);
+		for (size_t i = 0; i < setLength; ++ i) {
+			m_chars[i] = _mm_set1_epi8((char)set[i]);
+		}
+	}
+	uint match (__m128i v) const {
+		__m128i eq = _mm_cmpeq_epi8(v, m_chars[0]);
+		for (size_t i = 1; i < m_count; ++ i) {
+			eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, m_chars[i]));
+		}
+		return (uint)_mm_movemask_epi8(eq);
+	}
+	bool contains (uint8 c) const {
+		return m_set.contains(c);
+	}
+};
+
+/**
+ * a byte looked up in the bitmap of the set (SSSE3): the low nibble picks a
+ * row of 16 bits by pshufb, and the high nibble picks the bit of the row
+ */
+class CByteLookup
+{
+public:
+	typedef uint8 CharType;
+	static const size_t LANES = 16;
+
+private:
+	__m128i          m_rows0;    // the bits of the high nibbles 0 - 7
+	__m128i          m_rows1;    // the bits of the high nibbles 8 - 15
+	__m128i          m_bits;     // 1 << (i & 7)
+	BYTESET          m_set;
+
+public:
+	CByteLookup (const uint8 *set, size_t setLength) : m_set(set, setLength) {
+		uint8 rows[32];
+		memset(rows, 0, sizeof(rows));
+		for (size_t i = 0; i < setLength; ++ i) {
+			uint8 hi = set[i] >> 4, lo = set[i] & 0x0f;
+			rows[(hi >> 3) * 16 + lo] |= (uint8)(1 << (hi & 7));
+		}
+		m_rows0 = _mm_loadu_si128((const __m128i *)rows);
+		m_rows1 = _mm_loadu_si128((const __m128i *)(rows + 16));
+		m_bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	}
+	uint match (__m128i v) const {
+		const __m128i nibble = _mm_set1_epi8(0x0f);
+		__m128i lo = _mm_and_si128(v, nibble);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+		__m128i high = _mm_cmpgt_epi8(hi, _mm_set1_epi8(7));
+		__m128i row = _mm_or_si128(_mm_andnot_si128(high, _mm_shuffle_epi8(m_rows0, lo)),
+		                           _mm_and_si128(high, _mm_shuffle_epi8(m_rows1, lo)));
+		__m128i bit = _mm_shuffle_epi8(m_bits, hi);
+		return (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit));
+	}
+	bool contains (uint8 c) const {
+		return m_set.contains(c);
+	}
+};
+
+/**
+ * a 16 bits character compared to each one of the set (SSE2)
+ */
+class CWordCompare
+{
+public:
+	typedef ushort CharType;
+	static const size_t LANES = 8;
+	static const size_t MAX_SET = 8;
+
+private:
+	__m128i          m_chars[MAX_SET];
+	size_t           m_count;
+	const ushort    *m_set;
+
+public:
+	CWordCompare (const ushort *set, size_t setLength) : m_count(setLength), m_set(set) {
+		assert(setLength > 0 && setLength <= MAX_SET);
+		for (size_t i = 0; i < setLength; ++ i) {
+			m_chars[i] = _mm_set1_epi16((short)set[i]);
+		}
+	}
+	uint match (__m128i v) const {
+		__m128i eq = _mm_cmpeq_epi16(v, m_chars[0]);
+		for (size_t i = 1; i < m_count; ++ i) {
+			eq = _mm_or_si128(eq, _mm_cmpeq_epi16(v, m_chars[i]));
+		}
+		// a byte per lane
+		return (uint)_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128()));
+	}
+	bool contains (ushort c) const {
+		for (size_t i = 0; i < m_count; ++ i) {
+			if (m_set[i] == c) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// the dispatchers
+
+size_t _Scan8 (const uint8 *s, size_t n, const uint8 *set, size_t setLength, bool of, bool last) {
+	if (setLength == 0) {
+		// nothing is in it, everything is not
+		return of || n == 0 ? NPOS : (last ? n - 1 : 0);
+	}
+	if (n >= CByteCompare::LANES) {
+		if (_UseSSSE3() && setLength > 4) {
+			return _ScanBlocks(s, n, CByteLookup(set, setLength), of, last);
+		}
+		if (_UseSSE2() && setLength <= CByteCompare::MAX_SET) {
+			return _ScanBlocks(s, n, CByteCompare(set, setLength), of, last);
+		}
+	}
+	return _ScanScalar(s, n, BYTESET(set, setLength), of, last);
+}
+
+size_t _Scan16 (const ushort *s, size_t n, const ushort *set, size_t setLength, bool of, bool last) {
+	if (setLength == 0) {
+		return of || n == 0 ? NPOS : (last ? n - 1 : 0);
+	}
+	if (n >= CWordCompare::LANES && _UseSSE2() && setLength <= CWordCompare::MAX_SET) {
+		return _ScanBlocks(s, n, CWordCompare(set, setLength), of, last);
+	}
+	return _ScanScalar(s, n, SCALARSET<ushort>(set, setLength), of, last);
+}
+
+size_t _ScanWide (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength, bool of, bool last) {
+	if (sizeof(wchar_t) == sizeof(ushort)) {
+		return _Scan16((const ushort *)s, n, (const ushort *)set, setLength, of, last);
+	}
+	if (setLength == 0) {
+		return of || n == 0 ? NPOS : (last ? n - 1 : 0);
+	}
+	return _ScanScalar(s, n, SCALARSET<wchar_t>(set, setLength), of, last);
+}
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// scan
+
+size_t scan_first_of (const char *s, size_t n, const char *set, size_t setLength) {
+	return _Scan8((const uint8 *)s, n, (const uint8 *)set, setLength, true, false);
+}
+
+size_t scan_first_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength) {
+	return _ScanWide(s, n, set, setLength, true, false);
+}
+
+size_t scan_first_not_of (const char *s, size_t n, const char *set, size_t setLength) {
+	return _Scan8((const uint8 *)s, n, (const uint8 *)set, setLength, false, false);
+}
+
+size_t scan_first_not_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength) {
+	return _ScanWide(s, n, set, setLength, false, false);
+}
+
+size_t scan_last_of (const char *s, size_t n, const char *set, size_t setLength) {
+	return _Scan8((const uint8 *)s, n, (const uint8 *)set, setLength, true, true);
+}
+
+size_t scan_last_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength) {
+	return _ScanWide(s, n, set, setLength, true, true);
+}
+
+size_t scan_last_not_of (const char *s, size_t n, const char *set, size_t setLength) {
+	return _Scan8((const uint8 *)s, n, (const uint8 *)set, setLength, false, true);
+}
+
+size_t scan_last_not_of (const wchar_t *s, size_t n, const wchar_t *set, size_t setLength) {
+	return _ScanWide(s, n, set, setLength, false, true);
+}
+
+XL_END
@@ -0,0 +1,236 @@
+#include <assert.h>
+#include "../include/FileMapping.h"
+#include "../include/lockable.h"
+
+XL_BEGIN
+
+namespace {
+	// not in the old SDKs
+	struct _MEMORY_RANGE {
+		void   *VirtualAddress;
+		size_t  NumberOfBytes;
+	};
+	typedef BOOL (WINAPI *_PrefetchVirtualMemory) (HANDLE, ULONG_PTR, _MEMORY_RANGE *, ULONG);
+
+	_PrefetchVirtualMemory _GetPrefetchVirtualMemory () {
+		static volatile LONG once = 0;
+		CScopeOnce so(&once);
+		static _PrefetchVirtualMemory fn = (_PrefetchVirtualMemory)
+			::GetProcAddress(::GetModuleHandle(_T("kernel32.dll")), "PrefetchVirtualMemory");
+		return fn;
+	}
+
+	typedef SIZE_T (WINAPI *_GetLargePageMinimum) ();
+
+#ifndef SEC_LARGE_PAGES
+#define SEC_LARGE_PAGES 0x80000000
+#endif
+
+	DWORD _FlagsOf (CFileMapping::ADVICE advice) {
+		return advice == CFileMapping::ADV_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : 0;
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// private methods
+
+bool CFileMapping::_Create (HANDLE hFile, uint64 size, bool copyOnWrite) {
+	assert(m_hFile == INVALID_HANDLE_VALUE && m_hMapping == NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	// the file grows to size, unless it is copied on write
+	m_hMapping = ::CreateFileMapping(hFile, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READWRITE,
+		(DWORD)(size >> 32), (DWORD)(size & 0xffffffff), NULL);
+	if (m_hMapping == NULL) {
+		::CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_size = size;
+	m_copyOnWrite = copyOnWrite;
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// public methods
+
+CFileMapping::CFileMapping ()
+	: m_hFile(INVALID_HANDLE_VALUE)
+	, m_hMapping(NULL)
+	, m_size(0)
+	, m_copyOnWrite(false)
+{
+}
+
+CFileMapping::~CFileMapping () {
+	close();
+}
+
+bool CFileMapping::createTemp (uint64 size, ADVICE advice, const tchar *dir) {
+	assert(size > 0);
+	close();
+
+	tchar path[MAX_PATH], name[MAX_PATH];
+	if (dir == NULL) {
+		if (::GetTempPath(MAX_PATH, path) == 0) {
+			return false;
+		}
+		dir = path;
+	}
+	if (::GetTempFileName(dir, _T("xl"), 0, name) == 0) {
+		return false;
+	}
+
+	// FILE_ATTRIBUTE_TEMPORARY keeps the pages in the cache as long as the memory allows
+	HANDLE hFile = ::CreateFile(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE | _FlagsOf(advice), NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		::DeleteFile(name);
+		return false;
+	}
+	return _Create(hFile, size);
+}
+
+bool CFileMapping::create (const tstring &path, uint64 size, ADVICE advice) {
+	assert(size > 0);
+	close();
+
+	HANDLE hFile = ::CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | _FlagsOf(advice), NULL);
+	return _Create(hFile, size);
+}
+
+bool CFileMapping::open (const tstring &path, ADVICE advice) {
+	close();
+
+	HANDLE hFile = ::CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | _FlagsOf(advice), NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(hFile, &size) || size.QuadPart == 0) {
+		::CloseHandle(hFile);
+		return false;
+	}
+	return _Create(hFile, (uint64)size.QuadPart, true);
+}
+
+bool CFileMapping::openShared (const tstring &path, uint64 size, ADVICE advice) {
+	assert(size > 0);
+	close();
+
+	HANDLE hFile = ::CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | _FlagsOf(advice), NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER current;
+	if (!::GetFileSizeEx(hFile, &current)) {
+		::CloseHandle(hFile);
+		return false;
+	}
+	if ((uint64)current.QuadPart > size) {
+		size = (uint64)current.QuadPart;
+	}
+	return _Create(hFile, size);
+}
+
+bool CFileMapping::createAnonymous (uint64 size, bool largePages) {
+	assert(size > 0);
+	close();
+
+	size_t large = largePages ? getLargePageMinimum() : 0;
+	if (large > 0) {
+		uint64 rounded = (size + large - 1) / large * large;
+		m_hMapping = ::CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+			(DWORD)(rounded >> 32), (DWORD)(rounded & 0xffffffff), NULL);
+		if (m_hMapping != NULL) {
+			m_size = rounded;
+			return true;
+		}
+	}
+
+	m_hMapping = ::CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT,
+		(DWORD)(size >> 32), (DWORD)(size & 0xffffffff), NULL);
+	if (m_hMapping == NULL) {
+		return false;
+	}
+	m_size = size;
+	return true;
+}
+
+void CFileMapping::close () {
+	if (m_hMapping != NULL) {
+		::CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE) {
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+	m_copyOnWrite = false;
+}
+
+bool CFileMapping::isOpen () const {
+	return m_hMapping != NULL;
+}
+
+bool CFileMapping::hasFile () const {
+	return m_hFile != INVALID_HANDLE_VALUE;
+}
+
+uint64 CFileMapping::getSize () const {
+	return m_size;
+}
+
+HANDLE CFileMapping::getHandle () const {
+	return m_hMapping;
+}
+
+void* CFileMapping::map (uint64 offset, size_t size) {
+	assert(m_hMapping != NULL);
+	assert(offset + size <= m_size);
+	return ::MapViewOfFile(m_hMapping, m_copyOnWrite ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS,
+		(DWORD)(offset >> 32), (DWORD)(offset & 0xffffffff), size);
+}
+
+void CFileMapping::unmap (void *view) {
+	if (view != NULL) {
+		::UnmapViewOfFile(view);
+	}
+}
+
+void CFileMapping::advise (void *addr, size_t len, ADVICE advice) {
+	assert(advice >= ADV_NORMAL && advice < ADV_COUNT);
+	if (addr == NULL || len == 0) {
+		return;
+	}
+
+	if (advice == ADV_WILLNEED) {
+		_PrefetchVirtualMemory fn = _GetPrefetchVirtualMemory();
+		if (fn != NULL) {
+			_MEMORY_RANGE range = {addr, len};
+			fn(::GetCurrentProcess(), 1, &range, 0);
+		}
+	} else if (advice == ADV_DONTNEED) {
+		// unlocking pages which are not locked removes them from the working set
+		::VirtualUnlock(addr, len);
+	}
+}
+
+size_t CFileMapping::getLargePageMinimum () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static _GetLargePageMinimum fn = (_GetLargePageMinimum)
+		::GetProcAddress(::GetModuleHandle(_T("kernel32.dll")), "GetLargePageMinimum");
+	return fn != NULL ? fn() : 0;
+}
+
+XL_END
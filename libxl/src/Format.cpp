@@ -0,0 +1,360 @@
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include "../include/Format.h"
+
+XL_BEGIN
+
+namespace {
+
+template <class CharT>
+const CharT* _ParseSpec (const CharT *p, FormatSpec &spec) {
+	// flags
+	for (;; ++ p) {
+		if (*p == (CharT)'-') {
+			spec.left = true;
+		} else if (*p == (CharT)'0') {
+			spec.zero = true;
+		} else if (*p == (CharT)'#') {
+			spec.alternate = true;
+		} else if (*p == (CharT)'+') {
+			spec.sign = '+';
+		} else if (*p == (CharT)' ') {
+			if (spec.sign == 0) {
+				spec.sign = ' ';
+			}
+		} else {
+			break;
+		}
+	}
+
+	// width and precision
+	while (*p >= (CharT)'0' && *p <= (CharT)'9') {
+		spec.width = spec.width * 10 + (*p ++ - (CharT)'0');
+	}
+	if (*p == (CharT)'.') {
+		++ p;
+		spec.precision = 0;
+		while (*p >= (CharT)'0' && *p <= (CharT)'9') {
+			spec.precision = spec.precision * 10 + (*p ++ - (CharT)'0');
+		}
+	}
+
+	// the length modifiers, the type is of the argument
+	while (*p == (CharT)'h' || *p == (CharT)'l' || *p == (CharT)'L' || *p == (CharT)'z'
+		|| *p == (CharT)'j' || *p == (CharT)'t' || *p == (CharT)'w') {
+		++ p;
+	}
+	if (*p == (CharT)'I') {
+		++ p;
+		if ((p[0] == (CharT)'6' && p[1] == (CharT)'4') || (p[0] == (CharT)'3' && p[1] == (CharT)'2')) {
+			p += 2;
+		}
+	}
+
+	assert(*p != 0); // no conversion
+	if (*p != 0) {
+		spec.conversion = (char)*p ++;
+	}
+	return p;
+}
+
+const size_t MAX_WIDTH = 96;
+
+/**
+ * the precision + 1 significant digits of value >= 0, rounded, and the
+ * decimal exponent of the first one (once rounded: 9.99 is 1.0e+01)
+ */
+int _Digits (double value, int precision, char *digits) {
+	if (value == 0) {
+		for (int i = 0; i <= precision; ++ i) {
+			digits[i] = '0';
+		}
+		return 0;
+	}
+
+	int exponent = (int)floor(log10(value));
+	double mantissa = 0;
+	if (exponent < -300) { // 10^exponent is not a normal double
+		mantissa = value * 1e300 / pow(10.0, exponent + 300);
+	} else {
+		mantissa = value / pow(10.0, exponent);
+	}
+	if (mantissa >= 10) { // the error of log10() and pow()
+		mantissa /= 10;
+		++ exponent;
+	} else if (mantissa < 1) {
+		mantissa *= 10;
+		-- exponent;
+	}
+
+	// value itself rounded where it can be, the mantissa is not exact
+	char buffer[40];
+	size_t length = 0;
+	if (value < 9223372036854775808.0 && exponent <= precision && precision - exponent <= 17) {
+		length = format_double(value, precision - exponent, buffer);
+	} else {
+		length = format_double(mantissa, precision, buffer);
+	}
+	size_t count = 0;
+	for (size_t i = 0; i < length; ++ i) {
+		if (buffer[i] != '.' && (count != 0 || buffer[i] != '0')) {
+			digits[count ++] = buffer[i];
+		}
+	}
+	if (count > (size_t)precision + 1) { // rounded up to 10^(exponent + 1)
+		++ exponent;
+	}
+	return exponent;
+}
+
+/**
+ * d.ddde+xx of value >= 0, the point kept if alternate
+ */
+size_t _FormatExponent (double value, int precision, bool upper, bool alternate, char *buffer) {
+	char digits[24];
+	int exponent = _Digits(value, precision, digits);
+	size_t length = 0;
+	buffer[length ++] = digits[0];
+	if (precision > 0 || alternate) {
+		buffer[length ++] = '.';
+	}
+	for (int i = 1; i <= precision; ++ i) {
+		buffer[length ++] = digits[i];
+	}
+	buffer[length ++] = upper ? 'E' : 'e';
+	buffer[length ++] = exponent < 0 ? '-' : '+';
+	if (exponent < 0) {
+		exponent = -exponent;
+	}
+	if (exponent < 10) {
+		buffer[length ++] = '0';
+	}
+	length += format_uint(exponent, buffer + length);
+	return length;
+}
+
+/**
+ * "%f" of value >= 2^63, which is an integer, with all its digits as printf()
+ * gives them: the mantissa doubled in limbs of 9 decimal digits
+ */
+size_t _FormatLargeFixed (double value, int precision, char *buffer) {
+	const uint LIMB = 1000000000;
+	int exponent = 0;
+	unsigned __int64 mantissa = (unsigned __int64)ldexp(frexp(value, &exponent), 53);
+	exponent -= 53;
+
+	uint limbs[40]; // the lowest first, DBL_MAX has 309 digits
+	size_t count = 0;
+	do {
+		limbs[count ++] = (uint)(mantissa % LIMB);
+		mantissa /= LIMB;
+	} while (mantissa != 0);
+	for (; exponent > 0; -- exponent) {
+		uint carry = 0;
+		for (size_t i = 0; i < count; ++ i) {
+			uint limb = limbs[i] * 2 + carry;
+			carry = limb >= LIMB ? 1 : 0;
+			limbs[i] = limb - carry * LIMB;
+		}
+		if (carry != 0) {
+			limbs[count ++] = carry;
+		}
+	}
+
+	size_t length = format_uint(limbs[count - 1], buffer);
+	for (size_t i = count - 1; i > 0; -- i) {
+		uint limb = limbs[i - 1];
+		for (int j = 8; j >= 0; -- j) {
+			buffer[length + j] = (char)('0' + limb % 10);
+			limb /= 10;
+		}
+		length += 9;
+	}
+	if (precision > 0) {
+		buffer[length ++] = '.';
+		for (int i = 0; i < precision; ++ i) {
+			buffer[length ++] = '0';
+		}
+	}
+	return length;
+}
+
+/**
+ * "%g" of value >= 0: fixed if the exponent of "%e" (once rounded) is in
+ * [-4, precision), without the trailing zeros unless alternate (which keeps
+ * the point too)
+ */
+size_t _FormatGeneral (double value, int precision, bool upper, bool alternate, char *buffer) {
+	if (precision == 0) {
+		precision = 1;
+	}
+	char digits[24];
+	int exponent = _Digits(value, precision - 1, digits);
+	size_t length = 0;
+	size_t end = 0; // of the digits, before the exponent
+	if (exponent < -4 || exponent >= precision || precision - 1 - exponent > 17) {
+		length = _FormatExponent(value, precision - 1, upper, alternate, buffer);
+		end = length - 1;
+		while (buffer[end] != 'e' && buffer[end] != 'E') {
+			-- end;
+		}
+	} else {
+		length = end = format_double(value, precision - 1 - exponent, buffer);
+		if (alternate && precision - 1 == exponent) {
+			buffer[length ++] = '.';
+		}
+	}
+
+	if (!alternate) {
+		// strip the zeros of the fraction, and the point
+		size_t point = 0;
+		while (point < end && buffer[point] != '.') {
+			++ point;
+		}
+		if (point < end) {
+			size_t last = end;
+			while (last > point + 1 && buffer[last - 1] == '0') {
+				-- last;
+			}
+			if (last == point + 1) {
+				last = point;
+			}
+			for (size_t i = end; i < length; ++ i) {
+				buffer[last + i - end] = buffer[i];
+			}
+			length -= end - last;
+		}
+	}
+	return length;
+}
+
+}
+
+const char* parse_format_spec (const char *p, FormatSpec &spec) {
+	return _ParseSpec(p, spec);
+}
+
+const wchar_t* parse_format_spec (const wchar_t *p, FormatSpec &spec) {
+	return _ParseSpec(p, spec);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CFormatArg::formatNumber
+
+size_t CFormatArg::formatNumber (const FormatSpec &spec, char *buffer) const {
+	assert(!isString());
+	char c = spec.conversion;
+	bool upper = c == 'X' || c == 'E' || c == 'G' || c == 'F';
+	bool floating = c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G';
+
+	// the sign and the prefix, then the digits
+	char prefix[4];
+	size_t prefixLength = 0;
+	char digits[352];
+	size_t length = 0;
+	bool integer = false;
+	bool finite = true;
+
+	if (m_type == FAT_POINTER) {
+		length = format_hex((unsigned __int64)(size_t)m_value.p, sizeof(void *) * 2, true, digits);
+	} else if (m_type == FAT_DOUBLE && !floating) {
+		// truncated, as a cast
+		CFormatArg truncated((__int64)m_value.d);
+		return truncated.formatNumber(spec, buffer);
+	} else if (floating) {
+		double value = m_type == FAT_DOUBLE ? m_value.d
+			: m_type == FAT_INT ? (double)m_value.i : (double)m_value.u;
+		int precision = spec.precision < 0 ? 6 : (spec.precision > 17 ? 17 : spec.precision);
+		if (value < 0 || (value == 0 && 1 / value < 0)) {
+			prefix[prefixLength ++] = '-';
+			value = -value;
+		} else if (spec.sign != 0) {
+			prefix[prefixLength ++] = spec.sign;
+		}
+
+		if (value != value || value > DBL_MAX) {
+			finite = false;
+			length = format_double(value, precision, digits);
+			if (upper) {
+				for (size_t i = 0; i < length; ++ i) {
+					digits[i] = (char)(digits[i] - 'a' + 'A');
+				}
+			}
+		} else if (c == 'e' || c == 'E') {
+			length = _FormatExponent(value, precision, upper, spec.alternate, digits);
+		} else if (c == 'g' || c == 'G') {
+			length = _FormatGeneral(value, precision, upper, spec.alternate, digits);
+		} else if (value >= 9223372036854775808.0) { // 2^63, format_double() turns to d.ddde+xx
+			length = _FormatLargeFixed(value, precision, digits);
+		} else {
+			length = format_double(value, precision, digits);
+		}
+		if (spec.alternate && precision == 0 && (c == 'f' || c == 'F')) {
+			digits[length ++] = '.';
+		}
+	} else {
+		integer = true;
+		bool negative = m_type == FAT_INT && m_value.i < 0;
+		unsigned __int64 value = m_value.u;
+		if (c == 'x' || c == 'X' || c == 'o' || c == 'p') {
+			if (spec.alternate && value != 0 && c != 'o') {
+				prefix[prefixLength ++] = '0';
+				prefix[prefixLength ++] = upper ? 'X' : 'x';
+			}
+			if (c == 'o') {
+				char octal[24];
+				char *p = octal + sizeof(octal);
+				do {
+					*-- p = (char)('0' + (value & 7));
+					value >>= 3;
+				} while (value != 0);
+				if (spec.alternate && *p != '0') {
+					*-- p = '0';
+				}
+				length = octal + sizeof(octal) - p;
+				for (size_t i = 0; i < length; ++ i) {
+					digits[i] = p[i];
+				}
+			} else {
+				length = format_hex(value, 0, upper, digits);
+			}
+		} else {
+			if (negative) {
+				prefix[prefixLength ++] = '-';
+				value = 0 - value;
+			} else if (spec.sign != 0 && c != 'u') {
+				prefix[prefixLength ++] = spec.sign;
+			}
+			length = format_uint(value, digits);
+		}
+	}
+
+	// the zeros: of the precision for the integers, or of the width
+	size_t zeros = 0;
+	if (integer && spec.precision >= 0) {
+		size_t precision = (size_t)spec.precision < MAX_WIDTH ? (size_t)spec.precision : MAX_WIDTH;
+		if (precision == 0 && length == 1 && digits[0] == '0' && !(spec.alternate && c == 'o')) {
+			length = 0; // "%.0d" of 0 is "", "%#.0o" is "0"
+		}
+		zeros = precision > length ? precision - length : 0;
+	} else if (spec.zero && !spec.left && finite) {
+		size_t width = spec.width < MAX_WIDTH ? spec.width : MAX_WIDTH;
+		zeros = width > prefixLength + length ? width - prefixLength - length : 0;
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < prefixLength; ++ i) {
+		buffer[n ++] = prefix[i];
+	}
+	for (size_t i = 0; i < zeros; ++ i) {
+		buffer[n ++] = '0';
+	}
+	for (size_t i = 0; i < length; ++ i) {
+		buffer[n ++] = digits[i];
+	}
+	return n;
+}
+
+XL_END
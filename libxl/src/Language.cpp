@@ -2,6 +2,7 @@
 #include "../include/fs.h"
 #include "../include/ini.h"
 #include "../include/Language.h"
+#include "../include/utilities.h"
 
 static TCHAR *sDefLcid = _T("0409");
 
@@ -51,6 +52,7 @@ void CLanguage::_LoadStrings () {
 
 void CLanguage::setBaseDir (const tstring &baseDir) {
 	assert(baseDir.length() > 0);
+	CScopeLock sl(this);
 	tstring base = baseDir;
 	if (base.at(base.length() - 1) == _T('\\') || base.at(base.length() - 1) == _T('/')) {
 		base = base.substr(0, base.length() - 1);
@@ -63,6 +65,7 @@ void CLanguage::setBaseDir (const tstring &baseDir) {
 }
 
 void CLanguage::setLcid (const tstring &lcid) {
+	CScopeLock sl(this);
 	if (m_lcid != lcid) {
 		m_lcid = lcid;
 		m_pIni.reset();
@@ -74,7 +77,16 @@ CLanguage* CLanguage::getInstance () {
 	return &language;
 }
 
+bool CLanguage::preload () {
+	CScopeLock sl(this);
+	if (m_pIni.get() == NULL) {
+		_LoadStrings();
+	}
+	return m_pIni.get() != NULL;
+}
+
 tstring CLanguage::getString (const tstring &key) {
+	CScopeLock sl(this);
 	if (m_pIni.get() == NULL) {
 		this->_LoadStrings();
 		if (m_pIni.get() == NULL) {
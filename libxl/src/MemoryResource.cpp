@@ -0,0 +1,254 @@
+#include <assert.h>
+#include <new>
+#include "../include/MemoryResource.h"
+#include "../include/lockable.h"
+
+XL_BEGIN
+PMR_BEGIN
+
+namespace {
+
+inline size_t _AlignUp (size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+class CNewDeleteResource : public IMemoryResource
+{
+public:
+	virtual void* allocate (size_t bytes, size_t alignment) {
+		assert(alignment <= DEFAULT_ALIGNMENT);
+		XL_PARAMETER_NOT_USED(alignment);
+		return ::operator new(bytes);
+	}
+	virtual void deallocate (void *p, size_t /*bytes*/, size_t /*alignment*/) {
+		::operator delete(p);
+	}
+};
+
+IMemoryResource *s_defaultResource = NULL;
+
+}
+
+IMemoryResource* new_delete_resource () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static CNewDeleteResource resource;
+	return &resource;
+}
+
+IMemoryResource* get_default_resource () {
+	return s_defaultResource == NULL ? new_delete_resource() : s_defaultResource;
+}
+
+IMemoryResource* set_default_resource (IMemoryResource *resource) {
+	IMemoryResource *previous = get_default_resource();
+	s_defaultResource = resource;
+	return previous;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CMonotonicArena
+
+CMonotonicArena::CMonotonicArena (IMemoryResource *upstream)
+	: m_upstream(upstream == NULL ? get_default_resource() : upstream)
+	, m_blocks(NULL)
+	, m_initialSize(1024)
+{
+	_Init(NULL, 0);
+}
+
+CMonotonicArena::CMonotonicArena (size_t initialSize, IMemoryResource *upstream)
+	: m_upstream(upstream == NULL ? get_default_resource() : upstream)
+	, m_blocks(NULL)
+	, m_initialSize(initialSize < sizeof(_Block) * 2 ? sizeof(_Block) * 2 : initialSize)
+{
+	_Init(NULL, 0);
+}
+
+CMonotonicArena::CMonotonicArena (void *buffer, size_t size, IMemoryResource *upstream)
+	: m_upstream(upstream == NULL ? get_default_resource() : upstream)
+	, m_blocks(NULL)
+	, m_initialSize(1024)
+{
+	_Init(buffer, size);
+}
+
+CMonotonicArena::~CMonotonicArena () {
+	release();
+}
+
+void CMonotonicArena::_Init (void *buffer, size_t size) {
+	assert(m_blocks == NULL);
+	m_buffer = (char *)buffer;
+	m_bufferSize = size;
+	m_cur = m_buffer;
+	m_end = m_buffer + size;
+	// the blocks grow from the size of the buffer
+	m_nextSize = size * 2 > m_initialSize ? size * 2 : m_initialSize;
+}
+
+void CMonotonicArena::_Grow (size_t bytes) {
+	size_t header = _AlignUp(sizeof(_Block), DEFAULT_ALIGNMENT);
+	size_t size = m_nextSize;
+	if (size < header + bytes) {
+		size = header + bytes;
+	}
+
+	_Block *block = (_Block *)m_upstream->allocate(size, DEFAULT_ALIGNMENT);
+	block->next = m_blocks;
+	block->size = size;
+	m_blocks = block;
+	m_cur = (char *)block + header;
+	m_end = (char *)block + size;
+	m_nextSize = size * 2;
+}
+
+void CMonotonicArena::release () {
+	while (m_blocks != NULL) {
+		_Block *next = m_blocks->next;
+		m_upstream->deallocate(m_blocks, m_blocks->size, DEFAULT_ALIGNMENT);
+		m_blocks = next;
+	}
+	_Init(m_buffer, m_bufferSize);
+}
+
+void* CMonotonicArena::allocate (size_t bytes, size_t alignment) {
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= DEFAULT_ALIGNMENT);
+	char *p = (char *)_AlignUp((size_t)m_cur, alignment);
+	if (m_cur == NULL || p > m_end || (size_t)(m_end - p) < bytes) {
+		// the new block is aligned to DEFAULT_ALIGNMENT
+		_Grow(bytes);
+		p = m_cur;
+	}
+	m_cur = p + bytes;
+	return p;
+}
+
+void CMonotonicArena::deallocate (void * /*p*/, size_t /*bytes*/, size_t /*alignment*/) {
+	// freed by release()
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPoolResource
+
+CPoolResource::CPoolResource (IMemoryResource *upstream)
+	: m_upstream(upstream == NULL ? get_default_resource() : upstream)
+	, m_chunks(NULL)
+	, m_large(NULL)
+{
+	for (size_t i = 0; i < POOL_COUNT; ++ i) {
+		m_free[i] = NULL;
+		m_chunkBlocks[i] = 16;
+	}
+}
+
+CPoolResource::~CPoolResource () {
+	release();
+}
+
+size_t CPoolResource::_GetPool (size_t bytes, size_t alignment) {
+	size_t size = bytes > alignment ? bytes : alignment;
+	size_t pool = 0;
+	for (size_t blockSize = MIN_POOLED; blockSize < size; blockSize <<= 1) {
+		++ pool;
+	}
+	return pool; // POOL_COUNT and above for the large ones
+}
+
+void CPoolResource::_Refill (size_t pool) {
+	assert(pool < POOL_COUNT && m_free[pool] == NULL);
+	size_t blockSize = (size_t)MIN_POOLED << pool;
+	size_t header = _AlignUp(sizeof(_Chunk), DEFAULT_ALIGNMENT);
+	size_t count = m_chunkBlocks[pool];
+	size_t size = header + blockSize * count;
+
+	_Chunk *chunk = (_Chunk *)m_upstream->allocate(size, DEFAULT_ALIGNMENT);
+	chunk->next = m_chunks;
+	chunk->size = size;
+	m_chunks = chunk;
+
+	// link the blocks in the order of the addresses
+	char *p = (char *)chunk + header;
+	for (size_t i = 0; i < count; ++ i) {
+		_Free *block = (_Free *)(p + i * blockSize);
+		block->next = i + 1 < count ? (_Free *)(p + (i + 1) * blockSize) : NULL;
+	}
+	m_free[pool] = (_Free *)p;
+
+	if (blockSize * count * 2 <= MAX_CHUNK) {
+		m_chunkBlocks[pool] = count * 2;
+	}
+}
+
+void CPoolResource::release () {
+	while (m_chunks != NULL) {
+		_Chunk *next = m_chunks->next;
+		m_upstream->deallocate(m_chunks, m_chunks->size, DEFAULT_ALIGNMENT);
+		m_chunks = next;
+	}
+	while (m_large != NULL) {
+		_Large *next = m_large->next;
+		m_upstream->deallocate(m_large, m_large->size, DEFAULT_ALIGNMENT);
+		m_large = next;
+	}
+	for (size_t i = 0; i < POOL_COUNT; ++ i) {
+		m_free[i] = NULL;
+		m_chunkBlocks[i] = 16;
+	}
+}
+
+void* CPoolResource::allocate (size_t bytes, size_t alignment) {
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= DEFAULT_ALIGNMENT);
+	size_t pool = _GetPool(bytes, alignment);
+	if (pool < POOL_COUNT) {
+		if (m_free[pool] == NULL) {
+			_Refill(pool);
+		}
+		_Free *block = m_free[pool];
+		m_free[pool] = block->next;
+		return block;
+	}
+
+	// large, linked to be freed by release()
+	size_t header = _AlignUp(sizeof(_Large), DEFAULT_ALIGNMENT);
+	_Large *large = (_Large *)m_upstream->allocate(header + bytes, DEFAULT_ALIGNMENT);
+	large->size = header + bytes;
+	large->prev = NULL;
+	large->next = m_large;
+	if (m_large != NULL) {
+		m_large->prev = large;
+	}
+	m_large = large;
+	return (char *)large + header;
+}
+
+void CPoolResource::deallocate (void *p, size_t bytes, size_t alignment) {
+	if (p == NULL) {
+		return;
+	}
+	size_t pool = _GetPool(bytes, alignment);
+	if (pool < POOL_COUNT) {
+		_Free *block = (_Free *)p;
+		block->next = m_free[pool];
+		m_free[pool] = block;
+		return;
+	}
+
+	size_t header = _AlignUp(sizeof(_Large), DEFAULT_ALIGNMENT);
+	_Large *large = (_Large *)((char *)p - header);
+	assert(large->size == header + bytes);
+	if (large->prev != NULL) {
+		large->prev->next = large->next;
+	} else {
+		m_large = large->next;
+	}
+	if (large->next != NULL) {
+		large->next->prev = large->prev;
+	}
+	m_upstream->deallocate(large, large->size, DEFAULT_ALIGNMENT);
+}
+
+PMR_END
+XL_END
@@ -295,9 +295,8 @@ bool CRegistry::deleteKey (
 	}
 
 	// subkey forbidden ?
-	const xl::tchar *szSubKey = subKey.c_str();
 	for (size_t i = 0; i < COUNT_OF(forbiddenSubKeys); ++ i) {
-		if (_tcsicmp(szSubKey, forbiddenSubKeys[i]) == 0) {
+		if (xl::iequals(subKey.c_str(), subKey.length(), forbiddenSubKeys[i], _tcslen(forbiddenSubKeys[i]))) {
 			allowed = false;
 			break;
 		}
@@ -0,0 +1,167 @@
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include "../include/StringBuilder.h"
+
+XL_BEGIN
+
+namespace {
+
+const unsigned __int64 _Pow10[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+	100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+	10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL
+};
+
+/**
+ * value rounded to precision digits after the point, half away from zero,
+ * if its integer part fits in 63 bits
+ */
+bool _FormatFixed (double value, int precision, char *buffer, size_t &length) {
+	if (value >= 9223372036854775808.0) { // 2^63
+		return false;
+	}
+
+	// the fraction is exact, the rounding is of the digits only
+	unsigned __int64 integer = (unsigned __int64)value;
+	double fraction = value - (double)integer;
+	unsigned __int64 digits = (unsigned __int64)(fraction * (double)_Pow10[precision] + 0.5);
+	if (digits >= _Pow10[precision]) {
+		digits -= _Pow10[precision];
+		++ integer;
+	}
+
+	length = format_uint(integer, buffer);
+	if (precision > 0) {
+		buffer[length ++] = '.';
+		for (int i = precision - 1; i >= 0; -- i) {
+			buffer[length + i] = (char)('0' + digits % 10);
+			digits /= 10;
+		}
+		length += precision;
+	}
+	return true;
+}
+
+}
+
+size_t format_uint (unsigned __int64 value, char *buffer) {
+	char digits[24];
+	char *p = digits + sizeof(digits);
+	do {
+		*-- p = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	size_t length = digits + sizeof(digits) - p;
+	for (size_t i = 0; i < length; ++ i) {
+		buffer[i] = p[i];
+	}
+	return length;
+}
+
+size_t format_int (__int64 value, char *buffer) {
+	if (value < 0) {
+		buffer[0] = '-';
+		// -value overflows for the minimum
+		return 1 + format_uint(0 - (unsigned __int64)value, buffer + 1);
+	}
+	return format_uint((unsigned __int64)value, buffer);
+}
+
+size_t format_hex (unsigned __int64 value, size_t width, bool upper, char *buffer) {
+	assert(width <= 16);
+	const char *hex = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	size_t length = 1;
+	while (length < 16 && (value >> (length * 4)) != 0) {
+		++ length;
+	}
+	if (length < width) {
+		length = width;
+	}
+	for (size_t i = 0; i < length; ++ i) {
+		buffer[length - 1 - i] = hex[(value >> (i * 4)) & 0xf];
+	}
+	return length;
+}
+
+size_t format_double (double value, int precision, char *buffer) {
+	assert(precision >= 0 && precision <= 17);
+	if (precision < 0) {
+		precision = 0;
+	} else if (precision > 17) {
+		precision = 17;
+	}
+
+	if (value != value) {
+		buffer[0] = 'n';
+		buffer[1] = 'a';
+		buffer[2] = 'n';
+		return 3;
+	}
+
+	size_t length = 0;
+	if (value < 0 || (value == 0 && 1 / value < 0)) {
+		buffer[length ++] = '-';
+		value = -value;
+	}
+	if (value > DBL_MAX) {
+		buffer[length ++] = 'i';
+		buffer[length ++] = 'n';
+		buffer[length ++] = 'f';
+		return length;
+	}
+
+	size_t fixed = 0;
+	if (_FormatFixed(value, precision, buffer + length, fixed)) {
+		return length + fixed;
+	}
+
+	// d.ddde+xx, value >= 1 here
+	int exponent = (int)floor(log10(value));
+	double mantissa = value / pow(10.0, exponent);
+	if (mantissa >= 10) { // the error of log10() and pow()
+		mantissa /= 10;
+		++ exponent;
+	} else if (mantissa < 1) {
+		mantissa *= 10;
+		-- exponent;
+	}
+	if (mantissa * _Pow10[precision] + 0.5 >= 10.0 * _Pow10[precision]) { // rounded up to 10
+		mantissa /= 10;
+		++ exponent;
+	}
+	VERIFY(_FormatFixed(mantissa, precision, buffer + length, fixed));
+	length += fixed;
+	buffer[length ++] = 'e';
+	buffer[length ++] = '+';
+	if (exponent < 10) {
+		buffer[length ++] = '0';
+	}
+	length += format_uint(exponent, buffer + length);
+	return length;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// the printf() formats
+
+int format_length (const char *format, va_list args) {
+	return _vscprintf(format, args);
+}
+
+int format_length (const wchar_t *format, va_list args) {
+	return _vscwprintf(format, args);
+}
+
+int format_v (char *buffer, size_t count, const char *format, va_list args) {
+	return vsprintf_s(buffer, count, format, args);
+}
+
+int format_v (wchar_t *buffer, size_t count, const wchar_t *format, va_list args) {
+	return vswprintf_s(buffer, count, format, args);
+}
+
+XL_END
@@ -0,0 +1,190 @@
+#include <assert.h>
+#include <process.h>
+#include "../include/utilities.h"
+#include "../include/ThreadPool.h"
+
+XL_BEGIN
+
+namespace {
+
+/**
+ * the state shared by all threads of one parallel_for()
+ */
+struct BANDSTATE {
+	IBandExecutable   *task;
+	long               bands;
+	volatile long      next;
+	volatile long      failed;
+};
+
+void _RunBands (BANDSTATE *state) {
+	while (state->failed == 0) {
+		long band = ::InterlockedIncrement(&state->next) - 1;
+		if (band >= state->bands) {
+			break;
+		}
+		if (!(*state->task)((uint)band)) {
+			::InterlockedExchange(&state->failed, 1);
+		}
+	}
+}
+
+class CBandJob : public IExecutable
+{
+	BANDSTATE         *m_state;
+	HANDLE             m_done;
+
+public:
+	CBandJob (BANDSTATE *state) : m_state(state) {
+		m_done = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+		assert(m_done != NULL);
+	}
+
+	~CBandJob () {
+		::CloseHandle(m_done);
+	}
+
+	bool operator() () {
+		_RunBands(m_state);
+		::SetEvent(m_done);
+		return true;
+	}
+
+	void wait () {
+		::WaitForSingleObject(m_done, INFINITE);
+	}
+};
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CThreadPool
+
+CThreadPool::CThreadPool () : m_exiting(false) {
+	SYSTEM_INFO si;
+	::GetSystemInfo(&si);
+	uint count = si.dwNumberOfProcessors > 0 ? si.dwNumberOfProcessors : 1;
+
+	m_semaphore = ::CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+	assert(m_semaphore != NULL);
+	for (uint i = 0; i < count; ++ i) {
+		HANDLE thread = (HANDLE)_beginthreadex(NULL, 0, _ThreadProc, this, 0, NULL);
+		assert(thread != NULL);
+		if (thread != NULL) {
+			m_threads.push_back(thread);
+		}
+	}
+}
+
+CThreadPool::~CThreadPool () {
+	lock();
+	m_exiting = true;
+	unlock();
+
+	::ReleaseSemaphore(m_semaphore, (LONG)m_threads.size(), NULL);
+	for (_ThreadContainer::iterator it = m_threads.begin(); it != m_threads.end(); ++ it) {
+		::WaitForSingleObject(*it, INFINITE);
+		::CloseHandle(*it);
+	}
+	::CloseHandle(m_semaphore);
+}
+
+unsigned __stdcall CThreadPool::_ThreadProc (void *param) {
+	CThreadPool *pThis = (CThreadPool *)param;
+	pThis->_Run();
+	return 0;
+}
+
+void CThreadPool::_Run () {
+	while (true) {
+		::WaitForSingleObject(m_semaphore, INFINITE);
+
+		lock();
+		if (m_exiting) {
+			unlock();
+			break;
+		}
+		if (m_jobs.empty()) { // canceled
+			unlock();
+			continue;
+		}
+		IExecutable *job = m_jobs.front();
+		m_jobs.pop_front();
+		unlock();
+
+		(*job)();
+	}
+}
+
+CThreadPool* CThreadPool::getInstance () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static CThreadPool pool;
+	return &pool;
+}
+
+uint CThreadPool::getThreadCount () const {
+	return (uint)m_threads.size();
+}
+
+void CThreadPool::post (IExecutable *job) {
+	assert(job != NULL);
+	lock();
+	m_jobs.push_back(job);
+	unlock();
+	::ReleaseSemaphore(m_semaphore, 1, NULL);
+}
+
+bool CThreadPool::cancel (IExecutable *job) {
+	CScopeLock sl(this);
+	for (_JobContainer::iterator it = m_jobs.begin(); it != m_jobs.end(); ++ it) {
+		if (*it == job) {
+			m_jobs.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// parallel_for
+
+bool parallel_for (uint bands, IBandExecutable *task) {
+	assert(task != NULL);
+	BANDSTATE state;
+	state.task = task;
+	state.bands = (long)bands;
+	state.next = 0;
+	state.failed = 0;
+
+	CThreadPool *pool = CThreadPool::getInstance();
+	uint helpers = bands > 1 ? bands - 1 : 0;
+	if (helpers > pool->getThreadCount()) {
+		helpers = pool->getThreadCount();
+	}
+
+	std::vector<CBandJob *> jobs;
+	jobs.reserve(helpers);
+	for (uint i = 0; i < helpers; ++ i) {
+		jobs.push_back(new CBandJob(&state));
+		pool->post(jobs.back());
+	}
+
+	_RunBands(&state);
+
+	// the helpers which have not been started are not needed any more,
+	// and removing them makes nested calls from pool threads safe.
+	for (std::vector<CBandJob *>::iterator it = jobs.begin(); it != jobs.end(); ++ it) {
+		if (!pool->cancel(*it)) {
+			(*it)->wait();
+		}
+		delete *it;
+	}
+
+	return state.failed == 0;
+}
+
+
+XL_END
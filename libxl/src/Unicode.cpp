@@ -0,0 +1,471 @@
+#include <assert.h>
+#include <string.h>
+#include <emmintrin.h>
+#include "../include/Unicode.h"
+#include "../include/utilities.h"
+
+XL_BEGIN
+
+namespace {
+
+const uint INVALID = (uint)-1;
+const uint REPLACEMENT = 0xfffd;
+
+// the wchar_t in a vector
+const size_t WIDE_LANES = 16 / sizeof(wchar_t);
+
+bool _UseSSE2 () {
+	static const bool use = cpu_has_sse2();
+	return use;
+}
+
+bool _IsAsciiBlock (const char *s) {
+	return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)s)) == 0;
+}
+
+bool _IsAsciiWideBlock (const wchar_t *s) {
+	__m128i v = _mm_loadu_si128((const __m128i *)s);
+	__m128i eq;
+	if (sizeof(wchar_t) == 2) {
+		eq = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xff80)), _mm_setzero_si128());
+	} else {
+		eq = _mm_cmpeq_epi32(_mm_and_si128(v, _mm_set1_epi32((int)0xffffff80)), _mm_setzero_si128());
+	}
+	return _mm_movemask_epi8(eq) == 0xffff;
+}
+
+/**
+ * 16 bytes to 16 wchar_t
+ */
+void _WidenBlock (const char *s, wchar_t *dst) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v = _mm_loadu_si128((const __m128i *)s);
+	__m128i lo = _mm_unpacklo_epi8(v, zero);
+	__m128i hi = _mm_unpackhi_epi8(v, zero);
+	if (sizeof(wchar_t) == 2) {
+		_mm_storeu_si128((__m128i *)dst, lo);
+		_mm_storeu_si128((__m128i *)(dst + 8), hi);
+	} else {
+		_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo, zero));
+		_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(lo, zero));
+		_mm_storeu_si128((__m128i *)(dst + 8), _mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_si128((__m128i *)(dst + 12), _mm_unpackhi_epi16(hi, zero));
+	}
+}
+
+/**
+ * WIDE_LANES wchar_t below 0x80 to bytes
+ */
+void _NarrowBlock (const wchar_t *s, char *dst) {
+	__m128i v = _mm_loadu_si128((const __m128i *)s);
+	if (sizeof(wchar_t) == 2) {
+		_mm_storel_epi64((__m128i *)dst, _mm_packus_epi16(v, v));
+	} else {
+		v = _mm_packs_epi32(v, v);
+		int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+		memcpy(dst, &bytes, 4);
+	}
+}
+
+/**
+ * the code point at s[0, n), n > 0
+ * @param used Receives the bytes of the character, or of the maximal ill-formed part
+ * @return INVALID if it is ill-formed
+ */
+uint _DecodeUtf8 (const uint8 *s, size_t n, size_t *used) {
+	uint8 c = s[0];
+	if (c < 0x80) {
+		*used = 1;
+		return c;
+	}
+
+	size_t need;
+	uint cp;
+	uint8 lo = 0x80, hi = 0xbf; // the range of the second byte
+	if (c >= 0xc2 && c <= 0xdf) {
+		need = 1;
+		cp = c & 0x1f;
+	} else if (c >= 0xe0 && c <= 0xef) {
+		need = 2;
+		cp = c & 0x0f;
+		if (c == 0xe0) {
+			lo = 0xa0; // overlong
+		} else if (c == 0xed) {
+			hi = 0x9f; // surrogates
+		}
+	} else if (c >= 0xf0 && c <= 0xf4) {
+		need = 3;
+		cp = c & 0x07;
+		if (c == 0xf0) {
+			lo = 0x90; // overlong
+		} else if (c == 0xf4) {
+			hi = 0x8f; // above 0x10ffff
+		}
+	} else {
+		*used = 1;
+		return INVALID;
+	}
+
+	size_t i = 1;
+	for (; i <= need; ++ i) {
+		if (i >= n || s[i] < lo || s[i] > hi) {
+			*used = i;
+			return INVALID;
+		}
+		cp = (cp << 6) | (s[i] & 0x3f);
+		lo = 0x80;
+		hi = 0xbf;
+	}
+	*used = i;
+	return cp;
+}
+
+bool _IsHighSurrogate (uint c) {
+	return c >= 0xd800 && c <= 0xdbff;
+}
+
+bool _IsLowSurrogate (uint c) {
+	return c >= 0xdc00 && c <= 0xdfff;
+}
+
+/**
+ * the code point of UTF-16 units, lone surrogates are INVALID
+ */
+uint _DecodeUtf16 (uint unit, bool hasNext, uint next, size_t *used) {
+	*used = 1;
+	if (_IsHighSurrogate(unit)) {
+		if (hasNext && _IsLowSurrogate(next)) {
+			*used = 2;
+			return 0x10000 + ((unit - 0xd800) << 10) + (next - 0xdc00);
+		}
+		return INVALID;
+	}
+	return _IsLowSurrogate(unit) ? INVALID : unit;
+}
+
+/**
+ * the code point at s[0, n), n > 0, of UTF-16 or UTF-32 as wchar_t is
+ */
+uint _DecodeWide (const wchar_t *s, size_t n, size_t *used) {
+	if (sizeof(wchar_t) == 2) {
+		return _DecodeUtf16((ushort)s[0], n > 1, n > 1 ? (ushort)s[1] : 0, used);
+	}
+	*used = 1;
+	uint c = (uint)s[0];
+	return c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff) ? INVALID : c;
+}
+
+size_t _WideLength (uint cp) {
+	return sizeof(wchar_t) == 2 && cp >= 0x10000 ? 2 : 1;
+}
+
+size_t _PutWide (uint cp, wchar_t *dst) {
+	if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+		cp -= 0x10000;
+		dst[0] = (wchar_t)(0xd800 + (cp >> 10));
+		dst[1] = (wchar_t)(0xdc00 + (cp & 0x3ff));
+		return 2;
+	}
+	dst[0] = (wchar_t)cp;
+	return 1;
+}
+
+size_t _Utf8Length (uint cp) {
+	return cp < 0x80 ? 1 : (cp < 0x800 ? 2 : (cp < 0x10000 ? 3 : 4));
+}
+
+size_t _PutUtf8 (uint cp, char *dst) {
+	uint8 *p = (uint8 *)dst;
+	if (cp < 0x80) {
+		p[0] = (uint8)cp;
+		return 1;
+	} else if (cp < 0x800) {
+		p[0] = (uint8)(0xc0 | (cp >> 6));
+		p[1] = (uint8)(0x80 | (cp & 0x3f));
+		return 2;
+	} else if (cp < 0x10000) {
+		p[0] = (uint8)(0xe0 | (cp >> 12));
+		p[1] = (uint8)(0x80 | ((cp >> 6) & 0x3f));
+		p[2] = (uint8)(0x80 | (cp & 0x3f));
+		return 3;
+	}
+	p[0] = (uint8)(0xf0 | (cp >> 18));
+	p[1] = (uint8)(0x80 | ((cp >> 12) & 0x3f));
+	p[2] = (uint8)(0x80 | ((cp >> 6) & 0x3f));
+	p[3] = (uint8)(0x80 | (cp & 0x3f));
+	return 4;
+}
+
+uint _Unit (const uint8 *p, size_t index, bool bigEndian) {
+	return bigEndian ? (p[index * 2] << 8) | p[index * 2 + 1] : p[index * 2] | (p[index * 2 + 1] << 8);
+}
+
+/**
+ * 8 units of UTF-16 in the order of the CPU
+ */
+__m128i _LoadUnits (const uint8 *p, bool bigEndian) {
+	__m128i v = _mm_loadu_si128((const __m128i *)p);
+	if (bigEndian) {
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+	}
+	return v;
+}
+
+bool _HasSurrogate (__m128i v) {
+	__m128i eq = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xf800)), _mm_set1_epi16((short)0xd800));
+	return _mm_movemask_epi8(eq) != 0;
+}
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// detect_bom
+
+TEXT_ENCODING detect_bom (const void *data, size_t length, size_t *bomLength) {
+	const uint8 *p = (const uint8 *)data;
+	TEXT_ENCODING encoding = TE_UNKNOWN;
+	size_t bom = 0;
+	if (length >= 3 && p[0] == 0xef && p[1] == 0xbb && p[2] == 0xbf) {
+		encoding = TE_UTF8;
+		bom = 3;
+	} else if (length >= 2 && p[0] == 0xff && p[1] == 0xfe) {
+		encoding = TE_UTF16LE;
+		bom = 2;
+	} else if (length >= 2 && p[0] == 0xfe && p[1] == 0xff) {
+		encoding = TE_UTF16BE;
+		bom = 2;
+	}
+	if (bomLength != NULL) {
+		*bomLength = bom;
+	}
+	return encoding;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// ascii
+
+bool is_ascii (const char *s, size_t n) {
+	size_t i = 0;
+	if (_UseSSE2()) {
+		__m128i any = _mm_setzero_si128();
+		for (; i + 16 <= n; i += 16) {
+			any = _mm_or_si128(any, _mm_loadu_si128((const __m128i *)(s + i)));
+		}
+		if (_mm_movemask_epi8(any) != 0) {
+			return false;
+		}
+	}
+	for (; i < n; ++ i) {
+		if ((uint8)s[i] >= 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool is_ascii (const wchar_t *s, size_t n) {
+	size_t i = 0;
+	if (_UseSSE2()) {
+		for (; i + WIDE_LANES <= n; i += WIDE_LANES) {
+			if (!_IsAsciiWideBlock(s + i)) {
+				return false;
+			}
+		}
+	}
+	for (; i < n; ++ i) {
+		if ((uint)s[i] >= 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool utf8_validate (const char *s, size_t n) {
+	const uint8 *p = (const uint8 *)s;
+	const bool sse2 = _UseSSE2();
+	size_t i = 0;
+	while (i < n) {
+		if (sse2 && i + 16 <= n && _IsAsciiBlock(s + i)) {
+			i += 16;
+			continue;
+		}
+		size_t used;
+		if (_DecodeUtf8(p + i, n - i, &used) == INVALID) {
+			return false;
+		}
+		i += used;
+	}
+	return true;
+}
+
+void ascii_to_wide (const char *s, size_t n, wchar_t *dst) {
+	size_t i = 0;
+	if (_UseSSE2()) {
+		for (; i + 16 <= n; i += 16) {
+			_WidenBlock(s + i, dst + i);
+		}
+	}
+	for (; i < n; ++ i) {
+		assert((uint8)s[i] < 0x80);
+		dst[i] = (wchar_t)s[i];
+	}
+}
+
+void wide_to_ascii (const wchar_t *s, size_t n, char *dst) {
+	size_t i = 0;
+	if (_UseSSE2()) {
+		for (; i + WIDE_LANES <= n; i += WIDE_LANES) {
+			_NarrowBlock(s + i, dst + i);
+		}
+	}
+	for (; i < n; ++ i) {
+		assert((uint)s[i] < 0x80);
+		dst[i] = (char)s[i];
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// utf8 <=> wide
+
+size_t utf8_to_wide_length (const char *s, size_t n) {
+	const uint8 *p = (const uint8 *)s;
+	const bool sse2 = _UseSSE2();
+	size_t i = 0, length = 0;
+	while (i < n) {
+		if (sse2 && i + 16 <= n && _IsAsciiBlock(s + i)) {
+			i += 16;
+			length += 16;
+			continue;
+		}
+		// the block is not ASCII, decode it before trying the next one
+		size_t end = i + 16;
+		while (i < n && i < end) {
+			size_t used;
+			uint cp = _DecodeUtf8(p + i, n - i, &used);
+			length += cp == INVALID ? 1 : _WideLength(cp);
+			i += used;
+		}
+	}
+	return length;
+}
+
+size_t utf8_to_wide (const char *s, size_t n, wchar_t *dst) {
+	const uint8 *p = (const uint8 *)s;
+	const bool sse2 = _UseSSE2();
+	size_t i = 0;
+	wchar_t *d = dst;
+	while (i < n) {
+		if (sse2 && i + 16 <= n && _IsAsciiBlock(s + i)) {
+			_WidenBlock(s + i, d);
+			i += 16;
+			d += 16;
+			continue;
+		}
+		size_t end = i + 16;
+		while (i < n && i < end) {
+			size_t used;
+			uint cp = _DecodeUtf8(p + i, n - i, &used);
+			d += _PutWide(cp == INVALID ? REPLACEMENT : cp, d);
+			i += used;
+		}
+	}
+	return d - dst;
+}
+
+size_t wide_to_utf8_length (const wchar_t *s, size_t n) {
+	const bool sse2 = _UseSSE2();
+	size_t i = 0, length = 0;
+	while (i < n) {
+		if (sse2 && i + WIDE_LANES <= n && _IsAsciiWideBlock(s + i)) {
+			i += WIDE_LANES;
+			length += WIDE_LANES;
+			continue;
+		}
+		size_t end = i + WIDE_LANES;
+		while (i < n && i < end) {
+			size_t used;
+			uint cp = _DecodeWide(s + i, n - i, &used);
+			length += _Utf8Length(cp == INVALID ? REPLACEMENT : cp);
+			i += used;
+		}
+	}
+	return length;
+}
+
+size_t wide_to_utf8 (const wchar_t *s, size_t n, char *dst) {
+	const bool sse2 = _UseSSE2();
+	size_t i = 0;
+	char *d = dst;
+	while (i < n) {
+		if (sse2 && i + WIDE_LANES <= n && _IsAsciiWideBlock(s + i)) {
+			_NarrowBlock(s + i, d);
+			i += WIDE_LANES;
+			d += WIDE_LANES;
+			continue;
+		}
+		size_t end = i + WIDE_LANES;
+		while (i < n && i < end) {
+			size_t used;
+			uint cp = _DecodeWide(s + i, n - i, &used);
+			d += _PutUtf8(cp == INVALID ? REPLACEMENT : cp, d);
+			i += used;
+		}
+	}
+	return d - dst;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// utf16 => wide
+
+size_t utf16_to_wide_length (const void *data, size_t bytes, bool bigEndian) {
+	size_t units = bytes / 2;
+	if (sizeof(wchar_t) == 2) {
+		// a pair is 2 wchar_t, a lone surrogate is 1 U+FFFD
+		return units;
+	}
+
+	const uint8 *p = (const uint8 *)data;
+	size_t length = 0;
+	for (size_t i = 0; i < units; ) {
+		size_t used;
+		uint unit = _Unit(p, i, bigEndian);
+		_DecodeUtf16(unit, i + 1 < units, i + 1 < units ? _Unit(p, i + 1, bigEndian) : 0, &used);
+		++ length;
+		i += used;
+	}
+	return length;
+}
+
+size_t utf16_to_wide (const void *data, size_t bytes, bool bigEndian, wchar_t *dst) {
+	const uint8 *p = (const uint8 *)data;
+	const bool sse2 = _UseSSE2() && sizeof(wchar_t) == 2;
+	size_t units = bytes / 2;
+	size_t i = 0;
+	wchar_t *d = dst;
+	while (i < units) {
+		if (sse2 && i + 8 <= units) {
+			__m128i v = _LoadUnits(p + i * 2, bigEndian);
+			if (!_HasSurrogate(v)) {
+				_mm_storeu_si128((__m128i *)d, v);
+				i += 8;
+				d += 8;
+				continue;
+			}
+		}
+		size_t end = i + 8;
+		while (i < units && i < end) {
+			size_t used;
+			uint unit = _Unit(p, i, bigEndian);
+			uint cp = _DecodeUtf16(unit, i + 1 < units, i + 1 < units ? _Unit(p, i + 1, bigEndian) : 0, &used);
+			d += _PutWide(cp == INVALID ? REPLACEMENT : cp, d);
+			i += used;
+		}
+	}
+	return d - dst;
+}
+
+XL_END
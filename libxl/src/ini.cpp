@@ -2,14 +2,29 @@
 #include <stdio.h>
 #include "../include/fs.h"
 #include "../include/ini.h"
+#include "../include/StringBuilder.h"
 XL_BEGIN
 
-// FF FE (little endian)
-// FE FF (big endian)
-// EF BB BF (UTF8)
+namespace {
+
+void _AppendWide (CStringBuilderW &sb, const tstring_view &s) {
+#ifdef UNICODE
+	sb.append(s.data(), s.length());
+#else
+	sb.append(s2ws(string(s)));
+#endif
+}
+
+template <class Allocator>
+void _AppendWide (CStringBuilderW &sb, const std::basic_string<tchar, std::char_traits<tchar>, Allocator> &s) {
+	_AppendWide(sb, tstring_view(s.data(), s.length()));
+}
+
+}
 
 /**
- * Load the file content, and translate (if needed) to tstring
+ * Load the file content, and translate (if needed) to tstring, by the BOM:
+ * UTF-16 LE, UTF-16 BE or UTF-8, or MB if there is none
  */
 tstring CIni::_LoadFile () {
 	string data;
@@ -17,120 +32,115 @@ tstring CIni::_LoadFile () {
 		return tstring(); // error!
 	}
 
-	size_t len = data.length();
-	const uint8 *p = (const uint8 *)data.c_str();
-	if (len <= 4) { // MB
+	size_t bom = 0;
+	TEXT_ENCODING encoding = detect_bom(data.data(), data.length(), &bom);
+	const char *p = data.data() + bom;
+	size_t len = data.length() - bom;
+	switch (encoding) {
+	case TE_UTF16LE:
+	case TE_UTF16BE:
+		return ws2ts(utf162ws(p, len, encoding == TE_UTF16BE));
+	case TE_UTF8:
+#ifdef UNICODE
+		return utf82ws(p, len);
+#else
+		return ws2s(utf82ws(p, len));
+#endif
+	default:
+		// treats as MB
 		return s2ts(data);
 	}
-
-	// UCS LE ?
-	if (p[0] == 0xff && p[1] == 0xfe) {
-		wstring ws;
-		ws.reserve(len + 1);
-		size_t wl = len / 2;
-		for (size_t i = 1; i < wl; ++ i) {
-			wchar_t w = p[i * 2 + 1];
-			w <<= 8;
-			w |= p[i * 2];
-			ws += w;
-		}
-		return ws2ts(ws);
-	}
-
-	// UCS BE
-	if (p[0] == 0xfe && p[1] == 0xff) {
-		wstring ws;
-		ws.reserve(len + 1);
-		size_t wl = len / 2;
-		for (size_t i = 1; i < wl; ++ i) {
-			wchar_t w = p[i * 2];
-			w <<= 8;
-			w |= p[i * 2 + 1];
-			ws += w;
-		}
-		return ws2ts(ws);
-	}
-
-	// TODO: Test UTF8 CASE
-	if (p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
-		assert(false);
-	}
-
-	// treats as MB
-	return s2ts(data);
 }
 
 void CIni::_Load () {
 	tstring data = _LoadFile();
 
-	// split it into lines
-	ExplodeT<tchar>::ValueT lines = explode(_T("\r\n"), data);
+	// split it into lines, ended by CRLF, LF or CR
+	CSplitter lines(data, _T("\r\n"), -1, CSplitter::SM_LINES);
+	tstring_view token;
 
-	tstring section = _T("");
+	tstring_view section;
 	// parse every line
-	for (auto it = lines.begin(); it != lines.end(); ++ it) {
-		tstring line = *it;
-		line.trim(_T(" \t"));
+	while (lines.next(token)) {
+		tstring_view line = token.trimmed(_T(" \t"));
 
-		if (line.length() == 0) {
+		if (line.empty()) {
 			continue;
 		}
 
-		const tchar *l = line.c_str();
-		size_t len = line.length();
-
 		// comment ?
-		if (l[0] == _T(';')) {
+		if (line.front() == _T(';')) {
 			continue;
 		}
 
 		// [section] ?
-		if (l[0] == _T('[') && l[len - 1] == _T(']')) {
-			section = line.substr(1, len - 2);
+		if (line.front() == _T('[') && line.back() == _T(']')) {
+			section = line.substr(1, line.length() - 2);
 			continue;
 		}
 
 		// key=value ?
-		ExplodeT<tchar>::ValueT kv = explode(_T("="), line);
-		if (kv.size() < 2) {
-			if (line.at(line.length() - 1) != _T('=')) {
-				assert(false);
-				continue; // parse error
-			} else {
-				kv.push_back(_T(""));
-			}
+		CSplitter kv(line, _T("="), 2);
+		tstring_view k, v;
+		kv.next(k);
+		if (!kv.next(v) && line.back() != _T('=')) {
+			assert(false);
+			continue; // parse error
 		}
 
-		tstring key = kv[0];
-		tstring value = kv[1];
-		if (kv.size() > 2) {
-			for (size_t i = 2; i < kv.size(); ++ i) {
-				value += _T("=");
-				value += kv[i];
-			}
-		}
+		_Set(_GetSection(section), k, v);
+	}
+}
+
+/**
+ * the keys of the section, created with the resource if there are none
+ */
+CIni::_KVType& CIni::_GetSection (const tstring_view &section) {
+	pmr::tstring name(section, m_resource);
+	_MapType::iterator it = m_ini.find(name);
+	if (it == m_ini.end()) {
+		// the map of the keys takes the allocator of the one copied in
+		_KVType kv((_KVType::key_compare()), _KVType::allocator_type(m_resource));
+		it = m_ini.insert(std::make_pair(name, kv)).first;
+	}
+	return it->second;
+}
 
-		m_ini[section][key] = value;
+/**
+ * the key and the value allocated from the resource, a new value of a key
+ * reuses the string of the old one
+ */
+void CIni::_Set (_KVType &kv, const tstring_view &key, const tstring_view &value) {
+	pmr::tstring k(key, m_resource);
+	_KVType::iterator it = kv.find(k);
+	if (it == kv.end()) {
+		kv.insert(std::make_pair(k, pmr::tstring(value, m_resource)));
+	} else {
+		it->second.assign(value.data(), value.length());
 	}
 }
 
-CIni::CIni (const tstring &fileName) : m_fileName(fileName)
+CIni::CIni (const tstring &fileName, pmr::IMemoryResource *resource)
+	: m_fileName(fileName)
+	, m_resource(resource == NULL ? pmr::get_default_resource() : resource)
+	, m_ini(_MapType::key_compare(), _MapType::allocator_type(m_resource))
 {
 	_Load();
 }
 
 CIni::Iterator CIni::begin (const tstring &section) {
-	return m_ini[section].begin();
+	return _GetSection(tstring_view(section.data(), section.length())).begin();
 }
 
 CIni::Iterator CIni::end (const tstring &section) {
-	return m_ini[section].end();
+	return _GetSection(tstring_view(section.data(), section.length())).end();
 }
 
 tstring CIni::get (const tstring &section, const tstring &key) {
-	auto it = m_ini.find(section);
+	// compared by the characters, the allocator of the keys does not matter
+	auto it = m_ini.find(pmr::tstring(section.data(), section.length()));
 	if (it != m_ini.end()) {
-		auto v = it->second.find(key);
+		auto v = it->second.find(pmr::tstring(key.data(), key.length()));
 		if (v != it->second.end()) {
 			return v->second;
 		}
@@ -140,7 +150,7 @@ tstring CIni::get (const tstring &section, const tstring &key) {
 }
 
 void CIni::set (const tstring &section, const tstring &key, const tstring &value) {
-	m_ini[section][key] = value;
+	_Set(_GetSection(tstring_view(section.data(), section.length())), tstring_view(key.data(), key.length()), tstring_view(value.data(), value.length()));
 }
 
 void CIni::write (tstring fileName) {
@@ -149,37 +159,32 @@ void CIni::write (tstring fileName) {
 	}
 	assert(fileName.length() > 0);
 
-	// save as UCS2 LE
-	wstring ws = L"";
-	ws += (wchar_t)0xFEFF;
-	ws.reserve(1024 * 10);
+	// save as UCS2 LE, the blocks of the builder are written as they are
+	CStringBuilderW sb;
+	sb.append((wchar_t)0xFEFF);
 	for (auto sit = m_ini.begin(); sit != m_ini.end(); ++ sit) {
-		tstring section = sit->first;
+		const pmr::tstring &section = sit->first;
 		if (section.length() > 0) {
-			ws += _T("[");
-			ws += ts2ws(section);
-			ws += _T("]\r\n");
+			sb.append(L'[');
+			_AppendWide(sb, section);
+			sb.append(L"]\r\n", 3);
 		}
 
 		for (auto it = sit->second.begin(); it != sit->second.end(); ++ it) {
-			tstring line = it->first;
-			line += _T("=");
-			line += it->second;
-			ws += ts2ws(line);
-			ws += _T("\r\n");
+			_AppendWide(sb, it->first);
+			sb.append(L'=');
+			_AppendWide(sb, it->second);
+			sb.append(L"\r\n", 2);
 		}
 
-		ws += _T("\r\n\r\n");
+		sb.append(L"\r\n\r\n", 4);
 	}
 
-	const wchar_t *p = ws.c_str();
-	size_t len = ws.length();
-	const char *text = (const char *)p;
-	len = (len + 1) * 2;
-	string data;
-	data.append(text, len);
-
-	file_put_contents(fileName, data);
+	FILE *file = _tfopen(fileName.c_str(), _T("w+b"));
+	if (file) {
+		sb.write(file);
+		fclose(file);
+	}
 }
 
 void CIni::reload () {
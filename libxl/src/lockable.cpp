@@ -2,6 +2,44 @@
 #include "../include/lockable.h"
 XL_BEGIN
 
+namespace {
+
+// SRW is loaded dynamically, windows XP has none of it
+typedef void (WINAPI *_SRWFunction) (void **);
+typedef BOOLEAN (WINAPI *_SRWTryFunction) (void **);
+
+struct SRWAPI {
+	_SRWFunction     init;
+	_SRWFunction     lockExclusive;
+	_SRWFunction     unlockExclusive;
+	_SRWFunction     lockShared;
+	_SRWFunction     unlockShared;
+	_SRWTryFunction  tryExclusive;  // windows 7 and later
+
+	SRWAPI () {
+		HMODULE kernel = ::GetModuleHandle(_T("kernel32.dll"));
+		init = (_SRWFunction)::GetProcAddress(kernel, "InitializeSRWLock");
+		lockExclusive = (_SRWFunction)::GetProcAddress(kernel, "AcquireSRWLockExclusive");
+		unlockExclusive = (_SRWFunction)::GetProcAddress(kernel, "ReleaseSRWLockExclusive");
+		lockShared = (_SRWFunction)::GetProcAddress(kernel, "AcquireSRWLockShared");
+		unlockShared = (_SRWFunction)::GetProcAddress(kernel, "ReleaseSRWLockShared");
+		tryExclusive = (_SRWTryFunction)::GetProcAddress(kernel, "TryAcquireSRWLockExclusive");
+		if (!init || !lockExclusive || !unlockExclusive || !lockShared || !unlockShared) {
+			init = NULL;
+		}
+	}
+};
+
+const SRWAPI& _Srw () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static SRWAPI api;
+	return api;
+}
+
+}
+
+
 
 //////////////////////////////////////////////////////////////////////////
 /// user lock
@@ -49,4 +87,98 @@ int CUserLock::getLockLevel () const {
 }
 
 
+
+//////////////////////////////////////////////////////////////////////////
+/// read write lock
+
+CReadWriteLock::CReadWriteLock () : m_srw(NULL) {
+	if (_Srw().init) {
+		_Srw().init(&m_srw);
+	} else {
+		::InitializeCriticalSection(&m_cs);
+	}
+}
+
+CReadWriteLock::~CReadWriteLock () {
+	if (!_Srw().init) {
+		::DeleteCriticalSection(&m_cs);
+	}
+}
+
+void CReadWriteLock::lock () const {
+	if (_Srw().init) {
+		_Srw().lockExclusive(&m_srw);
+	} else {
+		::EnterCriticalSection(&m_cs);
+	}
+}
+
+void CReadWriteLock::unlock () const {
+	if (_Srw().init) {
+		_Srw().unlockExclusive(&m_srw);
+	} else {
+		::LeaveCriticalSection(&m_cs);
+	}
+}
+
+bool CReadWriteLock::tryLock () const {
+	if (_Srw().init) {
+		return _Srw().tryExclusive != NULL && _Srw().tryExclusive(&m_srw) != 0;
+	} else {
+		return ::TryEnterCriticalSection(&m_cs) != FALSE;
+	}
+}
+
+void CReadWriteLock::lockShared () const {
+	if (_Srw().init) {
+		_Srw().lockShared(&m_srw);
+	} else {
+		::EnterCriticalSection(&m_cs);
+	}
+}
+
+void CReadWriteLock::unlockShared () const {
+	if (_Srw().init) {
+		_Srw().unlockShared(&m_srw);
+	} else {
+		::LeaveCriticalSection(&m_cs);
+	}
+}
+
+bool CReadWriteLock::isSlim () {
+	return _Srw().init != NULL;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+/// once guard
+
+enum {
+	ONCE_NONE = 0,
+	ONCE_RUNNING,
+	ONCE_DONE
+};
+
+CScopeOnce::CScopeOnce (volatile LONG *state) : m_state(state), m_first(false) {
+	// the read of a volatile acquires, what the first caller built is visible
+	if (*m_state == ONCE_DONE) {
+		return;
+	}
+	if (::InterlockedCompareExchange(m_state, ONCE_RUNNING, ONCE_NONE) == ONCE_NONE) {
+		m_first = true;
+	} else {
+		while (*m_state != ONCE_DONE) {
+			::Sleep(1);
+		}
+	}
+}
+
+CScopeOnce::~CScopeOnce () {
+	if (m_first) {
+		::InterlockedExchange(m_state, ONCE_DONE);
+	}
+}
+
+
 XL_END
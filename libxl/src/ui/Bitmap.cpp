@@ -1,6 +1,7 @@
 #include <assert.h>
 #include "../../include/ui/Bitmap.h"
 #include "../../include/ui/Gdi.h"
+#include "../../include/ui/ImageCodec.h"
 XL_BEGIN
 UI_BEGIN
 
@@ -26,7 +27,7 @@ void CBitmap::clearColorKey () {
 }
 
 void CBitmap::gray () {
-	assert(m_hBitmap != NULL);
+	assert(!isNull());
 	assert(getBitCounts() >= 24);
 
 	int bitcount = getBitCounts();
@@ -107,9 +108,13 @@ bool CBitmap::load (int id) {
 	return m_hBitmap != NULL;
 }
 
+bool CBitmap::load (const tstring &path) {
+	return CImageCodec::map(path, this);
+}
+
 void CBitmap::draw (HDC hdc, int toX, int toY, int toW, int toH, int fromX, int fromY, uint op) {
-	assert(m_hBitmap != NULL);
-	if (!m_hBitmap) {
+	assert(!isNull());
+	if (isNull()) {
 		return;
 	}
 	draw(hdc, toX, toY, toW, toH, fromX, fromY, getWidth() - fromX, getHeight() - fromY, op);
@@ -121,11 +126,11 @@ void CBitmap::draw (
                     int fromX, int fromY, int fromW, int fromH,
                     uint op
                    ) {
-	assert(m_hBitmap != NULL);
+	assert(!isNull());
 	assert(fromX >= 0 && fromX < getWidth());
 	assert(fromY >= 0 && fromY < getHeight());
 	assert(fromW + fromX <= getWidth() && fromH + fromY <= getHeight());
-	if (!m_hBitmap) {
+	if (isNull() || !_Detach(true)) { // a mapped file has no HBITMAP yet
 		return;
 	}
 
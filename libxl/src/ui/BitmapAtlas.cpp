@@ -0,0 +1,239 @@
+#include <assert.h>
+#include <string.h>
+#include "../../include/utilities.h"
+#include "../../include/ui/BitmapAtlas.h"
+#include "../../include/ui/DIBConverter.h"
+
+XL_BEGIN
+UI_BEGIN
+
+//////////////////////////////////////////////////////////////////////////
+// CSkylinePacker
+
+int CSkylinePacker::_Fit (size_t i, int w, int h) const {
+	int x = m_skyline[i].x;
+	if (x + w > m_width) {
+		return -1;
+	}
+
+	int y = m_skyline[i].y;
+	for (int left = w; left > 0; ++ i) {
+		assert(i < m_skyline.size());
+		if (m_skyline[i].y > y) {
+			y = m_skyline[i].y;
+		}
+		if (y + h > m_height) {
+			return -1;
+		}
+		left -= m_skyline[i].width;
+	}
+	return y;
+}
+
+void CSkylinePacker::_Place (size_t i, int x, int y, int w, int h) {
+	SEGMENT segment = {x, y + h, w};
+	m_skyline.insert(m_skyline.begin() + i, segment);
+
+	// the segments under the new one are cut or removed
+	for (size_t j = i + 1; j < m_skyline.size(); ) {
+		const SEGMENT &prev = m_skyline[j - 1];
+		SEGMENT &cur = m_skyline[j];
+		int overlap = prev.x + prev.width - cur.x;
+		if (overlap <= 0) {
+			break;
+		}
+		if (overlap < cur.width) {
+			cur.x += overlap;
+			cur.width -= overlap;
+			break;
+		}
+		m_skyline.erase(m_skyline.begin() + j);
+	}
+
+	// merge the neighbours of the same height
+	for (size_t j = 1; j < m_skyline.size(); ) {
+		if (m_skyline[j - 1].y == m_skyline[j].y) {
+			m_skyline[j - 1].width += m_skyline[j].width;
+			m_skyline.erase(m_skyline.begin() + j);
+		} else {
+			++ j;
+		}
+	}
+	m_used += w * h;
+}
+
+CSkylinePacker::CSkylinePacker (int width, int height)
+	: m_width(width)
+	, m_height(height)
+{
+	assert(width > 0 && height > 0);
+	clear();
+}
+
+bool CSkylinePacker::insert (int w, int h, int &x, int &y) {
+	assert(w > 0 && h > 0);
+	int bestBottom = m_height + 1, bestWidth = 0;
+	size_t best = m_skyline.size();
+	for (size_t i = 0; i < m_skyline.size(); ++ i) {
+		int top = _Fit(i, w, h);
+		if (top < 0) {
+			continue;
+		}
+		// the lowest bottom, then the narrowest segment, which wastes less
+		if (top + h < bestBottom || (top + h == bestBottom && m_skyline[i].width < bestWidth)) {
+			best = i;
+			bestBottom = top + h;
+			bestWidth = m_skyline[i].width;
+		}
+	}
+	if (best == m_skyline.size()) {
+		return false;
+	}
+
+	x = m_skyline[best].x;
+	y = bestBottom - h;
+	_Place(best, x, y, w, h);
+	return true;
+}
+
+void CSkylinePacker::clear () {
+	m_skyline.clear();
+	SEGMENT segment = {0, 0, m_width};
+	m_skyline.push_back(segment);
+	m_used = 0;
+}
+
+double CSkylinePacker::getOccupancy () const {
+	return (double)m_used / ((double)m_width * m_height);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CSprite
+
+CSprite::CSprite (CBitmapPtr page, const RECT &rect)
+	: m_page(page)
+	, m_rect(rect)
+{
+	assert(page);
+	assert(rect.left >= 0 && rect.top >= 0 && rect.right <= page->getWidth() && rect.bottom <= page->getHeight());
+}
+
+int CSprite::getWidth () const {
+	return m_rect.right - m_rect.left;
+}
+
+int CSprite::getHeight () const {
+	return m_rect.bottom - m_rect.top;
+}
+
+CBitmapPtr CSprite::getPage () const {
+	return m_page;
+}
+
+RECT CSprite::getRect () const {
+	return m_rect;
+}
+
+void CSprite::draw (HDC hdc, int toX, int toY) {
+	draw(hdc, toX, toY, getWidth(), getHeight());
+}
+
+void CSprite::draw (HDC hdc, int toX, int toY, int toW, int toH) {
+	m_page->draw(hdc, toX, toY, toW, toH, m_rect.left, m_rect.top, getWidth(), getHeight());
+}
+
+void CSprite::draw (HDC hdc, int toX, int toY, int toW, int toH, int fromX, int fromY) {
+	assert(fromX >= 0 && fromY >= 0 && fromX + toW <= getWidth() && fromY + toH <= getHeight());
+	m_page->draw(hdc, toX, toY, toW, toH, m_rect.left + fromX, m_rect.top + fromY);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CBitmapAtlas
+
+CBitmapPtr CBitmapAtlas::_CreatePage (int w, int h, bool transparent, COLORREF colorKey) {
+	CBitmapPtr page(new CBitmap());
+	if (!page->create(w, h, 32)) {
+		return CBitmapPtr();
+	}
+
+	// the padding is transparent, or black
+	uint fill = transparent ? (0xff000000 | GetRValue(colorKey) << 16 | GetGValue(colorKey) << 8 | GetBValue(colorKey)) : 0xff000000;
+	for (int y = 0; y < h; ++ y) {
+		uint *line = (uint *)page->getLine(y);
+		for (int x = 0; x < w; ++ x) {
+			line[x] = fill;
+		}
+	}
+	if (transparent) {
+		page->setColorKey(colorKey);
+	}
+	return page;
+}
+
+CBitmapAtlas::CBitmapAtlas () {
+}
+
+CBitmapAtlas::~CBitmapAtlas () {
+}
+
+CSpritePtr CBitmapAtlas::add (const CDIBSection *src, bool transparent, COLORREF colorKey) {
+	assert(src != NULL && !src->isNull());
+	int w = src->getWidth(), h = src->getHeight();
+	RECT rc = {0, 0, w, h};
+
+	if (w > MAX_SPRITE_SIZE || h > MAX_SPRITE_SIZE) {
+		CBitmapPtr page = _CreatePage(w, h, transparent, colorKey);
+		if (!page || !CConvertEngine::convert(src, page.get())) {
+			return CSpritePtr();
+		}
+		return CSpritePtr(new CSprite(page, rc));
+	}
+
+	CScopeLock sl(this);
+	int x = 0, y = 0;
+	PAGE *page = NULL;
+	for (_PageContainer::iterator it = m_pages.begin(); it != m_pages.end(); ++ it) {
+		if (it->transparent == transparent && (!transparent || it->colorKey == colorKey)
+			&& it->packer.insert(w + PADDING, h + PADDING, x, y)) {
+			page = &*it;
+			break;
+		}
+	}
+	if (page == NULL) {
+		CBitmapPtr bitmap = _CreatePage(PAGE_SIZE, PAGE_SIZE, transparent, colorKey);
+		if (!bitmap) {
+			return CSpritePtr();
+		}
+		m_pages.push_back(PAGE(bitmap, transparent, colorKey));
+		page = &m_pages.back();
+		VERIFY(page->packer.insert(w + PADDING, h + PADDING, x, y));
+	}
+
+	// a view writes through the const lines, the writable ones copy the page
+	// first if a clone of it (by CSprite::getPage()) shares the pixels
+	page->bitmap->getLine(y);
+	if (page->bitmap->isShared()) { // selected into a DC, not copied
+		return CSpritePtr();
+	}
+	CDIBSectionPtr view = page->bitmap->createView(x, y, w, h);
+	if (!CConvertEngine::convert(src, view.get())) {
+		return CSpritePtr();
+	}
+	RECT sprite = {x, y, x + w, y + h};
+	return CSpritePtr(new CSprite(page->bitmap, sprite));
+}
+
+void CBitmapAtlas::clear () {
+	CScopeLock sl(this);
+	m_pages.clear();
+}
+
+int CBitmapAtlas::getPageCount () const {
+	CScopeLock sl(this);
+	return (int)m_pages.size();
+}
+
+UI_END
+XL_END
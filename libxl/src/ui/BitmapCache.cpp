@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "../../include/ui/BitmapCache.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+/**
+ * an unpinned entry, a candidate of the eviction
+ */
+struct CANDIDATE {
+	uint                   lastUse;
+	std::pair<int, uint64> key;
+
+	bool operator < (const CANDIDATE &rhs) const {
+		return lastUse < rhs.lastUse;
+	}
+};
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// protected methods
+
+uint CBitmapCache::_ShardOf (const _KeyType &key) {
+	uint64 h = (key.second ^ ((uint64)key.first << 56)) * 0x9e3779b97f4a7c15ULL;
+	return (uint)(h >> 32) % SHARDS;
+}
+
+uint64 CBitmapCache::_Bytes (const CBitmap *bitmap) {
+	if (bitmap->isNull()) {
+		return 0;
+	}
+	return CDIBSection::getBytes(bitmap->getWidth(), bitmap->getHeight(), bitmap->getBitCounts(), bitmap->getStrideAlign());
+}
+
+CBitmapPtr CBitmapCache::_Find (const _KeyType &key) {
+	SHARD &shard = m_shards[_ShardOf(key)];
+	CScopeSharedLock sl(&shard.lock);
+	_EntryContainer::iterator it = shard.entries.find(key);
+	if (it == shard.entries.end()) {
+		return CBitmapPtr();
+	}
+
+	// touch it, but do not dirty the line if it has been touched since the last insert
+	uint clock = m_clock;
+	if (it->second.lastUse != clock) {
+		it->second.lastUse = clock;
+	}
+	return it->second.bitmap;
+}
+
+bool CBitmapCache::_Erase (const _KeyType &key, bool keepPinned) {
+	SHARD &shard = m_shards[_ShardOf(key)];
+	CScopeLock sl(&shard.lock);
+	_EntryContainer::iterator entry = shard.entries.find(key);
+	if (entry == shard.entries.end() || (keepPinned && entry->second.bitmap.use_count() > 1)) {
+		return false;
+	}
+
+	STATS &stats = shard.stats[key.first];
+	-- stats.entries;
+	stats.bytes -= entry->second.bytes;
+	++ stats.evictions;
+	m_bytes -= entry->second.bytes;
+	shard.entries.erase(entry);
+	return true;
+}
+
+void CBitmapCache::_Group (const _KeyType &group, uint64 key) {
+	std::deque<uint64> &keys = m_groups[group];
+	std::deque<uint64>::iterator it = std::find(keys.begin(), keys.end(), key);
+	if (it != keys.end()) {
+		keys.erase(it);
+	}
+	keys.push_front(key);
+
+	while (keys.size() > GROUP_VARIANTS) {
+		// the users of a dropped variant keep it alive, but it is not found any more
+		_Erase(_KeyType(group.first, keys.back()), false);
+		keys.pop_back();
+	}
+}
+
+void CBitmapCache::_Trim () {
+	if (m_bytes <= m_budget) {
+		return;
+	}
+
+	std::vector<CANDIDATE> candidates;
+	for (uint i = 0; i < SHARDS; ++ i) {
+		CScopeSharedLock sl(&m_shards[i].lock);
+		const _EntryContainer &entries = m_shards[i].entries;
+		for (_EntryContainer::const_iterator it = entries.begin(); it != entries.end(); ++ it) {
+			if (it->second.bitmap.use_count() == 1) {
+				CANDIDATE candidate = {it->second.lastUse, it->first};
+				candidates.push_back(candidate);
+			}
+		}
+	}
+	std::stable_sort(candidates.begin(), candidates.end());
+
+	// they may have been taken (pinned) meanwhile, not replaced, m_trimLock is held
+	for (std::vector<CANDIDATE>::iterator it = candidates.begin(); it != candidates.end() && m_bytes > m_budget; ++ it) {
+		_Erase(it->key, true);
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// public methods
+
+CBitmapCache::CBitmapCache (uint64 budget)
+	: m_clock(0)
+	, m_budget(budget)
+	, m_bytes(0)
+{
+	for (uint i = 0; i < SHARDS; ++ i) {
+		memset((void *)m_shards[i].hits, 0, sizeof(m_shards[i].hits));
+		memset((void *)m_shards[i].misses, 0, sizeof(m_shards[i].misses));
+		memset(m_shards[i].stats, 0, sizeof(m_shards[i].stats));
+	}
+}
+
+CBitmapCache::~CBitmapCache () {
+}
+
+CBitmapPtr CBitmapCache::find (CATEGORY category, uint64 key) {
+	assert(category >= 0 && category < BC_COUNT);
+	_KeyType k(category, key);
+	CBitmapPtr bitmap = _Find(k);
+	SHARD &shard = m_shards[_ShardOf(k)];
+	::InterlockedIncrement(bitmap ? &shard.hits[category] : &shard.misses[category]);
+	return bitmap;
+}
+
+void CBitmapCache::insert (CATEGORY category, uint64 key, CBitmapPtr bitmap, uint64 group) {
+	assert(category >= 0 && category < BC_COUNT);
+	assert(bitmap);
+	_KeyType k(category, key);
+	SHARD &shard = m_shards[_ShardOf(k)];
+	uint64 bytes = _Bytes(bitmap.get());
+	uint64 replaced = 0;
+
+	// the entry and m_bytes change together, a clear() or a _Trim() sees both or none
+	CScopeLock sl(&m_trimLock);
+	{
+		CScopeLock sl(&shard.lock);
+		STATS &stats = shard.stats[category];
+		ENTRY &entry = shard.entries[k];
+		if (entry.bitmap) {
+			replaced = entry.bytes;
+			-- stats.entries;
+			stats.bytes -= entry.bytes;
+		}
+		entry.bitmap = bitmap;
+		entry.bytes = bytes;
+		entry.lastUse = ::InterlockedIncrement((volatile LONG *)&m_clock);
+		++ stats.entries;
+		stats.bytes += bytes;
+	}
+
+	m_bytes += bytes - replaced;
+	if (group != 0) {
+		_Group(_KeyType(category, group), key);
+	}
+	_Trim();
+}
+
+void CBitmapCache::clear () {
+	CScopeLock sl(&m_trimLock);
+	for (uint i = 0; i < SHARDS; ++ i) {
+		CScopeLock sl(&m_shards[i].lock);
+		m_shards[i].entries.clear();
+		for (int c = 0; c < BC_COUNT; ++ c) {
+			m_shards[i].stats[c].entries = 0;
+			m_shards[i].stats[c].bytes = 0;
+		}
+	}
+	m_groups.clear();
+	m_bytes = 0;
+}
+
+void CBitmapCache::setBudget (uint64 budget) {
+	CScopeLock sl(&m_trimLock);
+	m_budget = budget;
+	_Trim();
+}
+
+uint64 CBitmapCache::getBudget () const {
+	return m_budget;
+}
+
+uint64 CBitmapCache::getBytes () const {
+	CScopeLock sl(&m_trimLock);
+	return m_bytes;
+}
+
+CBitmapCache::STATS CBitmapCache::getStats (CATEGORY category) const {
+	assert(category >= 0 && category < BC_COUNT);
+	STATS stats;
+	memset(&stats, 0, sizeof(stats));
+	for (uint i = 0; i < SHARDS; ++ i) {
+		CScopeSharedLock sl(&m_shards[i].lock);
+		const STATS &s = m_shards[i].stats[category];
+		stats.entries += s.entries;
+		stats.bytes += s.bytes;
+		stats.evictions += s.evictions;
+		stats.hits += (uint)m_shards[i].hits[category];
+		stats.misses += (uint)m_shards[i].misses[category];
+	}
+	return stats;
+}
+
+UI_END
+XL_END
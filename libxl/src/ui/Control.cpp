@@ -327,9 +327,9 @@ void CControl::draw (HDC hdc, CRect rcClip) {
 	HDC hdcPaint = hdc;
 
 	CControlPtr parent = m_parent.lock();
-	std::auto_ptr<CMemoryDC> mdc;
+	std::auto_ptr<CDIBMemoryDC> mdc;
 	if (parent == NULL || opacity != 100/* || transparent*/) {
-		mdc.reset(new CMemoryDC(hdc, rc));
+		mdc.reset(new CDIBMemoryDC(hdc, rc));
 		if (parent != NULL) {
 			mdc->BitBlt(rc.left, rc.top, rc.Width(), rc.Height(), hdc, m_rect.left, m_rect.top, SRCCOPY);
 		}
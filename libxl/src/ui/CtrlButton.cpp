@@ -75,9 +75,10 @@ void CCtrlButton::_DrawImageAndText (HDC hdc) {
 	dc.SetTextColor(rgbOld);
 }
 
-void CCtrlButton::_ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw) {
-	if (key == _T("button-image")) {
-		ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
+void CCtrlButton::_ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw) {
+	if (key == KA_BUTTON_IMAGE) {
+		pmr::CLocalArena<256> arena;
+		pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
 		assert(values.size() == 1 || values.size() == 2);
 		uint id = _tstoi(values[0]);
 		if (values.size() == 1) {
@@ -90,7 +91,7 @@ void CCtrlButton::_ParseProperty (const tstring &key, const tstring &value, bool
 			m_imgId = id;
 			redraw = true;
 		}
-	} else if (key == _T("button-image-text-padding")) {
+	} else if (key == KA_BUTTON_IMAGE_TEXT_PADDING) {
 		int v = _tstoi(value);
 		if (v != m_text_image_pading) {
 			m_text_image_pading = v;
@@ -170,7 +171,7 @@ void CCtrlButton::onLButtonUp (CPoint pt, uint /*key*/) {
 
 //////////////////////////////////////////////////////////////////////////
 
-CBitmapPtr CCtrlImageButton::_GetImage() {
+CBitmapPtr CCtrlImageButton::_GetImage(int width, int height) {
 	uint id = m_imageIds[0];
 	if (m_pushAndCapture) {
 		id = m_imageIds[2];
@@ -187,16 +188,17 @@ CBitmapPtr CCtrlImageButton::_GetImage() {
 		if (m_pColorKey != NULL) {
 			return pResMgr->getTransBitmap((ushort)id, m_colorKey, disable);
 		} else {
-			return pResMgr->getBitmap((ushort)id, disable);
+			return pResMgr->getBitmap((ushort)id, width, height, CDIBSection::RT_BICUBIC, disable);
 		}
 	}
 	return CBitmapPtr();
 }
 
 
-void CCtrlImageButton::_ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw) {
-	if (key == _T("imagebutton-image")) { // id id id type
-		ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
+void CCtrlImageButton::_ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw) {
+	if (key == KA_IMAGEBUTTON_IMAGE) { // id id id type
+		pmr::CLocalArena<256> arena;
+		pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
 		assert(values.size() == 3 || values.size() == 4);
 		m_imageIds[0] = _tstoi(values[0]);
 		m_imageIds[1] = _tstoi(values[1]);
@@ -226,9 +228,9 @@ CCtrlImageButton::CCtrlImageButton (uint id, uint n, uint h, uint p, bool bitmap
 
 void CCtrlImageButton::drawMe (HDC hdc) {
 
-	CBitmapPtr image = _GetImage();
+	CRect rc = getClientRect();
+	CBitmapPtr image = rc.Width() > 0 && rc.Height() > 0 ? _GetImage(rc.Width(), rc.Height()) : CBitmapPtr();
 	if (image != NULL) {
-		CRect rc = getClientRect();
 		image->draw(hdc, rc.left, rc.top, rc.Width(), rc.Height(), 0, 0);
 	}
 
@@ -16,17 +16,17 @@
 XL_BEGIN
 UI_BEGIN
 
-void CCtrlGesture::_ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw) {
-	if (key == _T("gesture-sensitivity")) {
+void CCtrlGesture::_ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw) {
+	if (key == KA_GESTURE_SENSITIVITY) {
 		m_gestureSensitivity = _tstoi(value);
 		assert(m_gestureSensitivity != 0);
-	} else if (key == _T("gesture-timeout")) {
+	} else if (key == KA_GESTURE_TIMEOUT) {
 		m_gestureTimeout = _tstoi(value);
 		assert(m_gestureTimeout > 0);
-	} else if (key == _T("gesture-line-width")) {
+	} else if (key == KA_GESTURE_LINE_WIDTH) {
 		m_gestureLineWidth = _tstoi(value);
 		assert(m_gestureLineWidth >= 0);
-	} else if (key == _T("float")) {
+	} else if (key == KA_FLOAT) {
 		CControl::_ParseProperty(key, value, relayout, redraw);
 		assert(isfloat == true);
 	} else {
@@ -58,9 +58,10 @@ int CCtrlSlider::_ValueByPoint (CPoint pt) const {
 	return v;
 }
 
-void CCtrlSlider::_ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw) {
-	if (key == _T("slider")) {
-		ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
+void CCtrlSlider::_ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw) {
+	if (key == KA_SLIDER) {
+		pmr::CLocalArena<256> arena;
+		pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
 		assert(values.size() == 3);
 		m_min = _tstoi(values[0]);
 		m_max = _tstoi(values[1]);
@@ -70,7 +71,7 @@ void CCtrlSlider::_ParseProperty (const tstring &key, const tstring &value, bool
 			setStyle(_T("disable:true"));
 		}
 		redraw = true;
-	} else if (key == _T("thumbnail-min-width")) {
+	} else if (key == KA_THUMBNAIL_MIN_WIDTH) {
 		int minWidth = _tstoi(value);
 		if (minWidth > 0 && minWidth != m_thumbMinWidth) {
 			m_thumbMinWidth = minWidth;
@@ -0,0 +1,162 @@
+#include <assert.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include "../../include/ui/DIBConverter.h"
+#include "../../include/utilities.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+bool _UseSSSE3 () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static const bool use = cpu_has_ssse3();
+	return use;
+}
+
+/**
+ * 16 pixels (48 bytes) in, 64 bytes out
+ */
+template <bool ALIGNED>
+uint _Convert24to32SSSE3 (const uint8 *src, uint8 *dst, uint count, uint8 alpha) {
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i a = _mm_set1_epi32((int)((uint)alpha << 24));
+	uint x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m128i in0 = _mm_loadu_si128((const __m128i *)src);
+		__m128i in1 = _mm_loadu_si128((const __m128i *)(src + 16));
+		__m128i in2 = _mm_loadu_si128((const __m128i *)(src + 32));
+		__m128i out0 = _mm_or_si128(_mm_shuffle_epi8(in0, mask), a);
+		__m128i out1 = _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(in1, in0, 12), mask), a);
+		__m128i out2 = _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(in2, in1, 8), mask), a);
+		__m128i out3 = _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(in2, 4), mask), a);
+		if (ALIGNED) {
+			_mm_store_si128((__m128i *)dst, out0);
+			_mm_store_si128((__m128i *)(dst + 16), out1);
+			_mm_store_si128((__m128i *)(dst + 32), out2);
+			_mm_store_si128((__m128i *)(dst + 48), out3);
+		} else {
+			_mm_storeu_si128((__m128i *)dst, out0);
+			_mm_storeu_si128((__m128i *)(dst + 16), out1);
+			_mm_storeu_si128((__m128i *)(dst + 32), out2);
+			_mm_storeu_si128((__m128i *)(dst + 48), out3);
+		}
+		src += 48;
+		dst += 64;
+	}
+	return x;
+}
+
+/**
+ * 16 pixels (64 bytes) in, 48 bytes out
+ */
+template <bool ALIGNED>
+uint _Convert32to24SSSE3 (const uint8 *src, uint8 *dst, uint count) {
+	const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	uint x = 0;
+	for (; x + 16 <= count; x += 16) {
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), mask);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 16)), mask);
+		__m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 32)), mask);
+		__m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + 48)), mask);
+		__m128i out0 = _mm_or_si128(a, _mm_slli_si128(b, 12));
+		__m128i out1 = _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8));
+		__m128i out2 = _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4));
+		if (ALIGNED) {
+			_mm_store_si128((__m128i *)dst, out0);
+			_mm_store_si128((__m128i *)(dst + 16), out1);
+			_mm_store_si128((__m128i *)(dst + 32), out2);
+		} else {
+			_mm_storeu_si128((__m128i *)dst, out0);
+			_mm_storeu_si128((__m128i *)(dst + 16), out1);
+			_mm_storeu_si128((__m128i *)(dst + 32), out2);
+		}
+		src += 64;
+		dst += 48;
+	}
+	return x;
+}
+
+bool _IsAligned (const void *p) {
+	return ((size_t)p & 15) == 0;
+}
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Convert Engine
+
+void CConvertEngine::convert24to32 (const uint8 *src, uint8 *dst, uint count, uint8 alpha) {
+	assert(src != NULL && dst != NULL);
+	uint x = 0;
+	if (_UseSSSE3()) {
+		x = _IsAligned(dst) ? _Convert24to32SSSE3<true>(src, dst, count, alpha)
+		                    : _Convert24to32SSSE3<false>(src, dst, count, alpha);
+		src += x * 3;
+		dst += x * 4;
+	}
+
+	for (; x < count; ++ x) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = alpha;
+		src += 3;
+		dst += 4;
+	}
+}
+
+void CConvertEngine::convert32to24 (const uint8 *src, uint8 *dst, uint count) {
+	assert(src != NULL && dst != NULL);
+	uint x = 0;
+	if (_UseSSSE3()) {
+		x = _IsAligned(dst) ? _Convert32to24SSSE3<true>(src, dst, count)
+		                    : _Convert32to24SSSE3<false>(src, dst, count);
+		src += x * 4;
+		dst += x * 3;
+	}
+
+	for (; x < count; ++ x) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		src += 4;
+		dst += 3;
+	}
+}
+
+bool CConvertEngine::convert (const CDIBSection *src, CDIBSection *dst, uint8 alpha) {
+	assert(src != NULL && dst != NULL);
+	assert(src != dst);
+	int src_bitcount = src->getBitCounts();
+	int dst_bitcount = dst->getBitCounts();
+	assert(src_bitcount == 24 || src_bitcount == 32);
+	assert(dst_bitcount == 24 || dst_bitcount == 32);
+	assert(src->getWidth() == dst->getWidth() && src->getHeight() == dst->getHeight());
+	if (src->getWidth() != dst->getWidth() || src->getHeight() != dst->getHeight()) {
+		return false;
+	}
+
+	GdiFlush();
+	uint w = src->getWidth();
+	uint h = src->getHeight();
+	for (uint y = 0; y < h; ++ y) {
+		const uint8 *s = src->getLine(y);
+		uint8 *d = dst->getLine(y);
+		if (src_bitcount == dst_bitcount) {
+			memcpy(d, s, w * (src_bitcount / 8));
+		} else if (src_bitcount == 24) {
+			convert24to32(s, d, w, alpha);
+		} else {
+			convert32to24(s, d, w);
+		}
+	}
+	return true;
+}
+
+
+UI_END
+XL_END
@@ -0,0 +1,429 @@
+#include <assert.h>
+#include "../../include/ui/DIBPool.h"
+#include "../../include/utilities.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+const uint64 MIN_CLASS_SIZE = 64 * 1024;
+
+// FLS is loaded dynamically, there is no thread cache without it
+typedef void (__stdcall *_FlsCallbackFunction) (void *);
+typedef DWORD (WINAPI *_FlsAlloc) (_FlsCallbackFunction);
+typedef BOOL (WINAPI *_FlsFree) (DWORD);
+typedef void* (WINAPI *_FlsGetValue) (DWORD);
+typedef BOOL (WINAPI *_FlsSetValue) (DWORD, void *);
+
+struct FLSAPI {
+	_FlsAlloc     alloc;
+	_FlsFree      free;
+	_FlsGetValue  get;
+	_FlsSetValue  set;
+
+	FLSAPI () {
+		HMODULE kernel = ::GetModuleHandle(_T("kernel32.dll"));
+		alloc = (_FlsAlloc)::GetProcAddress(kernel, "FlsAlloc");
+		free = (_FlsFree)::GetProcAddress(kernel, "FlsFree");
+		get = (_FlsGetValue)::GetProcAddress(kernel, "FlsGetValue");
+		set = (_FlsSetValue)::GetProcAddress(kernel, "FlsSetValue");
+		if (!alloc || !free || !get || !set) {
+			alloc = NULL;
+		}
+	}
+};
+
+const FLSAPI& _Fls () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static FLSAPI api;
+	return api;
+}
+
+// the pool has been destroyed, the buffers released later are simply deleted
+bool s_destroyed = false;
+
+}
+
+
+/**
+ * the released buffers of a thread, MRU first. The lock is taken by the
+ * thread, uncontended, and by the pool when it flushes the cache.
+ */
+struct CDIBPool::_ThreadCache {
+	CUserLock     lock;
+	CDIBSection  *dibs[CDIBPool::THREAD_CACHE_SIZE];
+	uint          count;
+	_ThreadCache *prev;
+	_ThreadCache *next;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// protected methods
+
+CDIBPool::CDIBPool ()
+	: m_caches(NULL)
+	, m_threadUnits(0)
+	, m_capacity(DEFAULT_CAPACITY)
+	, m_largePages(false)
+	, m_fls(FLS_OUT_OF_INDEXES)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	if (_Fls().alloc != NULL) {
+		m_fls = _Fls().alloc(_FlsCallback);
+	}
+}
+
+CDIBPool::~CDIBPool () {
+	s_destroyed = true;
+	if (m_fls != FLS_OUT_OF_INDEXES) {
+		_Fls().free(m_fls); // calls _FlsCallback for each thread
+	}
+
+	for (_DIBContainer::iterator it = m_idle.begin(); it != m_idle.end(); ++ it) {
+		delete *it;
+	}
+	m_idle.clear();
+}
+
+uint64 CDIBPool::_Capacity (CDIBSection *dib) {
+	assert(dib != NULL && dib->m_storage != NULL && dib->m_storage->pFileMapping != NULL);
+	return dib->m_storage->pFileMapping->getSize();
+}
+
+uint64 CDIBPool::_SectionSize (uint64 classSize) const {
+	uint64 large = m_largePages ? CFileMapping::getLargePageMinimum() : 0;
+	if (large > 0 && classSize >= large) {
+		return (classSize + large - 1) / large * large;
+	}
+	return classSize;
+}
+
+bool CDIBPool::_Fits (CDIBSection *dib, uint64 classSize) const {
+	uint64 capacity = _Capacity(dib);
+	return capacity == classSize || capacity == _SectionSize(classSize);
+}
+
+bool CDIBPool::_HasShape (CDIBSection *dib, int w, int h, int bitcount, uint stridealign) {
+	return dib->getWidth() == w && dib->getHeight() == h
+		&& dib->getBitCounts() == bitcount && dib->getStrideAlign() == stridealign;
+}
+
+CDIBSection* CDIBPool::_TakeFromThread (int w, int h, int bitcount, uint stridealign, uint64 classSize) {
+	if (m_fls == FLS_OUT_OF_INDEXES) {
+		return NULL;
+	}
+
+	_ThreadCache *cache = (_ThreadCache *)_Fls().get(m_fls);
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	CScopeLock sl(&cache->lock);
+	int found = -1;
+	for (uint i = 0; i < cache->count; ++ i) {
+		if (_Fits(cache->dibs[i], classSize)) {
+			if (_HasShape(cache->dibs[i], w, h, bitcount, stridealign)) {
+				found = (int)i;
+				break;
+			} else if (found == -1) {
+				found = (int)i;
+			}
+		}
+	}
+	if (found == -1) {
+		return NULL;
+	}
+
+	CDIBSection *dib = cache->dibs[found];
+	for (uint i = (uint)found; i + 1 < cache->count; ++ i) {
+		cache->dibs[i] = cache->dibs[i + 1];
+	}
+	cache->count --;
+	::InterlockedExchangeAdd(&m_threadUnits, -(LONG)(_Capacity(dib) / MIN_CLASS_SIZE));
+	return dib;
+}
+
+CDIBSection* CDIBPool::_TakeIdle (int w, int h, int bitcount, uint stridealign, uint64 classSize) {
+	CScopeLock sl(this);
+	_DIBContainer::iterator found = m_idle.end();
+	for (_DIBContainer::iterator it = m_idle.begin(); it != m_idle.end(); ++ it) {
+		if (_Fits(*it, classSize)) {
+			if (_HasShape(*it, w, h, bitcount, stridealign)) {
+				found = it;
+				break;
+			} else if (found == m_idle.end()) {
+				found = it;
+			}
+		}
+	}
+	if (found == m_idle.end()) {
+		return NULL;
+	}
+
+	CDIBSection *dib = *found;
+	m_idle.erase(found);
+	m_stats.idleBytes -= _Capacity(dib);
+	return dib;
+}
+
+CDIBSection* CDIBPool::_Create (int w, int h, int bitcount, uint stridealign, uint64 classSize) {
+	uint64 size = _SectionSize(classSize);
+	CDIBSection *dib = new CDIBSection();
+	dib->m_storage.reset(new CDIBSection::STORAGE());
+	dib->m_storage->shareable = false; // the section goes back to the pool, so clones must copy
+	dib->m_storage->pFileMapping = new CFileMapping();
+	if (dib->m_storage->pFileMapping->createAnonymous(size, size != classSize)
+			&& dib->_CreateBitmap(w, h, bitcount, stridealign)) {
+		return dib;
+	}
+
+	// GDI may refuse a large page section
+	if (size != classSize) {
+		dib->_Clear();
+		dib->m_storage.reset(new CDIBSection::STORAGE());
+		dib->m_storage->shareable = false;
+		dib->m_storage->pFileMapping = new CFileMapping();
+		if (dib->m_storage->pFileMapping->createAnonymous(classSize)
+				&& dib->_CreateBitmap(w, h, bitcount, stridealign)) {
+			return dib;
+		}
+	}
+
+	delete dib;
+	return NULL;
+}
+
+void CDIBPool::_PutIdle (CDIBSection *dib) {
+	CScopeLock sl(this);
+	m_idle.push_front(dib);
+	m_stats.idleBytes += _Capacity(dib);
+	_Trim(m_capacity);
+}
+
+uint64 CDIBPool::_ThreadBytes () const {
+	return (uint64)m_threadUnits * MIN_CLASS_SIZE;
+}
+
+void CDIBPool::_FlushThreads () {
+	// locked by the caller, the LRU ones of all the threads go behind the shared list
+	for (_ThreadCache *cache = m_caches; cache != NULL; cache = cache->next) {
+		CScopeLock sl(&cache->lock);
+		for (uint i = 0; i < cache->count; ++ i) {
+			uint64 capacity = _Capacity(cache->dibs[i]);
+			m_idle.push_back(cache->dibs[i]);
+			m_stats.idleBytes += capacity;
+			::InterlockedExchangeAdd(&m_threadUnits, -(LONG)(capacity / MIN_CLASS_SIZE));
+		}
+		cache->count = 0;
+	}
+}
+
+void CDIBPool::_Trim (uint64 bytes) {
+	// locked by the caller, the thread caches are flushed if they are over bytes by themselves,
+	// or once the shared list is used up and the total is still over
+	if (_ThreadBytes() > bytes) {
+		_FlushThreads();
+	}
+	while (m_stats.idleBytes + _ThreadBytes() > bytes) {
+		if (m_idle.empty()) {
+			_FlushThreads();
+			if (m_idle.empty()) {
+				break; // the threads took theirs meanwhile
+			}
+		}
+		CDIBSection *dib = m_idle.back();
+		m_idle.pop_back();
+		m_stats.idleBytes -= _Capacity(dib);
+		m_stats.trimmed ++;
+		delete dib;
+	}
+}
+
+void CDIBPool::_Release (CDIBSection *dib) {
+	assert(dib != NULL);
+	uint64 capacity = _Capacity(dib);
+	if (m_fls != FLS_OUT_OF_INDEXES && capacity <= THREAD_CACHE_MAX_BYTES && capacity <= m_capacity) {
+		_ThreadCache *cache = (_ThreadCache *)_Fls().get(m_fls);
+		if (cache == NULL) {
+			cache = new _ThreadCache;
+			cache->count = 0;
+			cache->prev = NULL;
+			CScopeLock sl(this);
+			cache->next = m_caches;
+			if (m_caches != NULL) {
+				m_caches->prev = cache;
+			}
+			m_caches = cache;
+			_Fls().set(m_fls, cache);
+		}
+
+		// the LRU one goes to the shared list
+		CDIBSection *evicted = NULL;
+		{
+			CScopeLock sl(&cache->lock);
+			if (cache->count == THREAD_CACHE_SIZE) {
+				evicted = cache->dibs[-- cache->count];
+				::InterlockedExchangeAdd(&m_threadUnits, -(LONG)(_Capacity(evicted) / MIN_CLASS_SIZE));
+			}
+			for (uint i = cache->count; i > 0; -- i) {
+				cache->dibs[i] = cache->dibs[i - 1];
+			}
+			cache->dibs[0] = dib;
+			cache->count ++;
+			::InterlockedExchangeAdd(&m_threadUnits, (LONG)(capacity / MIN_CLASS_SIZE));
+		}
+
+		dib = evicted;
+		if (dib == NULL) {
+			// over the capacity with the thread caches? checked again under the lock
+			if (m_stats.idleBytes + _ThreadBytes() > m_capacity) {
+				CScopeLock sl(this);
+				_Trim(m_capacity);
+			}
+			return;
+		}
+	}
+
+	_PutIdle(dib);
+}
+
+void CDIBPool::_Recycle (CDIBSection *dib) {
+	assert(dib != NULL);
+	assert(dib->m_hOldBitmap == INVALID_HANDLE_VALUE); // still selected into a DC
+	if (s_destroyed) {
+		delete dib;
+	} else {
+		getInstance()->_Release(dib);
+	}
+}
+
+void __stdcall CDIBPool::_FlsCallback (void *data) {
+	_ThreadCache *cache = (_ThreadCache *)data;
+	if (cache == NULL) {
+		return;
+	}
+
+	// the thread is gone, or the pool is being destroyed
+	CDIBPool *pool = getInstance();
+	CScopeLock sl(pool);
+	if (cache->prev != NULL) {
+		cache->prev->next = cache->next;
+	} else {
+		pool->m_caches = cache->next;
+	}
+	if (cache->next != NULL) {
+		cache->next->prev = cache->prev;
+	}
+
+	for (uint i = 0; i < cache->count; ++ i) {
+		::InterlockedExchangeAdd(&pool->m_threadUnits, -(LONG)(_Capacity(cache->dibs[i]) / MIN_CLASS_SIZE));
+		if (s_destroyed) {
+			delete cache->dibs[i];
+		} else {
+			pool->m_idle.push_front(cache->dibs[i]);
+			pool->m_stats.idleBytes += _Capacity(cache->dibs[i]);
+		}
+	}
+	if (!s_destroyed) {
+		pool->_Trim(pool->m_capacity);
+	}
+	delete cache;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// public methods
+
+CDIBPool* CDIBPool::getInstance () {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
+	static CDIBPool pool;
+	return &pool;
+}
+
+CDIBSectionPtr CDIBPool::lease (int w, int h, int bitcount, uint stridealign) {
+	assert(w > 0 && h > 0);
+	assert(bitcount == 24 || bitcount == 32);
+	uint64 classSize = getClassSize(CDIBSection::getBytes(w, h, bitcount, stridealign));
+	::InterlockedIncrement((long *)&m_stats.leases);
+
+	CDIBSection *dib = _TakeFromThread(w, h, bitcount, stridealign, classSize);
+	if (dib != NULL) {
+		::InterlockedIncrement((long *)&m_stats.threadHits);
+	} else {
+		dib = _TakeIdle(w, h, bitcount, stridealign, classSize);
+	}
+
+	if (dib != NULL) {
+		::InterlockedIncrement((long *)&m_stats.reused);
+		if (!_HasShape(dib, w, h, bitcount, stridealign)) {
+			::InterlockedIncrement((long *)&m_stats.reshaped);
+			GdiFlush();
+			dib->_ClearBitmap();
+			if (!dib->_CreateBitmap(w, h, bitcount, stridealign)) {
+				delete dib;
+				dib = NULL;
+			}
+		}
+	}
+
+	if (dib == NULL) {
+		dib = _Create(w, h, bitcount, stridealign, classSize);
+		if (dib == NULL) {
+			return CDIBSectionPtr();
+		}
+		::InterlockedIncrement((long *)&m_stats.created);
+	}
+
+	return CDIBSectionPtr(dib, _Recycle);
+}
+
+void CDIBPool::setCapacity (uint64 bytes) {
+	CScopeLock sl(this);
+	m_capacity = bytes;
+	_Trim(m_capacity);
+}
+
+uint64 CDIBPool::getCapacity () const {
+	CScopeLock sl(this);
+	return m_capacity;
+}
+
+void CDIBPool::setLargePages (bool enable) {
+	CScopeLock sl(this);
+	m_largePages = enable;
+}
+
+void CDIBPool::trim (uint64 bytes) {
+	CScopeLock sl(this);
+	_FlushThreads();
+	_Trim(bytes);
+}
+
+CDIBPool::STATS CDIBPool::getStats () const {
+	CScopeLock sl(this);
+	STATS stats = m_stats;
+	stats.threadBytes = _ThreadBytes();
+	stats.idleBytes += stats.threadBytes;
+	return stats;
+}
+
+uint64 CDIBPool::getClassSize (uint64 bytes) {
+	if (bytes <= MIN_CLASS_SIZE) {
+		return MIN_CLASS_SIZE;
+	}
+
+	// 4 classes per power of 2
+	uint64 step = MIN_CLASS_SIZE;
+	while ((step << 3) <= bytes) {
+		step <<= 1;
+	}
+	return (bytes + step - 1) / step * step;
+}
+
+
+UI_END
+XL_END
@@ -3,9 +3,16 @@
  * (Filters.h, Resize.h, Resize.cpp and Rescale.cpp)
  */
 #include <math.h>
+#include <memory>
+#include <vector>
+#include <algorithm>
 #include <emmintrin.h>
 #include "../../include/utilities.h"
+#include "../../include/ThreadPool.h"
 #include "../../include/ui/DIBResizer.h"
+#include "../../include/ui/DIBRotator.h"
+#include "../../include/ui/DIBConverter.h"
+#include "../../include/ui/DIBPool.h"
 
 #define USE_SSE
 // #define USE_SSE2
@@ -21,6 +28,25 @@ template <class T> T MIN(T a, T b) {
 	return (a < b) ? a: b;
 }
 
+/**
+ * the intermediate follows the file mapping of dst, or is leased from the pool
+ */
+static CDIBSectionPtr _CreateTemp(int w, int h, int bitcount, CDIBSection *dst) {
+	if (dst->isFileMapped()) {
+		return CDIBSection::createDIBSection(w, h, bitcount, true, dst->getStrideAlign());
+	}
+	return CDIBPool::getInstance()->lease(w, h, bitcount, dst->getStrideAlign());
+}
+
+/**
+ * if the lines of src and dst are each one block of their own, in the same
+ * layout, so height * stride bytes are copied at once; not so for a view,
+ * the bytes after its lines are the pixels of the DIB it is on
+ */
+static bool _IsBlockCopy(const CDIBSection *src, const CDIBSection *dst) {
+	return src->getPitch() == dst->getPitch() && dst->getPitch() > 0 && !src->isView() && !dst->isView();
+}
+
 
 //////////////////////////////////////////////////////////////////////////
 // Weight Table
@@ -100,7 +126,7 @@ CWeightsTable::~CWeightsTable() {
 //////////////////////////////////////////////////////////////////////////
 // Resize Engine
 
-bool CResizeEngine::scale (CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback) {
+bool CResizeEngine::scale (const CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback) {
 	assert(src != NULL && dst != NULL);
 	uint src_width  = (uint)src->getWidth();
 	uint src_height = (uint)src->getHeight();
@@ -116,7 +142,7 @@ bool CResizeEngine::scale (CDIBSection *src, CDIBSection *dst, ILongTimeRunCallb
 	}
 
 	if(dst_width * src_height <= dst_height * src_width) {
-		CDIBSectionPtr tmp = CDIBSection::createDIBSection(dst_width, src_height, bitcount, false);
+		CDIBSectionPtr tmp = _CreateTemp(dst_width, src_height, bitcount, dst);
 		if (!tmp) {
 			return false;
 		}
@@ -131,7 +157,7 @@ bool CResizeEngine::scale (CDIBSection *src, CDIBSection *dst, ILongTimeRunCallb
 		}
 
 	} else {
-		CDIBSectionPtr tmp = CDIBSection::createDIBSection(src_width, dst_height, bitcount, false);
+		CDIBSectionPtr tmp = _CreateTemp(src_width, dst_height, bitcount, dst);
 		if (!tmp) {
 			return false;
 		}
@@ -148,7 +174,155 @@ bool CResizeEngine::scale (CDIBSection *src, CDIBSection *dst, ILongTimeRunCallb
 	return true;
 }
 
-bool CResizeEngine::horizontalFilter(CDIBSection *src, uint src_height,
+bool CResizeEngine::scale (const CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback,
+                           CDIBSection::ORIENTATION ot) {
+	assert(src != NULL && dst != NULL);
+	if (ot == CDIBSection::OT_NORMAL) {
+		return scale(src, dst, pCallback);
+	}
+
+	bool transposed = CRotateEngine::isTransposed(ot);
+	bool rx = CRotateEngine::isReversedX(ot);
+	bool ry = CRotateEngine::isReversedY(ot);
+	uint src_width  = (uint)src->getWidth();
+	uint src_height = (uint)src->getHeight();
+	uint dst_width = (uint)dst->getWidth();
+	uint dst_height = (uint)dst->getHeight();
+	int bitcount = src->getBitCounts();
+	assert(bitcount == 24 || bitcount == 32);
+
+	if (!transposed) {
+		if (!scale(src, dst, pCallback)) {
+			return false;
+		}
+		CRotateEngine::flip(dst, rx, ry);
+		return true;
+	}
+
+	assert(dst_width > 0 && dst_height > 0);
+	if (dst_width == src_height && dst_height == src_width) {
+		return CRotateEngine::rotate(src, dst, ot);
+	}
+
+	if (m_pFilter == NULL) {
+		CDIBSectionPtr tmp = _CreateTemp(dst_height, dst_width, bitcount, dst);
+		if (!tmp) {
+			return false;
+		}
+		_FastScale(src, tmp.get());
+		return CRotateEngine::rotate(tmp.get(), dst, ot);
+	}
+
+	// rows of src -> columns of tmp, then a plain horizontal pass
+	CDIBSectionPtr tmp = _CreateTemp(src_height, dst_height, bitcount, dst);
+	if (!tmp) {
+		return false;
+	}
+	if (!transposedFilter(src, tmp.get(), rx, ry, pCallback)) {
+		assert(pCallback && pCallback->shouldStop());
+		return false;
+	}
+	if (!horizontalFilter(tmp.get(), dst_height, dst, 0, dst_height, pCallback)) {
+		assert(pCallback && pCallback->shouldStop());
+		return false;
+	}
+
+	return true;
+}
+
+bool CResizeEngine::transposedFilter (const CDIBSection *src, CDIBSection *dst, bool reverseX, bool reverseY,
+                                      ILongTimeRunCallback *pCallback) {
+	assert(src->getBitCounts() == dst->getBitCounts());
+	uint src_width = src->getWidth();
+	uint src_height = src->getHeight();
+	uint dst_height = dst->getHeight();
+	assert(dst->getWidth() == (int)src_height);
+	uint bytespp = src->getBitCounts() / 8;
+	assert(bytespp == 3 || bytespp == 4);
+	int dst_pitch = reverseX ? -dst->getPitch() : dst->getPitch();
+	bool copy = src_width == dst_height || m_pFilter == NULL;
+	double ratio = (double)src_width / (double)dst_height;
+
+	std::auto_ptr<CWeightsTable> weightsTable;
+	if (!copy) {
+		weightsTable.reset(new CWeightsTable(m_pFilter, dst_height, src_width));
+	}
+#ifdef USE_SSE
+	__m128 v05 = _mm_set_ps1(0.5);
+#endif
+
+	for (uint srcy = 0; srcy < src_height; ++ srcy) {
+		// test for stop
+		if (srcy % 32 == 0) {
+			if (pCallback && pCallback->shouldStop()) {
+				return false;
+			}
+		}
+
+		const uint8 *src_bits = src->getLine(srcy);
+		uint column = reverseY ? src_height - 1 - srcy : srcy;
+		uint8 *dst_bits = dst->getLine(reverseX ? dst_height - 1 : 0) + column * bytespp;
+
+		for (uint x = 0; x < dst_height; ++ x) {
+			if (copy) {
+				uint sx = (uint)(x * ratio + 0.5);
+				if (sx >= src_width) {
+					sx = src_width - 1;
+				}
+				for (uint j = 0; j < bytespp; ++ j) {
+					dst_bits[j] = src_bits[sx * bytespp + j];
+				}
+				dst_bits += dst_pitch;
+				continue;
+			}
+
+			int iLeft = weightsTable->getLeftBoundary(x);
+			int iRight = weightsTable->getRightBoundary(x);
+			uint index = iLeft * bytespp;
+#ifdef USE_SSE
+			__m128 v = _mm_set_ps1(0.0);
+			for (int i = iLeft; i <= iRight; ++ i) {
+				__m128 a = _mm_set_ps1((float)weightsTable->getWeight(x, i - iLeft));
+				__m128i t;
+				if (bytespp == 3) {
+					t = _mm_set_epi32(0, src_bits[index + 2], src_bits[index + 1], src_bits[index]);
+				} else {
+					t = _mm_set_epi32(src_bits[index + 3], src_bits[index + 2], src_bits[index + 1], src_bits[index]);
+				}
+				v = _mm_add_ps(v, _mm_mul_ps(a, _mm_cvtepi32_ps(t)));
+				index += bytespp;
+			}
+
+			// clamp to [0, 255] by the saturated packs
+			__m128i value = _mm_cvtps_epi32(_mm_add_ps(v, v05));
+			value = _mm_packs_epi32(value, value);
+			value = _mm_packus_epi16(value, value);
+			uint pixel = (uint)_mm_cvtsi128_si32(value);
+			dst_bits[0] = (uint8)pixel;
+			dst_bits[1] = (uint8)(pixel >> 8);
+			dst_bits[2] = (uint8)(pixel >> 16);
+			if (bytespp == 4) {
+				dst_bits[3] = (uint8)(pixel >> 24);
+			}
+#else
+			double value[4] = {0, 0, 0, 0}; // 4 = 32bpp max
+			for (int i = iLeft; i <= iRight; ++ i) {
+				double weight = weightsTable->getWeight(x, i - iLeft);
+				for (uint j = 0; j < bytespp; ++ j) {
+					value[j] += (weight * (double)src_bits[index ++]);
+				}
+			}
+			for (uint j = 0; j < bytespp; ++ j) {
+				dst_bits[j] = (unsigned char)MIN(MAX((int)0, (int)(value[j] + 0.5)), (int)255);
+			}
+#endif
+			dst_bits += dst_pitch;
+		}
+	}
+	return true;
+}
+
+bool CResizeEngine::horizontalFilter(const CDIBSection *src, uint src_height,
                                      CDIBSection *dst, uint dst_yoffset, uint dst_height,
                                      ILongTimeRunCallback *pCallback) {
 	assert(src->getBitCounts() == dst->getBitCounts());
@@ -162,12 +336,18 @@ bool CResizeEngine::horizontalFilter(CDIBSection *src, uint src_height,
 
 	if (dst_width == src_width) {
 
-		uint8 *src_bits = src->getData();
-		uint8 *dst_bits = dst->getLine(dst_yoffset);
-		assert(src_bits && dst_bits);
-
 		uint height = min(dst_height, src_height);
-		memcpy(dst_bits, src_bits, height * dst->getStride());
+		if (_IsBlockCopy(src, dst)) {
+			const uint8 *src_bits = src->getData();
+			uint8 *dst_bits = dst->getLine(dst_yoffset);
+			assert(src_bits && dst_bits);
+			memcpy(dst_bits, src_bits, height * dst->getStride());
+		} else { // the stride alignments or the line orders differ, or a view
+			uint len = dst_width * (bitcount / 8);
+			for (uint y = 0; y < height; ++ y) {
+				memcpy(dst->getLine(dst_yoffset + y), src->getLine(y), len);
+			}
+		}
 
 	} else if (!m_pFilter) { // fast (COLORONCOLOR)
 		double ratio_w = (double)src_width / (double)dst_width;
@@ -175,7 +355,7 @@ bool CResizeEngine::horizontalFilter(CDIBSection *src, uint src_height,
 
 		for (uint y = dst_yoffset, sy = 0; y < dst_ymax; ++ y, ++ sy) {
 			uint8 *dst_data = (uint8 *)dst->getLine(y);
-			uint8 *src_line = (uint8 *)src->getLine(sy);
+			const uint8 *src_line = (const uint8 *)src->getLine(sy);
 
 			for (uint x = 0; x < dst_width; ++ x) {
 				uint sx = (uint)(x * ratio_w + 0.5);
@@ -183,7 +363,7 @@ bool CResizeEngine::horizontalFilter(CDIBSection *src, uint src_height,
 					sx = src_width - 1;
 				}
 
-				uint8 *src_data = src_line + sx * bytespp;
+				const uint8 *src_data = src_line + sx * bytespp;
 				for (uint i = 0; i < bytespp; ++ i) {
 					*dst_data ++ = *src_data ++;
 				}
@@ -209,9 +389,16 @@ bool CResizeEngine::horizontalFilter(CDIBSection *src, uint src_height,
 				if (pCallback && pCallback->shouldStop()) {
 					return false;
 				}
+
+				// page file mapped DIBs through the cache, no-op for the others
+				src->advise(srcy, 32, CFileMapping::ADV_WILLNEED);
+				if (srcy >= 32) {
+					src->advise(srcy - 32, 32, CFileMapping::ADV_DONTNEED);
+					dst->advise(dsty - 32, 32, CFileMapping::ADV_DONTNEED);
+				}
 			}
 
-			uint8 *src_bits = src->getLine(srcy);
+			const uint8 *src_bits = src->getLine(srcy);
 			uint8 *dst_bits = dst->getLine(dsty);
 
 			for(uint x = 0; x < dst_width; ++ x) {
@@ -305,7 +492,7 @@ bool CResizeEngine::horizontalFilter(CDIBSection *src, uint src_height,
 	return true;
 }
 
-bool CResizeEngine::verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback) {
+bool CResizeEngine::verticalFilter(const CDIBSection *src, CDIBSection *dst, ILongTimeRunCallback *pCallback) {
 	assert(src->getBitCounts() == dst->getBitCounts());
 	int bitcount = src->getBitCounts();
 	uint src_width = src->getWidth();
@@ -316,11 +503,17 @@ bool CResizeEngine::verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTime
 	src_width = src_width;
 	if (src_height == dst_height) {
 
-		unsigned char *src_bits = (unsigned char *)src->getData();
-		unsigned char *dst_bits = (unsigned char *)dst->getData();
-		assert(src_bits && dst_bits);
-
-		memcpy(dst_bits, src_bits, dst_height * dst->getStride());
+		if (_IsBlockCopy(src, dst)) {
+			const unsigned char *src_bits = (const unsigned char *)src->getData();
+			unsigned char *dst_bits = (unsigned char *)dst->getData();
+			assert(src_bits && dst_bits);
+			memcpy(dst_bits, src_bits, dst_height * dst->getStride());
+		} else { // the stride alignments or the line orders differ, or a view
+			uint len = dst_width * (bitcount / 8);
+			for (uint y = 0; y < dst_height; ++ y) {
+				memcpy(dst->getLine(y), src->getLine(y), len);
+			}
+		}
 
 	} else if (!m_pFilter) { // fast (COLOR ON COLOR)
 
@@ -333,10 +526,10 @@ bool CResizeEngine::verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTime
 				sy = src_height - 1;
 			}
 			uint8 *dst_data = (uint8 *)dst->getLine(y);
-			uint8 *src_line = (uint8 *)src->getLine(sy);
+			const uint8 *src_line = (const uint8 *)src->getLine(sy);
 
 			for (uint x = 0; x < dst_width; ++ x) {
-				uint8 *src_data = src_line + x * bytespp;
+				const uint8 *src_data = src_line + x * bytespp;
 				for (uint i = 0; i < bytespp; ++ i) {
 					*dst_data ++ = *src_data ++;
 				}
@@ -357,8 +550,8 @@ bool CResizeEngine::verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTime
 		uint bytespp = src->getBitCounts() / 8;
 		assert(bytespp == 3 || bytespp == 4);
 
-		unsigned src_pitch = src->getStride();
-		unsigned dst_pitch = dst->getStride();
+		int src_pitch = src->getPitch();
+		int dst_pitch = dst->getPitch();
 
 		for(uint x = 0; x < dst_width; ++ x) {
 			// test for stop
@@ -386,7 +579,7 @@ bool CResizeEngine::verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTime
 				int iLeft = weightsTable.getLeftBoundary(y);
 				int iRight = weightsTable.getRightBoundary(y);
 
-				uint8 *src_bits = src->getLine(iLeft);
+				const uint8 *src_bits = src->getLine(iLeft);
 				src_bits += index;
 
 				for(int i = iLeft; i <= iRight; ++ i) {
@@ -472,7 +665,194 @@ bool CResizeEngine::verticalFilter(CDIBSection *src, CDIBSection *dst, ILongTime
 	return true;
 }
 
-void CResizeEngine::_FastScale (CDIBSection *src, CDIBSection *dst) {
+void CResizeEngine::horizontalRegion (const CDIBSection *src, int src_x, CDIBSection *dst, int dst_x,
+                                      const CWeightsTable &table) {
+	assert(src->getBitCounts() == dst->getBitCounts());
+	assert(src->getHeight() == dst->getHeight());
+	uint bytespp = src->getBitCounts() / 8;
+	assert(bytespp == 3 || bytespp == 4);
+	int dst_width = dst->getWidth();
+	int height = dst->getHeight();
+	__m128 v05 = _mm_set_ps1(0.5);
+
+	for (int y = 0; y < height; ++ y) {
+		const uint8 *src_bits = src->getLine(y);
+		uint8 *dst_bits = dst->getLine(y);
+		for (int x = 0; x < dst_width; ++ x) {
+			int pos = dst_x + x;
+			int iLeft = table.getLeftBoundary(pos);
+			int iRight = table.getRightBoundary(pos);
+			assert(iLeft >= src_x && iRight < src_x + src->getWidth());
+			const uint8 *s = src_bits + (iLeft - src_x) * bytespp;
+
+			__m128 v = _mm_set_ps1(0.0);
+			for (int i = iLeft; i <= iRight; ++ i) {
+				__m128 a = _mm_set_ps1((float)table.getWeight(pos, i - iLeft));
+				__m128i t;
+				if (bytespp == 3) {
+					t = _mm_set_epi32(0, s[2], s[1], s[0]);
+				} else {
+					t = _mm_set_epi32(s[3], s[2], s[1], s[0]);
+				}
+				v = _mm_add_ps(v, _mm_mul_ps(a, _mm_cvtepi32_ps(t)));
+				s += bytespp;
+			}
+
+			// clamp to [0, 255] by the saturated packs
+			__m128i value = _mm_cvtps_epi32(_mm_add_ps(v, v05));
+			value = _mm_packs_epi32(value, value);
+			value = _mm_packus_epi16(value, value);
+			uint pixel = (uint)_mm_cvtsi128_si32(value);
+			dst_bits[0] = (uint8)pixel;
+			dst_bits[1] = (uint8)(pixel >> 8);
+			dst_bits[2] = (uint8)(pixel >> 16);
+			if (bytespp == 4) {
+				dst_bits[3] = (uint8)(pixel >> 24);
+			}
+			dst_bits += bytespp;
+		}
+	}
+}
+
+void CResizeEngine::verticalRegion (const CDIBSection *src, int src_y, CDIBSection *dst, int dst_y,
+                                    const CWeightsTable &table) {
+	assert(src->getBitCounts() == dst->getBitCounts());
+	assert(src->getWidth() == dst->getWidth());
+	uint bytespp = src->getBitCounts() / 8;
+	assert(bytespp == 3 || bytespp == 4);
+	uint len = dst->getWidth() * bytespp;
+	int height = dst->getHeight();
+
+	// a line is accumulated from the src lines one by one, so both are read in order
+	std::vector<float> sum(len);
+	for (int y = 0; y < height; ++ y) {
+		int pos = dst_y + y;
+		int iLeft = table.getLeftBoundary(pos);
+		int iRight = table.getRightBoundary(pos);
+		assert(iLeft >= src_y && iRight < src_y + src->getHeight());
+
+		std::fill(sum.begin(), sum.end(), 0.5f);
+		for (int i = iLeft; i <= iRight; ++ i) {
+			float weight = (float)table.getWeight(pos, i - iLeft);
+			const uint8 *s = src->getLine(i - src_y);
+			for (uint j = 0; j < len; ++ j) {
+				sum[j] += weight * (float)s[j];
+			}
+		}
+
+		// rounded as the other passes, clamped to [0, 255] by the saturated packs
+		uint8 *dst_bits = dst->getLine(y);
+		uint j = 0;
+		for (; j + 4 <= len; j += 4) {
+			__m128i value = _mm_cvtps_epi32(_mm_loadu_ps(&sum[j]));
+			value = _mm_packs_epi32(value, value);
+			value = _mm_packus_epi16(value, value);
+			*(int *)(dst_bits + j) = _mm_cvtsi128_si32(value);
+		}
+		for (; j < len; ++ j) {
+			int value = _mm_cvtss_si32(_mm_set_ss(sum[j]));
+			dst_bits[j] = (uint8)MIN(MAX(0, value), 255);
+		}
+	}
+}
+
+CGenericFilter* CResizeEngine::createFilter (CDIBSection::RESIZE_TYPE rt) {
+	switch (rt) {
+		case CDIBSection::RT_FAST:
+			return NULL;
+		case CDIBSection::RT_BOX:
+			return new CBoxFilter();
+		case CDIBSection::RT_BICUBIC:
+			return new CBicubicFilter();
+		case CDIBSection::RT_BILINEAR:
+			return new CBilinearFilter();
+		case CDIBSection::RT_BSPLINE:
+			return new CBSplineFilter();
+		case CDIBSection::RT_CATMULLROM:
+			return new CCatmullRomFilter();
+		case CDIBSection::RT_LANCZOS3:
+			return new CLanczos3Filter();
+		default:
+			assert(false);
+			return NULL;
+	}
+}
+
+namespace {
+
+/**
+ * a band is a placement, the filter is shared, it is only read
+ */
+class CScaleIntoTask : public IBandExecutable
+{
+	const CDIBSection::PLACEMENT  *m_placements;
+	CDIBSection                   *m_dst;
+	CGenericFilter                *m_pFilter;
+	ILongTimeRunCallback          *m_pCallback;
+
+public:
+	CScaleIntoTask (const CDIBSection::PLACEMENT *placements, CDIBSection *dst,
+	                CGenericFilter *pFilter, ILongTimeRunCallback *pCallback)
+		: m_placements(placements), m_dst(dst), m_pFilter(pFilter), m_pCallback(pCallback)
+	{
+	}
+
+	virtual bool operator() (uint band) {
+		if (m_pCallback && m_pCallback->shouldStop()) {
+			return false;
+		}
+		const CDIBSection *src = m_placements[band].src;
+		const RECT &rc = m_placements[band].rect;
+		int w = rc.right - rc.left, h = rc.bottom - rc.top;
+		CDIBSectionPtr view = m_dst->createView(rc.left, rc.top, w, h);
+		int bitcount = src->getBitCounts();
+
+		// the progress is of the whole work, not of a source, so no callback below
+		CResizeEngine engine(m_pFilter);
+		if (bitcount == view->getBitCounts()) {
+			if (src->getWidth() == w && src->getHeight() == h) {
+				return CConvertEngine::convert(src, view.get());
+			}
+			return engine.scale(src, view.get());
+		}
+
+		CDIBSectionPtr tmp = CDIBPool::getInstance()->lease(w, h, bitcount);
+		return tmp && engine.scale(src, tmp.get()) && CConvertEngine::convert(tmp.get(), view.get());
+	}
+};
+
+}
+
+bool CResizeEngine::scaleInto (const CDIBSection::PLACEMENT *placements, uint count, CDIBSection *dst,
+                               CDIBSection::RESIZE_TYPE rt, ILongTimeRunCallback *pCallback) {
+	assert(dst != NULL && !dst->isNull());
+	for (uint i = 0; i < count; ++ i) {
+		const RECT &rc = placements[i].rect;
+		assert(placements[i].src != NULL && !placements[i].src->isNull());
+		assert(rc.left >= 0 && rc.top >= 0 && rc.right <= dst->getWidth() && rc.bottom <= dst->getHeight());
+		if (placements[i].src == NULL || placements[i].src->isNull()) {
+			return false;
+		}
+		if (rc.left < 0 || rc.top < 0 || rc.right > dst->getWidth() || rc.bottom > dst->getHeight()
+		    || rc.left >= rc.right || rc.top >= rc.bottom) {
+			return false;
+		}
+	}
+	if (count == 0) {
+		return true;
+	}
+
+	// the sources write through views, so dst must not be shared by a clone
+	if (dst->getData() == NULL) {
+		return false;
+	}
+	GdiFlush();
+	std::auto_ptr<CGenericFilter> pFilter(createFilter(rt));
+	CScaleIntoTask task(placements, dst, pFilter.get(), pCallback);
+	return parallel_for(count, &task);
+}
+
+void CResizeEngine::_FastScale (const CDIBSection *src, CDIBSection *dst) {
 	assert(src != NULL && dst != NULL);
 	assert(src->getBitCounts() == dst->getBitCounts());
 	uint bitcount = src->getBitCounts();
@@ -491,7 +871,7 @@ void CResizeEngine::_FastScale (CDIBSection *src, CDIBSection *dst) {
 			sy = src_height - 1;
 		}
 		uint8 *dst_data = (uint8 *)dst->getLine(y);
-		uint8 *src_line = (uint8 *)src->getLine(sy);
+		const uint8 *src_line = (const uint8 *)src->getLine(sy);
 
 		for (uint x = 0; x < dst_width; ++ x) {
 			uint sx = (uint)(x * ratio_w + 0.5);
@@ -499,7 +879,7 @@ void CResizeEngine::_FastScale (CDIBSection *src, CDIBSection *dst) {
 				sx = src_width - 1;
 			}
 
-			uint8 *src_data = src_line + sx * bytespp;
+			const uint8 *src_data = src_line + sx * bytespp;
 			for (uint i = 0; i < bytespp; ++ i) {
 				*dst_data ++ = *src_data ++;
 			}
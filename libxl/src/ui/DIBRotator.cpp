@@ -0,0 +1,248 @@
+#include <assert.h>
+#include <vector>
+#include <emmintrin.h>
+#include "../../include/ui/DIBRotator.h"
+
+#define USE_SSE
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+template <class T> T MIN(T a, T b) {
+	return (a < b) ? a: b;
+}
+
+/**
+ * the source pixel of destination (x, y) is base + x * dx + y * dy,
+ * dx and dy are in bytes and can be negative
+ */
+struct TRANSFORM {
+	const uint8 *base;
+	int dx;
+	int dy;
+};
+
+void _Transform24 (const TRANSFORM &t, CDIBSection *dst, uint tile) {
+	uint w = dst->getWidth();
+	uint h = dst->getHeight();
+
+	for (uint ty = 0; ty < h; ty += tile) {
+		uint ymax = MIN(ty + tile, h);
+		for (uint tx = 0; tx < w; tx += tile) {
+			uint xmax = MIN(tx + tile, w);
+			for (uint y = ty; y < ymax; ++ y) {
+				uint8 *d = dst->getLine(y) + tx * 3;
+				const uint8 *s = t.base + (int)tx * t.dx + (int)y * t.dy;
+				for (uint x = tx; x < xmax; ++ x) {
+					d[0] = s[0];
+					d[1] = s[1];
+					d[2] = s[2];
+					d += 3;
+					s += t.dx;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * 32 bpp, dst rows are src rows (may be reversed), tiling gains nothing here
+ */
+void _Transform32Rows (const TRANSFORM &t, CDIBSection *dst) {
+	uint w = dst->getWidth();
+	uint h = dst->getHeight();
+	assert(t.dx == 4 || t.dx == -4);
+
+	for (uint y = 0; y < h; ++ y) {
+		uint8 *d = dst->getLine(y);
+		const uint8 *s = t.base + (int)y * t.dy;
+		if (t.dx > 0) {
+			memcpy(d, s, w * 4);
+			continue;
+		}
+
+		uint x = 0;
+#ifdef USE_SSE
+		for (; x + 4 <= w; x += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(s - (int)(x + 3) * 4));
+			v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+			_mm_storeu_si128((__m128i *)(d + x * 4), v);
+		}
+#endif
+		for (; x < w; ++ x) {
+			*(uint *)(d + x * 4) = *(const uint *)(s - (int)x * 4);
+		}
+	}
+}
+
+/**
+ * 32 bpp, dst rows are src columns, walk tile by tile and transpose 4x4 blocks in registers
+ */
+void _Transform32Transposed (const TRANSFORM &t, CDIBSection *dst, uint tile) {
+	uint w = dst->getWidth();
+	uint h = dst->getHeight();
+	assert(t.dy == 4 || t.dy == -4);
+
+	for (uint ty = 0; ty < h; ty += tile) {
+		uint ymax = MIN(ty + tile, h);
+		for (uint tx = 0; tx < w; tx += tile) {
+			uint xmax = MIN(tx + tile, w);
+			uint y = ty;
+#ifdef USE_SSE
+			for (; y + 4 <= ymax; y += 4) {
+				uint x = tx;
+				for (; x + 4 <= xmax; x += 4) {
+					// r[i] holds the 4 pixels of dst column (x + i), rows y .. y + 3
+					__m128i r[4];
+					for (int i = 0; i < 4; ++ i) {
+						const uint8 *s = t.base + (int)(x + i) * t.dx + (int)y * t.dy;
+						if (t.dy > 0) {
+							r[i] = _mm_loadu_si128((const __m128i *)s);
+						} else {
+							r[i] = _mm_loadu_si128((const __m128i *)(s - 12));
+							r[i] = _mm_shuffle_epi32(r[i], _MM_SHUFFLE(0, 1, 2, 3));
+						}
+					}
+					__m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+					__m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+					__m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+					__m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+					_mm_storeu_si128((__m128i *)(dst->getLine(y) + x * 4), _mm_unpacklo_epi64(t0, t1));
+					_mm_storeu_si128((__m128i *)(dst->getLine(y + 1) + x * 4), _mm_unpackhi_epi64(t0, t1));
+					_mm_storeu_si128((__m128i *)(dst->getLine(y + 2) + x * 4), _mm_unpacklo_epi64(t2, t3));
+					_mm_storeu_si128((__m128i *)(dst->getLine(y + 3) + x * 4), _mm_unpackhi_epi64(t2, t3));
+				}
+
+				// the columns left in this tile
+				for (; x < xmax; ++ x) {
+					const uint8 *s = t.base + (int)x * t.dx + (int)y * t.dy;
+					for (int j = 0; j < 4; ++ j) {
+						*(uint *)(dst->getLine(y + j) + x * 4) = *(const uint *)(s + j * t.dy);
+					}
+				}
+			}
+#endif
+			// the rows left in this tile
+			for (; y < ymax; ++ y) {
+				uint8 *d = dst->getLine(y) + tx * 4;
+				const uint8 *s = t.base + (int)tx * t.dx + (int)y * t.dy;
+				for (uint x = tx; x < xmax; ++ x) {
+					*(uint *)d = *(const uint *)s;
+					d += 4;
+					s += t.dx;
+				}
+			}
+		}
+	}
+}
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Rotate Engine
+
+bool CRotateEngine::isTransposed (CDIBSection::ORIENTATION ot) {
+	return ot >= CDIBSection::OT_TRANSPOSE;
+}
+
+bool CRotateEngine::isReversedX (CDIBSection::ORIENTATION ot) {
+	return ot == CDIBSection::OT_FLIP_H || ot == CDIBSection::OT_ROTATE_180
+		|| ot == CDIBSection::OT_TRANSVERSE || ot == CDIBSection::OT_ROTATE_270;
+}
+
+bool CRotateEngine::isReversedY (CDIBSection::ORIENTATION ot) {
+	return ot == CDIBSection::OT_FLIP_V || ot == CDIBSection::OT_ROTATE_180
+		|| ot == CDIBSection::OT_ROTATE_90 || ot == CDIBSection::OT_TRANSVERSE;
+}
+
+bool CRotateEngine::rotate (const CDIBSection *src, CDIBSection *dst, CDIBSection::ORIENTATION ot) {
+	assert(src != NULL && dst != NULL);
+	assert(src != dst);
+	assert(ot >= CDIBSection::OT_NORMAL && ot < CDIBSection::OT_COUNT);
+	assert(src->getBitCounts() == dst->getBitCounts());
+	int bitcount = src->getBitCounts();
+	assert(bitcount == 24 || bitcount == 32);
+	int src_width = src->getWidth();
+	int src_height = src->getHeight();
+	bool transposed = isTransposed(ot);
+	bool rx = isReversedX(ot);
+	bool ry = isReversedY(ot);
+	if (transposed) {
+		assert(dst->getWidth() == src_height && dst->getHeight() == src_width);
+		if (dst->getWidth() != src_height || dst->getHeight() != src_width) {
+			return false;
+		}
+	} else {
+		assert(dst->getWidth() == src_width && dst->getHeight() == src_height);
+		if (dst->getWidth() != src_width || dst->getHeight() != src_height) {
+			return false;
+		}
+	}
+
+	GdiFlush();
+	int bytespp = bitcount / 8;
+	int stride = src->getPitch();
+	TRANSFORM t;
+	t.base = src->getLine(ry ? src_height - 1 : 0) + (rx ? (src_width - 1) * bytespp : 0);
+	if (transposed) {
+		t.dx = ry ? -stride : stride;
+		t.dy = rx ? -bytespp : bytespp;
+	} else {
+		t.dx = rx ? -bytespp : bytespp;
+		t.dy = ry ? -stride : stride;
+	}
+
+	if (bytespp == 3) {
+		_Transform24(t, dst, TILE_SIZE);
+	} else if (transposed) {
+		_Transform32Transposed(t, dst, TILE_SIZE);
+	} else {
+		_Transform32Rows(t, dst);
+	}
+	return true;
+}
+
+void CRotateEngine::flip (CDIBSection *dib, bool horizontal, bool vertical) {
+	assert(dib != NULL);
+	int bitcount = dib->getBitCounts();
+	assert(bitcount == 24 || bitcount == 32);
+	uint bytespp = bitcount / 8;
+	uint w = dib->getWidth();
+	uint h = dib->getHeight();
+
+	GdiFlush();
+	if (vertical) {
+		uint len = w * bytespp;
+		std::vector<uint8> tmp(len);
+		for (uint y = 0; y < h / 2; ++ y) {
+			uint8 *a = dib->getLine(y);
+			uint8 *b = dib->getLine(h - 1 - y);
+			memcpy(&tmp[0], a, len);
+			memcpy(a, b, len);
+			memcpy(b, &tmp[0], len);
+		}
+	}
+
+	if (horizontal) {
+		for (uint y = 0; y < h; ++ y) {
+			uint8 *l = dib->getLine(y);
+			uint8 *r = l + (w - 1) * bytespp;
+			while (l < r) {
+				for (uint i = 0; i < bytespp; ++ i) {
+					uint8 c = l[i];
+					l[i] = r[i];
+					r[i] = c;
+				}
+				l += bytespp;
+				r -= bytespp;
+			}
+		}
+	}
+}
+
+
+UI_END
+XL_END
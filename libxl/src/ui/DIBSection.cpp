@@ -4,6 +4,8 @@
 #include <map>
 #include "../../include/ui/DIBSection.h"
 #include "../../include/ui/DIBResizer.h"
+#include "../../include/ui/DIBRotator.h"
+#include "../../include/ui/DIBConverter.h"
 #include "../../include/ui/Gdi.h"
 #include "../../include/utilities.h"
 
@@ -17,6 +19,20 @@
 
 namespace {
 	static int dibcount = 0;
+
+	/**
+	 * the pixels of a line of the DIB: w, unless align is more than GDI requires,
+	 * then the bytes are padded to align and the line holds as many pixels as
+	 * fit (GDI pads them to 4 bytes, which is the same stride)
+	 */
+	int _PaddedWidth (int w, int bitcount, uint align) {
+		if (align <= 4) { // CDIBSection::STRIDE_ALIGN_DEFAULT
+			return w;
+		}
+		uint bytespp = (uint)bitcount / 8;
+		uint bytes = ((uint)w * bytespp + align - 1) & ~(align - 1);
+		return (int)(bytes / bytespp);
+	}
 }
 
 
@@ -26,61 +42,279 @@ UI_BEGIN
 //////////////////////////////////////////////////////////////////////////
 // protected methods
 
-void CDIBSection::_Clear () {
+CDIBSection::STORAGE::~STORAGE () {
+	if (hBitmap) {
+		::DeleteObject(hBitmap);
+	}
+	CFileMapping::unmap(view);
+
+	// the section must be closed after the DIB is deleted
+	delete pFileMapping;
+}
+
+void CDIBSection::_ClearBitmap () {
 	assert(m_hOldBitmap == INVALID_HANDLE_VALUE);
+	assert(!isShared());
 	if (m_hBitmap) {
 		::DeleteObject(m_hBitmap);
+		m_storage->hBitmap = NULL;
+		m_hBitmap = NULL;
 		memset(&m_section, 0, sizeof(m_section));
+		m_width = 0;
+		m_pitch = 0;
+	}
+}
+
+void CDIBSection::_Clear () {
+	assert(m_hOldBitmap == INVALID_HANDLE_VALUE);
+	m_storage.reset();
+	m_hBitmap = NULL;
+	memset(&m_section, 0, sizeof(m_section));
+	m_width = 0;
+	m_pitch = 0;
+}
+
+bool CDIBSection::_CreateBitmap (int w, int h, int bitcount, uint stridealign) {
+	assert(m_hBitmap == NULL);
+	if (m_storage == NULL) {
+		m_storage.reset(new STORAGE());
+	}
+	assert(m_storage->hBitmap == NULL);
+	assert(w > 0 && h > 0);
+	assert(bitcount == 24 || bitcount == 32);
+	assert(stridealign >= STRIDE_ALIGN_DEFAULT && (stridealign & (stridealign - 1)) == 0);
+
+	int pw = _PaddedWidth(w, bitcount, stridealign);
+	BITMAPINFO info;
+	memset(&info, 0, sizeof(info));
+	BITMAPINFOHEADER &bih = info.bmiHeader;
+	bih.biSize = sizeof(BITMAPINFOHEADER);
+	bih.biWidth = pw;
+	bih.biHeight = -h;
+	bih.biPlanes = 1;
+	bih.biBitCount = (WORD)bitcount;
+	bih.biCompression = BI_RGB;
+	bih.biSizeImage = 0;
+
+	HANDLE hSection = NULL;
+	CFileMapping *pFileMapping = m_storage->pFileMapping;
+	if (pFileMapping != NULL) {
+		assert(getBytes(w, h, bitcount, stridealign) <= pFileMapping->getSize());
+		hSection = pFileMapping->getHandle();
+	}
+
+	void *data = NULL;
+	HDC hdc = ::GetDC(NULL);
+	m_hBitmap = ::CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &data, hSection, 0);
+	::ReleaseDC(NULL, hdc);
+
+	if (m_hBitmap) {
+		m_storage->hBitmap = m_hBitmap;
+		::GetObject(m_hBitmap, sizeof(m_section), &m_section);
+		assert(m_section.dsBm.bmWidth == pw);
+		assert(m_section.dsBm.bmHeight == h);
+		m_width = w;
+		m_pitch = m_section.dsBm.bmWidthBytes;
+		m_strideAlign = stridealign;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+bool CDIBSection::_Detach (bool needBitmap) {
+	if (!isShared() && (m_hBitmap != NULL || !needBitmap)) {
+		return true;
+	}
+
+	// GDI draws on m_hBitmap while it is selected, and detachFromDC() restores it
+	assert(m_hOldBitmap == INVALID_HANDLE_VALUE);
+	if (m_hOldBitmap != INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	GdiFlush();
+	_StoragePtr shared = m_storage;
+	DIBSECTION section = m_section;
+	int pitch = m_pitch;
+	int w = getWidth(), h = getHeight(), bitcount = getBitCounts();
+	bool filemap = isFileMapped();
+
+	m_storage.reset(new STORAGE());
+	m_hBitmap = NULL;
+	bool created = false;
+	if (filemap) {
+		m_storage->pFileMapping = new CFileMapping();
+		created = m_storage->pFileMapping->createTemp(getBytes(w, h, bitcount, m_strideAlign), CFileMapping::ADV_SEQUENTIAL)
+			&& _CreateBitmap(w, h, bitcount, m_strideAlign);
+		if (!created) {
+			// in the memory of the process then
+			m_storage.reset(new STORAGE());
+		}
+	}
+	if (!created) {
+		created = _CreateBitmap(w, h, bitcount, m_strideAlign);
 	}
+	if (created) {
+		const uint8 *src = (const uint8 *)section.dsBm.bmBits;
+		size_t len = (size_t)w * (bitcount / 8);
+		for (int y = 0; y < h; ++ y) {
+			memcpy((uint8 *)m_section.dsBm.bmBits + y * m_pitch, src + y * pitch, len);
+		}
+		return true;
+	}
+
+	// out of memory, keep sharing, there is nothing better to do
+	assert(false);
+	m_storage = shared;
+	m_hBitmap = shared->hBitmap;
+	m_section = section;
+	m_pitch = pitch;
+	m_width = w;
+	return false;
+}
+
+bool CDIBSection::_Wrap (CFileMapping *pFileMapping, void *view, uint8 *top,
+                         int w, int h, int bitcount, int pitch) {
+	assert(w > 0 && h > 0);
+	assert(bitcount == 24 || bitcount == 32);
+	assert(top != NULL);
+	assert(pitch >= w * (bitcount / 8) || -pitch >= w * (bitcount / 8));
+	__int64 line = (__int64)w * (bitcount / 8);
+	if (top == NULL || w <= 0 || h <= 0 || (bitcount != 24 && bitcount != 32)
+	    || ((__int64)pitch < line && -(__int64)pitch < line)) {
+		// the lines would overlap, or go past the view
+		CFileMapping::unmap(view);
+		delete pFileMapping;
+		return false;
+	}
+	_Clear();
+
+	m_storage.reset(new STORAGE());
+	m_storage->pFileMapping = pFileMapping;
+	m_storage->view = view;
+	m_section.dsBm.bmWidth = w;
+	m_section.dsBm.bmHeight = h;
+	m_section.dsBm.bmWidthBytes = pitch > 0 ? pitch : -pitch;
+	m_section.dsBm.bmPlanes = 1;
+	m_section.dsBm.bmBitsPixel = (WORD)bitcount;
+	m_section.dsBm.bmBits = top;
+	m_width = w;
+	m_pitch = pitch;
+	m_strideAlign = STRIDE_ALIGN_DEFAULT;
+	return true;
+}
+
+bool CDIBSection::isNull () const {
+	return m_section.dsBm.bmBits == NULL;
 }
 
 int CDIBSection::getWidth () const {
-	return m_hBitmap == NULL ? -1 : m_section.dsBm.bmWidth;
+	return isNull() ? -1 : m_width;
 }
 
 int CDIBSection::getHeight () const {
-	return m_hBitmap == NULL ? -1 : m_section.dsBm.bmHeight;
+	return isNull() ? -1 : m_section.dsBm.bmHeight;
 }
 
 int CDIBSection::getBitCounts () const {
-	return m_hBitmap == NULL ? -1 : m_section.dsBm.bmBitsPixel;
+	return isNull() ? -1 : m_section.dsBm.bmBitsPixel;
 }
 
 int CDIBSection::getStride () const {
-	if (m_hBitmap == NULL) {
+	if (isNull()) {
 		return -1;
+	} else if (m_hBitmap == NULL) { // wrapped, such as a mapped file
+		return m_section.dsBm.bmWidthBytes;
 	} else {
 		uint stride = (uint)m_section.dsBm.bmWidth * (getBitCounts() / 8);
 		stride += 3;
 		stride &= ~(uint)3;
 		assert(stride < (uint)std::numeric_limits<int>::max());
 		assert(stride == (uint)m_section.dsBm.bmWidthBytes);
+		assert(stride % m_strideAlign == 0);
 		return (int)stride;
 	}
 }
 
+int CDIBSection::getPitch () const {
+	return isNull() ? 0 : m_pitch;
+}
+
+uint CDIBSection::getStrideAlign () const {
+	return m_strideAlign;
+}
+
+bool CDIBSection::isFileMapped () const {
+	return m_storage != NULL && m_storage->pFileMapping != NULL && m_storage->pFileMapping->hasFile();
+}
+
+bool CDIBSection::isShared () const {
+	return m_storage != NULL && !m_storage.unique();
+}
+
+bool CDIBSection::isView () const {
+	// wrapped, but neither a bitmap nor a mapped file of its own
+	return m_storage != NULL && m_storage->hBitmap == NULL
+		&& m_storage->pFileMapping == NULL && m_storage->view == NULL;
+}
+
+void CDIBSection::advise (int line, int lines, CFileMapping::ADVICE advice) const {
+	if (!isFileMapped() || isNull()) {
+		return;
+	}
+
+	int h = getHeight();
+	if (line < 0) {
+		lines += line;
+		line = 0;
+	}
+	if (line + lines > h) {
+		lines = h - line;
+	}
+	if (lines > 0) {
+		const uint8 *p = getLine(m_pitch > 0 ? line : line + lines - 1);
+		CFileMapping::advise((void *)p, (size_t)lines * getStride(), advice);
+	}
+}
+
 uint8* CDIBSection::getLine (int line) {
 	// assert(m_hOldBitmap == INVALID_HANDLE_VALUE);
-	if (m_hBitmap == NULL) {
+	_Detach();
+	return const_cast<uint8 *>(static_cast<const CDIBSection *>(this)->getLine(line));
+}
+
+uint8* CDIBSection::getData () {
+	// assert(m_hOldBitmap == INVALID_HANDLE_VALUE);
+	if (isNull()) {
+		assert(false);
+		return NULL;
+	}
+
+	_Detach();
+	if (m_hBitmap != NULL) {
+		::GetObject(m_hBitmap, sizeof(m_section), &m_section);
+	}
+	return (uint8 *)m_section.dsBm.bmBits;
+}
+
+const uint8* CDIBSection::getLine (int line) const {
+	if (isNull()) {
 		return NULL;
 	} else {
 		assert(line >= 0 && line < getHeight());
-		uint8 *data = (uint8 *)m_section.dsBm.bmBits;
-		assert(data != NULL);
-		data += line * getStride();
+		const uint8 *data = (const uint8 *)m_section.dsBm.bmBits;
+		data += line * m_pitch;
 		return data;
 	}
 }
 
-uint8* CDIBSection::getData () {
-	// assert(m_hOldBitmap == INVALID_HANDLE_VALUE);
-	if (m_hBitmap == NULL) {
+const uint8* CDIBSection::getData () const {
+	if (isNull()) {
 		assert(false);
 		return NULL;
 	}
-
-	::GetObject(m_hBitmap, sizeof(m_section), &m_section);
-	return m_hBitmap == NULL ? NULL : (uint8 *)m_section.dsBm.bmBits;
+	return (const uint8 *)m_section.dsBm.bmBits;
 }
 
 
@@ -90,7 +324,11 @@ uint8* CDIBSection::getData () {
 CDIBSection::CDIBSection ()
 	: m_hBitmap(NULL)
 	, m_hOldBitmap((HBITMAP)INVALID_HANDLE_VALUE)
+	, m_width(0)
+	, m_pitch(0)
+	, m_strideAlign(STRIDE_ALIGN_DEFAULT)
 {
+	memset(&m_section, 0, sizeof(m_section));
 	dibcount ++;
 }
 
@@ -100,45 +338,34 @@ CDIBSection::~CDIBSection () {
 	// XLTRACE(_T("%d DIBSection remains\n"), dibcount);
 }
 
-bool CDIBSection::create (int w, int h, int bitcount /* = 24 */, bool usefilemap /* = false */) {
-	XL_PARAMETER_NOT_USED(usefilemap);
+bool CDIBSection::create (int w, int h, int bitcount /* = 24 */, bool usefilemap /* = false */,
+                          uint stridealign /* = STRIDE_ALIGN_DEFAULT */) {
 	GdiFlush();
 	_Clear();
 
-	assert(w > 0 && h > 0);
-	assert(bitcount == 24 || bitcount == 32);
-	assert(!usefilemap); // not support now
-
-	BITMAPINFO info;
-	memset(&info, 0, sizeof(info));
-	BITMAPINFOHEADER &bih = info.bmiHeader;
-	bih.biSize = sizeof(BITMAPINFOHEADER);
-	bih.biWidth = w;
-	bih.biHeight = -h;
-	bih.biPlanes = 1;
-	bih.biBitCount = (WORD)bitcount;
-	bih.biCompression = BI_RGB;
-	bih.biSizeImage = 0;
-
-	void *data = NULL;
-	HDC hdc = ::GetDC(NULL);
-	m_hBitmap = ::CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &data, NULL, 0);
-	::ReleaseDC(NULL, hdc);
+	m_storage.reset(new STORAGE());
+	if (usefilemap) {
+		m_storage->pFileMapping = new CFileMapping();
+		if (!m_storage->pFileMapping->createTemp(getBytes(w, h, bitcount, stridealign), CFileMapping::ADV_SEQUENTIAL)) {
+			_Clear();
+			return false;
+		}
+	}
 
-	if (m_hBitmap) {
-		::GetObject(m_hBitmap, sizeof(m_section), &m_section);
-		assert(m_section.dsBm.bmWidth == w);
-		assert(m_section.dsBm.bmHeight == h);
-		return true;
-	} else {
+	if (!_CreateBitmap(w, h, bitcount, stridealign)) {
+		_Clear();
 		return false;
 	}
+	return true;
 }
 
 
 
 bool CDIBSection::attachToDC (HDC hdc) {
-	assert(m_hBitmap != NULL);
+	assert(!isNull());
+	if (m_hOldBitmap == INVALID_HANDLE_VALUE) {
+		_Detach(true);
+	}
 #ifndef _WIN64
 	long v = InterlockedCompareExchange((long *)&m_hOldBitmap, 1, (long)INVALID_HANDLE_VALUE);
 #else
@@ -165,7 +392,7 @@ void CDIBSection::detachFromDC (HDC hdc) {
 
 void CDIBSection::stretchBlt (HDC hdc, int xDest, int yDest, int nDestWidth, int nDestHeight,
                               int xSrc, int ySrc, int nSrcWidth, int nSrcHeight, DWORD dwRop,
-			      bool highQuality) {
+			      bool highQuality) const {
 	assert(false); // it seems doesn't work!!!
 	assert(m_hBitmap != NULL);
 	assert(getBitCounts() >= 16);
@@ -176,14 +403,14 @@ void CDIBSection::stretchBlt (HDC hdc, int xDest, int yDest, int nDestWidth, int
 	memset(&info, 0, sizeof(info));
 	BITMAPINFOHEADER &bih = info.bmiHeader;
 	bih.biSize = sizeof(BITMAPINFOHEADER);
-	bih.biWidth = getWidth();
+	bih.biWidth = m_section.dsBm.bmWidth; // the DIB may be wider than getWidth()
 	bih.biHeight = -getHeight();
 	bih.biPlanes = 1;
 	bih.biBitCount = (WORD)getBitCounts();
 	bih.biCompression = BI_RGB;
 	bih.biSizeImage = 0;
 
-	void *data = getData();
+	const void *data = getData();
 	assert(data != NULL);
 
 	int mode = highQuality ? HALFTONE : COLORONCOLOR;
@@ -197,40 +424,65 @@ void CDIBSection::stretchBlt (HDC hdc, int xDest, int yDest, int nDestWidth, int
 
 
 
-CDIBSectionPtr CDIBSection::clone () {
-	GdiFlush();
-	assert(m_hBitmap != NULL);
-	if (m_hBitmap == NULL) {
+CDIBSectionPtr CDIBSection::clone () const {
+	assert(!isNull());
+	if (isNull()) {
 		return CDIBSectionPtr();
 	}
 
-	assert(m_section.dshSection == NULL);
 	assert(getWidth() > 0 && getHeight() > 0);
-	CDIBSectionPtr dib = createDIBSection(getWidth(), getHeight(), getBitCounts());
+	// GDI may be drawing on the bits of a DIB selected into a DC, a clone copies them
+	if (m_storage->shareable && m_hOldBitmap == INVALID_HANDLE_VALUE) {
+		CDIBSectionPtr dib(new CDIBSection());
+		dib->m_storage = m_storage;
+		dib->m_hBitmap = m_hBitmap;
+		dib->m_section = m_section;
+		dib->m_width = m_width;
+		dib->m_pitch = m_pitch;
+		dib->m_strideAlign = m_strideAlign;
+		return dib;
+	}
+
+	GdiFlush();
+	CDIBSectionPtr dib = createDIBSection(getWidth(), getHeight(), getBitCounts(), isFileMapped(), m_strideAlign);
 	if (dib) {
 		assert(getWidth() == dib->getWidth());
 		assert(getHeight() == dib->getHeight());
 		assert(getStride() == dib->getStride());
-		void *src = getData();
+		const void *src = getData();
 		void *dst = dib->getData();
 		memcpy(dst, src, getStride() * getHeight());
 	}
-	return CDIBSectionPtr(dib);
+	return dib;
+}
+
+CDIBSectionPtr CDIBSection::createView (int x, int y, int w, int h) const {
+	assert(!isNull());
+	assert(x >= 0 && y >= 0 && w > 0 && h > 0);
+	assert(x + w <= getWidth() && y + h <= getHeight());
+	CDIBSectionPtr dib(new CDIBSection());
+	uint8 *top = const_cast<uint8 *>(getLine(y)) + x * (getBitCounts() / 8);
+	dib->_Wrap(NULL, NULL, top, w, h, getBitCounts(), m_pitch);
+	return dib;
 }
 
 // #define USE_STRETCHBLT
 CDIBSectionPtr CDIBSection::cloneAndResize (int w, int h, RESIZE_TYPE rt,
-                                            ILongTimeRunCallback *pCallback, bool usefilemap
-                                           ) {
+                                            ILongTimeRunCallback *pCallback, bool usefilemap,
+                                            ORIENTATION ot
+                                           ) const {
 	GdiFlush();
-	assert(m_hBitmap != NULL);
+	assert(!isNull());
 	assert(w > 0 && h > 0);
 
-	if (getWidth() == w && getHeight() == h) {
-		return clone();
+	bool transposed = CRotateEngine::isTransposed(ot);
+	int rw = transposed ? getHeight() : getWidth();
+	int rh = transposed ? getWidth() : getHeight();
+	if (rw == w && rh == h) {
+		return ot == OT_NORMAL ? cloneAndConvert(getBitCounts(), usefilemap) : cloneAndRotate(ot, usefilemap);
 	}
 
-	CDIBSectionPtr dib = createDIBSection(w, h, getBitCounts(), usefilemap);
+	CDIBSectionPtr dib = createDIBSection(w, h, getBitCounts(), usefilemap, m_strideAlign);
 	if (dib) {
 #ifdef USE_STRETCHBLT
 		assert(w == dib->getWidth());
@@ -243,16 +495,16 @@ CDIBSectionPtr CDIBSection::cloneAndResize (int w, int h, RESIZE_TYPE rt,
 		dib->attachToDC(dc);
 		CDC mdc;
 		mdc.CreateCompatibleDC(dc);
-		attachToDC(mdc);
+		const_cast<CDIBSection *>(this)->attachToDC(mdc);
 		int oldMode = dc.SetStretchBltMode(rt != RT_FAST ? HALFTONE : COLORONCOLOR);
 
 		dc.StretchBlt(0, 0, w, h, mdc, 0, 0, getWidth(), getHeight(), SRCCOPY);
 
 		dc.SetStretchBltMode(oldMode);
-		detachFromDC(mdc);
+		const_cast<CDIBSection *>(this)->detachFromDC(mdc);
 		dib->detachFromDC(dc);
 #else
-		if (!resize(dib.get(), rt, pCallback)) {
+		if (!resize(dib.get(), rt, pCallback, ot)) {
 			dib.reset();
 		}
 #endif
@@ -261,46 +513,80 @@ CDIBSectionPtr CDIBSection::cloneAndResize (int w, int h, RESIZE_TYPE rt,
 	return dib;
 }
 
-bool CDIBSection::resize (CDIBSection *dib, RESIZE_TYPE rt, ILongTimeRunCallback *pCallback) {
-	assert(dib != NULL);
+CDIBSectionPtr CDIBSection::cloneAndRotate (ORIENTATION ot, bool usefilemap) const {
+	assert(!isNull());
+	if (ot == OT_NORMAL) {
+		return clone();
+	}
+
+	bool transposed = CRotateEngine::isTransposed(ot);
+	int w = transposed ? getHeight() : getWidth();
+	int h = transposed ? getWidth() : getHeight();
+	CDIBSectionPtr dib = createDIBSection(w, h, getBitCounts(), usefilemap, m_strideAlign);
+	if (dib) {
+		if (!rotate(dib.get(), ot)) {
+			dib.reset();
+		}
+	}
 
-	std::auto_ptr<CGenericFilter> pFilter;
-	switch (rt) {
-		case RT_FAST:
-			break;
-		case RT_BOX:
-			pFilter.reset(new CBoxFilter());
-			break;
-		case RT_BICUBIC:
-			pFilter.reset(new CBicubicFilter());
-			break;
-		case RT_BILINEAR:
-			pFilter.reset(new CBilinearFilter());
-			break;
-		case RT_BSPLINE:
-			pFilter.reset(new CBSplineFilter());
-			break;
-		case RT_CATMULLROM:
-			pFilter.reset(new CCatmullRomFilter());
-			break;
-		case RT_LANCZOS3:
-			pFilter.reset(new CLanczos3Filter());
-			break;
-		default:
-			assert(false);
+	return dib;
+}
+
+CDIBSectionPtr CDIBSection::cloneAndConvert (int bitcount, bool usefilemap) const {
+	assert(!isNull());
+	assert(bitcount == 24 || bitcount == 32);
+	if (bitcount == getBitCounts() && usefilemap == isFileMapped()) {
+		return clone();
 	}
 
+	CDIBSectionPtr dib = createDIBSection(getWidth(), getHeight(), bitcount, usefilemap, m_strideAlign);
+	if (dib) {
+		if (!convert(dib.get())) {
+			dib.reset();
+		}
+	}
+
+	return dib;
+}
+
+bool CDIBSection::resize (CDIBSection *dib, RESIZE_TYPE rt, ILongTimeRunCallback *pCallback, ORIENTATION ot) const {
+	assert(dib != NULL);
+
+	std::auto_ptr<CGenericFilter> pFilter(CResizeEngine::createFilter(rt));
 	CResizeEngine engine(pFilter.get());
-	return engine.scale(this, dib, pCallback);
+	return engine.scale(this, dib, pCallback, ot);
+}
+
+bool CDIBSection::compose (const PLACEMENT *placements, uint count, RESIZE_TYPE rt, ILongTimeRunCallback *pCallback) {
+	assert(placements != NULL || count == 0);
+	return CResizeEngine::scaleInto(placements, count, this, rt, pCallback);
+}
+
+bool CDIBSection::rotate (CDIBSection *dib, ORIENTATION ot) const {
+	assert(dib != NULL);
+	return CRotateEngine::rotate(this, dib, ot);
+}
+
+bool CDIBSection::convert (CDIBSection *dib) const {
+	assert(dib != NULL);
+	return CConvertEngine::convert(this, dib);
 }
 
 
 //////////////////////////////////////////////////////////////////////////
 // STATIC
-CDIBSectionPtr CDIBSection::createDIBSection (int w, int h, int bitcount /* = 24 */, bool usefilemap /* = false */) {
+uint64 CDIBSection::getBytes (int w, int h, int bitcount, uint stridealign /* = STRIDE_ALIGN_DEFAULT */) {
+	assert(w > 0 && h > 0);
+	uint64 stride = (uint64)_PaddedWidth(w, bitcount, stridealign) * (bitcount / 8);
+	stride = (stride + 3) & ~(uint64)3;
+	return stride * h;
+}
+
+CDIBSectionPtr CDIBSection::createDIBSection (int w, int h, int bitcount /* = 24 */, bool usefilemap /* = false */,
+                                              uint stridealign /* = STRIDE_ALIGN_DEFAULT */) {
 	CDIBSection *pDIB = new CDIBSection();
 	if (pDIB) {
-		if (!pDIB->create(w, h, bitcount, usefilemap)) {
+		if (!pDIB->create(w, h, bitcount, usefilemap, stridealign)) {
 			delete pDIB;
 			pDIB = NULL;
 		}
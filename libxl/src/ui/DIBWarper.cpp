@@ -0,0 +1,360 @@
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <emmintrin.h>
+#include "../../include/ThreadPool.h"
+#include "../../include/ui/DIBWarper.h"
+
+#define USE_SSE
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+template <class T> T MAX(T a, T b) {
+	return (a > b) ? a: b;
+}
+template <class T> T MIN(T a, T b) {
+	return (a < b) ? a: b;
+}
+
+enum SAMPLER {
+	SAMPLER_NEAREST,
+	SAMPLER_BILINEAR,
+	SAMPLER_FILTER
+};
+
+/**
+ * narrow [xmin, xmax] to the x where lo <= p0 + step * x < hi
+ */
+bool _Clip (double p0, double step, double lo, double hi, double &xmin, double &xmax) {
+	if (step == 0) {
+		return p0 >= lo && p0 < hi;
+	}
+	double t0 = (lo - p0) / step;
+	double t1 = (hi - p0) / step;
+	if (t0 > t1) {
+		double t = t0;
+		t0 = t1;
+		t1 = t;
+	}
+	xmin = MAX(xmin, t0);
+	xmax = MIN(xmax, t1);
+	return xmin <= xmax;
+}
+
+class CWarpBands : public IBandExecutable
+{
+public:
+	const CDIBSection          *src;
+	CDIBSection                *dst;
+	AFFINEMATRIX                inv; // dst -> src
+	CGenericFilter             *filter;
+	SAMPLER                     sampler;
+	uint8                       bg[4];
+	bool                        fill;
+	ILongTimeRunCallback       *pCallback;
+
+	bool operator() (uint band);
+
+protected:
+	void _Fill (uint8 *line, int from, int to, uint bytespp);
+	void _Nearest (uint8 *out, double sx, double sy, uint bytespp);
+	void _Bilinear (uint8 *out, double sx, double sy, uint bytespp);
+	void _Filtered (uint8 *out, double sx, double sy, uint bytespp, std::vector<float> &wx, std::vector<float> &wy);
+};
+
+bool CWarpBands::operator() (uint band) {
+	if (pCallback && pCallback->shouldStop()) {
+		return false;
+	}
+
+	int src_width = src->getWidth();
+	int src_height = src->getHeight();
+	int dst_width = dst->getWidth();
+	int dst_height = dst->getHeight();
+	uint bytespp = dst->getBitCounts() / 8;
+	int y0 = band * CWarpEngine::BAND_HEIGHT;
+	int y1 = MIN(y0 + (int)CWarpEngine::BAND_HEIGHT, dst_height);
+
+	std::vector<float> wx, wy;
+	if (sampler == SAMPLER_FILTER) {
+		size_t taps = 2 * (size_t)ceil(filter->GetWidth()) + 2;
+		wx.resize(taps);
+		wy.resize(taps);
+	}
+
+	for (int y = y0; y < y1; ++ y) {
+		uint8 *line = dst->getLine(y);
+		double sx0 = inv.b * y + inv.c;
+		double sy0 = inv.e * y + inv.f;
+
+		// the span of this row which falls into src
+		double xmin = 0, xmax = dst_width - 1;
+		if (!_Clip(sx0, inv.a, -0.5, src_width - 0.5, xmin, xmax)
+		    || !_Clip(sy0, inv.d, -0.5, src_height - 0.5, xmin, xmax)) {
+			if (fill) {
+				_Fill(line, 0, dst_width, bytespp);
+			}
+			continue;
+		}
+		int x0 = (int)ceil(xmin);
+		int x1 = (int)floor(xmax) + 1;
+		if (fill) {
+			_Fill(line, 0, x0, bytespp);
+			_Fill(line, x1, dst_width, bytespp);
+		}
+
+		double sx = sx0 + inv.a * x0;
+		double sy = sy0 + inv.d * x0;
+		uint8 *out = line + x0 * bytespp;
+		for (int x = x0; x < x1; ++ x) {
+			switch (sampler) {
+			case SAMPLER_NEAREST:
+				_Nearest(out, sx, sy, bytespp);
+				break;
+			case SAMPLER_BILINEAR:
+				_Bilinear(out, sx, sy, bytespp);
+				break;
+			default:
+				_Filtered(out, sx, sy, bytespp, wx, wy);
+				break;
+			}
+			out += bytespp;
+			sx += inv.a;
+			sy += inv.d;
+		}
+	}
+
+	return true;
+}
+
+void CWarpBands::_Fill (uint8 *line, int from, int to, uint bytespp) {
+	uint8 *p = line + from * bytespp;
+	for (int x = from; x < to; ++ x) {
+		for (uint i = 0; i < bytespp; ++ i) {
+			*p ++ = bg[i];
+		}
+	}
+}
+
+void CWarpBands::_Nearest (uint8 *out, double sx, double sy, uint bytespp) {
+	int ix = MIN(MAX((int)(sx + 0.5), 0), src->getWidth() - 1);
+	int iy = MIN(MAX((int)(sy + 0.5), 0), src->getHeight() - 1);
+	const uint8 *p = src->getLine(iy) + ix * bytespp;
+	for (uint i = 0; i < bytespp; ++ i) {
+		out[i] = p[i];
+	}
+}
+
+void CWarpBands::_Bilinear (uint8 *out, double sx, double sy, uint bytespp) {
+	int w = src->getWidth();
+	int h = src->getHeight();
+	sx = MIN(MAX(sx, 0.0), (double)(w - 1));
+	sy = MIN(MAX(sy, 0.0), (double)(h - 1));
+	int ix = (int)sx;
+	int iy = (int)sy;
+	int fx = (int)((sx - ix) * 256);
+	int fy = (int)((sy - iy) * 256);
+	if (ix >= w - 1) {
+		ix = w - 2;
+		fx = 256;
+	}
+	if (iy >= h - 1) {
+		iy = h - 2;
+		fy = 256;
+	}
+
+	const uint8 *p0 = src->getLine(iy) + ix * bytespp;
+	const uint8 *p1 = src->getLine(iy + 1) + ix * bytespp;
+#ifdef USE_SSE
+	__m128i zero = _mm_setzero_si128();
+	__m128i half = _mm_set1_epi16(128);
+	__m128i r0, r1;
+	if (bytespp == 4) {
+		r0 = _mm_loadl_epi64((const __m128i *)p0);
+		r1 = _mm_loadl_epi64((const __m128i *)p1);
+	} else {
+		r0 = _mm_set_epi32(0, 0, p0[3] | (p0[4] << 8) | (p0[5] << 16), p0[0] | (p0[1] << 8) | (p0[2] << 16));
+		r1 = _mm_set_epi32(0, 0, p1[3] | (p1[4] << 8) | (p1[5] << 16), p1[0] | (p1[1] << 8) | (p1[2] << 16));
+	}
+	r0 = _mm_unpacklo_epi8(r0, zero);
+	r1 = _mm_unpacklo_epi8(r1, zero);
+
+	// vertical, 8 lanes (2 pixels), the sum of weights is 256 so no lane overflows 16 bits
+	__m128i v = _mm_add_epi16(_mm_mullo_epi16(r0, _mm_set1_epi16((short)(256 - fy))),
+		_mm_mullo_epi16(r1, _mm_set1_epi16((short)fy)));
+	v = _mm_srli_epi16(_mm_add_epi16(v, half), 8);
+
+	// horizontal, the left pixel is in the low 4 lanes
+	short wl = (short)(256 - fx), wr = (short)fx;
+	v = _mm_mullo_epi16(v, _mm_set_epi16(wr, wr, wr, wr, wl, wl, wl, wl));
+	v = _mm_add_epi16(v, _mm_srli_si128(v, 8));
+	v = _mm_srli_epi16(_mm_add_epi16(v, half), 8);
+	v = _mm_packus_epi16(v, v);
+	uint pixel = (uint)_mm_cvtsi128_si32(v);
+	out[0] = (uint8)pixel;
+	out[1] = (uint8)(pixel >> 8);
+	out[2] = (uint8)(pixel >> 16);
+	if (bytespp == 4) {
+		out[3] = (uint8)(pixel >> 24);
+	}
+#else
+	for (uint i = 0; i < bytespp; ++ i) {
+		int top = p0[i] * (256 - fx) + p0[i + bytespp] * fx;
+		int bottom = p1[i] * (256 - fx) + p1[i + bytespp] * fx;
+		out[i] = (uint8)((top * (256 - fy) + bottom * fy + 32768) >> 16);
+	}
+#endif
+}
+
+void CWarpBands::_Filtered (uint8 *out, double sx, double sy, uint bytespp,
+                            std::vector<float> &wx, std::vector<float> &wy) {
+	int w = src->getWidth();
+	int h = src->getHeight();
+	double radius = filter->GetWidth();
+	int left = (int)ceil(sx - radius);
+	int right = (int)floor(sx + radius);
+	int top = (int)ceil(sy - radius);
+	int bottom = (int)floor(sy + radius);
+	assert(right - left + 1 <= (int)wx.size());
+	assert(bottom - top + 1 <= (int)wy.size());
+
+	float total = 0;
+	for (int i = left; i <= right; ++ i) {
+		wx[i - left] = (float)filter->Filter(sx - i);
+		total += wx[i - left];
+	}
+	if (total != 0) {
+		for (int i = left; i <= right; ++ i) {
+			wx[i - left] /= total;
+		}
+	}
+	total = 0;
+	for (int j = top; j <= bottom; ++ j) {
+		wy[j - top] = (float)filter->Filter(sy - j);
+		total += wy[j - top];
+	}
+	if (total != 0) {
+		for (int j = top; j <= bottom; ++ j) {
+			wy[j - top] /= total;
+		}
+	}
+
+	float value[4] = {0, 0, 0, 0}; // 4 = 32bpp max
+	for (int j = top; j <= bottom; ++ j) {
+		const uint8 *line = src->getLine(MIN(MAX(j, 0), h - 1));
+		float row[4] = {0, 0, 0, 0};
+		for (int i = left; i <= right; ++ i) {
+			const uint8 *p = line + MIN(MAX(i, 0), w - 1) * bytespp;
+			float weight = wx[i - left];
+			for (uint k = 0; k < bytespp; ++ k) {
+				row[k] += weight * p[k];
+			}
+		}
+		for (uint k = 0; k < bytespp; ++ k) {
+			value[k] += wy[j - top] * row[k];
+		}
+	}
+
+	for (uint k = 0; k < bytespp; ++ k) {
+		out[k] = (uint8)MIN(MAX((int)0, (int)(value[k] + 0.5f)), (int)255);
+	}
+}
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Affine matrix
+
+AFFINEMATRIX AFFINEMATRIX::then (const AFFINEMATRIX &m) const {
+	return AFFINEMATRIX(m.a * a + m.b * d, m.a * b + m.b * e, m.a * c + m.b * f + m.c,
+		m.d * a + m.e * d, m.d * b + m.e * e, m.d * c + m.e * f + m.f);
+}
+
+bool AFFINEMATRIX::invert (AFFINEMATRIX &inv) const {
+	double det = a * e - b * d;
+	if (fabs(det) < 1e-12) {
+		return false;
+	}
+
+	inv.a = e / det;
+	inv.b = -b / det;
+	inv.d = -d / det;
+	inv.e = a / det;
+	inv.c = -(inv.a * c + inv.b * f);
+	inv.f = -(inv.d * c + inv.e * f);
+	return true;
+}
+
+AFFINEMATRIX AFFINEMATRIX::translation (double tx, double ty) {
+	return AFFINEMATRIX(1, 0, tx, 0, 1, ty);
+}
+
+AFFINEMATRIX AFFINEMATRIX::scaling (double sx, double sy) {
+	return AFFINEMATRIX(sx, 0, 0, 0, sy, 0);
+}
+
+AFFINEMATRIX AFFINEMATRIX::rotation (double degrees, double cx, double cy) {
+	double r = degrees * FILTER_PI / 180;
+	double cs = cos(r), sn = sin(r);
+	return translation(-cx, -cy).then(AFFINEMATRIX(cs, -sn, 0, sn, cs, 0)).then(translation(cx, cy));
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Warp Engine
+
+bool CWarpEngine::warp (const CDIBSection *src, CDIBSection *dst, const AFFINEMATRIX &m,
+                        COLORREF background, bool fill, ILongTimeRunCallback *pCallback) {
+	assert(src != NULL && dst != NULL);
+	assert(src != dst);
+	assert(src->getBitCounts() == dst->getBitCounts());
+	int bitcount = src->getBitCounts();
+	assert(bitcount == 24 || bitcount == 32);
+
+	CWarpBands bands;
+	if (!m.invert(bands.inv)) {
+		assert(false);
+		return false;
+	}
+
+	bands.src = src;
+	bands.dst = dst;
+	bands.filter = m_pFilter;
+	bands.fill = fill;
+	bands.pCallback = pCallback;
+	bands.bg[0] = GetBValue(background);
+	bands.bg[1] = GetGValue(background);
+	bands.bg[2] = GetRValue(background);
+	bands.bg[3] = 0; // transparent
+	if (m_pFilter == NULL) {
+		bands.sampler = SAMPLER_NEAREST;
+	} else if (dynamic_cast<CBilinearFilter *>(m_pFilter) != NULL) {
+		bands.sampler = src->getWidth() > 1 && src->getHeight() > 1 ? SAMPLER_BILINEAR : SAMPLER_NEAREST;
+	} else {
+		bands.sampler = SAMPLER_FILTER;
+	}
+
+	GdiFlush();
+	uint count = (dst->getHeight() + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	return parallel_for(count, &bands);
+}
+
+AFFINEMATRIX CWarpEngine::rotation (double degrees, int w, int h, int &dst_w, int &dst_h) {
+	assert(w > 0 && h > 0);
+	double r = degrees * FILTER_PI / 180;
+	double cs = fabs(cos(r)), sn = fabs(sin(r));
+	dst_w = MAX(1, (int)ceil(w * cs + h * sn - 1e-6));
+	dst_h = MAX(1, (int)ceil(w * sn + h * cs - 1e-6));
+
+	return AFFINEMATRIX::translation(-(w - 1) / 2.0, -(h - 1) / 2.0)
+		.then(AFFINEMATRIX::rotation(degrees))
+		.then(AFFINEMATRIX::translation((dst_w - 1) / 2.0, (dst_h - 1) / 2.0));
+}
+
+
+UI_END
+XL_END
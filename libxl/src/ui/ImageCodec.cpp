@@ -0,0 +1,517 @@
+#include <assert.h>
+#include <string.h>
+#include "../../include/ui/ImageCodec.h"
+#include "../../include/FileMapping.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+	// the lines written to a file mapped DIB are dropped from the working set by these
+	const int DROP_LINES = 256;
+
+	// the largest image read: the lines of the file and of the DIB (4 bytes per
+	// pixel at most) are addressed by an int pitch
+	const uint64 MAX_SIDE = 0x100000;
+	const uint64 MAX_BYTES = 0x7fffffff;
+
+	uint _Word (const uint8 *p) {
+		return (uint)p[0] | ((uint)p[1] << 8);
+	}
+
+	uint _Dword (const uint8 *p) {
+		return (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+	}
+
+	void _PutWord (uint8 *p, uint v) {
+		p[0] = (uint8)v;
+		p[1] = (uint8)(v >> 8);
+	}
+
+	void _PutDword (uint8 *p, uint v) {
+		p[0] = (uint8)v;
+		p[1] = (uint8)(v >> 8);
+		p[2] = (uint8)(v >> 16);
+		p[3] = (uint8)(v >> 24);
+	}
+
+	/**
+	 * skip the white spaces and the comments of a PNM header, then read a number
+	 */
+	bool _ReadPNMNumber (FILE *file, uint &value) {
+		int c = fgetc(file);
+		while (true) {
+			if (c == '#') {
+				while (c != EOF && c != '\n' && c != '\r') {
+					c = fgetc(file);
+				}
+			} else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+				c = fgetc(file);
+			} else {
+				break;
+			}
+		}
+		if (c < '0' || c > '9') {
+			return false;
+		}
+		value = 0;
+		while (c >= '0' && c <= '9') {
+			value = value * 10 + (uint)(c - '0');
+			if (value > 0xffff) {
+				return false;
+			}
+			c = fgetc(file);
+		}
+		// exactly one white space ends the number
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	FILE* _Open (const tstring &path, const tchar *mode) {
+		return _tfopen(path.c_str(), mode);
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CImageCodec
+
+CImageCodec::FORMAT CImageCodec::detect (const tstring &path) {
+	CImageReader reader;
+	return reader.open(path) ? reader.getFormat() : IF_UNKNOWN;
+}
+
+CImageCodec::FORMAT CImageCodec::formatOf (const tstring &path) {
+	tstring::size_type dot = path.rfind(_T('.'));
+	if (dot == tstring::npos) {
+		return IF_UNKNOWN;
+	}
+	tstring ext = path.substr(dot + 1);
+	for (tstring::iterator it = ext.begin(); it != ext.end(); ++ it) {
+		if (*it >= _T('A') && *it <= _T('Z')) {
+			*it = *it - _T('A') + _T('a');
+		}
+	}
+	if (ext == _T("bmp") || ext == _T("dib")) {
+		return IF_BMP;
+	} else if (ext == _T("ppm")) {
+		return IF_PPM;
+	} else if (ext == _T("pgm")) {
+		return IF_PGM;
+	} else if (ext == _T("tga")) {
+		return IF_TGA;
+	} else {
+		return IF_UNKNOWN;
+	}
+}
+
+bool CImageCodec::load (const tstring &path, CDIBSection *dib, bool usefilemap,
+                        ILongTimeRunCallback *pCallback) {
+	assert(dib != NULL);
+	CImageReader reader;
+	if (!reader.open(path)) {
+		return false;
+	}
+	if (!dib->create(reader.getWidth(), reader.getHeight(), reader.getBitCounts(), usefilemap)) {
+		return false;
+	}
+	return reader.readAll(dib, pCallback);
+}
+
+bool CImageCodec::map (const tstring &path, CDIBSection *dib) {
+	assert(dib != NULL);
+	CImageReader reader;
+	if (!reader.open(path)) {
+		return false;
+	}
+
+	// the colors and the lines must be as in a DIB
+	if (reader.m_rgb || reader.m_bytespp < 3) {
+		reader.close();
+		return load(path, dib);
+	}
+	int w = reader.getWidth(), h = reader.getHeight(), bitcount = reader.getBitCounts();
+	bool bottomUp = reader.isBottomUp();
+	uint stride = reader.m_fileStride;
+	uint64 offset = reader.m_dataOffset;
+	reader.close();
+
+	CFileMapping *pFileMapping = new CFileMapping();
+	if (!pFileMapping->open(path, CFileMapping::ADV_SEQUENTIAL)
+	    || offset + (uint64)stride * h > pFileMapping->getSize()) {
+		delete pFileMapping;
+		return load(path, dib);
+	}
+	uint8 *view = (uint8 *)pFileMapping->map();
+	if (view == NULL) {
+		delete pFileMapping;
+		return load(path, dib);
+	}
+
+	uint8 *top = view + (size_t)offset;
+	int pitch = (int)stride;
+	if (bottomUp) {
+		top += (size_t)stride * (h - 1);
+		pitch = -pitch;
+	}
+	return dib->_Wrap(pFileMapping, view, top, w, h, bitcount, pitch);
+}
+
+bool CImageCodec::save (const CDIBSection *dib, const tstring &path, FORMAT format, bool topdown) {
+	assert(dib != NULL && !dib->isNull());
+	if (format == IF_UNKNOWN) {
+		format = formatOf(path);
+	}
+	if (format <= IF_UNKNOWN || format >= IF_COUNT) {
+		assert(false);
+		return false;
+	}
+
+	int w = dib->getWidth(), h = dib->getHeight(), bitcount = dib->getBitCounts();
+	int bytespp = bitcount / 8;
+	assert(bytespp == 3 || bytespp == 4);
+
+	// the header, and the bytes of a line in the file
+	std::vector<uint8> header;
+	uint stride = 0;
+	switch (format) {
+	case IF_BMP:
+		stride = ((uint)w * bytespp + 3) & ~3;
+		header.resize(14 + 40, 0);
+		header[0] = 'B';
+		header[1] = 'M';
+		_PutDword(&header[2], (uint)header.size() + stride * h);
+		_PutDword(&header[10], (uint)header.size());
+		_PutDword(&header[14], 40);
+		_PutDword(&header[18], (uint)w);
+		_PutDword(&header[22], (uint)(topdown ? -h : h));
+		_PutWord(&header[26], 1);
+		_PutWord(&header[28], (uint)bitcount);
+		_PutDword(&header[34], stride * h);
+		break;
+	case IF_TGA:
+		stride = (uint)w * bytespp;
+		header.resize(18, 0);
+		header[2] = 2; // uncompressed true color
+		_PutWord(&header[12], (uint)w);
+		_PutWord(&header[14], (uint)h);
+		header[16] = (uint8)bitcount;
+		header[17] = (uint8)((topdown ? 0x20 : 0) | (bytespp == 4 ? 8 : 0));
+		break;
+	case IF_PPM:
+	case IF_PGM: {
+		stride = (uint)w * (format == IF_PPM ? 3 : 1);
+		char buf[64];
+		int len = sprintf_s(buf, "%s\n%d %d\n255\n", format == IF_PPM ? "P6" : "P5", w, h);
+		header.assign(buf, buf + len);
+		topdown = true;
+		break;
+	}
+	default:
+		break;
+	}
+
+	FILE *file = _Open(path, _T("wb"));
+	if (file == NULL) {
+		return false;
+	}
+	bool result = fwrite(&header[0], 1, header.size(), file) == header.size();
+
+	std::vector<uint8> line(stride, 0);
+	for (int i = 0; i < h && result; ++ i) {
+		const uint8 *src = dib->getLine(topdown ? i : h - 1 - i);
+		if (format == IF_PPM) { // BGR(A) to RGB
+			uint8 *dst = &line[0];
+			for (int x = 0; x < w; ++ x) {
+				dst[0] = src[2];
+				dst[1] = src[1];
+				dst[2] = src[0];
+				dst += 3;
+				src += bytespp;
+			}
+		} else if (format == IF_PGM) { // gray, as CBitmap::gray()
+			for (int x = 0; x < w; ++ x) {
+				line[x] = (uint8)(((uint)src[0] + (uint)src[1] + (uint)src[2]) / 3);
+				src += bytespp;
+			}
+		} else {
+			memcpy(&line[0], src, (size_t)w * bytespp);
+		}
+		result = fwrite(&line[0], 1, stride, file) == stride;
+	}
+
+	fclose(file);
+	return result;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CImageReader
+
+CImageReader::CImageReader ()
+	: m_file(NULL)
+{
+	close();
+}
+
+CImageReader::~CImageReader () {
+	close();
+}
+
+/**
+ * the size from the header, checked in 64 bits before the stride is
+ * computed, as the sizes of a broken or crafted file are anything
+ */
+bool CImageReader::_SetSize (uint64 w, uint64 h, int bytespp, uint align) {
+	if (w == 0 || h == 0 || w > MAX_SIDE || h > MAX_SIDE) {
+		return false;
+	}
+	uint64 stride = (w * bytespp + align - 1) / align * align;
+	if (stride * h > MAX_BYTES || w * 4 * h > MAX_BYTES) {
+		return false;
+	}
+	m_width = (int)w;
+	m_height = (int)h;
+	m_bytespp = bytespp;
+	m_fileStride = (uint)stride;
+	return true;
+}
+
+bool CImageReader::_ReadBMPHeader () {
+	uint8 header[14 + 40];
+	if (fread(header, 1, sizeof(header), m_file) != sizeof(header)) {
+		return false;
+	}
+	const uint8 *info = header + 14;
+	uint size = _Dword(info);
+	__int64 w = (int)_Dword(info + 4);
+	__int64 h = (int)_Dword(info + 8); // negative if top down, INT_MIN too
+	uint bitcount = _Word(info + 14);
+	uint compression = _Dword(info + 16);
+	if (size < 40 || w <= 0 || h == 0 || _Word(info + 12) != 1) {
+		return false;
+	}
+	if (compression != BI_RGB || (bitcount != 24 && bitcount != 32)) {
+		return false;
+	}
+	if (!_SetSize((uint64)w, (uint64)(h > 0 ? h : -h), (int)bitcount / 8, 4)) {
+		return false;
+	}
+
+	m_format = CImageCodec::IF_BMP;
+	m_bottomUp = h > 0;
+	m_rgb = false;
+	m_dataOffset = _Dword(header + 10);
+	return true;
+}
+
+bool CImageReader::_ReadPNMHeader () {
+	char magic[2];
+	if (fread(magic, 1, 2, m_file) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6')) {
+		return false;
+	}
+	uint w, h, maxval;
+	if (!_ReadPNMNumber(m_file, w) || !_ReadPNMNumber(m_file, h) || !_ReadPNMNumber(m_file, maxval)) {
+		return false;
+	}
+	if (maxval == 0 || maxval > 255) { // 16 bits samples are not supported
+		return false;
+	}
+	bool gray = magic[1] == '5';
+	if (!_SetSize(w, h, gray ? 1 : 3, 1)) {
+		return false;
+	}
+
+	m_format = gray ? CImageCodec::IF_PGM : CImageCodec::IF_PPM;
+	m_bottomUp = false;
+	m_rgb = !gray;
+	m_dataOffset = (uint64)_ftelli64(m_file);
+	m_maxval = maxval;
+	for (uint i = 0; i < 256; ++ i) {
+		m_levels[i] = (uint8)(i >= maxval ? 255 : (i * 255 + maxval / 2) / maxval);
+	}
+	return true;
+}
+
+bool CImageReader::_ReadTGAHeader () {
+	uint8 header[18];
+	if (fread(header, 1, sizeof(header), m_file) != sizeof(header)) {
+		return false;
+	}
+	uint type = header[2];
+	uint bitcount = header[16];
+	uint descriptor = header[17];
+	uint w = _Word(header + 12);
+	uint h = _Word(header + 14);
+	if ((descriptor & 0x10) != 0) { // right to left is not supported
+		return false;
+	}
+	if (!(type == 2 && (bitcount == 24 || bitcount == 32)) && !(type == 3 && bitcount == 8)) {
+		return false;
+	}
+	if (!_SetSize(w, h, (int)bitcount / 8, 1)) {
+		return false;
+	}
+
+	// the ID and the color map (unused by a true color image) come before the pixels
+	uint64 offset = sizeof(header) + header[0];
+	if (header[1] != 0) {
+		offset += (uint64)_Word(header + 5) * ((header[7] + 7) / 8);
+	}
+
+	m_format = CImageCodec::IF_TGA;
+	m_bottomUp = (descriptor & 0x20) == 0;
+	m_rgb = false;
+	m_dataOffset = offset;
+	return true;
+}
+
+bool CImageReader::open (const tstring &path) {
+	close();
+	m_file = _Open(path, _T("rb"));
+	if (m_file == NULL) {
+		return false;
+	}
+
+	uint8 magic[2] = {0, 0};
+	bool result = false;
+	if (fread(magic, 1, 2, m_file) == 2 && _fseeki64(m_file, 0, SEEK_SET) == 0) {
+		if (magic[0] == 'B' && magic[1] == 'M') {
+			result = _ReadBMPHeader();
+		} else if (magic[0] == 'P') {
+			result = _ReadPNMHeader();
+		} else { // TGA has no magic
+			result = _ReadTGAHeader();
+		}
+	}
+
+	// all the lines must be in the file
+	__int64 fileSize = -1;
+	if (result && _fseeki64(m_file, 0, SEEK_END) == 0) {
+		fileSize = _ftelli64(m_file);
+	}
+	if (!result || fileSize < 0 || m_dataOffset + (uint64)m_fileStride * m_height > (uint64)fileSize
+	    || _fseeki64(m_file, (__int64)m_dataOffset, SEEK_SET) != 0) {
+		close();
+		return false;
+	}
+	m_buffer.resize(m_fileStride);
+	return true;
+}
+
+void CImageReader::close () {
+	if (m_file != NULL) {
+		fclose(m_file);
+		m_file = NULL;
+	}
+	m_format = CImageCodec::IF_UNKNOWN;
+	m_width = 0;
+	m_height = 0;
+	m_bytespp = 0;
+	m_bottomUp = false;
+	m_rgb = false;
+	m_fileStride = 0;
+	m_dataOffset = 0;
+	m_maxval = 255;
+	m_read = 0;
+	m_buffer.clear();
+}
+
+bool CImageReader::isOpen () const {
+	return m_file != NULL;
+}
+
+CImageCodec::FORMAT CImageReader::getFormat () const {
+	return m_format;
+}
+
+int CImageReader::getWidth () const {
+	return m_width;
+}
+
+int CImageReader::getHeight () const {
+	return m_height;
+}
+
+int CImageReader::getBitCounts () const {
+	return m_bytespp == 4 ? 32 : 24;
+}
+
+bool CImageReader::isBottomUp () const {
+	return m_bottomUp;
+}
+
+int CImageReader::getNextLine () const {
+	if (m_file == NULL || m_read >= m_height) {
+		return -1;
+	}
+	return m_bottomUp ? m_height - 1 - m_read : m_read;
+}
+
+bool CImageReader::readLine (uint8 *dst) {
+	assert(dst != NULL);
+	if (getNextLine() < 0) {
+		return false;
+	}
+	if (fread(&m_buffer[0], 1, m_fileStride, m_file) != m_fileStride) {
+		return false;
+	}
+	++ m_read;
+
+	if (m_maxval != 255) {
+		for (uint i = 0; i < m_fileStride; ++ i) {
+			m_buffer[i] = m_levels[m_buffer[i]];
+		}
+	}
+
+	const uint8 *src = &m_buffer[0];
+	int w = m_width;
+	if (m_bytespp == 1) {
+		for (int x = 0; x < w; ++ x) {
+			dst[0] = dst[1] = dst[2] = src[x];
+			dst += 3;
+		}
+	} else if (m_rgb) {
+		for (int x = 0; x < w; ++ x) {
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst += 3;
+			src += 3;
+		}
+	} else {
+		memcpy(dst, src, (size_t)w * m_bytespp);
+	}
+	return true;
+}
+
+bool CImageReader::readAll (CDIBSection *dib, ILongTimeRunCallback *pCallback) {
+	assert(dib != NULL);
+	assert(dib->getWidth() == m_width && dib->getHeight() == m_height);
+	assert(dib->getBitCounts() == getBitCounts());
+	if (dib->getWidth() != m_width || dib->getHeight() != m_height || dib->getBitCounts() != getBitCounts()) {
+		return false;
+	}
+
+	bool filemap = dib->isFileMapped();
+	int dropped = m_read; // the lines read before are not ours to drop
+	int y;
+	while ((y = getNextLine()) >= 0) {
+		if (m_read % 32 == 0 && pCallback && pCallback->shouldStop()) {
+			return false;
+		}
+		if (!readLine(dib->getLine(y))) {
+			return false;
+		}
+
+		// keep the working set small, the lines go to the file
+		if (filemap && m_read - dropped >= DROP_LINES) {
+			int first = m_bottomUp ? m_height - m_read : dropped;
+			dib->advise(first, m_read - dropped, CFileMapping::ADV_DONTNEED);
+			dropped = m_read;
+		}
+	}
+	return m_read == m_height;
+}
+
+UI_END
+XL_END
@@ -0,0 +1,495 @@
+#include <assert.h>
+#include <math.h>
+#include "../../include/ThreadPool.h"
+#include "../../include/ui/ImagePipeline.h"
+#include "../../include/ui/DIBConverter.h"
+#include "../../include/ui/DIBPool.h"
+#include "../../include/ui/DIBRotator.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+template <class T> T MIN(T a, T b) {
+	return (a < b) ? a: b;
+}
+template <class T> T MAX(T a, T b) {
+	return (a > b) ? a: b;
+}
+
+CDIBSectionPtr _Lease (int w, int h, int bitcount) {
+	return CDIBPool::getInstance()->lease(w, h, bitcount);
+}
+
+/**
+ * the tiles of the output, a band is a tile
+ */
+class CRenderTask : public IBandExecutable
+{
+	CImageNode              *m_node;
+	CDIBSection             *m_dst;
+	ILongTimeRunCallback    *m_pCallback;
+	int                      m_tile;
+	int                      m_columns;
+
+public:
+	CRenderTask (CImageNode *node, CDIBSection *dst, ILongTimeRunCallback *pCallback, int tile)
+		: m_node(node), m_dst(dst), m_pCallback(pCallback), m_tile(tile)
+	{
+		m_columns = (dst->getWidth() + tile - 1) / tile;
+	}
+
+	uint getBands () const {
+		return (uint)(m_columns * ((m_dst->getHeight() + m_tile - 1) / m_tile));
+	}
+
+	virtual bool operator() (uint band) {
+		if (m_pCallback && m_pCallback->shouldStop()) {
+			return false;
+		}
+		int x = (int)band % m_columns * m_tile;
+		int y = (int)band / m_columns * m_tile;
+		int w = MIN(m_tile, m_dst->getWidth() - x);
+		int h = MIN(m_tile, m_dst->getHeight() - y);
+		CDIBSectionPtr view = m_dst->createView(x, y, w, h);
+		return m_node->generate(x, y, view.get());
+	}
+};
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CImageNode
+
+CImageNode::CImageNode (CImageNodePtr input, int w, int h, int bitcount)
+	: m_input(input)
+	, m_width(w)
+	, m_height(h)
+	, m_bitcount(bitcount)
+{
+	assert(w > 0 && h > 0);
+	assert(bitcount == 24 || bitcount == 32);
+}
+
+CImageNode::~CImageNode () {
+}
+
+int CImageNode::getWidth () const {
+	return m_width;
+}
+
+int CImageNode::getHeight () const {
+	return m_height;
+}
+
+int CImageNode::getBitCounts () const {
+	return m_bitcount;
+}
+
+CImageNodePtr CImageNode::getInput () const {
+	return m_input;
+}
+
+CDIBSectionPtr CImageNode::region (int x, int y, int w, int h) {
+	assert(x >= 0 && y >= 0 && x + w <= m_width && y + h <= m_height);
+	CDIBSectionPtr dib = _Lease(w, h, m_bitcount);
+	if (dib && !generate(x, y, dib.get())) {
+		dib.reset();
+	}
+	return dib;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CSourceNode
+
+CSourceNode::CSourceNode (const CDIBSection *dib)
+	: CImageNode(CImageNodePtr(), dib->getWidth(), dib->getHeight(), dib->getBitCounts())
+	, m_dib(dib->clone())
+{
+}
+
+bool CSourceNode::generate (int x, int y, CDIBSection *dst) {
+	assert(dst->getBitCounts() == m_bitcount);
+	int w = dst->getWidth(), h = dst->getHeight();
+	assert(x >= 0 && y >= 0 && x + w <= m_width && y + h <= m_height);
+	uint offset = x * (m_bitcount / 8);
+	uint len = w * (m_bitcount / 8);
+	const CDIBSection *src = m_dib.get();
+	for (int i = 0; i < h; ++ i) {
+		memcpy(dst->getLine(i), src->getLine(y + i) + offset, len);
+	}
+	return true;
+}
+
+CDIBSectionPtr CSourceNode::region (int x, int y, int w, int h) {
+	return m_dib->createView(x, y, w, h);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CCropNode
+
+CCropNode::CCropNode (CImageNodePtr input, int x, int y, int w, int h)
+	: CImageNode(input, w, h, input->getBitCounts())
+	, m_x(x)
+	, m_y(y)
+{
+	assert(x >= 0 && y >= 0);
+	assert(x + w <= input->getWidth() && y + h <= input->getHeight());
+}
+
+bool CCropNode::generate (int x, int y, CDIBSection *dst) {
+	return m_input->generate(m_x + x, m_y + y, dst);
+}
+
+CDIBSectionPtr CCropNode::region (int x, int y, int w, int h) {
+	return m_input->region(m_x + x, m_y + y, w, h);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CRotateNode
+
+CRotateNode::CRotateNode (CImageNodePtr input, CDIBSection::ORIENTATION ot)
+	: CImageNode(input,
+		CRotateEngine::isTransposed(ot) ? input->getHeight() : input->getWidth(),
+		CRotateEngine::isTransposed(ot) ? input->getWidth() : input->getHeight(),
+		input->getBitCounts())
+	, m_ot(ot)
+{
+}
+
+bool CRotateNode::generate (int x, int y, CDIBSection *dst) {
+	int w = dst->getWidth(), h = dst->getHeight();
+	bool transposed = CRotateEngine::isTransposed(m_ot);
+	bool rx = CRotateEngine::isReversedX(m_ot);
+	bool ry = CRotateEngine::isReversedY(m_ot);
+
+	// the region of the input, see CRotateEngine::rotate() for the mapping
+	int src_w = m_input->getWidth(), src_h = m_input->getHeight();
+	int sx = transposed ? y : x;
+	int sy = transposed ? x : y;
+	int sw = transposed ? h : w;
+	int sh = transposed ? w : h;
+	if (rx) {
+		sx = src_w - sx - sw;
+	}
+	if (ry) {
+		sy = src_h - sy - sh;
+	}
+
+	CDIBSectionPtr src = m_input->region(sx, sy, sw, sh);
+	return src && CRotateEngine::rotate(src.get(), dst, m_ot);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CResizeNode
+
+CResizeNode::CResizeNode (CImageNodePtr input, int w, int h, CDIBSection::RESIZE_TYPE rt)
+	: CImageNode(input, w, h, input->getBitCounts())
+	, m_pFilter(CResizeEngine::createFilter(rt))
+{
+	if (m_pFilter.get() != NULL) {
+		if (w != input->getWidth()) {
+			m_pTableX.reset(new CWeightsTable(m_pFilter.get(), w, input->getWidth()));
+		}
+		if (h != input->getHeight()) {
+			m_pTableY.reset(new CWeightsTable(m_pFilter.get(), h, input->getHeight()));
+		}
+	}
+}
+
+void CResizeNode::_Range (const CWeightsTable &table, int pos, int len, int &first, int &count) {
+	int left = table.getLeftBoundary(pos);
+	int right = table.getRightBoundary(pos);
+	for (int i = pos + 1; i < pos + len; ++ i) {
+		left = MIN(left, table.getLeftBoundary(i));
+		right = MAX(right, table.getRightBoundary(i));
+	}
+	first = left;
+	count = right - left + 1;
+}
+
+bool CResizeNode::generate (int x, int y, CDIBSection *dst) {
+	int w = dst->getWidth(), h = dst->getHeight();
+	int src_w = m_input->getWidth(), src_h = m_input->getHeight();
+
+	if (m_pFilter.get() == NULL) { // fast, the nearest pixels
+		double ratio_w = (double)src_w / (double)m_width;
+		double ratio_h = (double)src_h / (double)m_height;
+		int sx = MIN((int)(x * ratio_w + 0.5), src_w - 1);
+		int sy = MIN((int)(y * ratio_h + 0.5), src_h - 1);
+		int sw = MIN((int)((x + w - 1) * ratio_w + 0.5), src_w - 1) - sx + 1;
+		int sh = MIN((int)((y + h - 1) * ratio_h + 0.5), src_h - 1) - sy + 1;
+		CDIBSectionPtr src = m_input->region(sx, sy, sw, sh);
+		if (!src) {
+			return false;
+		}
+
+		uint bytespp = m_bitcount / 8;
+		for (int i = 0; i < h; ++ i) {
+			int line = MIN((int)((y + i) * ratio_h + 0.5), src_h - 1) - sy;
+			const uint8 *src_line = static_cast<const CDIBSection *>(src.get())->getLine(line);
+			uint8 *dst_data = dst->getLine(i);
+			for (int j = 0; j < w; ++ j) {
+				int column = MIN((int)((x + j) * ratio_w + 0.5), src_w - 1) - sx;
+				const uint8 *src_data = src_line + column * bytespp;
+				for (uint k = 0; k < bytespp; ++ k) {
+					*dst_data ++ = *src_data ++;
+				}
+			}
+		}
+		return true;
+	}
+
+	int sx = x, sw = w, sy = y, sh = h;
+	if (m_pTableX.get() != NULL) {
+		_Range(*m_pTableX, x, w, sx, sw);
+	}
+	if (m_pTableY.get() != NULL) {
+		_Range(*m_pTableY, y, h, sy, sh);
+	}
+	CDIBSectionPtr src = m_input->region(sx, sy, sw, sh);
+	if (!src) {
+		return false;
+	}
+
+	if (m_pTableY.get() == NULL) {
+		if (m_pTableX.get() == NULL) { // nothing to scale
+			return CConvertEngine::convert(src.get(), dst);
+		}
+		CResizeEngine::horizontalRegion(src.get(), sx, dst, x, *m_pTableX);
+		return true;
+	}
+
+	CDIBSectionPtr tmp = src;
+	if (m_pTableX.get() != NULL) {
+		tmp = _Lease(w, sh, m_bitcount);
+		if (!tmp) {
+			return false;
+		}
+		CResizeEngine::horizontalRegion(src.get(), sx, tmp.get(), x, *m_pTableX);
+	}
+	CResizeEngine::verticalRegion(tmp.get(), sy, dst, y, *m_pTableY);
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CSharpenNode
+
+CSharpenNode::CSharpenNode (CImageNodePtr input, double amount)
+	: CImageNode(input, input->getWidth(), input->getHeight(), input->getBitCounts())
+	, m_amount((int)(amount * 256 + 0.5))
+{
+	assert(amount >= 0);
+}
+
+bool CSharpenNode::generate (int x, int y, CDIBSection *dst) {
+	int w = dst->getWidth(), h = dst->getHeight();
+
+	// one more pixel around, except at the borders of the image
+	int sx = MAX(x - 1, 0), sy = MAX(y - 1, 0);
+	int sw = MIN(x + w + 1, m_width) - sx;
+	int sh = MIN(y + h + 1, m_height) - sy;
+	CDIBSectionPtr src = m_input->region(sx, sy, sw, sh);
+	if (!src) {
+		return false;
+	}
+	const CDIBSection *s = src.get();
+
+	int bytespp = m_bitcount / 8;
+	for (int i = 0; i < h; ++ i) {
+		int line = y + i - sy;
+		const uint8 *above = s->getLine(MAX(line - 1, 0));
+		const uint8 *center = s->getLine(line);
+		const uint8 *below = s->getLine(MIN(line + 1, sh - 1));
+		uint8 *d = dst->getLine(i);
+		for (int j = 0; j < w; ++ j) {
+			int column = x + j - sx;
+			int left = MAX(column - 1, 0) * bytespp;
+			int right = MIN(column + 1, sw - 1) * bytespp;
+			int middle = column * bytespp;
+			for (int k = 0; k < 3; ++ k) {
+				int sum = above[left + k] + above[middle + k] + above[right + k]
+				        + center[left + k] + center[middle + k] + center[right + k]
+				        + below[left + k] + below[middle + k] + below[right + k];
+				int c = center[middle + k];
+				int v = c + m_amount * (9 * c - sum) / (9 * 256);
+				d[k] = (uint8)MIN(MAX(v, 0), 255);
+			}
+			if (bytespp == 4) {
+				d[3] = center[middle + 3];
+			}
+			d += bytespp;
+		}
+	}
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CColorNode
+
+CColorNode::CColorNode (CImageNodePtr input, bool gray, int brightness, double contrast, double gamma)
+	: CImageNode(input, input->getWidth(), input->getHeight(), input->getBitCounts())
+	, m_gray(gray)
+{
+	assert(contrast >= 0 && gamma > 0);
+	for (int i = 0; i < 256; ++ i) {
+		double v = (i - 128) * contrast + 128 + brightness;
+		v = MIN(MAX(v, 0.0), 255.0);
+		if (gamma != 1) {
+			v = 255 * pow(v / 255, 1 / gamma);
+		}
+		m_table[i] = (uint8)MIN(MAX((int)(v + 0.5), 0), 255);
+	}
+}
+
+bool CColorNode::generate (int x, int y, CDIBSection *dst) {
+	// in place, no tile of its own
+	if (!m_input->generate(x, y, dst)) {
+		return false;
+	}
+
+	int w = dst->getWidth(), h = dst->getHeight();
+	int bytespp = m_bitcount / 8;
+	for (int i = 0; i < h; ++ i) {
+		uint8 *d = dst->getLine(i);
+		for (int j = 0; j < w; ++ j) {
+			if (m_gray) {
+				uint v = ((uint)d[0] + (uint)d[1] + (uint)d[2]) / 3;
+				d[0] = d[1] = d[2] = m_table[v];
+			} else {
+				d[0] = m_table[d[0]];
+				d[1] = m_table[d[1]];
+				d[2] = m_table[d[2]];
+			}
+			d += bytespp;
+		}
+	}
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CConvertNode
+
+CConvertNode::CConvertNode (CImageNodePtr input, int bitcount)
+	: CImageNode(input, input->getWidth(), input->getHeight(), bitcount)
+{
+}
+
+bool CConvertNode::generate (int x, int y, CDIBSection *dst) {
+	if (m_bitcount == m_input->getBitCounts()) {
+		return m_input->generate(x, y, dst);
+	}
+	CDIBSectionPtr src = m_input->region(x, y, dst->getWidth(), dst->getHeight());
+	return src && CConvertEngine::convert(src.get(), dst);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CImagePipeline
+
+CImagePipeline::CImagePipeline (const CDIBSection *src)
+	: m_node(new CSourceNode(src))
+{
+}
+
+CImagePipeline::CImagePipeline (CImageNodePtr node)
+	: m_node(node)
+{
+	assert(node);
+}
+
+CImagePipeline& CImagePipeline::then (CImageNodePtr node) {
+	assert(node && node->getInput() == m_node);
+	m_node = node;
+	return *this;
+}
+
+CImagePipeline& CImagePipeline::crop (int x, int y, int w, int h) {
+	return then(CImageNodePtr(new CCropNode(m_node, x, y, w, h)));
+}
+
+CImagePipeline& CImagePipeline::rotate (CDIBSection::ORIENTATION ot) {
+	if (ot == CDIBSection::OT_NORMAL) {
+		return *this;
+	}
+	return then(CImageNodePtr(new CRotateNode(m_node, ot)));
+}
+
+CImagePipeline& CImagePipeline::resize (int w, int h, CDIBSection::RESIZE_TYPE rt) {
+	if (w == getWidth() && h == getHeight()) {
+		return *this;
+	}
+	return then(CImageNodePtr(new CResizeNode(m_node, w, h, rt)));
+}
+
+CImagePipeline& CImagePipeline::sharpen (double amount) {
+	return then(CImageNodePtr(new CSharpenNode(m_node, amount)));
+}
+
+CImagePipeline& CImagePipeline::color (int brightness, double contrast, double gamma) {
+	return then(CImageNodePtr(new CColorNode(m_node, false, brightness, contrast, gamma)));
+}
+
+CImagePipeline& CImagePipeline::gray () {
+	return then(CImageNodePtr(new CColorNode(m_node, true)));
+}
+
+CImagePipeline& CImagePipeline::convert (int bitcount) {
+	if (bitcount == getBitCounts()) {
+		return *this;
+	}
+	return then(CImageNodePtr(new CConvertNode(m_node, bitcount)));
+}
+
+CImageNodePtr CImagePipeline::getNode () const {
+	return m_node;
+}
+
+int CImagePipeline::getWidth () const {
+	return m_node->getWidth();
+}
+
+int CImagePipeline::getHeight () const {
+	return m_node->getHeight();
+}
+
+int CImagePipeline::getBitCounts () const {
+	return m_node->getBitCounts();
+}
+
+bool CImagePipeline::render (CDIBSection *dst, ILongTimeRunCallback *pCallback, int tile) const {
+	assert(dst != NULL && tile > 0);
+	assert(dst->getWidth() == getWidth() && dst->getHeight() == getHeight());
+	assert(dst->getBitCounts() == getBitCounts());
+	if (dst->getWidth() != getWidth() || dst->getHeight() != getHeight() || dst->getBitCounts() != getBitCounts()) {
+		return false;
+	}
+
+	// the tiles write through views, so dst must not be shared by a clone
+	if (dst->getData() == NULL) {
+		return false;
+	}
+	GdiFlush();
+	CRenderTask task(m_node.get(), dst, pCallback, tile);
+	return parallel_for(task.getBands(), &task);
+}
+
+CDIBSectionPtr CImagePipeline::render (bool usefilemap, ILongTimeRunCallback *pCallback) const {
+	CDIBSectionPtr dib = CDIBSection::createDIBSection(getWidth(), getHeight(), getBitCounts(), usefilemap);
+	if (dib && !render(dib.get(), pCallback)) {
+		dib.reset();
+	}
+	return dib;
+}
+
+UI_END
+XL_END
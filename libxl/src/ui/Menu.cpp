@@ -233,11 +233,11 @@ void CMenuCustomizer::drawItem (HDC hdc, CRect rc, CMenuItem &item, bool hover)
 
 		if (item.getImageId() != 0) {
 			CResMgr *pResMgr = CResMgr::getInstance();
-			CBitmapPtr img = pResMgr->getTransBitmap(item.getImageId(), item.getColorKey(), item.disable());
+			CSpritePtr img = pResMgr->getTransSprite(item.getImageId(), item.getColorKey(), item.disable());
 			assert(img != NULL);
 			int x = rc.left + IMAGE_PADDING;
 			int y = rc.top + IMAGE_PADDING;
-			img->draw(hdc, x, y, IMAGE_WIDTH, IMAGE_HEIGHT, 0, 0);
+			img->draw(hdc, x, y, min(img->getWidth(), (int)IMAGE_WIDTH), min(img->getHeight(), (int)IMAGE_HEIGHT), 0, 0);
 		}
 	}
 }
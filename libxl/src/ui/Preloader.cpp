@@ -0,0 +1,390 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "../../include/ini.h"
+#include "../../include/fs.h"
+#include "../../include/Language.h"
+#include "../../include/ThreadPool.h"
+#include "../../include/utilities.h"
+#include "../../include/ui/ResMgr.h"
+#include "../../include/ui/Preloader.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+
+const tchar *s_sections[] = {_T("fonts"), _T("icons"), _T("bitmaps"), _T("sprites"), _T("language")};
+const tchar *s_kinds[] = {_T("font"), _T("icon"), _T("bitmap"), _T("sprite"), _T("language")};
+
+bool _ParseInt (const tstring &s, int base, long &value) {
+	tchar *end = NULL;
+	value = _tcstol(s.c_str(), &end, base);
+	return s.length() > 0 && end != NULL && *end == _T('\0');
+}
+
+/**
+ * "48x48"
+ */
+bool _ParseSize (const tstring &s, int &width, int &height) {
+	size_t x = s.find(_T('x'));
+	long w = 0, h = 0;
+	if (x == tstring::npos || !_ParseInt(s.substr(0, x), 10, w) || !_ParseInt(s.substr(x + 1), 10, h)) {
+		return false;
+	}
+	if (w <= 0 || w > 0xffff || h <= 0 || h > 0xffff) {
+		return false;
+	}
+	width = (int)w;
+	height = (int)h;
+	return true;
+}
+
+double _Ms (const LARGE_INTEGER &begin, const LARGE_INTEGER &end) {
+	LARGE_INTEGER freq;
+	::QueryPerformanceFrequency(&freq);
+	return (double)(end.QuadPart - begin.QuadPart) * 1000.0 / (double)freq.QuadPart;
+}
+
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPreloadManifest
+
+CPreloadManifest::ITEM CPreloadManifest::_Item (KIND kind, const tstring &name) {
+	ITEM item;
+	item.kind = kind;
+	item.name = name;
+	item.id = 0;
+	item.width = 0;
+	item.height = 0;
+	item.style = 0;
+	item.grayscale = false;
+	item.transparent = false;
+	item.colorKey = 0;
+	return item;
+}
+
+bool CPreloadManifest::_Parse (KIND kind, const tstring &name, const tstring &value) {
+	ExplodeT<tchar>::ValueT tokens = explode(_T(","), value);
+	for (ExplodeT<tchar>::ValueT::iterator it = tokens.begin(); it != tokens.end(); ++ it) {
+		it->trim(_T(" \t"));
+	}
+	ITEM item = _Item(kind, name);
+	long number = 0;
+
+	if (kind == PK_LANGUAGE) {
+		m_items.push_back(item);
+		return true;
+	}
+
+	// the first one is the id, or the height of the font
+	if (tokens.empty() || !_ParseInt(tokens[0], 10, number)) {
+		return false;
+	}
+	if (kind == PK_FONT) {
+		item.height = (int)number;
+	} else {
+		if (number <= 0 || number > 0xffff) {
+			return false;
+		}
+		item.id = (ushort)number;
+	}
+
+	for (size_t i = 1; i < tokens.size(); ++ i) {
+		const tstring &token = tokens[i];
+		if (kind == PK_FONT) {
+			if (token == _T("bold")) {
+				item.style |= CResMgr::FS_BOLD;
+			} else if (token == _T("italic")) {
+				item.style |= CResMgr::FS_ITALIC;
+			} else if (token == _T("underline")) {
+				item.style |= CResMgr::FS_UNDERLINE;
+			} else if (token == _T("strikeout")) {
+				item.style |= CResMgr::FS_STRIKEOUT;
+			} else {
+				return false;
+			}
+		} else if (kind == PK_ICON) {
+			return false;
+		} else if (token == _T("gray")) {
+			item.grayscale = true;
+		} else if (kind == PK_BITMAP) {
+			if (!_ParseSize(token, item.width, item.height)) {
+				return false;
+			}
+		} else if (token.length() == 6 && _ParseInt(token, 16, number)) { // rrggbb
+			item.transparent = true;
+			item.colorKey = RGB((number >> 16) & 0xff, (number >> 8) & 0xff, number & 0xff);
+		} else {
+			return false;
+		}
+	}
+
+	m_items.push_back(item);
+	return true;
+}
+
+void CPreloadManifest::addFont (const tstring &name, int height, uint style) {
+	assert(style == (style & CResMgr::FS_MASK));
+	ITEM item = _Item(PK_FONT, name);
+	item.height = height;
+	item.style = style;
+	m_items.push_back(item);
+}
+
+void CPreloadManifest::addIcon (const tstring &name, ushort id) {
+	ITEM item = _Item(PK_ICON, name);
+	item.id = id;
+	m_items.push_back(item);
+}
+
+void CPreloadManifest::addBitmap (const tstring &name, ushort id, bool grayscale, int width, int height) {
+	assert((width == 0) == (height == 0));
+	ITEM item = _Item(PK_BITMAP, name);
+	item.id = id;
+	item.grayscale = grayscale;
+	item.width = width;
+	item.height = height;
+	m_items.push_back(item);
+}
+
+void CPreloadManifest::addSprite (const tstring &name, ushort id, bool grayscale, bool transparent, COLORREF colorKey) {
+	ITEM item = _Item(PK_SPRITE, name);
+	item.id = id;
+	item.grayscale = grayscale;
+	item.transparent = transparent;
+	item.colorKey = colorKey;
+	m_items.push_back(item);
+}
+
+void CPreloadManifest::addLanguage (const tstring &name) {
+	m_items.push_back(_Item(PK_LANGUAGE, name));
+}
+
+bool CPreloadManifest::load (const tstring &path) {
+	if (!file_exists(path)) {
+		return false;
+	}
+
+	CIni ini(path);
+	bool result = true;
+	for (int kind = 0; kind < PK_COUNT; ++ kind) {
+		tstring section = s_sections[kind];
+		for (CIni::Iterator it = ini.begin(section); it != ini.end(section); ++ it) {
+			// CIni keeps the blanks around '=' and the comments after the values
+			tstring name = it->first;
+			tstring value = it->second.substr(0, it->second.find(_T(';')));
+			name.trim(_T(" \t"));
+			value.trim(_T(" \t"));
+			if (!_Parse((KIND)kind, name, value)) {
+				result = false;
+			}
+		}
+	}
+	return result;
+}
+
+void CPreloadManifest::clear () {
+	m_items.clear();
+}
+
+size_t CPreloadManifest::getCount () const {
+	return m_items.size();
+}
+
+const CPreloadManifest::ITEM& CPreloadManifest::getItem (size_t index) const {
+	assert(index < m_items.size());
+	return m_items[index];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPreloader::CJob
+
+CPreloader::CJob::CJob (CPreloader *pPreloader, const CPreloadManifest::ITEM &item, TIMING *pTiming)
+	: m_pPreloader(pPreloader)
+	, m_item(item)
+	, m_pTiming(pTiming)
+{
+}
+
+bool CPreloader::CJob::operator() () {
+	LARGE_INTEGER begin, end;
+	::QueryPerformanceCounter(&begin);
+	bool loaded = CPreloader::_Load(m_item);
+	::QueryPerformanceCounter(&end);
+	m_pTiming->loaded = loaded;
+	m_pTiming->thread = ::GetCurrentThreadId();
+	m_pTiming->ms = _Ms(begin, end);
+
+	// the preloader may delete this job from now on
+	m_pPreloader->_Done();
+	return loaded;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPreloader
+
+bool CPreloader::_Load (const CPreloadManifest::ITEM &item) {
+	CResMgr *pResMgr = CResMgr::getInstance();
+	switch (item.kind) {
+	case CPreloadManifest::PK_FONT:
+		return pResMgr->getSysFont(item.height, item.style) != NULL;
+	case CPreloadManifest::PK_ICON:
+		return pResMgr->getIcon(item.id) != NULL;
+	case CPreloadManifest::PK_BITMAP:
+		if (item.width > 0 && item.height > 0) {
+			return pResMgr->getBitmap(item.id, item.width, item.height, CDIBSection::RT_BICUBIC, item.grayscale) != NULL;
+		}
+		return pResMgr->getBitmap(item.id, item.grayscale) != NULL;
+	case CPreloadManifest::PK_SPRITE:
+		if (item.transparent) {
+			return pResMgr->getTransSprite(item.id, item.colorKey, item.grayscale) != NULL;
+		}
+		return pResMgr->getSprite(item.id, item.grayscale) != NULL;
+	case CPreloadManifest::PK_LANGUAGE:
+		return CLanguage::getInstance()->preload();
+	default:
+		assert(false);
+		return false;
+	}
+}
+
+void CPreloader::_Done () {
+	if (::InterlockedDecrement(&m_pending) == 0) {
+		LARGE_INTEGER end;
+		::QueryPerformanceCounter(&end);
+		m_elapsed = _Ms(m_start, end);
+		// the last one, no job runs any more (the one calling returns at once)
+		_FreeJobs();
+		::SetEvent(m_done);
+	}
+}
+
+void CPreloader::_FreeJobs () {
+	for (_JobContainer::iterator it = m_jobs.begin(); it != m_jobs.end(); ++ it) {
+		delete *it;
+	}
+	m_jobs.clear();
+}
+
+bool CPreloader::_Hold () {
+	LONG pending = m_pending;
+	while (pending != 0) {
+		LONG previous = ::InterlockedCompareExchange(&m_pending, pending + 1, pending);
+		if (previous == pending) {
+			return true;
+		}
+		pending = previous;
+	}
+	return false;
+}
+
+void CPreloader::_Stop () {
+	// one more pending, so the last job does not free the jobs while they are
+	// canceled here; if none is pending, they are freed (or being freed)
+	if (_Hold()) {
+		CThreadPool *pool = CThreadPool::getInstance();
+		for (_JobContainer::iterator it = m_jobs.begin(); it != m_jobs.end(); ++ it) {
+			if (pool->cancel(*it)) {
+				_Done();
+			}
+		}
+		_Done();
+	}
+	::WaitForSingleObject(m_done, INFINITE);
+	assert(m_jobs.empty());
+}
+
+CPreloader::CPreloader ()
+	: m_pending(0)
+	, m_elapsed(0)
+{
+	m_done = ::CreateEvent(NULL, TRUE, TRUE, NULL);
+	assert(m_done != NULL);
+	m_start.QuadPart = 0;
+}
+
+CPreloader::~CPreloader () {
+	// once done there is nothing to cancel, and at exit the thread pool may be
+	// destroyed already
+	if (!isDone()) {
+		_Stop();
+	}
+	::CloseHandle(m_done);
+}
+
+bool CPreloader::start (const CPreloadManifest &manifest) {
+	if (!isDone()) {
+		return false;
+	}
+	assert(m_jobs.empty());
+
+	size_t count = manifest.getCount();
+	m_timings.clear();
+	m_timings.resize(count);
+	m_elapsed = 0;
+	for (size_t i = 0; i < count; ++ i) {
+		const CPreloadManifest::ITEM &item = manifest.getItem(i);
+		m_timings[i].kind = item.kind;
+		m_timings[i].name = item.name;
+		m_timings[i].loaded = false;
+		m_timings[i].thread = 0;
+		m_timings[i].ms = 0;
+	}
+	if (count == 0) {
+		return true;
+	}
+
+	// the singletons the jobs use are constructed here first, not by several
+	// threads at once
+	CResMgr::getInstance();
+	CLanguage::getInstance();
+
+	// the jobs are all made before any is posted, m_timings does not move any more
+	for (size_t i = 0; i < count; ++ i) {
+		m_jobs.push_back(new CJob(this, manifest.getItem(i), &m_timings[i]));
+	}
+	m_pending = (LONG)count;
+	::ResetEvent(m_done);
+	::QueryPerformanceCounter(&m_start);
+
+	CThreadPool *pool = CThreadPool::getInstance();
+	for (_JobContainer::iterator it = m_jobs.begin(); it != m_jobs.end(); ++ it) {
+		pool->post(*it);
+	}
+	return true;
+}
+
+bool CPreloader::wait (uint timeout) {
+	return ::WaitForSingleObject(m_done, timeout) == WAIT_OBJECT_0;
+}
+
+bool CPreloader::isDone () const {
+	return ::WaitForSingleObject(m_done, 0) == WAIT_OBJECT_0;
+}
+
+const std::vector<CPreloader::TIMING>& CPreloader::getTimings () const {
+	assert(isDone());
+	return m_timings;
+}
+
+double CPreloader::getElapsed () const {
+	return m_elapsed;
+}
+
+void CPreloader::report () const {
+	assert(isDone());
+	double sum = 0;
+	for (_TimingContainer::const_iterator it = m_timings.begin(); it != m_timings.end(); ++ it) {
+		trace(_T("preload %s %s: %.2fms on thread %u%s\n"), s_kinds[it->kind], it->name.c_str(), it->ms,
+			it->thread, it->loaded ? _T("") : _T(", failed"));
+		sum += it->ms;
+	}
+	trace(_T("preload %u items: %.2fms, %.2fms of work\n"), (uint)m_timings.size(), m_elapsed, sum);
+}
+
+UI_END
+XL_END
@@ -0,0 +1,425 @@
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "../../include/utilities.h"
+#include "../../include/ui/RenditionCache.h"
+
+XL_BEGIN
+UI_BEGIN
+
+namespace {
+	const uint MAGIC = 0x43524c58; // XLRC
+	const uint VERSION = 1;
+	const uint64 ALIGN = 16;      // of the pixels of an entry
+	const uint64 FNV_OFFSET = 14695981039346656037ULL;
+	const uint64 FNV_PRIME = 1099511628211ULL;
+
+	struct EXTENT {
+		uint64   offset;
+		uint64   bytes;
+
+		bool operator < (const EXTENT &rhs) const {
+			return offset < rhs.offset;
+		}
+	};
+
+	uint64 _Mix (uint64 h, uint64 v) {
+		h = (h ^ v) * FNV_PRIME;
+		return h ^ (h >> 29);
+	}
+
+	/**
+	 * the mutex of a file, case insensitive
+	 */
+	tstring _MutexName (const tstring &path) {
+		uint64 h = FNV_OFFSET;
+		for (tstring::const_iterator it = path.begin(); it != path.end(); ++ it) {
+			tchar c = *it;
+			if (c >= _T('A') && c <= _T('Z')) {
+				c = c - _T('A') + _T('a');
+			} else if (c == _T('/')) {
+				c = _T('\\');
+			}
+			h = (h ^ (uint64)c) * FNV_PRIME;
+		}
+		tchar name[64];
+		_stprintf_s(name, 64, _T("Local\\xl.renditions.%08x%08x"), (uint)(h >> 32), (uint)h);
+		return name;
+	}
+}
+
+struct CRenditionCache::HEADER {
+	uint     magic;
+	uint     version;
+	uint     entries;
+	uint     reserved;
+	uint64   dataOffset;   // from the beginning of the file
+	uint64   dataSize;
+	uint64   clock;        // ticks on every use, for the LRU order
+};
+
+struct CRenditionCache::ENTRY {
+	uint64   hash;
+	int      width;
+	int      height;
+	int      rt;
+	int      bitcount;
+	uint64   offset;       // in the data area
+	uint64   bytes;
+	uint64   lastUse;
+	uint     used;
+	uint     reserved;
+
+	bool matches (const KEY &key) const {
+		return used && hash == key.hash && width == key.width && height == key.height
+			&& rt == key.rt && bitcount == key.bitcount;
+	}
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+// protected methods
+
+bool CRenditionCache::_Lock () const {
+	DWORD result = ::WaitForSingleObject(m_mutex, INFINITE);
+	// abandoned by a dead process, the entries it did not finish are not marked used
+	return result == WAIT_OBJECT_0 || result == WAIT_ABANDONED;
+}
+
+void CRenditionCache::_Unlock () const {
+	::ReleaseMutex(m_mutex);
+}
+
+CRenditionCache::HEADER* CRenditionCache::_Header () const {
+	return (HEADER *)m_view;
+}
+
+CRenditionCache::ENTRY* CRenditionCache::_Entries () const {
+	return (ENTRY *)(m_view + sizeof(HEADER));
+}
+
+uint8* CRenditionCache::_Data () const {
+	return m_view + _Header()->dataOffset;
+}
+
+bool CRenditionCache::_IsValid (const ENTRY *entry) const {
+	uint64 dataSize = _Header()->dataSize;
+	if (!entry->used || entry->width <= 0 || entry->height <= 0
+	    || (entry->bitcount != 24 && entry->bitcount != 32)) {
+		return false;
+	}
+	uint64 line = (uint64)entry->width * (entry->bitcount / 8);
+	return entry->bytes % line == 0 && entry->bytes / line == (uint64)entry->height
+		&& entry->offset <= dataSize && entry->bytes <= dataSize - entry->offset;
+}
+
+CRenditionCache::ENTRY* CRenditionCache::_Find (const KEY &key) const {
+	// a few thousand entries, a scan costs less than reading one rendition
+	ENTRY *entries = _Entries();
+	uint count = _Header()->entries;
+	for (uint i = 0; i < count; ++ i) {
+		if (entries[i].matches(key)) {
+			return &entries[i];
+		}
+	}
+	return NULL;
+}
+
+int64 CRenditionCache::_Allocate (uint64 bytes) {
+	HEADER *header = _Header();
+	ENTRY *entries = _Entries();
+	bytes = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+	if (bytes > header->dataSize) {
+		return -1;
+	}
+
+	std::vector<EXTENT> extents;
+	while (true) {
+		extents.clear();
+		ENTRY *lru = NULL;
+		for (uint i = 0; i < header->entries; ++ i) {
+			if (entries[i].used && !_IsValid(&entries[i])) {
+				_Evict(&entries[i]);
+			} else if (entries[i].used) {
+				EXTENT extent = {entries[i].offset, (entries[i].bytes + ALIGN - 1) / ALIGN * ALIGN};
+				extents.push_back(extent);
+				if (lru == NULL || entries[i].lastUse < lru->lastUse) {
+					lru = &entries[i];
+				}
+			}
+		}
+
+		// the first gap large enough
+		std::sort(extents.begin(), extents.end());
+		uint64 offset = 0;
+		for (std::vector<EXTENT>::iterator it = extents.begin(); it != extents.end(); ++ it) {
+			if (it->offset >= offset && it->offset - offset >= bytes) {
+				return (int64)offset;
+			}
+			if (it->offset + it->bytes > offset) {
+				offset = it->offset + it->bytes;
+			}
+		}
+		if (offset <= header->dataSize && header->dataSize - offset >= bytes) {
+			return (int64)offset;
+		}
+
+		if (lru == NULL) {
+			assert(false);
+			return -1;
+		}
+		_Evict(lru);
+	}
+}
+
+CRenditionCache::ENTRY* CRenditionCache::_FreeEntry () {
+	ENTRY *entries = _Entries();
+	ENTRY *lru = NULL;
+	for (uint i = 0; i < _Header()->entries; ++ i) {
+		if (!entries[i].used) {
+			return &entries[i];
+		} else if (lru == NULL || entries[i].lastUse < lru->lastUse) {
+			lru = &entries[i];
+		}
+	}
+	if (lru != NULL) {
+		_Evict(lru);
+	}
+	return lru;
+}
+
+void CRenditionCache::_Evict (ENTRY *entry) {
+	assert(entry->used);
+	entry->used = 0;
+	++ m_stats.evictions;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// public methods
+
+CRenditionCache::CRenditionCache ()
+	: m_mutex(NULL)
+	, m_view(NULL)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CRenditionCache::~CRenditionCache () {
+	close();
+}
+
+bool CRenditionCache::open (const tstring &path, uint64 budget, uint entries) {
+	assert(budget > 0 && entries > 0);
+	CScopeLock sl(this);
+	close();
+
+	m_mutex = ::CreateMutex(NULL, FALSE, _MutexName(path).c_str());
+	if (m_mutex == NULL) {
+		return false;
+	}
+	if (!_Lock()) {
+		close();
+		return false;
+	}
+
+	uint64 dataOffset = (sizeof(HEADER) + (uint64)entries * sizeof(ENTRY) + 4095) / 4096 * 4096;
+	bool result = m_file.openShared(path, dataOffset + budget);
+	if (result) {
+		m_view = (uint8 *)m_file.map();
+		result = m_view != NULL;
+	}
+	if (result) {
+		HEADER *header = _Header();
+		uint64 size = m_file.getSize();
+		bool valid = header->magic == MAGIC && header->version == VERSION && header->entries > 0
+			&& sizeof(HEADER) + (uint64)header->entries * sizeof(ENTRY) <= header->dataOffset
+			&& header->dataOffset <= size && header->dataSize <= size - header->dataOffset;
+		if (!valid) {
+			memset(m_view, 0, (size_t)dataOffset);
+			header->version = VERSION;
+			header->entries = entries;
+			header->dataOffset = dataOffset;
+			header->dataSize = budget;
+			header->magic = MAGIC;
+		}
+	}
+	_Unlock();
+
+	if (!result) {
+		close();
+	}
+	return result;
+}
+
+void CRenditionCache::close () {
+	CScopeLock sl(this);
+	if (m_view != NULL) {
+		CFileMapping::unmap(m_view);
+		m_view = NULL;
+	}
+	m_file.close();
+	if (m_mutex != NULL) {
+		::CloseHandle(m_mutex);
+		m_mutex = NULL;
+	}
+}
+
+bool CRenditionCache::isOpen () const {
+	CScopeLock sl(this);
+	return m_view != NULL;
+}
+
+bool CRenditionCache::get (const KEY &key, CDIBSection *dib) {
+	assert(dib != NULL);
+	CScopeLock sl(this);
+	if (!isOpen() || !_Lock()) {
+		return false;
+	}
+
+	bool result = false;
+	ENTRY *entry = _Find(key);
+	if (entry != NULL && !_IsValid(entry)) {
+		_Evict(entry);
+		entry = NULL;
+	}
+	if (entry != NULL && dib->create(key.width, key.height, key.bitcount)) {
+		uint len = key.width * (key.bitcount / 8);
+		const uint8 *src = _Data() + entry->offset;
+		for (int y = 0; y < key.height; ++ y) {
+			memcpy(dib->getLine(y), src, len);
+			src += len;
+		}
+		entry->lastUse = ++ _Header()->clock;
+		result = true;
+	}
+	_Unlock();
+
+	if (result) {
+		++ m_stats.hits;
+	} else {
+		++ m_stats.misses;
+	}
+	return result;
+}
+
+bool CRenditionCache::put (const KEY &key, const CDIBSection *dib) {
+	assert(dib != NULL && !dib->isNull());
+	assert(dib->getWidth() == key.width && dib->getHeight() == key.height);
+	assert(dib->getBitCounts() == key.bitcount);
+	CScopeLock sl(this);
+	if (!isOpen() || !_Lock()) {
+		return false;
+	}
+
+	bool result = true;
+	ENTRY *entry = _Find(key);
+	if (entry != NULL && !_IsValid(entry)) {
+		_Evict(entry);
+		entry = NULL;
+	}
+	if (entry != NULL) { // put by another process
+		entry->lastUse = ++ _Header()->clock;
+	} else {
+		uint len = key.width * (key.bitcount / 8);
+		uint64 bytes = (uint64)len * key.height;
+		entry = _FreeEntry();
+		int64 offset = entry != NULL ? _Allocate(bytes) : -1;
+		if (offset >= 0) {
+			uint8 *dst = _Data() + offset;
+			for (int y = 0; y < key.height; ++ y) {
+				memcpy(dst, dib->getLine(y), len);
+				dst += len;
+			}
+
+			entry->hash = key.hash;
+			entry->width = key.width;
+			entry->height = key.height;
+			entry->rt = key.rt;
+			entry->bitcount = key.bitcount;
+			entry->offset = (uint64)offset;
+			entry->bytes = bytes;
+			entry->lastUse = ++ _Header()->clock;
+			MemoryBarrier(); // the pixels and the entry are stored before it is marked
+			entry->used = 1;
+			++ m_stats.puts;
+		} else {
+			result = false;
+		}
+	}
+	_Unlock();
+	return result;
+}
+
+void CRenditionCache::clear () {
+	CScopeLock sl(this);
+	if (!isOpen() || !_Lock()) {
+		return;
+	}
+	memset(_Entries(), 0, _Header()->entries * sizeof(ENTRY));
+	_Unlock();
+}
+
+CDIBSectionPtr CRenditionCache::resize (const CDIBSection *src, int w, int h, CDIBSection::RESIZE_TYPE rt,
+                                        uint64 hash, ILongTimeRunCallback *pCallback) {
+	assert(src != NULL && !src->isNull());
+	if (!isOpen()) {
+		return src->cloneAndResize(w, h, rt, pCallback);
+	}
+
+	KEY key(hash != 0 ? hash : CRenditionCache::hash(src), w, h, rt, src->getBitCounts());
+	CDIBSectionPtr dib(new CDIBSection());
+	if (get(key, dib.get())) {
+		return dib;
+	}
+
+	dib = src->cloneAndResize(w, h, rt, pCallback);
+	if (dib) {
+		put(key, dib.get());
+	}
+	return dib;
+}
+
+CRenditionCache::STATS CRenditionCache::getStats () const {
+	CScopeLock sl(this);
+	STATS stats = m_stats;
+	stats.entries = 0;
+	stats.bytes = 0;
+	if (isOpen() && _Lock()) {
+		const ENTRY *entries = _Entries();
+		for (uint i = 0; i < _Header()->entries; ++ i) {
+			if (entries[i].used) {
+				++ stats.entries;
+				stats.bytes += entries[i].bytes;
+			}
+		}
+		_Unlock();
+	}
+	return stats;
+}
+
+uint64 CRenditionCache::hash (const CDIBSection *dib) {
+	assert(dib != NULL && !dib->isNull());
+	int w = dib->getWidth(), h = dib->getHeight(), bitcount = dib->getBitCounts();
+	uint64 value = _Mix(FNV_OFFSET, ((uint64)w << 32) | (uint)h);
+	value = _Mix(value, (uint64)bitcount);
+
+	uint len = w * (bitcount / 8);
+	for (int y = 0; y < h; ++ y) {
+		const uint8 *p = dib->getLine(y);
+		uint i = 0;
+		for (; i + 8 <= len; i += 8) {
+			uint64 v;
+			memcpy(&v, p + i, 8);
+			value = _Mix(value, v);
+		}
+		for (; i < len; ++ i) {
+			value = _Mix(value, p[i]);
+		}
+	}
+	return value != 0 ? value : 1; // 0 means "not computed" for resize()
+}
+
+UI_END
+XL_END
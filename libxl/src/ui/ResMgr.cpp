@@ -8,26 +8,9 @@
 XL_BEGIN
 UI_BEGIN
 
-///////////////////////////////////////////////////////////
-// private
-
-CResMgr::CResMgr() {
-}
-
-CResMgr::~CResMgr() {
-	reset();
-}
-
-void CResMgr::_Lock() {
-	lock();
-}
-
-void CResMgr::_Unlock() {
-	unlock();
-}
-
+namespace {
 
-HFONT CResMgr::_CreateSysFont(int height, uint style) {
+HFONT _CreateSysFont(int height, uint style) {
 	HFONT font = (HFONT)::GetStockObject(DEFAULT_GUI_FONT);
 	assert (font != NULL);
 	LOGFONT lf;
@@ -41,16 +24,16 @@ HFONT CResMgr::_CreateSysFont(int height, uint style) {
 		height = lf.lfHeight;
 	}
 	lf.lfHeight = height;
-	if (style & FS_BOLD) {
+	if (style & CResMgr::FS_BOLD) {
 		lf.lfWeight = FW_BOLD;
 	}
-	if (style & FS_ITALIC) {
+	if (style & CResMgr::FS_ITALIC) {
 		lf.lfItalic = TRUE;
 	}
-	if (style & FS_UNDERLINE) {
+	if (style & CResMgr::FS_UNDERLINE) {
 		lf.lfUnderline = TRUE;
 	}
-	if (style & FS_STRIKEOUT) {
+	if (style & CResMgr::FS_STRIKEOUT) {
 		lf.lfStrikeOut = TRUE;
 	}
 
@@ -58,30 +41,190 @@ HFONT CResMgr::_CreateSysFont(int height, uint style) {
 	return font;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// the creators of the missing resources, see CShardedMapT::get()
+
+struct FONTCREATOR {
+	int height;
+	uint style;
+
+	FONTCREATOR (int _height, uint _style) : height(_height), style(_style) {}
+	HFONT operator () () const {
+		return _CreateSysFont(height, style);
+	}
+};
+
+struct PENCREATOR {
+	ushort style, width;
+	COLORREF color;
+
+	PENCREATOR (ushort _style, ushort _width, COLORREF _color) : style(_style), width(_width), color(_color) {}
+	HPEN operator () () const {
+		return ::CreatePen(style, width, color);
+	}
+};
+
+struct ICONCREATOR {
+	ushort id;
+
+	ICONCREATOR (ushort _id) : id(_id) {}
+	HICON operator () () const {
+		return ::LoadIcon(::GetModuleHandle(NULL), MAKEINTRESOURCE(id));
+	}
+};
+
+struct BITMAPCREATOR {
+	ushort id;
+	bool grayscale;
+	bool transparent;
+	COLORREF colorKey;
+
+	BITMAPCREATOR (ushort _id, bool _grayscale, bool _transparent = false, COLORREF _colorKey = 0)
+		: id(_id), grayscale(_grayscale), transparent(_transparent), colorKey(_colorKey) {}
+	CBitmapPtr operator () () const {
+		CBitmapPtr bitmap(new CBitmap());
+		if (!bitmap->load(id)) {
+			return CBitmapPtr();
+		}
+		if (transparent) {
+			bitmap->setColorKey(colorKey);
+		}
+		if (grayscale) {
+			bitmap->gray();
+		}
+		return bitmap;
+	}
+};
+
+/**
+ * resized from the bitmap of the original size, or read from the disk cache.
+ * The source is got before, the creators must not get other bitmaps, which
+ * could wait for a creator waiting for this one.
+ */
+struct SIZEDCREATOR {
+	CBitmapPtr src;
+	CRenditionCache *pDiskCache;
+	int width, height;
+	CDIBSection::RESIZE_TYPE rt;
+
+	SIZEDCREATOR (CBitmapPtr _src, CRenditionCache *_pDiskCache, int _width, int _height, CDIBSection::RESIZE_TYPE _rt)
+		: src(_src), pDiskCache(_pDiskCache), width(_width), height(_height), rt(_rt) {}
+	CBitmapPtr operator () () const {
+		CBitmapPtr bitmap(new CBitmap());
+		if (pDiskCache->isOpen()) {
+			CRenditionCache::KEY key(CRenditionCache::hash(src.get()), width, height, rt, src->getBitCounts());
+			if (pDiskCache->get(key, bitmap.get())) {
+				return bitmap;
+			}
+			if (bitmap->create(width, height, src->getBitCounts()) && src->resize(bitmap.get(), rt)) {
+				pDiskCache->put(key, bitmap.get());
+				return bitmap;
+			}
+		} else if (bitmap->create(width, height, src->getBitCounts()) && src->resize(bitmap.get(), rt)) {
+			return bitmap;
+		}
+		return CBitmapPtr();
+	}
+};
+
+/**
+ * loaded into the atlas, the loaded bitmap is dropped
+ */
+struct SPRITECREATOR {
+	CBitmapAtlas *pAtlas;
+	ushort id;
+	bool grayscale;
+	bool transparent;
+	COLORREF colorKey;
+
+	SPRITECREATOR (CBitmapAtlas *_pAtlas, ushort _id, bool _grayscale, bool _transparent = false, COLORREF _colorKey = 0)
+		: pAtlas(_pAtlas), id(_id), grayscale(_grayscale), transparent(_transparent), colorKey(_colorKey) {}
+	CSpritePtr operator () () const {
+		CBitmap bitmap;
+		if (!bitmap.load(id)) {
+			return CSpritePtr();
+		}
+		if (transparent) {
+			bitmap.setColorKey(colorKey);
+		}
+		if (grayscale) {
+			bitmap.gray();
+		}
+		return pAtlas->add(&bitmap, transparent, colorKey);
+	}
+};
+
+/**
+ * 4 classes per power of 2, as CDIBPool
+ */
+uint64 _SizeClass (int size) {
+	assert(size > 0);
+	if (size < 8) {
+		return (uint64)size;
+	}
+	int e = 0;
+	while ((size >> e) >= 8) {
+		++ e;
+	}
+	return (uint64)(e * 4 + (size >> e));
+}
+
+struct FONTDESTROYER {
+	void operator () (HGDIOBJ obj) const {
+		::DeleteObject(obj);
+	}
+};
+
+struct ICONDESTROYER {
+	void operator () (HICON icon) const {
+		::DestroyIcon(icon);
+	}
+};
+
+struct SPRITEDESTROYER {
+	void operator () (CSpritePtr) const {
+	}
+};
+
+}
+
+
+///////////////////////////////////////////////////////////
+// private
+
+CResMgr::CResMgr() {
+}
+
+CResMgr::~CResMgr() {
+	reset();
+}
+
+void CResMgr::_Lock() {
+	lock();
+}
+
+void CResMgr::_Unlock() {
+	unlock();
+}
+
 
 ///////////////////////////////////////////////////////////
 // public
 
 CResMgr* CResMgr::getInstance() {
+	static volatile LONG once = 0;
+	CScopeOnce so(&once);
 	static CResMgr This;
 	return &This;
 }
 
 void CResMgr::reset () {
-	for (_FontMapType::iterator it = m_sysFonts.begin(); it != m_sysFonts.end(); ++ it) {
-		::DeleteObject(it->second);
-	}
-	m_sysFonts.clear();
-
-	for (_PenMapType::iterator it = m_pens.begin(); it != m_pens.end(); ++ it) {
-		::DeleteObject(it->second);
-	}
-	m_pens.clear();
-
-	for (_IconMapType::iterator it = m_icons.begin(); it != m_icons.end(); ++ it) {
-		::DestroyIcon(it->second);
-	}
-	m_icons.clear();
+	m_sysFonts.clear(FONTDESTROYER());
+	m_pens.clear(FONTDESTROYER());
+	m_icons.clear(ICONDESTROYER());
+	m_bitmaps.clear();
+	m_sprites.clear(SPRITEDESTROYER());
+	m_atlas.clear();
 }
 
 HFONT CResMgr::getSysFont (int height, uint style) {
@@ -90,21 +233,7 @@ HFONT CResMgr::getSysFont (int height, uint style) {
 	uint key = height << 16;
 	key |= style;
 
-	HFONT font = NULL;
-	_Lock();
-	// find font
-	_FontMapType::iterator it = m_sysFonts.find(key);
-	if (it == m_sysFonts.end()) {
-		// create font
-		font = _CreateSysFont(height, style);
-		if (font != NULL) {
-			m_sysFonts[key] = font;
-		}
-	} else {
-		font = it->second;
-	}
-	_Unlock();
-	return font;
+	return m_sysFonts.get(key, FONTCREATOR(height, style));
 }
 
 HPEN CResMgr::getPen (ushort style, ushort width, COLORREF color) {
@@ -114,34 +243,11 @@ HPEN CResMgr::getPen (ushort style, ushort width, COLORREF color) {
 	key <<= 32;
 	key |= (uint)color;
 
-	_PenMapType::iterator it = m_pens.find(key);
-	if (it != m_pens.end()) {
-		return it->second;
-	} else {
-		HPEN pen = ::CreatePen(style, width, color);
-		if (pen != NULL) {
-			m_pens[key] = pen;
-			return pen;
-		}
-	}
-
-	return NULL;
+	return m_pens.get(key, PENCREATOR(style, width, color));
 }
 
 HICON CResMgr::getIcon (ushort id) {
-	uint key = id;
-	_IconMapType::iterator it = m_icons.find(key);
-	if (it != m_icons.end()) {
-		return it->second;
-	} else {
-		HICON icon = ::LoadIcon(::GetModuleHandle(NULL), MAKEINTRESOURCE(id));
-		if (icon != NULL) {
-			m_icons[key] = icon;
-			return icon;
-		}
-	}
-
-	return NULL;
+	return m_icons.get(id, ICONCREATOR(id));
 }
 
 CBitmapPtr CResMgr::getBitmap (ushort bmpid, bool grayscale) {
@@ -150,22 +256,26 @@ CBitmapPtr CResMgr::getBitmap (ushort bmpid, bool grayscale) {
 		id |= BMP_GRAY;
 	}
 
-	_BitmapBigMapType::iterator it = m_bitmaps.find(id);
-	if (it != m_bitmaps.end()) {
-		return it->second;
-	} else {
-		CBitmapPtr bitmap(new CBitmap());
-		if (bitmap->load(bmpid)) {
-			if (grayscale) {
-				bitmap->gray();
-			}
+	return m_bitmaps.get(CBitmapCache::BC_BITMAP, id, BITMAPCREATOR(bmpid, grayscale));
+}
 
-			m_bitmaps[id] = bitmap;
-			return bitmap;
-		}
+CBitmapPtr CResMgr::getBitmap (ushort bmpid, int width, int height, CDIBSection::RESIZE_TYPE rt, bool grayscale) {
+	assert(width > 0 && width <= 0xffff && height > 0 && height <= 0xffff);
+	assert(rt >= 0 && rt < CDIBSection::RT_COUNT);
+	CBitmapPtr bitmap = getBitmap(bmpid, grayscale);
+	if (!bitmap || (bitmap->getWidth() == width && bitmap->getHeight() == height)) {
+		return bitmap;
 	}
 
-	return CBitmapPtr();
+	// gray(1) rt(3) id(16) width(16) height(16), and the group has the size classes instead
+	uint64 id = grayscale ? 1 : 0;
+	id = (id << 3) | (uint64)rt;
+	id = (id << 16) | bmpid;
+	uint64 group = id;
+	id = (id << 32) | ((uint64)width << 16) | (uint64)height;
+	group = (group << 32) | (_SizeClass(width) << 16) | _SizeClass(height) | ((uint64)1 << 63);
+
+	return m_bitmaps.get(CBitmapCache::BC_SIZED, id, SIZEDCREATOR(bitmap, &m_diskCache, width, height, rt), group);
 }
 
 CBitmapPtr CResMgr::getTransBitmap (ushort bmpid, COLORREF colorKey, bool grayscale) {
@@ -176,23 +286,46 @@ CBitmapPtr CResMgr::getTransBitmap (ushort bmpid, COLORREF colorKey, bool graysc
 		id |= BMP_GRAY;
 	}
 
-	_BitmapBigMapType::iterator it = m_transBitmaps.find(id);
-	if (it != m_transBitmaps.end()) {
-		return it->second;
-	} else {
-		CBitmapPtr bitmap(new CBitmap());
-		if (bitmap->load(bmpid)) {
-			bitmap->setColorKey(colorKey);
-			if (grayscale) {
-				bitmap->gray();
-			}
+	return m_bitmaps.get(CBitmapCache::BC_TRANS, id, BITMAPCREATOR(bmpid, grayscale, true, colorKey));
+}
 
-			m_transBitmaps[id] = bitmap;
-			return bitmap;
-		}
+CSpritePtr CResMgr::getSprite (ushort bmpid, bool grayscale) {
+	uint64 id = bmpid;
+	if (grayscale) {
+		id |= BMP_GRAY;
 	}
 
-	return CBitmapPtr();
+	return m_sprites.get(id, SPRITECREATOR(&m_atlas, bmpid, grayscale));
+}
+
+CSpritePtr CResMgr::getTransSprite (ushort bmpid, COLORREF colorKey, bool grayscale) {
+	uint64 id = (uint)colorKey;
+	id <<= 32;
+	id |= (uint64)bmpid | BMP_TRANS;
+	if (grayscale) {
+		id |= BMP_GRAY;
+	}
+
+	return m_sprites.get(id, SPRITECREATOR(&m_atlas, bmpid, grayscale, true, colorKey));
+}
+
+void CResMgr::setBitmapBudget (uint64 budget) {
+	m_bitmaps.setBudget(budget);
+}
+
+CBitmapCache::STATS CResMgr::getBitmapStats (CBitmapCache::CATEGORY category) const {
+	return m_bitmaps.getStats(category);
+}
+
+bool CResMgr::setDiskCache (const tstring &path, uint64 budget) {
+	_Lock();
+	bool result = m_diskCache.open(path, budget);
+	_Unlock();
+	return result;
+}
+
+CRenditionCache* CResMgr::getDiskCache () {
+	return &m_diskCache;
 }
 
 
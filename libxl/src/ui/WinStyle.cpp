@@ -111,23 +111,26 @@ void CWinStyle::_Reset () {
 void CWinStyle::_SetStyle (tstring style, bool &relayout, bool &redraw) {
 	relayout = redraw = false;
 	style.trim();
-	ExplodeT<TCHAR>::ValueT styles = explode(_T(";"), style);
+	CSplitter styles(style, _T(";"));
+	tstring_view property;
 
-	for (size_t i = 0; i < styles.size(); ++ i) {
-		tstring property = styles[i];
-		ExplodeT<TCHAR>::ValueT kv = explode(_T(":"), property);
-		assert (kv.size() == 2);
-		kv[0].trim();
-		while (kv[1].replace(_T("  "), _T(" ")) > 0)
+	while (styles.next(property)) {
+		CSplitter kv(property, _T(":"));
+		tstring_view k, v;
+		VERIFY(kv.next(k) && kv.next(v));
+		assert (!kv.next(v));
+		CAtom key(k.trimmed());
+		tstring value(v.trimmed());
+		while (value.replace(_T("  "), _T(" ")) > 0)
 			;
-		kv[1].trim();
-		_ParseProperty(kv[0], kv[1], relayout, redraw);
+		_ParseProperty(key, value, relayout, redraw);
 	}
 }
 
 void CWinStyle::_ParsePosition (tstring value) {
 	value.trim();
-	ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
+	pmr::CLocalArena<256> arena;
+	pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
 	assert(values.size() == 2);
 	values[0].trim();
 	values[1].trim();
@@ -140,7 +143,8 @@ void CWinStyle::_ParseEdge (tstring value, EDGE &edge) {
 	tchar tmp[32];
 	_stprintf(tmp, _T("%d"), EDGE_AUTO);
 	value.replace(_T("auto"), tmp);
-	ExplodeT<TCHAR>::ValueT edges = explode(_T(" "), value);
+	pmr::CLocalArena<256> arena;
+	pmr::ExplodeT<tchar>::ValueT edges = pmr::explode(_T(" "), value, &arena);
 	assert (edges.size() > 0 && edges.size() <= ET_COUNT);
 	if (edges.size() == 1) {
 		int v = _tstoi(edges[0]);
@@ -181,15 +185,16 @@ COLORREF CWinStyle::_ParseColor (tstring value) {
 	return color;
 }
 
-void CWinStyle::_ParseBorder (tstring key, tstring value) {
-	ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
-	if (key == _T("border") || key == _T("border-top") || key == _T("border-right")
-	    || key == _T("border-bottom") || key == _T("border-left")) // border[-top|-right|-bottom|-left]: int[ color[ style]]
+void CWinStyle::_ParseBorder (CAtom key, tstring value) {
+	pmr::CLocalArena<256> arena;
+	pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
+	if (key == KA_BORDER || key == KA_BORDER_TOP || key == KA_BORDER_RIGHT
+	    || key == KA_BORDER_BOTTOM || key == KA_BORDER_LEFT) // border[-top|-right|-bottom|-left]: int[ color[ style]]
 	{
-		EDGETYPE et = key == _T("border") ? ET_ALL : 
-			(key == _T("border-top") ? ET_TOP : 
-			(key == _T("border-right") ? ET_RIGHT :
-			(key == _T("border-bottom") ? ET_BOTTOM : ET_LEFT)));
+		EDGETYPE et = key == KA_BORDER ? ET_ALL : 
+			(key == KA_BORDER_TOP ? ET_TOP : 
+			(key == KA_BORDER_RIGHT ? ET_RIGHT :
+			(key == KA_BORDER_BOTTOM ? ET_BOTTOM : ET_LEFT)));
 		assert(values.size() > 0);
 		values[0].trim();
 		border.setWidth(_tstoi(values[0]), et);
@@ -236,19 +241,20 @@ BACKGROUNDIMAGEPOS_Y CWinStyle::_ParseBackgroundImagePosY (tstring value) {
 	return BGIPY_FILL;
 }
 
-void CWinStyle::_ParseBackground (tstring key, tstring value) {
-	if (key == _T("background")) {
+void CWinStyle::_ParseBackground (CAtom key, tstring value) {
+	if (key == KA_BACKGROUND) {
 		assert(value == _T("none"));
 		background.type = BGT_NONE;
-	} else if (key == _T("background-color")) {
+	} else if (key == KA_BACKGROUND_COLOR) {
 		background.type = BGT_RGB;
 		background.color = _ParseColor(value);
-	} else if (key == _T("background-image-id")) {
+	} else if (key == KA_BACKGROUND_IMAGE_ID) {
 		assert(false); // not supported now
 		background.type = BGT_IMAGE_ID;
 		background.x = BGIPX_FILL;
 		background.y = BGIPY_FILL;
-		ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
+		pmr::CLocalArena<256> arena;
+		pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
 		assert(values.size() > 1);
 		background.id = _tstoi(values[0]);
 		background.url_or_idtype = values[1];
@@ -259,12 +265,13 @@ void CWinStyle::_ParseBackground (tstring key, tstring value) {
 			background.y = _ParseBackgroundImagePosY(values[3]);
 		}
 
-	} else if (key == _T("background-image-url")) {
+	} else if (key == KA_BACKGROUND_IMAGE_URL) {
 		assert(false); // not supported now
 		background.type = BGT_IMAGE_URL;
 		background.x = BGIPX_FILL;
 		background.y = BGIPY_FILL;
-		ExplodeT<TCHAR>::ValueT values = explode(_T(" "), value);
+		pmr::CLocalArena<256> arena;
+		pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), value, &arena);
 		assert(values.size() > 0);
 		background.url_or_idtype = values[0];
 		if (values.size() > 1) {
@@ -279,79 +286,104 @@ void CWinStyle::_ParseBackground (tstring key, tstring value) {
 	}
 }
 
-void CWinStyle::_ParseProperty (const tstring &key, const tstring &value, bool &relayout, bool &redraw) {
-	if (key == _T("width")) {
-		int w = value == _T("fill") ? SIZE_FILL : _tstoi(value);
-		if (w != width) {
-			width = w;
-			relayout = true;
-			redraw = true;
+void CWinStyle::_ParseProperty (CAtom key, const tstring &value, bool &relayout, bool &redraw) {
+	switch (key.getId()) {
+	case KA_WIDTH: {
+			int w = value == _T("fill") ? SIZE_FILL : _tstoi(value);
+			if (w != width) {
+				width = w;
+				relayout = true;
+				redraw = true;
+			}
 		}
-	} else if (key == _T("height")) {
-		int h = value == _T("fill") ? SIZE_FILL : _tstoi(value);
-		if (h != height) {
-			height = h;
-			relayout = true;
-			redraw = true;
+		break;
+	case KA_HEIGHT: {
+			int h = value == _T("fill") ? SIZE_FILL : _tstoi(value);
+			if (h != height) {
+				height = h;
+				relayout = true;
+				redraw = true;
+			}
 		}
-	} else if (key == _T("position")) {
-		POSITION_X _px = px;
-		POSITION_Y _py = py;
-		_ParsePosition(value);
-		if (_px != px || _py != py) {
-			relayout = true;
-			redraw = true;
+		break;
+	case KA_POSITION: {
+			POSITION_X _px = px;
+			POSITION_Y _py = py;
+			_ParsePosition(value);
+			if (_px != px || _py != py) {
+				relayout = true;
+				redraw = true;
+			}
 		}
-	} else if (key == _T("px")) {
-		POSITION_X _px = value == _T("left") ? PX_LEFT : (value == _T("right") ? PX_RIGHT : PX_COUNT);
-		assert (_px != PX_COUNT);
-		if (_px != px) {
-			px = _px;
-			relayout = true;
-			redraw = true;
+		break;
+	case KA_PX: {
+			POSITION_X _px = value == _T("left") ? PX_LEFT : (value == _T("right") ? PX_RIGHT : PX_COUNT);
+			assert (_px != PX_COUNT);
+			if (_px != px) {
+				px = _px;
+				relayout = true;
+				redraw = true;
+			}
 		}
-	} else if (key == _T("py")) {
-		POSITION_Y _py = value == _T("top") ? PY_TOP : (value == _T("bottom")) ? PY_BOTTOM : PY_COUNT;
-		assert (_py != PY_COUNT);
-		if (_py != py) {
-			py = _py;
-			relayout = true;
-			redraw = true;
+		break;
+	case KA_PY: {
+			POSITION_Y _py = value == _T("top") ? PY_TOP : (value == _T("bottom")) ? PY_BOTTOM : PY_COUNT;
+			assert (_py != PY_COUNT);
+			if (_py != py) {
+				py = _py;
+				relayout = true;
+				redraw = true;
+			}
 		}
-	} else if (key == _T("float")) {
-		bool _isfloat = isfloat;
-		if (value == _T("true")) {
-			_isfloat = true;
-		} else if (value == _T("false") || value == _T("none")) {
-			_isfloat = false;
-		} else {
-			assert(false);
+		break;
+	case KA_FLOAT: {
+			bool _isfloat = isfloat;
+			if (value == _T("true")) {
+				_isfloat = true;
+			} else if (value == _T("false") || value == _T("none")) {
+				_isfloat = false;
+			} else {
+				assert(false);
+			}
+			if (_isfloat != isfloat) {
+				isfloat = _isfloat;
+				relayout = true;
+				redraw = true;
+			}
 		}
-		if (_isfloat != isfloat) {
-			isfloat = _isfloat;
-			relayout = true;
-			redraw = true;
-		}
-	} else if (key == _T("margin")) {
+		break;
+	case KA_MARGIN:
 		_ParseEdge(value, margin);
 		relayout = true;
 		redraw = true;
-	} else if (key == _T("padding")) {
+		break;
+	case KA_PADDING:
 		_ParseEdge(value, padding);
 		relayout = true;
 		redraw = true;
-	} else if (key.find(_T("border")) == 0) {
+		break;
+	case KA_BORDER:
+	case KA_BORDER_TOP:
+	case KA_BORDER_RIGHT:
+	case KA_BORDER_BOTTOM:
+	case KA_BORDER_LEFT:
 		_ParseBorder(key, value);
 		relayout = true;
 		redraw = true;
-	} else if (key.find(_T("background")) == 0) {
+		break;
+	case KA_BACKGROUND:
+	case KA_BACKGROUND_COLOR:
+	case KA_BACKGROUND_IMAGE_ID:
+	case KA_BACKGROUND_IMAGE_URL:
 		_ParseBackground(key, value);
 		redraw = true;
-	} else if (key == _T("opacity")) {
+		break;
+	case KA_OPACITY:
 		opacity = _tstoi(value);
 		assert(opacity <= 100 && opacity >= 0);
 		redraw = true;
-	} else if (key == _T("font-weight")) {
+		break;
+	case KA_FONT_WEIGHT:
 		if (value == _T("normal")) {
 			fontweight = FONTW_NORMAL;
 		} else if (value == _T("bold")) {
@@ -360,16 +392,20 @@ void CWinStyle::_ParseProperty (const tstring &key, const tstring &value, bool &
 			assert(false);
 		}
 		redraw = true;
-	} else if (key == _T("font-size")) {
-		int fs = _tstoi(value);
-		if (fs != fontsize) {
-			fontsize = fs;
-			redraw = true;
+		break;
+	case KA_FONT_SIZE: {
+			int fs = _tstoi(value);
+			if (fs != fontsize) {
+				fontsize = fs;
+				redraw = true;
+			}
 		}
-	} else if (key == _T("color")) {
+		break;
+	case KA_COLOR:
 		color = _ParseColor(value);
 		redraw = true;
-	} else if (key == _T("display")) {
+		break;
+	case KA_DISPLAY:
 		if (value == _T("true")) {
 			display = true;
 		} else if (value == _T("false") || value == _T("none")) {
@@ -378,7 +414,8 @@ void CWinStyle::_ParseProperty (const tstring &key, const tstring &value, bool &
 			assert(false);
 		}
 		redraw = true;
-	} else if (key == _T("disable")) {
+		break;
+	case KA_DISABLE:
 		if (value == _T("true")) {
 			disable = true;
 		} else if (value == _T("false")) {
@@ -387,11 +424,12 @@ void CWinStyle::_ParseProperty (const tstring &key, const tstring &value, bool &
 			assert(false);
 		}
 		redraw = true;
-	} else {
+		break;
+	default:
 		assert(false);
+		break;
 	}
 }
 
-
 UI_END
 XL_END
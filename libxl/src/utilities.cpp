@@ -1,6 +1,7 @@
 #include <assert.h>
 
 #include <Windows.h>
+#include <intrin.h>
 
 #include "../include/utilities.h"
 
@@ -9,72 +10,54 @@ XL_BEGIN
 //////////////////////////////////////////////////////////////////////////
 // trace
 
-void trace (const tchar *format, ...) {
-	va_list args;
-	int     len;
-	tchar  *buffer, *bufferex;
-	tchar   buf[MAX_PATH];
-	tchar   bufex[MAX_PATH];
-	tstring formatex;
-
-	va_start(args, format);
-
-	len = _vsctprintf(format, args) + 32;
-	if (len > MAX_PATH) {
-		buffer = (tchar *)malloc(len * sizeof(tchar));
-		bufferex = (tchar *)malloc(len * sizeof(tchar));
-	} else {
-		buffer = buf;
-		bufferex = bufex;
-	}
-	assert(buffer);
-	_vstprintf_s(buffer, len, format, args);
-	_stprintf_s(bufferex, len, _T("%d(tid:%d):\t%s"), ::GetTickCount(), ::GetCurrentThreadId(), buffer);
+namespace {
 
-	OutputDebugString(bufferex);
+void _Trace (const tchar *format, const CFormatArg *const *args, size_t count) {
+	CStringBuilderT<tchar, MAX_PATH> sb;
+	sb.appendUInt(::GetTickCount());
+	sb.append(_T("(tid:"), 5);
+	sb.appendUInt(::GetCurrentThreadId());
+	sb.append(_T("):\t"), 3);
+	format_args(sb, format, args, count);
+	OutputDebugString(sb.c_str());
+}
 
-	if (buffer != buf) {
-		free(buffer);
-	}
-	if (bufferex != bufex) {
-		free(bufferex);
-	}
 }
 
+#define XL_TRACE_DEFINE(n) \
+	void trace (const tchar *format XL_FORMAT_PARAMS_##n) { \
+		XL_FORMAT_ARGS_##n; \
+		_Trace(format, args + 1, n); \
+	}
+XL_FORMAT_OVERLOADS(XL_TRACE_DEFINE)
+#undef XL_TRACE_DEFINE
+
 
 //////////////////////////////////////////////////////////////////////////
 // CTimerLogger
 
-void CTimerLogger::_Init (const tchar *format, va_list args) {
-	int     len;
-	tchar  *buffer;
-	tchar   buf[MAX_PATH];
-	tstring formatex;
-
-	len = _vsctprintf(format, args) + 1;
-	if (len > MAX_PATH) {
-		buffer = (tchar *)malloc(len * sizeof(tchar));
-	} else {
-		buffer = buf;
-	}
-	assert(buffer);
-	_vstprintf_s(buffer, len, format, args);
-
-	m_msg = buffer;
-
-	if (buffer != buf) {
-		free(buffer);
-	}
+void CTimerLogger::_Init (const tchar *format, const CFormatArg *const *args, size_t count) {
+	CStringBuilderT<tchar, MAX_PATH> sb;
+	format_args(sb, format, args, count);
+	m_msg.clear();
+	sb.appendTo(m_msg);
 }
 
-CTimerLogger::CTimerLogger (const tchar *format, ...) 
-	: m_logged(false)
-	, m_tick(::GetTickCount())
-{
-	va_list args;
-	va_start(args, format);
-	_Init(format, args);
-}
+#define XL_TIMER_LOGGER_DEFINE(n) \
+	CTimerLogger::CTimerLogger (const tchar *format XL_FORMAT_PARAMS_##n) \
+		: m_logged(false) \
+		, m_tick(::GetTickCount()) \
+	{ \
+		XL_FORMAT_ARGS_##n; \
+		_Init(format, args + 1, n); \
+	} \
+	void CTimerLogger::restart (const tchar *format XL_FORMAT_PARAMS_##n) { \
+		m_logged = false; \
+		XL_FORMAT_ARGS_##n; \
+		_Init(format, args + 1, n); \
+	}
+XL_FORMAT_OVERLOADS(XL_TIMER_LOGGER_DEFINE)
+#undef XL_TIMER_LOGGER_DEFINE
 
 CTimerLogger::~CTimerLogger () {
 	log();
@@ -85,17 +68,10 @@ void CTimerLogger::log () {
 		m_logged = true;
 
 		m_tick = ::GetTickCount() - m_tick;
-		trace(_T("%s: %dms\n"), m_msg.c_str(), m_tick);
+		trace(_T("%s: %ums\n"), m_msg, m_tick);
 	}
 }
 
-void CTimerLogger::restart (const tchar *format, ...) {
-	m_logged = false;
-	va_list args;
-	va_start(args, format);
-	_Init(format, args);
-}
-
 
 //////////////////////////////////////////////////////////////////////////
 // CScopeLock
@@ -127,6 +103,25 @@ void CScopeLock::unlock () {
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+// CScopeSharedLock
+CScopeSharedLock::CScopeSharedLock (const CReadWriteLock *lock) : m_lock(lock) {
+	assert(lock != NULL);
+	lock->lockShared();
+}
+
+CScopeSharedLock::~CScopeSharedLock () {
+	unlock();
+}
+
+void CScopeSharedLock::unlock () {
+	if (m_lock) {
+		m_lock->unlockShared();
+		m_lock = NULL;
+	}
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 // OS Version
 #ifdef WIN32
@@ -146,4 +141,42 @@ bool os_is_vista_or_later () {
 #endif
 
 
+//////////////////////////////////////////////////////////////////////////
+// CPU Features
+namespace {
+	/**
+	 * cpuid(1), [0] is ecx, [1] is edx
+	 */
+	const int* _CpuFeatures () {
+		static volatile LONG once = 0;
+		CScopeOnce so(&once);
+		static int features[2] = {-1, -1};
+		if (features[0] == -1) {
+			int info[4] = {0, 0, 0, 0};
+			__cpuid(info, 0);
+			if (info[0] >= 1) {
+				__cpuid(info, 1);
+			} else {
+				info[2] = info[3] = 0;
+			}
+			features[1] = info[3];
+			features[0] = info[2];
+		}
+		return features;
+	}
+}
+
+bool cpu_has_sse2 () {
+	return (_CpuFeatures()[1] & (1 << 26)) != 0;
+}
+
+bool cpu_has_ssse3 () {
+	return (_CpuFeatures()[0] & (1 << 9)) != 0;
+}
+
+bool cpu_has_sse41 () {
+	return (_CpuFeatures()[0] & (1 << 19)) != 0;
+}
+
+
 XL_END
@@ -0,0 +1,147 @@
+#ifndef UNICODE
+#define UNICODE
+#endif
+#ifndef _UNICODE
+#define _UNICODE
+#endif
+
+#include <iostream>
+#include <map>
+#include <process.h>
+#include "../libxl/include/lockable.h"
+#include "../libxl/include/utilities.h"
+#include "../libxl/include/ui/ResMgr.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc ResMgr.cpp
+// link ResMgr.obj ..\Release\libxl.lib user32.lib gdi32.lib
+//
+// The latency of the hits of CResMgr (fonts, pens) and of CBitmapCache with
+// 1 to 16 readers, against a std::map behind one critical section.
+
+static const int READERS = 16;
+static const int LOOKUPS = 200000;
+static const int KEYS = 64;
+
+static xl::ui::CBitmapCache s_bitmaps;
+static std::map<xl::uint64, xl::ui::CBitmapPtr> s_locked;
+static xl::CUserLock s_lock;
+static volatile LONG s_start = 0;
+
+enum KIND {
+	K_FONT,
+	K_PEN,
+	K_BITMAP,
+	K_LOCKED_MAP,
+	K_COUNT
+};
+static const char *s_names[] = {"getSysFont", "getPen", "CBitmapCache", "map + lock"};
+
+struct STUB {
+	xl::ui::CBitmapPtr operator () () const {
+		return xl::ui::CBitmapPtr();
+	}
+};
+
+struct READER {
+	KIND kind;
+	int seed;
+	double ns;      // per lookup
+};
+
+static unsigned __stdcall reader (void *param) {
+	READER *r = (READER *)param;
+	xl::ui::CResMgr *pResMgr = xl::ui::CResMgr::getInstance();
+	while (s_start == 0) {
+		::Sleep(0);
+	}
+
+	LARGE_INTEGER freq, begin, end;
+	::QueryPerformanceFrequency(&freq);
+	::QueryPerformanceCounter(&begin);
+	int found = 0;
+	for (int i = 0; i < LOOKUPS; ++ i) {
+		int key = (i + r->seed) % KEYS;
+		switch (r->kind) {
+		case K_FONT:
+			found += pResMgr->getSysFont(-12 - key % 8, key / 8 % 4) != NULL;
+			break;
+		case K_PEN:
+			found += pResMgr->getPen(PS_SOLID, 1, RGB(key, 0, 0)) != NULL;
+			break;
+		case K_BITMAP:
+			found += s_bitmaps.get(xl::ui::CBitmapCache::BC_BITMAP, key, STUB()) ? 1 : 0;
+			break;
+		case K_LOCKED_MAP: {
+				xl::CScopeLock sl(&s_lock);
+				found += s_locked.find(key)->second ? 1 : 0;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	::QueryPerformanceCounter(&end);
+	r->ns = (double)(end.QuadPart - begin.QuadPart) * 1e9 / freq.QuadPart / LOOKUPS;
+	return found == LOOKUPS ? 0 : 1;
+}
+
+static double run (KIND kind, int readers) {
+	READER params[READERS];
+	HANDLE threads[READERS];
+	s_start = 0;
+	for (int i = 0; i < readers; ++ i) {
+		params[i].kind = kind;
+		params[i].seed = i * 7;
+		threads[i] = (HANDLE)_beginthreadex(NULL, 0, reader, &params[i], 0, NULL);
+	}
+	::InterlockedExchange(&s_start, 1);
+	::WaitForMultipleObjects(readers, threads, TRUE, INFINITE);
+
+	double ns = 0;
+	for (int i = 0; i < readers; ++ i) {
+		DWORD code = 0;
+		::GetExitCodeThread(threads[i], &code);
+		if (code != 0) {
+			std::cout << "missing resources!" << std::endl;
+		}
+		::CloseHandle(threads[i]);
+		ns += params[i].ns;
+	}
+	return ns / readers;
+}
+
+#ifdef IN_IDE
+int test_resmgr(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+	std::cout << "slim read write lock: " << (xl::CReadWriteLock::isSlim() ? "yes" : "no") << std::endl;
+
+	// warm up, every lookup below is a hit
+	xl::ui::CResMgr *pResMgr = xl::ui::CResMgr::getInstance();
+	for (int key = 0; key < KEYS; ++ key) {
+		pResMgr->getSysFont(-12 - key % 8, key / 8 % 4);
+		pResMgr->getPen(PS_SOLID, 1, RGB(key, 0, 0));
+		xl::ui::CBitmapPtr bitmap(new xl::ui::CBitmap());
+		bitmap->create(16, 16, 32);
+		s_bitmaps.insert(xl::ui::CBitmapCache::BC_BITMAP, key, bitmap);
+		s_locked[key] = bitmap;
+	}
+
+	std::cout << "ns per hit, readers:\t1\t2\t4\t8\t16" << std::endl;
+	for (int kind = 0; kind < K_COUNT; ++ kind) {
+		std::cout << s_names[kind];
+		for (int readers = 1; readers <= READERS; readers *= 2) {
+			std::cout << "\t" << (int)(run((KIND)kind, readers) + 0.5);
+		}
+		std::cout << std::endl;
+	}
+
+	xl::ui::CBitmapCache::STATS stats = s_bitmaps.getStats(xl::ui::CBitmapCache::BC_BITMAP);
+	std::cout << "bitmaps: " << stats.entries << " entries, " << stats.hits << " hits, "
+		<< stats.misses << " misses" << std::endl;
+	pResMgr->reset();
+	return 0;
+}
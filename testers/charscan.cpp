@@ -0,0 +1,188 @@
+#include <iostream>
+#include <vector>
+#include "../libxl/include/CharScan.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc charscan.cpp
+// link charscan.obj ..\Release\libxl.lib
+//
+// The scan_xxx_of() kernels (SSE2 compare, SSSE3 lookup, the wide compare
+// and the scalar tails) against a plain loop: every length up to a few
+// vectors, every alignment in a vector, and a match at every position, so
+// at the block boundaries and in the tail too.
+
+static const size_t MAX_LENGTH = 80;
+static const size_t ALIGNMENTS = 16;
+
+/**
+ * the sets of each kernel: up to 4 bytes compared, 5 and more looked up
+ * (SSSE3), more than 16 looked up or scanned by the scalar table, the high
+ * bytes test the sign bit of pshufb
+ */
+static const char *s_sets[] = {
+	" ",
+	" \t",
+	" \t\r\n",
+	" \t\r\n=",
+	"[];#=\"' \t\r\n&*.,:",
+	"abcdefghijklmnopqrstuvwxyz0123456789",
+	"\x80\xff\x7f\x01",
+	"\x80\xff\x7f\x01\x90\xa0",
+};
+
+/**
+ * the wide sets, up to 8 compared, more scanned; some fillers share the low
+ * byte of a character of the set
+ */
+static const wchar_t *s_wideSets[] = {
+	L" ",
+	L" \t\r\n",
+	L" \t\r\n=;#\x4e2d",
+	L" \t\r\n=;#\x4e2d[]",
+	L"\xff\x100\xfffe",
+};
+
+template <class CharT>
+static size_t ref_first (const CharT *s, size_t n, const CharT *set, size_t setLength, bool of) {
+	for (size_t i = 0; i < n; ++ i) {
+		bool in = std::char_traits<CharT>::find(set, setLength, s[i]) != NULL;
+		if (in == of) {
+			return i;
+		}
+	}
+	return (size_t)-1;
+}
+
+template <class CharT>
+static size_t ref_last (const CharT *s, size_t n, const CharT *set, size_t setLength, bool of) {
+	for (size_t i = n; i > 0; -- i) {
+		bool in = std::char_traits<CharT>::find(set, setLength, s[i - 1]) != NULL;
+		if (in == of) {
+			return i - 1;
+		}
+	}
+	return (size_t)-1;
+}
+
+/**
+ * s[0, n) of the kernels against the loops, in the four directions
+ */
+template <class CharT>
+static bool check (const CharT *s, size_t n, const CharT *set, size_t setLength) {
+	return xl::scan_first_of(s, n, set, setLength) == ref_first(s, n, set, setLength, true)
+		&& xl::scan_first_not_of(s, n, set, setLength) == ref_first(s, n, set, setLength, false)
+		&& xl::scan_last_of(s, n, set, setLength) == ref_last(s, n, set, setLength, true)
+		&& xl::scan_last_not_of(s, n, set, setLength) == ref_last(s, n, set, setLength, false);
+}
+
+/**
+ * in: a string of fillers (not in the set) with one character of the set,
+ * out: a string of the set with one filler, at each position, and none at all
+ */
+template <class CharT>
+static bool test_set (const CharT *set, size_t setLength, const CharT *fillers, size_t fillerLength) {
+	std::vector<CharT> buffer(MAX_LENGTH + ALIGNMENTS);
+	for (size_t align = 0; align < ALIGNMENTS; ++ align) {
+		CharT *s = &buffer[align];
+		for (size_t n = 0; n <= MAX_LENGTH; ++ n) {
+			for (size_t pos = 0; pos <= n; ++ pos) {
+				for (size_t i = 0; i < n; ++ i) {
+					s[i] = fillers[(i + align) % fillerLength];
+				}
+				if (pos < n) {
+					s[pos] = set[(pos + n) % setLength];
+				}
+				if (!check(s, n, set, setLength)) {
+					std::cout << "in: length " << n << ", align " << align << ", match " << pos << std::endl;
+					return false;
+				}
+
+				for (size_t i = 0; i < n; ++ i) {
+					s[i] = set[(i + align) % setLength];
+				}
+				if (pos < n) {
+					s[pos] = fillers[(pos + n) % fillerLength];
+				}
+				if (!check(s, n, set, setLength)) {
+					std::cout << "out: length " << n << ", align " << align << ", filler " << pos << std::endl;
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * the 256 values not in the set, so the fillers cover both halves of the lookup
+ */
+static std::vector<char> fillers_of (const char *set, size_t setLength) {
+	std::vector<char> fillers;
+	for (int c = 0; c < 256; ++ c) {
+		if (std::char_traits<char>::find(set, setLength, (char)c) == NULL) {
+			fillers.push_back((char)c);
+		}
+	}
+	return fillers;
+}
+
+static std::vector<wchar_t> fillers_of (const wchar_t *set, size_t setLength) {
+	static const wchar_t candidates[] = {
+		L'a', L'\x120', L'\x4e0d', L'\x2d', L'\x4e20', L'\xff00', L'\x1ff', L'\xfeff', L'0', L'\x7f'
+	};
+	std::vector<wchar_t> fillers;
+	for (size_t i = 0; i < COUNT_OF(candidates); ++ i) {
+		if (std::char_traits<wchar_t>::find(set, setLength, candidates[i]) == NULL) {
+			fillers.push_back(candidates[i]);
+		}
+	}
+	return fillers;
+}
+
+
+#ifdef IN_IDE
+int test_charscan(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+	int failed = 0;
+
+	std::cout << "1. test scan_xxx_of(char)..." << std::endl;
+	for (int i = 0; i < COUNT_OF(s_sets); ++ i) {
+		size_t setLength = std::char_traits<char>::length(s_sets[i]);
+		std::vector<char> fillers = fillers_of(s_sets[i], setLength);
+		std::cout << "set of " << setLength << " ";
+		if (test_set(s_sets[i], setLength, &fillers[0], fillers.size())) {
+			std::cout << "succeed!" << std::endl;
+		} else {
+			std::cout << "failed!" << std::endl;
+			++ failed;
+		}
+	}
+
+	std::cout << "2. test scan_xxx_of(wchar_t)..." << std::endl;
+	for (int i = 0; i < COUNT_OF(s_wideSets); ++ i) {
+		size_t setLength = std::char_traits<wchar_t>::length(s_wideSets[i]);
+		std::vector<wchar_t> fillers = fillers_of(s_wideSets[i], setLength);
+		std::cout << "set of " << setLength << " ";
+		if (test_set(s_wideSets[i], setLength, &fillers[0], fillers.size())) {
+			std::cout << "succeed!" << std::endl;
+		} else {
+			std::cout << "failed!" << std::endl;
+			++ failed;
+		}
+	}
+
+	std::cout << "3. test an empty set..." << std::endl;
+	const char *s = "abc";
+	if (xl::scan_first_of(s, 3, "", 0) == (size_t)-1 && xl::scan_first_not_of(s, 3, "", 0) == 0
+	    && xl::scan_last_of(s, 3, "", 0) == (size_t)-1 && xl::scan_last_not_of(s, 3, "", 0) == 2) {
+		std::cout << "succeed!" << std::endl;
+	} else {
+		std::cout << "failed!" << std::endl;
+		++ failed;
+	}
+
+	return failed;
+}
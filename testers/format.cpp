@@ -0,0 +1,214 @@
+#include <iostream>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <tchar.h>
+#include "../libxl/include/Format.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc format.cpp
+// link format.obj ..\Release\libxl.lib
+//
+// format() against _stprintf_s() for the conversions of the numbers, with
+// every flag, width and precision. The floating points are compared to 15
+// significant digits, and with no tie exact in binary (rounded away from zero
+// by format(), maybe to even by printf()). What the CRT prints otherwise
+// (the strings, "%c", inf and nan, "%F"...) is compared to fixed results.
+
+static const TCHAR *s_flags[] = {
+	_T(""), _T("-"), _T("+"), _T(" "), _T("#"), _T("0"), _T("-+"), _T("+0"), _T("#0"), _T("- "), _T("-#0")
+};
+static const TCHAR *s_widths[] = {_T(""), _T("1"), _T("8"), _T("30")};
+static const TCHAR *s_precisions[] = {_T(""), _T(".0"), _T(".1"), _T(".3"), _T(".6"), _T(".10")};
+
+static const int s_ints[] = {0, 1, -1, 42, -1234567, INT_MAX, INT_MIN};
+static const unsigned int s_uints[] = {0, 1, 8, 0xbeef, 0x80000000u, UINT_MAX};
+static const __int64 s_int64s[] = {0, -1, 1234567890123LL, LLONG_MAX, LLONG_MIN};
+static const double s_doubles[] = {
+	0.0, -0.0, 1.0, -1.0, 0.1, -0.3, 2.0 / 3, 123.456, 9.9999996, 0.000123456, 0.0001, 0.00001,
+	99999.95, 999999.4, 1e15, 123456789.0, 1e100, -1e-100, 9223372036854775808.0, 1e19, DBL_MAX, DBL_MIN
+};
+
+static int s_failed = 0;
+static int s_count = 0;
+
+template <class T>
+static void check (const TCHAR *format, T value) {
+	TCHAR expected[512];
+	_stprintf_s(expected, COUNT_OF(expected), format, value);
+	xl::tstring result = xl::format(format, value);
+	++ s_count;
+	if (result != expected) {
+		++ s_failed;
+		std::wcout << L"failed! " << format << L": " << xl::ts2ws(result).c_str()
+			<< L" but expect " << xl::ts2ws(expected).c_str() << std::endl;
+	}
+}
+
+/**
+ * "%<flags><width><precision><length><conversion>"
+ */
+static xl::tstring spec (size_t flag, size_t width, size_t precision, const TCHAR *conversion) {
+	xl::tstring s = _T("%");
+	s += s_flags[flag];
+	s += s_widths[width];
+	s += s_precisions[precision];
+	s += conversion;
+	return s;
+}
+
+/**
+ * the significant digits printed, of a finite value
+ */
+static int significant (double value, TCHAR conversion, int precision) {
+	if (precision < 0) {
+		precision = 6;
+	}
+	if (conversion == _T('e') || conversion == _T('E')) {
+		return precision + 1;
+	} else if (conversion == _T('g') || conversion == _T('G')) {
+		return precision;
+	}
+	int exponent = value == 0 ? 0 : (int)floor(log10(fabs(value)));
+	return (exponent > 0 ? exponent + 1 : 1) + precision;
+}
+
+static void test_integers () {
+	static const TCHAR *conversions[] = {_T("d"), _T("i"), _T("u"), _T("x"), _T("X"), _T("o")};
+	for (size_t f = 0; f < COUNT_OF(s_flags); ++ f) {
+		for (size_t w = 0; w < COUNT_OF(s_widths); ++ w) {
+			for (size_t p = 0; p < COUNT_OF(s_precisions); ++ p) {
+				for (size_t c = 0; c < COUNT_OF(conversions); ++ c) {
+					xl::tstring s = spec(f, w, p, conversions[c]);
+					if (c < 2) {
+						for (size_t i = 0; i < COUNT_OF(s_ints); ++ i) {
+							check(s.c_str(), s_ints[i]);
+						}
+					} else {
+						for (size_t i = 0; i < COUNT_OF(s_uints); ++ i) {
+							check(s.c_str(), s_uints[i]);
+						}
+					}
+				}
+				xl::tstring s = spec(f, w, p, _T("lld"));
+				for (size_t i = 0; i < COUNT_OF(s_int64s); ++ i) {
+					check(s.c_str(), s_int64s[i]);
+				}
+				s = spec(f, w, p, _T("llx"));
+				for (size_t i = 0; i < COUNT_OF(s_int64s); ++ i) {
+					check(s.c_str(), (unsigned __int64)s_int64s[i]);
+				}
+			}
+		}
+	}
+}
+
+static void test_doubles () {
+	static const TCHAR *conversions[] = {_T("f"), _T("e"), _T("E"), _T("g"), _T("G")};
+	static const int precisions[] = {-1, 0, 1, 3, 6, 10};
+	for (size_t f = 0; f < COUNT_OF(s_flags); ++ f) {
+		for (size_t w = 0; w < COUNT_OF(s_widths); ++ w) {
+			for (size_t p = 0; p < COUNT_OF(s_precisions); ++ p) {
+				for (size_t c = 0; c < COUNT_OF(conversions); ++ c) {
+					xl::tstring s = spec(f, w, p, conversions[c]);
+					for (size_t i = 0; i < COUNT_OF(s_doubles); ++ i) {
+						// the large "%f" are all the digits of the double, exact
+						bool large = conversions[c][0] == _T('f') && fabs(s_doubles[i]) >= 9223372036854775808.0;
+						if (large || significant(s_doubles[i], conversions[c][0], precisions[p]) <= 15) {
+							check(s.c_str(), s_doubles[i]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+struct FIXED_CASE {
+	const TCHAR    *expected;
+	xl::tstring   (*format)();
+};
+
+// the format() of each fixed case, as the arguments are of several types
+#define FIXED_FORMAT(name, fmt, arg) \
+	static xl::tstring name () { return xl::format(_T(fmt), arg); }
+FIXED_FORMAT(f_tie, "%.0f", 2.5)
+FIXED_FORMAT(f_tie2, "%.2f", 0.125)
+FIXED_FORMAT(f_tie3, "%.1e", 0.125)
+FIXED_FORMAT(g_round, "%g", 999999.5)
+FIXED_FORMAT(g_round2, "%g", 9.9999996)
+FIXED_FORMAT(g_round3, "%.3g", 0.00099996)
+FIXED_FORMAT(g_alternate, "%#g", 1.0)
+FIXED_FORMAT(f_upper, "%F", 1.5)
+FIXED_FORMAT(f_large, "%.1f", 1e22)
+FIXED_FORMAT(f_inf, "%f", HUGE_VAL)
+FIXED_FORMAT(f_minf, "%+8f", -HUGE_VAL)
+FIXED_FORMAT(e_inf, "%E", HUGE_VAL)
+FIXED_FORMAT(s_width, "[%5s]", "ab")
+FIXED_FORMAT(s_left, "[%-5s]", L"ab")
+FIXED_FORMAT(s_precision, "[%.1s]", "ab")
+FIXED_FORMAT(s_null, "%s", (const char *)NULL)
+FIXED_FORMAT(s_int, "%s", 42)
+FIXED_FORMAT(c_char, "[%3c]", 'x')
+FIXED_FORMAT(c_int, "%c", 65)
+FIXED_FORMAT(d_double, "%d", -3.9)
+FIXED_FORMAT(f_int, "%.1f", 3)
+#undef FIXED_FORMAT
+static xl::tstring percent () { return xl::format(_T("100%%")); }
+
+static const FIXED_CASE s_fixed[] = {
+	{_T("3"), f_tie},
+	{_T("0.13"), f_tie2},
+	{_T("1.3e-01"), f_tie3},
+	{_T("1e+06"), g_round},
+	{_T("10"), g_round2},
+	{_T("0.001"), g_round3},
+	{_T("1.00000"), g_alternate},
+	{_T("1.500000"), f_upper},
+	{_T("10000000000000000000000.0"), f_large},
+	{_T("inf"), f_inf},
+	{_T("    -inf"), f_minf},
+	{_T("INF"), e_inf},
+	{_T("[   ab]"), s_width},
+	{_T("[ab   ]"), s_left},
+	{_T("[a]"), s_precision},
+	{_T("(null)"), s_null},
+	{_T("42"), s_int},
+	{_T("[  x]"), c_char},
+	{_T("A"), c_int},
+	{_T("-3"), d_double},
+	{_T("3.0"), f_int},
+	{_T("100%"), percent},
+};
+
+
+#ifdef IN_IDE
+int test_format(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+#if defined(_MSC_VER) && _MSC_VER < 1900
+	_set_output_format(_TWO_DIGIT_EXPONENT); // "1e+006" otherwise
+#endif
+	std::cout << "1. test the integers..." << std::endl;
+	test_integers();
+	std::cout << "2. test the floating points..." << std::endl;
+	test_doubles();
+	std::cout << s_count - s_failed << " of " << s_count << " succeed!" << std::endl;
+
+	std::cout << "3. test the fixed results..." << std::endl;
+	for (int i = 0; i < COUNT_OF(s_fixed); ++ i) {
+		xl::tstring result = s_fixed[i].format();
+		if (result != s_fixed[i].expected) {
+			std::wcout << L"failed! " << xl::ts2ws(result).c_str()
+				<< L" but expect " << xl::ts2ws(s_fixed[i].expected).c_str() << std::endl;
+			++ s_failed;
+		}
+	}
+	if (s_failed == 0) {
+		std::cout << "succeed!" << std::endl;
+	}
+	return s_failed;
+}
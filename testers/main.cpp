@@ -3,6 +3,13 @@
 int test_sharedptr(int argc, char **argv);
 int test_ini(int argc, char **argv);
 int test_registry(int argc, char **argv);
+int test_resmgr(int argc, char **argv);
+int test_trim(int argc, char **argv);
+int test_charscan(int argc, char **argv);
+int test_unicode(int argc, char **argv);
+int test_stringbuilder(int argc, char **argv);
+int test_format(int argc, char **argv);
+int test_memoryresource(int argc, char **argv);
 
 
 
@@ -11,6 +18,13 @@ int main(int argc, char **argv) {
 	// test_sharedptr(argc, argv);
 	// test_ini(argc, argv);
 	test_registry(argc, argv);
+	// test_resmgr(argc, argv);
+	// test_trim(argc, argv);
+	// test_charscan(argc, argv);
+	// test_unicode(argc, argv);
+	// test_stringbuilder(argc, argv);
+	// test_format(argc, argv);
+	// test_memoryresource(argc, argv);
 	return 0;
 }
 
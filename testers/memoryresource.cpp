@@ -0,0 +1,337 @@
+#include <iostream>
+#include <string.h>
+#include <vector>
+#include "../libxl/include/MemoryResource.h"
+#include "../libxl/include/fs.h"
+#include "../libxl/include/ini.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc memoryresource.cpp
+// link memoryresource.obj ..\Release\libxl.lib
+//
+// The resources over an upstream which counts what it gives: the alignment
+// and the blocks of the arena, release(), the size classes and the large
+// blocks of the pool, the allocator, the strings built with one (and copied
+// to a tstring, as the callers of CIni do), then a CIni in an arena.
+
+using namespace xl;
+
+/**
+ * new_delete_resource(), counted
+ */
+class CCountingResource : public pmr::IMemoryResource
+{
+public:
+	int                                                   allocs;
+	int                                                   frees;
+	size_t                                                live;  // the bytes not freed
+
+	CCountingResource () : allocs(0), frees(0), live(0) {}
+
+	virtual void* allocate (size_t bytes, size_t alignment) {
+		++ allocs;
+		live += bytes;
+		return pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	virtual void deallocate (void *p, size_t bytes, size_t alignment) {
+		++ frees;
+		live -= bytes;
+		pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+};
+
+static bool aligned (void *p, size_t alignment) {
+	return ((size_t)p & (alignment - 1)) == 0;
+}
+
+static bool test_arena_alignment () {
+	CCountingResource upstream;
+	pmr::CLocalArena<256> arena(&upstream);
+	std::vector<char *> blocks;
+	std::vector<size_t> sizes;
+	for (int i = 0; i < 200; ++ i) {
+		// odd sizes, so the next one is misaligned unless it is aligned up
+		size_t alignment = (size_t)1 << (i % 5);
+		size_t size = 1 + i % 13;
+		char *p = (char *)arena.allocate(size, alignment);
+		if (!aligned(p, alignment)) {
+			return false;
+		}
+		memset(p, i & 0xff, size);
+		blocks.push_back(p);
+		sizes.push_back(size);
+	}
+	// none overlaps another
+	for (size_t i = 0; i < blocks.size(); ++ i) {
+		for (size_t j = 0; j < sizes[i]; ++ j) {
+			if (blocks[i][j] != (char)(i & 0xff)) {
+				return false;
+			}
+		}
+	}
+	return upstream.allocs > 0;
+}
+
+static bool test_arena_growth () {
+	CCountingResource upstream;
+	{
+		pmr::CMonotonicArena arena(64, &upstream);
+		for (int i = 0; i < 1000; ++ i) {
+			arena.allocate(24);
+		}
+		// each block twice as large as the last, 24000 bytes are a few blocks
+		if (upstream.allocs > 12) {
+			return false;
+		}
+		// larger than the next block, a block of its own
+		int allocs = upstream.allocs;
+		size_t live = upstream.live;
+		arena.allocate(1024 * 1024);
+		if (upstream.allocs != allocs + 1 || upstream.live < live + 1024 * 1024) {
+			return false;
+		}
+	}
+	return upstream.live == 0 && upstream.allocs == upstream.frees;
+}
+
+static bool test_arena_release () {
+	CCountingResource upstream;
+	char buffer[128];
+	pmr::CMonotonicArena arena(buffer, sizeof(buffer), &upstream);
+	void *first = arena.allocate(16);
+	if (first != buffer || upstream.allocs != 0) {
+		return false;
+	}
+	for (int i = 0; i < 100; ++ i) {
+		arena.allocate(100);
+	}
+	if (upstream.allocs == 0) {
+		return false;
+	}
+	arena.release();
+	if (upstream.live != 0 || upstream.allocs != upstream.frees) {
+		return false;
+	}
+	// from the buffer again, then from new blocks
+	if (arena.allocate(16) != buffer) {
+		return false;
+	}
+	arena.allocate(1000);
+	return upstream.live > 0 && arena.getUpstream() == &upstream;
+}
+
+static bool test_pool_classes () {
+	CCountingResource upstream;
+	{
+		pmr::CPoolResource pool(&upstream);
+		for (size_t size = 1; size <= pmr::CPoolResource::MAX_POOLED; ++ size) {
+			void *p = pool.allocate(size, 8);
+			if (!aligned(p, 8)) {
+				return false;
+			}
+			pool.deallocate(p, size, 8);
+			// the sizes of a class share its blocks: 8, 16, 32...
+			size_t classSize = pmr::CPoolResource::MIN_POOLED;
+			while (classSize < size) {
+				classSize <<= 1;
+			}
+			void *q = pool.allocate(classSize, 8);
+			pool.deallocate(q, classSize, 8);
+			if (q != p) {
+				return false;
+			}
+		}
+		// an alignment larger than the size takes the class of the alignment
+		void *p = pool.allocate(1, pmr::DEFAULT_ALIGNMENT);
+		if (!aligned(p, pmr::DEFAULT_ALIGNMENT)) {
+			return false;
+		}
+		pool.deallocate(p, 1, pmr::DEFAULT_ALIGNMENT);
+
+		// the freed blocks come back, no more chunks
+		std::vector<void *> blocks;
+		for (int i = 0; i < 500; ++ i) {
+			blocks.push_back(pool.allocate(1 + i % 512));
+		}
+		for (int i = 0; i < 500; ++ i) {
+			pool.deallocate(blocks[i], 1 + i % 512);
+		}
+		int allocs = upstream.allocs;
+		for (int i = 0; i < 500; ++ i) {
+			blocks[i] = pool.allocate(1 + i % 512);
+		}
+		if (upstream.allocs != allocs) {
+			return false;
+		}
+	}
+	return upstream.live == 0 && upstream.allocs == upstream.frees;
+}
+
+static bool test_pool_large () {
+	CCountingResource upstream;
+	pmr::CPoolResource pool(&upstream);
+	const size_t sizes[] = {513, 1000, 5000, 100000};
+	char *blocks[COUNT_OF(sizes)];
+	for (int i = 0; i < COUNT_OF(sizes); ++ i) {
+		blocks[i] = (char *)pool.allocate(sizes[i]);
+		memset(blocks[i], i, sizes[i]);
+	}
+	if (upstream.allocs != COUNT_OF(sizes)) {
+		return false;
+	}
+
+	// unlinked from the middle, the head and the tail, given back at once
+	const int order[] = {1, 3, 0};
+	for (int i = 0; i < COUNT_OF(order); ++ i) {
+		size_t live = upstream.live;
+		pool.deallocate(blocks[order[i]], sizes[order[i]]);
+		if (upstream.live >= live - sizes[order[i]] + 1) {
+			return false;
+		}
+	}
+	if (upstream.frees != COUNT_OF(order) || blocks[2][0] != 2 || blocks[2][4999] != 2) {
+		return false;
+	}
+
+	// release() frees the one left
+	pool.allocate(1);
+	pool.release();
+	return upstream.live == 0 && upstream.allocs == upstream.frees;
+}
+
+static bool test_allocator () {
+	CCountingResource upstream;
+	pmr::CPoolResource pool(&upstream);
+	pmr::CAllocator<int> a(&pool);
+	pmr::CAllocator<double> b(a);
+	if (a != b || a == pmr::CAllocator<int>(&upstream) || b.getResource() != &pool) {
+		return false;
+	}
+
+	// constructed without a resource, the default one
+	pmr::IMemoryResource *previous = pmr::set_default_resource(&upstream);
+	bool result = pmr::CAllocator<int>().getResource() == &upstream
+		&& pmr::CAllocator<int>(NULL).getResource() == &upstream;
+	pmr::set_default_resource(previous);
+	if (!result || pmr::get_default_resource() != previous) {
+		return false;
+	}
+
+	pmr::vector<int>::type v(a);
+	pmr::map<int, int>::type m(std::less<int>(), a);
+	for (int i = 0; i < 1000; ++ i) {
+		v.push_back(i);
+		m[i] = i * 2;
+	}
+	return v[999] == 999 && m[999] == 1998 && upstream.allocs > 0 && v.get_allocator() == a;
+}
+
+static bool test_strings () {
+	CCountingResource upstream;
+	{
+		pmr::CMonotonicArena arena(&upstream);
+		pmr::CAllocator<tchar> a(&arena);
+		const tchar *text = _T("a string longer than the small buffer");
+		size_t length = tstring(text).length();
+
+		pmr::tstring s1(a);
+		s1 = text;
+		pmr::tstring s2(text, length, a);
+		pmr::tstring s3(text, a);
+		pmr::tstring s4(length, _T('x'), a);
+		pmr::tstring s5(tstring_view(text, length), a);
+		if (s1 != text || s2 != text || s3 != text || tstring(s4) != tstring(length, _T('x')) || s5 != text) {
+			return false;
+		}
+		if (s2.get_allocator().getResource() != &arena || s5.get_allocator().getResource() != &arena) {
+			return false;
+		}
+
+		// a copy of another allocator, from the default one
+		tstring t = s3;
+		tstring u(s5);
+		if (t != text || u != text) {
+			return false;
+		}
+		pmr::ExplodeT<tchar>::ValueT values = pmr::explode(_T(" "), text, &arena);
+		if (values.size() != 7 || tstring(values[6]) != _T("buffer")) {
+			return false;
+		}
+	}
+	return upstream.live == 0 && upstream.allocs > 0;
+}
+
+static bool test_ini () {
+	tstring file = _T("memoryresource.ini");
+	std::string data = "[s]\r\nk=v ; comment\r\nn=1\r\n";
+	if (file_put_contents(file, data) != (int)data.length()) {
+		return false;
+	}
+
+	CCountingResource upstream;
+	{
+		pmr::CMonotonicArena arena(&upstream);
+		CIni ini(file, &arena);
+		if (upstream.allocs == 0) {
+			return false;
+		}
+		// the keys and the values to tstring, as the callers copy them
+		int count = 0;
+		for (CIni::Iterator it = ini.begin(_T("s")); it != ini.end(_T("s")); ++ it) {
+			tstring name = it->first;
+			tstring value = it->second.substr(0, it->second.find(_T(';')));
+			if ((name != _T("k") || value != _T("v ")) && (name != _T("n") || value != _T("1"))) {
+				return false;
+			}
+			++ count;
+		}
+		ini.set(_T("s"), _T("n"), _T("2"));
+		ini.set(_T("new"), _T("k"), _T("w"));
+		if (count != 2 || ini.get(_T("s"), _T("n")) != _T("2") || !ini.get(_T("none"), _T("k")).empty()) {
+			return false;
+		}
+		ini.write();
+	}
+	if (upstream.live != 0) {
+		return false;
+	}
+
+	// read again, with the default resource
+	CIni ini(file);
+	return ini.get(_T("s"), _T("k")) == _T("v ; comment") && ini.get(_T("s"), _T("n")) == _T("2")
+		&& ini.get(_T("new"), _T("k")) == _T("w");
+}
+
+
+#ifdef IN_IDE
+int test_memoryresource(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+	struct {
+		const char  *name;
+		bool       (*test)();
+	} tests[] = {
+		{"1. test the alignment of the arena...", test_arena_alignment},
+		{"2. test the blocks of the arena...", test_arena_growth},
+		{"3. test release() of the arena...", test_arena_release},
+		{"4. test the size classes of the pool...", test_pool_classes},
+		{"5. test the large blocks of the pool...", test_pool_large},
+		{"6. test CAllocator...", test_allocator},
+		{"7. test the strings with an allocator...", test_strings},
+		{"8. test CIni in an arena...", test_ini},
+	};
+
+	int failed = 0;
+	for (int i = 0; i < COUNT_OF(tests); ++ i) {
+		std::cout << tests[i].name << std::endl;
+		if (tests[i].test()) {
+			std::cout << "succeed!" << std::endl;
+		} else {
+			std::cout << "failed!" << std::endl;
+			++ failed;
+		}
+	}
+	return failed;
+}
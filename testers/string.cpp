@@ -49,6 +49,27 @@ static const char *trimresults[] = {
 	"",
 };
 
+static const char *lrtrims[] = {
+	"  abc  ",
+	"abc  ",
+	"  abc",
+	"    ",
+};
+
+static const char *ltrimresults[] = {
+	"abc  ",
+	"abc  ",
+	"abc",
+	"",
+};
+
+static const char *rtrimresults[] = {
+	"  abc",
+	"abc",
+	"  abc",
+	"",
+};
+
 static const char *charlist = "\t&* .";
 static const char *multitrims[] = {
 	"\t&*abc***.",
@@ -109,5 +130,22 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	std::cout << "4. test ltrim(), rtrim() and trimmed_view()..." << std::endl;
+	for (int i = 0; i < COUNT_OF(lrtrims); ++ i) {
+		xl::string l = lrtrims[i], r = lrtrims[i], v = lrtrims[i];
+		l.ltrim();
+		r.rtrim();
+		if (l == ltrimresults[i] && r == rtrimresults[i]
+		    && xl::string(v.ltrimmed_view()) == ltrimresults[i]
+		    && xl::string(v.rtrimmed_view()) == rtrimresults[i]
+		    && xl::string(v.trimmed_view()) == trimresults[i < 3 ? 0 : 4]
+		    && v == lrtrims[i])
+		{
+			std::cout << "trim " << lrtrims[i] << " succeed!" << std::endl;
+		} else {
+			std::cout << "trim " << lrtrims[i] << " failed!" << std::endl;
+		}
+	}
+
 	return 0;
 }
\ No newline at end of file
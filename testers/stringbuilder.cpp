@@ -0,0 +1,187 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <limits.h>
+#include "../libxl/include/StringBuilder.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc stringbuilder.cpp
+// link stringbuilder.obj ..\Release\libxl.lib
+//
+// CStringBuilderT against a std::string built alongside: the appends across
+// the end of the stack buffer and of the blocks, c_str() (which joins the
+// blocks) and the chunks. Then the number appenders and format_double().
+
+/**
+ * a small stack buffer, so the blocks come soon
+ */
+typedef xl::CStringBuilderT<char, 16> CSmallBuilder;
+
+static std::string joined (const CSmallBuilder &sb) {
+	std::vector<CSmallBuilder::Chunk> chunks;
+	sb.getChunks(chunks);
+	std::string s;
+	for (size_t i = 0; i < chunks.size(); ++ i) {
+		if (chunks[i].length == 0) {
+			return "<an empty chunk>";
+		}
+		s.append(chunks[i].data, chunks[i].length);
+	}
+	return s;
+}
+
+static bool test_growth () {
+	CSmallBuilder sb;
+	std::string expected;
+	for (int i = 0; i < 1000; ++ i) {
+		// one character, then a run longer than the room left
+		char c = (char)('a' + i % 26);
+		sb.append(c);
+		expected += c;
+		if (i % 7 == 0) {
+			std::string run(i % 40, c);
+			sb.append(run.data(), run.length());
+			expected += run;
+		}
+		if (sb.length() != expected.length()) {
+			return false;
+		}
+	}
+	// each block as large as all before, so a few blocks only
+	if (sb.getChunkCount() > 16) {
+		return false;
+	}
+	std::string s;
+	sb.appendTo(s);
+	return s == expected && sb.str() == expected && joined(sb) == expected;
+}
+
+static bool test_c_str () {
+	CSmallBuilder sb;
+	std::string expected;
+	// exactly the stack buffer, then one more
+	sb.append("0123456789abcdef", 16);
+	expected = "0123456789abcdef";
+	if (expected != sb.c_str()) {
+		return false;
+	}
+	for (int i = 0; i < 10; ++ i) {
+		sb.append(100, (char)('A' + i));
+		expected.append(100, (char)('A' + i));
+	}
+	if (sb.getChunkCount() < 3 || expected != sb.c_str()) {
+		return false;
+	}
+	// joined into one block, still appendable
+	sb.append("xyz");
+	expected += "xyz";
+	if (expected != sb.c_str() || joined(sb) != expected) {
+		return false;
+	}
+	sb.clear();
+	return sb.empty() && std::string(sb.c_str()).empty() && joined(sb).empty();
+}
+
+static bool test_chunks () {
+	CSmallBuilder sb;
+	std::vector<CSmallBuilder::Chunk> chunks;
+	if (sb.getChunks(chunks) != 0) {
+		return false;
+	}
+	// a first append larger than the stack buffer fills it, the rest goes to a block
+	std::string big(40, 'x');
+	sb.append(big.data(), big.length());
+	if (joined(sb) != big) {
+		return false;
+	}
+	sb.append("y");
+	size_t count = sb.getChunks(chunks);
+	return count == chunks.size() && count <= sb.getChunkCount() && joined(sb) == big + "y";
+}
+
+static bool test_numbers () {
+	xl::CStringBuilderA sb;
+	sb.appendInt(0).append(' ').appendInt(-1).append(' ').appendInt(LLONG_MIN).append(' ').appendInt(LLONG_MAX);
+	sb.append(' ').appendUInt(ULLONG_MAX);
+	sb.append(' ').appendHex(0xbeef).append(' ').appendHex(0xbeef, 8, true).append(' ').appendHex(0, 0);
+	return sb.str() == "0 -1 -9223372036854775808 9223372036854775807 18446744073709551615 beef 0000BEEF 0";
+}
+
+struct DOUBLE_CASE {
+	double      value;
+	int         precision;
+	const char *expected;
+};
+
+/**
+ * the ties which are exact in binary are rounded away from zero, printf()
+ * may round them to even
+ */
+static const DOUBLE_CASE s_doubles[] = {
+	{0.0, 0, "0"},
+	{0.0, 6, "0.000000"},
+	{-0.0, 2, "-0.00"},
+	{0.125, 2, "0.13"},
+	{0.5, 0, "1"},
+	{2.5, 0, "3"},
+	{-2.5, 0, "-3"},
+	{123456789.125, 2, "123456789.13"},
+	{1.005, 2, "1.00"},                 // 1.00499999999999989...
+	{9.995, 2, "9.99"},                 // 9.99499999999999922...
+	{0.05, 1, "0.1"},                   // 0.05000000000000000277...
+	{0.999999, 2, "1.00"},
+	{9.9999996, 6, "10.000000"},
+	{1.0 / 3, 6, "0.333333"},
+	{2.0 / 3, 0, "1"},
+	{-2.0 / 3, 3, "-0.667"},
+	{1e-7, 17, "0.00000010000000000"},
+	{1e-300, 2, "0.00"},
+	{1e18, 1, "1000000000000000000.0"},
+	{9223372036854774784.0, 0, "9223372036854774784"},
+};
+
+static bool test_doubles () {
+	bool result = true;
+	for (int i = 0; i < COUNT_OF(s_doubles); ++ i) {
+		char buffer[64];
+		size_t n = xl::format_double(s_doubles[i].value, s_doubles[i].precision, buffer);
+		if (std::string(buffer, n) != s_doubles[i].expected) {
+			std::cout << "format_double(" << s_doubles[i].expected << ") gets " << std::string(buffer, n) << std::endl;
+			result = false;
+		}
+	}
+	xl::CStringBuilderW sb;
+	sb.appendFloat(-2.5, 1).append(L' ').appendFloat(0.125);
+	return result && sb.str() == L"-2.5 0.125000";
+}
+
+
+#ifdef IN_IDE
+int test_stringbuilder(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+	struct {
+		const char  *name;
+		bool       (*test)();
+	} tests[] = {
+		{"1. test the growth of the blocks...", test_growth},
+		{"2. test c_str()...", test_c_str},
+		{"3. test getChunks()...", test_chunks},
+		{"4. test the integers...", test_numbers},
+		{"5. test format_double()...", test_doubles},
+	};
+
+	int failed = 0;
+	for (int i = 0; i < COUNT_OF(tests); ++ i) {
+		std::cout << tests[i].name << std::endl;
+		if (tests[i].test()) {
+			std::cout << "succeed!" << std::endl;
+		} else {
+			std::cout << "failed!" << std::endl;
+			++ failed;
+		}
+	}
+	return failed;
+}
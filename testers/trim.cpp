@@ -0,0 +1,121 @@
+#include <iostream>
+#include <memory>
+#include <windows.h>
+#include "../libxl/include/string.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc trim.cpp
+// link trim.obj ..\Release\libxl.lib
+//
+// The allocations and the time per line of trimming the lines of an ini
+// file: a copy trimmed by substr() (as trim() did), a copy trimmed in place
+// by trim(), and a view trimmed by trimmed().
+
+static const int LINES = 100000;
+static const int ROUNDS = 10;
+
+static long s_allocations = 0;
+
+/**
+ * std::allocator which counts the calls of allocate()
+ */
+template <class T>
+struct COUNTING_ALLOCATOR : public std::allocator<T> {
+	template <class U>
+	struct rebind {
+		typedef COUNTING_ALLOCATOR<U> other;
+	};
+
+	COUNTING_ALLOCATOR () {}
+	COUNTING_ALLOCATOR (const COUNTING_ALLOCATOR &) {}
+	template <class U>
+	COUNTING_ALLOCATOR (const COUNTING_ALLOCATOR<U> &) {}
+
+	T* allocate (size_t count, const void * = NULL) {
+		++ s_allocations;
+		return std::allocator<T>::allocate(count);
+	}
+};
+
+typedef xl::basic_string<char, std::char_traits<char>, COUNTING_ALLOCATOR<char> > cstring;
+
+enum KIND {
+	K_SUBSTR,
+	K_IN_PLACE,
+	K_VIEW,
+	K_COUNT
+};
+static const char *s_names[] = {"substr + swap", "trim()", "trimmed()"};
+
+/**
+ * what trim() did before, a new string of the trimmed part swapped in
+ */
+static void trim_by_substr (cstring &line, const char *charlist) {
+	size_t start = line.find_first_not_of(charlist);
+	if (start == cstring::npos) {
+		line.clear();
+		return;
+	}
+	size_t end = line.find_last_not_of(charlist) + 1;
+	cstring tmp = line.substr(start, end - start);
+	std::swap(line, tmp);
+}
+
+static size_t run (KIND kind, const std::string &text, double &ns) {
+	size_t length = 0;
+	cstring line; // reused by every line, as a parser does
+	LARGE_INTEGER freq, begin, end;
+	::QueryPerformanceFrequency(&freq);
+	::QueryPerformanceCounter(&begin);
+	for (int round = 0; round < ROUNDS; ++ round) {
+		xl::CSplitterA lines(text, "\r\n", -1, xl::CSplitterA::SM_LINES);
+		xl::string_view token;
+		while (lines.next(token)) {
+			if (kind == K_VIEW) {
+				length += token.trimmed(" \t").length();
+				continue;
+			}
+			line.assign(token.data(), token.length());
+			if (kind == K_SUBSTR) {
+				trim_by_substr(line, " \t");
+			} else {
+				line.trim(" \t");
+			}
+			length += line.length();
+		}
+	}
+	::QueryPerformanceCounter(&end);
+	ns = (double)(end.QuadPart - begin.QuadPart) * 1e9 / freq.QuadPart / (LINES * ROUNDS);
+	return length;
+}
+
+#ifdef IN_IDE
+int test_trim(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+	std::string text;
+	char buf[128];
+	for (int i = 0; i < LINES; ++ i) {
+		sprintf(buf, "  \tkey_of_the_line_%d = the value of the line %d, long enough to be on the heap\t  \r\n", i, i);
+		text += buf;
+	}
+
+	std::cout << "lines: " << LINES << " x " << ROUNDS << std::endl;
+	std::cout << "allocations per line\tns per line" << std::endl;
+	size_t expected = 0;
+	for (int kind = 0; kind < K_COUNT; ++ kind) {
+		double ns = 0;
+		s_allocations = 0;
+		size_t length = run((KIND)kind, text, ns);
+		if (kind == 0) {
+			expected = length;
+		} else if (length != expected) {
+			std::cout << "different results!" << std::endl;
+		}
+		std::cout << s_names[kind] << "\t" << (double)s_allocations / (LINES * ROUNDS)
+			<< "\t" << (int)(ns + 0.5) << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,168 @@
+#ifndef IN_IDE
+#define UNICODE
+#define _UNICODE
+#endif
+#include <iostream>
+#include <string.h>
+#include "../libxl/include/Unicode.h"
+#include "../libxl/include/string.h"
+#include "../libxl/include/fs.h"
+#include "../libxl/include/ini.h"
+
+//////////////////////////////////////////////////////////////////////////
+// compile:
+// cl -c /EHsc unicode.cpp
+// link unicode.obj ..\Release\libxl.lib
+//
+// The UTF-8 decoder against fixed results: each maximal ill-formed part is
+// one U+FFFD (see "U+FFFD Substitution of Maximal Subparts" of the Unicode
+// standard), overlongs, surrogates and the code points above U+10FFFF are not
+// decoded, a truncated sequence at the end is one U+FFFD. Then the BOMs of CIni.
+
+struct CASE {
+	const char *input;
+	bool        valid;
+	xl::uint    expected[12];     // the code points, 0 ended
+};
+
+static const CASE s_cases[] = {
+	{"", true, {0}},
+	{"abc", true, {'a', 'b', 'c', 0}},
+	{"\xc3\xa9", true, {0xe9, 0}},
+	{"\xe2\x82\xac", true, {0x20ac, 0}},
+	{"\xef\xbf\xbd", true, {0xfffd, 0}},
+	{"\xf0\x9f\x98\x80", true, {0x1f600, 0}},
+	{"\xf4\x8f\xbf\xbf", true, {0x10ffff, 0}},
+	// lone continuation bytes, each one replaced
+	{"a\x80" "b", false, {'a', 0xfffd, 'b', 0}},
+	{"\x80\xbf", false, {0xfffd, 0xfffd, 0}},
+	// overlongs, the lead byte is not a prefix of any well-formed sequence
+	{"\xc0\xaf", false, {0xfffd, 0xfffd, 0}},
+	{"\xc1\xbf", false, {0xfffd, 0xfffd, 0}},
+	{"\xe0\x80\xaf", false, {0xfffd, 0xfffd, 0xfffd, 0}},
+	{"\xf0\x80\x80\xaf", false, {0xfffd, 0xfffd, 0xfffd, 0xfffd, 0}},
+	// surrogates
+	{"\xed\xa0\x80", false, {0xfffd, 0xfffd, 0xfffd, 0}},
+	{"\xed\xbf\xbf", false, {0xfffd, 0xfffd, 0xfffd, 0}},
+	{"\xed\x9f\xbf", true, {0xd7ff, 0}},
+	// above U+10FFFF
+	{"\xf4\x90\x80\x80", false, {0xfffd, 0xfffd, 0xfffd, 0xfffd, 0}},
+	{"\xf5\x80", false, {0xfffd, 0xfffd, 0}},
+	{"\xff", false, {0xfffd, 0}},
+	// truncated, a maximal part is one replacement
+	{"\xe2\x82", false, {0xfffd, 0}},
+	{"\xf0\x9f\x98", false, {0xfffd, 0}},
+	{"\xe2\x82" "a", false, {0xfffd, 'a', 0}},
+	{"\xf0\x9f" "\xe2\x82\xac", false, {0xfffd, 0x20ac, 0}},
+	{"\xc3", false, {0xfffd, 0}},
+	// the example of the Unicode standard (table 3-8)
+	{"\x61\xf1\x80\x80\xe1\x80\xc2\x62\x80\x63\x80\xbf\x64", false,
+		{0x61, 0xfffd, 0xfffd, 0xfffd, 0x62, 0xfffd, 0x63, 0xfffd, 0xfffd, 0x64, 0}},
+};
+
+/**
+ * the ASCII before the case, so it starts in, at the end of, or after an SSE2 block
+ */
+static const size_t s_prefixes[] = {0, 1, 15, 16, 17, 31, 32};
+
+/**
+ * the code points as wchar_t, UTF-16 where wchar_t is 16 bits
+ */
+static xl::wstring to_wide (const xl::uint *codes) {
+	xl::wstring ws;
+	for (; *codes != 0; ++ codes) {
+		xl::uint c = *codes;
+		if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+			ws += (wchar_t)(0xd800 + ((c - 0x10000) >> 10));
+			ws += (wchar_t)(0xdc00 + ((c - 0x10000) & 0x3ff));
+		} else {
+			ws += (wchar_t)c;
+		}
+	}
+	return ws;
+}
+
+static bool test_case (const CASE &c, size_t prefix) {
+	std::string input(prefix, 'x');
+	input += c.input;
+	xl::wstring expected(prefix, L'x');
+	expected += to_wide(c.expected);
+
+	size_t length = xl::utf8_to_wide_length(input.data(), input.length());
+	xl::wstring ws(length + 1, L'#');
+	size_t written = xl::utf8_to_wide(input.data(), input.length(), &ws[0]);
+	ws.resize(written);
+	return length == expected.length() && written == length && ws == expected
+		&& xl::utf8_validate(input.data(), input.length()) == c.valid;
+}
+
+/**
+ * "[s]\r\nk=<value>\r\n" with the BOM, in the encoding of it
+ */
+static bool test_ini (const char *name, const std::string &data, const xl::wstring &value) {
+	xl::tstring file = xl::s2ts(name);
+	if (xl::file_put_contents(file, data) != (int)data.length()) {
+		return false;
+	}
+	xl::CIni ini(file);
+	return xl::ts2ws(ini.get(_T("s"), _T("k"))) == value;
+}
+
+/**
+ * the UTF-16 code units, the BOM first
+ */
+static std::string utf16 (const wchar_t *s, bool bigEndian) {
+	std::string data = bigEndian ? "\xfe\xff" : "\xff\xfe";
+	for (; *s != L'\0'; ++ s) {
+		char high = (char)((*s >> 8) & 0xff), low = (char)(*s & 0xff);
+		data += bigEndian ? high : low;
+		data += bigEndian ? low : high;
+	}
+	return data;
+}
+
+
+#ifdef IN_IDE
+int test_unicode(int argc, char **argv) {
+#else
+int main(int argc, char **argv) {
+#endif
+	int failed = 0;
+
+	std::cout << "1. test utf8_to_wide()..." << std::endl;
+	for (int i = 0; i < COUNT_OF(s_cases); ++ i) {
+		for (int j = 0; j < COUNT_OF(s_prefixes); ++ j) {
+			if (!test_case(s_cases[i], s_prefixes[j])) {
+				std::cout << "case " << i + 1 << " after " << s_prefixes[j] << " ASCII failed!" << std::endl;
+				++ failed;
+			}
+		}
+	}
+	if (failed == 0) {
+		std::cout << "succeed!" << std::endl;
+	}
+
+	std::cout << "2. test the BOM of CIni..." << std::endl;
+	std::string content = "[s]\r\nk=";
+	std::string utf8 = "\xef\xbb\xbf" + content + "\xe2\x82\xac\xc0\xaf" "a\r\n";
+	struct {
+		const char   *name;
+		std::string   data;
+		xl::wstring   value;
+	} inis[] = {
+		{"unicode_utf8.ini", utf8, L"\x20ac\xfffd\xfffd" L"a"},
+		{"unicode_le.ini", utf16(L"[s]\r\nk=\x20ac" L"a\r\n", false), L"\x20ac" L"a"},
+		{"unicode_be.ini", utf16(L"[s]\r\nk=\x20ac" L"a\r\n", true), L"\x20ac" L"a"},
+		{"unicode_none.ini", content + "abc\r\n", L"abc"},
+	};
+	for (int i = 0; i < COUNT_OF(inis); ++ i) {
+		if (test_ini(inis[i].name, inis[i].data, inis[i].value)) {
+			std::cout << inis[i].name << " succeed!" << std::endl;
+		} else {
+			std::cout << inis[i].name << " failed!" << std::endl;
+			++ failed;
+		}
+	}
+
+	return failed;
+}